@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+
+// Intersects two bitmaps, counts the result and finds its first set bit,
+//   server side with BITOP, BITCOUNT and BITPOS, then client side with
+//   Bitmap:
+//     portable  8 bytes at a time, one thread
+//     avx2      32 bytes at a time, one thread (if the CPU has AVX2)
+//     threads   32 or 8 bytes at a time, on every core or [threads]
+// The server side times are how long each command kept the server from
+//   serving anyone else.  Needs a running Redis whose proto-max-bulk-len
+//   allows the values.
+//
+//   rediswraps_bench_bitmap [megabytes] [threads] [host] [port]
+//
+namespace {
+
+std::string const kFirst  = "bench:bitmap:first";
+std::string const kSecond = "bench:bitmap:second";
+std::string const kResult = "bench:bitmap:result";
+
+// Best of this many runs, for the client side kernels.
+constexpr int kRuns = 5;
+
+
+double const Milliseconds(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+}
+
+
+// About one bit in "sparsity" set, at random; none in the first tenth, so
+//   that BITPOS has some way to go.
+std::string const Value(size_t const size, unsigned const sparsity, uint64_t seed) {
+  std::string value(size, '\0');
+
+  for (size_t i = size / 10; i < size; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    uint8_t byte = 0;
+
+    for (int bit = 0; bit < 8; ++bit) {
+      if ((seed >> (bit * 8)) % sparsity == 0) {
+        byte |= 0x80 >> bit;
+      }
+    }
+
+    value[i] = static_cast<char>(byte);
+  }
+
+  return value;
+}
+
+
+void Server(Connection &redis) {
+  auto start = std::chrono::steady_clock::now();
+  redis.Cmd("BITOP", "AND", kResult, kFirst, kSecond);
+  double const bitop = Milliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  int64_t const count = redis.Cmd("BITCOUNT", kResult);
+  double const bitcount = Milliseconds(start);
+
+  start = std::chrono::steady_clock::now();
+  int64_t const position = redis.Cmd("BITPOS", kResult, 1);
+  double const bitpos = Milliseconds(start);
+
+  std::cout <<
+    "server bitop_ms=" << bitop <<
+    " bitcount_ms=" << bitcount <<
+    " bitpos_ms=" << bitpos <<
+    " blocked_ms=" << bitop + bitcount + bitpos <<
+    " count=" << count <<
+    " position=" << position
+  << std::endl;
+}
+
+
+double const Best(std::function<void()> const &run) {
+  double best = 0.0;
+
+  for (int i = 0; i < kRuns; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    run();
+    double const elapsed = Milliseconds(start);
+
+    best = (i == 0) ? elapsed : std::min(best, elapsed);
+  }
+
+  return best;
+}
+
+
+void Client(
+    std::string const &mode,
+    Bitmap const &first,
+    Bitmap const &second,
+    BitmapOptions const &options
+) {
+  Bitmap const left(
+    std::string(first.bytes().begin(), first.bytes().end()), options
+  );
+
+  Bitmap result(options);
+  uint64_t count    = 0;
+  int64_t  position = 0;
+
+  // The copy is part of what BITOP does too.
+  double const bitop = Best([&]() {
+    result = left;
+    result.And(second);
+  });
+
+  double const bitcount = Best([&]() { count = result.Count(); });
+  double const bitpos   = Best([&]() { position = result.Position(true); });
+
+  double const gigabytes = first.size() / 1e9;
+
+  std::cout <<
+    mode <<
+    " and_ms=" << bitop <<
+    " count_ms=" << bitcount <<
+    " position_ms=" << bitpos <<
+    " count_GB/s=" << gigabytes / (bitcount / 1000.0) <<
+    " count=" << count <<
+    " position=" << position
+  << std::endl;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  size_t const megabytes =
+    (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64;
+  size_t const threads =
+    (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+  std::string const host = (argc > 3) ? argv[3] : constants::kDefaultHost;
+  int const port = (argc > 4) ? std::atoi(argv[4]) : constants::kDefaultPort;
+
+  size_t const size = megabytes * 1024 * 1024;
+
+  if (size == 0) {
+    std::cerr << "megabytes must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    Connection redis(host, port);
+
+    if (
+        !Bitmap(Value(size, 4, 1)).Store(redis, kFirst) ||
+        !Bitmap(Value(size, 4, 2)).Store(redis, kSecond)
+    ) {
+      std::cerr << "could not store the bitmaps" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    Server(redis);
+
+    Bitmap first, second;
+
+    auto start = std::chrono::steady_clock::now();
+    bool const loaded = first.Load(redis, kFirst) && second.Load(redis, kSecond);
+    double const load = Milliseconds(start);
+
+    if (!loaded) {
+      std::cerr << "could not load the bitmaps" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout <<
+      "MB=" << megabytes <<
+      " avx2=" << Bitmap::HasAvx2() <<
+      " cores=" << std::thread::hardware_concurrency() <<
+      " load_both_ms=" << load
+    << std::endl;
+
+    BitmapOptions portable;
+    portable.simd    = false;
+    portable.threads = 1;
+
+    BitmapOptions avx2;
+    avx2.threads = 1;
+
+    BitmapOptions parallel;
+    parallel.threads = threads;
+
+    Client("portable", first, second, portable);
+
+    if (Bitmap::HasAvx2()) {
+      Client("avx2", first, second, avx2);
+    }
+
+    Client("threads", first, second, parallel);
+
+    Bitmap result(first);
+    result.And(second);
+
+    start = std::chrono::steady_clock::now();
+    bool const stored = result.Store(redis, kResult);
+
+    std::cout << "store_ms=" << Milliseconds(start) << std::endl;
+
+    redis.Cmd("DEL", kFirst, kSecond, kResult);
+
+    return stored ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+
+// Moves one large value up to Redis and back down, three ways:
+//   string  whole-value SET and GET through std::string
+//   buffer  BlobTransfer from an mmapped file into a preallocated buffer
+//   file    BlobTransfer from file to file
+// Each runs in its own process so that its peak RSS is its own.  Needs a
+//   running Redis whose proto-max-bulk-len allows the value.
+//
+//   rediswraps_bench_blob [megabytes] [chunk KiB] [window] [host] [port]
+//
+namespace {
+
+std::string const kKey = "bench:blob";
+
+struct Config {
+  std::string host;
+  int         port;
+  std::string source;
+  std::string destination;
+  size_t      size;
+  BlobOptions options;
+};
+
+
+double const Seconds(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+}
+
+
+long const PeakRssKiB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_maxrss;
+}
+
+
+void Report(
+    std::string const &mode,
+    Config const &config,
+    double const upload,
+    double const download,
+    std::string const &extra = ""
+) {
+  double const megabytes = config.size / (1024.0 * 1024.0);
+
+  std::cout <<
+    mode <<
+    " MB=" << megabytes <<
+    " upload_MB/s=" << megabytes / upload <<
+    " download_MB/s=" << megabytes / download <<
+    " peak_rss_MiB=" << PeakRssKiB() / 1024.0 <<
+    extra
+  << std::endl;
+}
+
+
+// Maps the source file, as both BlobTransfer modes and the string mode
+//   start from the same bytes on disk.
+char const* MapSource(Config const &config) {
+  int const fd = open(config.source.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  void *const mapped =
+    mmap(nullptr, config.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  return mapped == MAP_FAILED ? nullptr : static_cast<char const*>(mapped);
+}
+
+
+bool const StringMode(Connection &redis, Config const &config) {
+  char const *mapped = MapSource(config);
+
+  if (mapped == nullptr) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // What a caller without BlobTransfer does: build the value, send it.
+  std::string value(mapped, config.size);
+  munmap(const_cast<char*>(mapped), config.size);
+
+  ReplyPtr const set = redis.RawCmd("SET", kKey, value);
+  double const upload = Seconds(start);
+
+  value = std::string();
+  start = std::chrono::steady_clock::now();
+
+  ReplyPtr const get = redis.RawCmd("GET", kKey);
+
+  if (!get || get->type != REDIS_REPLY_STRING || get->len != config.size) {
+    return false;
+  }
+
+  value.assign(get->str, get->len);
+  double const download = Seconds(start);
+
+  Report("string", config, upload, download);
+  return set && set->type != REDIS_REPLY_ERROR;
+}
+
+
+bool const BufferMode(Connection &redis, Config const &config) {
+  char const *mapped = MapSource(config);
+
+  if (mapped == nullptr) {
+    return false;
+  }
+
+  BlobTransfer blobs(redis, config.options);
+
+  auto start = std::chrono::steady_clock::now();
+  bool const uploaded = blobs.Upload(kKey, mapped, config.size);
+  double const upload = Seconds(start);
+
+  munmap(const_cast<char*>(mapped), config.size);
+
+  std::vector<char> buffer(config.size);
+  size_t size;
+
+  start = std::chrono::steady_clock::now();
+  bool const downloaded =
+    blobs.Download(kKey, buffer.data(), buffer.size(), size);
+  double const download = Seconds(start);
+
+  Report(
+    "buffer", config, upload, download,
+    " commands=" + std::to_string(blobs.stats().commands)
+  );
+
+  return uploaded && downloaded && size == config.size;
+}
+
+
+bool const FileMode(Connection &redis, Config const &config) {
+  BlobTransfer blobs(redis, config.options);
+
+  auto start = std::chrono::steady_clock::now();
+  bool const uploaded = blobs.UploadFile(kKey, config.source);
+  double const upload = Seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  bool const downloaded = blobs.DownloadFile(kKey, config.destination);
+  double const download = Seconds(start);
+
+  Report(
+    "file", config, upload, download,
+    " commands=" + std::to_string(blobs.stats().commands)
+  );
+
+  return uploaded && downloaded;
+}
+
+
+void Run(
+    std::string const &mode,
+    std::function<bool const(Connection&, Config const&)> const &bench,
+    Config const &config
+) {
+  pid_t const child = fork();
+
+  if (child == 0) {
+    bool success = false;
+
+    try {
+      Connection redis(config.host, config.port);
+      success = bench(redis, config);
+    }
+    catch (std::exception const &e) {
+      std::cout << mode << " skipped: " << e.what() << std::endl;
+    }
+
+    _exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  int status = 0;
+  waitpid(child, &status, 0);
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    std::cout << mode << " failed" << std::endl;
+  }
+}
+
+
+bool const WriteSource(Config const &config) {
+  std::ofstream file(config.source, std::ios::binary | std::ios::trunc);
+  std::string   block(1024 * 1024, '\0');
+
+  for (size_t i = 0; i < block.size(); ++i) {
+    block[i] = static_cast<char>((i * 2654435761u) >> 24);
+  }
+
+  for (size_t written = 0; written < config.size; written += block.size()) {
+    file.write(block.data(), std::min(block.size(), config.size - written));
+  }
+
+  return static_cast<bool>(file);
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  size_t const megabytes =
+    (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 256;
+
+  Config config;
+  config.size = megabytes * 1024 * 1024;
+
+  if (argc > 2) {
+    config.options.chunk_size = std::strtoul(argv[2], nullptr, 10) * 1024;
+  }
+
+  if (argc > 3) {
+    config.options.window = std::strtoul(argv[3], nullptr, 10);
+  }
+
+  config.host = (argc > 4) ? argv[4] : constants::kDefaultHost;
+  config.port = (argc > 5) ? std::atoi(argv[5]) : constants::kDefaultPort;
+
+  config.source      = "/tmp/rediswraps-bench-blob.in";
+  config.destination = "/tmp/rediswraps-bench-blob.out";
+
+  if (
+      config.size == 0 ||
+      config.options.chunk_size == 0 ||
+      config.options.window == 0
+  ) {
+    std::cerr << "megabytes, chunk size and window must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!WriteSource(config)) {
+    std::cerr << "could not write " << config.source << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout <<
+    "chunk_KiB=" << config.options.chunk_size / 1024 <<
+    " window=" << config.options.window <<
+    " baseline_rss_MiB=" << PeakRssKiB() / 1024.0
+  << std::endl;
+
+  Run("string", StringMode, config);
+  Run("buffer", BufferMode, config);
+  Run("file",   FileMode,   config);
+
+  unlink(config.source.c_str());
+  unlink(config.destination.c_str());
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+
+// Operations per second of each primitive in primitives.hh, one call per
+//   round trip and then [depth] calls per pipeline, over a spread of keys:
+//
+//   rediswraps_bench_primitives [seconds per run] [depth] [host] [port]
+//
+// The lock and semaphore runs count an acquisition and its release as two
+//   operations.
+//
+namespace {
+
+constexpr size_t kKeys = 1024;
+
+using Clock = std::chrono::steady_clock;
+
+// Runs one step at a time, for "seconds"; each step says how many
+//   operations it did.
+using Step = std::function<size_t const(size_t const)>;
+
+
+std::string const Key(std::string const &name, size_t const i) {
+  return "bench:primitives:" + name + ":" + std::to_string(i % kKeys);
+}
+
+
+double const Rate(double const seconds, Step const &step) {
+  auto const start    = Clock::now();
+  auto const deadline = start + std::chrono::duration<double>(seconds);
+
+  size_t operations = 0;
+
+  for (size_t i = 0; Clock::now() < deadline; ++i) {
+    operations += step(i);
+  }
+
+  return operations /
+    std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+void Report(
+    std::string const &name,
+    double const seconds,
+    size_t const depth,
+    Step const &single,
+    Step const &pipelined
+) {
+  std::cout << name << " single_ops/s=" << Rate(seconds, single);
+  std::cout << " pipelined_ops/s=" << Rate(seconds, pipelined)
+    << " depth=" << depth << std::endl;
+}
+
+
+void Delete(Connection &redis, std::string const &name) {
+  Pipeline pipe(redis);
+
+  for (size_t i = 0; i < kKeys; ++i) {
+    pipe.Add("DEL", Key(name, i), primitives::FencedLock::FenceKey(Key(name, i)));
+  }
+
+  pipe.ExecuteRaw();
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  double const seconds = (argc > 1) ? std::atof(argv[1]) : 5.0;
+  size_t const depth   = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 32;
+
+  std::string const host = (argc > 3) ? argv[3] : constants::kDefaultHost;
+  int const port = (argc > 4) ? std::atoi(argv[4]) : constants::kDefaultPort;
+
+  if (seconds <= 0.0 || depth == 0) {
+    std::cerr << "seconds and depth must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    Connection redis(host, port);
+    Pipeline pipe(redis);
+
+    using std::chrono::milliseconds;
+
+    primitives::Decision decision;
+    primitives::Fence fence;
+    primitives::CounterUpdate update;
+    bool done;
+
+    primitives::TokenBucket bucket(redis, 1000.0, 100);
+
+    Report(
+      "token_bucket", seconds, depth,
+      [&](size_t const i) {
+        bucket.Take(Key("bucket", i), decision);
+        return 1;
+      },
+      [&](size_t const i) {
+        for (size_t j = 0; j < depth; ++j) {
+          bucket.AddTake(pipe, Key("bucket", i * depth + j));
+        }
+
+        pipe.ExecuteRaw();
+        return depth;
+      }
+    );
+
+    Delete(redis, "bucket");
+
+    primitives::SlidingWindow window(redis, milliseconds(1000), 100);
+
+    Report(
+      "sliding_window", seconds, depth,
+      [&](size_t const i) {
+        window.Take(Key("window", i), decision);
+        return 1;
+      },
+      [&](size_t const i) {
+        for (size_t j = 0; j < depth; ++j) {
+          window.AddTake(pipe, Key("window", i * depth + j));
+        }
+
+        pipe.ExecuteRaw();
+        return depth;
+      }
+    );
+
+    Delete(redis, "window");
+
+    primitives::FencedLock lock(redis, milliseconds(10000));
+
+    Report(
+      "fenced_lock", seconds, depth,
+      [&](size_t const i) {
+        lock.Acquire(Key("lock", i), "bench", fence);
+        lock.Release(Key("lock", i), "bench", fence.token, done);
+        return 2;
+      },
+      [&](size_t const i) {
+        for (size_t j = 0; j < depth; ++j) {
+          lock.AddAcquire(pipe, Key("lock", i * depth + j), "bench");
+        }
+
+        std::vector<ReplyPtr> const acquired = pipe.ExecuteRaw();
+
+        for (size_t j = 0; j < depth; ++j) {
+          primitives::Parse(acquired[j].get(), fence);
+          lock.AddRelease(pipe, Key("lock", i * depth + j), "bench", fence.token);
+        }
+
+        pipe.ExecuteRaw();
+        return 2 * depth;
+      }
+    );
+
+    Delete(redis, "lock");
+
+    primitives::CappedCounter counter(redis, std::numeric_limits<int64_t>::max());
+
+    Report(
+      "capped_counter", seconds, depth,
+      [&](size_t const i) {
+        counter.Increment(Key("counter", i), update);
+        return 1;
+      },
+      [&](size_t const i) {
+        for (size_t j = 0; j < depth; ++j) {
+          counter.AddIncrement(pipe, Key("counter", i * depth + j));
+        }
+
+        pipe.ExecuteRaw();
+        return depth;
+      }
+    );
+
+    Delete(redis, "counter");
+
+    primitives::LeaseSemaphore semaphore(redis, 4, milliseconds(10000));
+
+    Report(
+      "lease_semaphore", seconds, depth,
+      [&](size_t const i) {
+        semaphore.Acquire(Key("semaphore", i), "bench", decision);
+        semaphore.Release(Key("semaphore", i), "bench", done);
+        return 2;
+      },
+      [&](size_t const i) {
+        for (size_t j = 0; j < depth; ++j) {
+          semaphore.AddAcquire(pipe, Key("semaphore", i * depth + j), "bench");
+        }
+
+        for (size_t j = 0; j < depth; ++j) {
+          semaphore.AddRelease(pipe, Key("semaphore", i * depth + j), "bench");
+        }
+
+        pipe.ExecuteRaw();
+        return 2 * depth;
+      }
+    );
+
+    Delete(redis, "semaphore");
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <rediswraps/sharded.hh>
+using namespace rediswraps;
+
+
+// Cost of routing a key to its shard, for a few ring sizes.
+//
+//   rediswraps_bench_sharded [lookups]
+//
+int main(int const argc, char const *argv[]) {
+  size_t const lookups = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+  std::vector<std::string> keys;
+  keys.reserve(4096);
+
+  for (size_t i = 0; i < 4096; ++i) {
+    keys.push_back("user:" + std::to_string(i * 7919) + ":profile");
+  }
+
+  for (size_t const nodes : {2, 8, 32, 128}) {
+    HashRing ring;
+
+    for (size_t i = 0; i < nodes; ++i) {
+      ring.Add("10.0." + std::to_string(i / 256) + "." +
+        std::to_string(i % 256) + ":6379");
+    }
+
+    size_t checksum = 0;
+    auto const start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < lookups; ++i) {
+      checksum += ring.Locate(keys[i & 4095]);
+    }
+
+    auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start
+    ).count();
+
+    std::cout <<
+      "nodes=" << nodes <<
+      " points=" << nodes * constants::kKetamaPointsPerNode <<
+      " ns/lookup=" << static_cast<double>(elapsed) / lookups <<
+      " (checksum " << checksum << ")"
+    << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
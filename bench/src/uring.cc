@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+
+// The hiredis blocking path against UringDriver on the same connections,
+//   over TCP loopback and a local Unix socket.  Needs a running Redis.
+//
+//   rediswraps_bench_uring [connections] [commands per connection]
+//       [unix socket (default /tmp/redis.sock)] [host] [port]
+//
+#ifdef REDISWRAPS_WITH_IO_URING
+
+namespace {
+
+using Connections = std::vector<std::unique_ptr<Connection>>;
+
+void Report(
+    std::string const &transport,
+    std::string const &path,
+    size_t const commands,
+    std::chrono::steady_clock::time_point const start,
+    std::string const &extra = ""
+) {
+  auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start
+  ).count();
+
+  std::cout <<
+    transport << " " << path <<
+    " commands=" << commands <<
+    " ns/command=" << static_cast<double>(elapsed) / commands <<
+    " commands/s=" << commands * 1e9 / elapsed <<
+    extra
+  << std::endl;
+}
+
+
+void Bench(
+    std::string const &transport,
+    std::function<Connection*()> const &connect,
+    size_t const connections,
+    size_t const depth
+) {
+  Connections conns;
+
+  try {
+    for (size_t i = 0; i < connections; ++i) {
+      conns.emplace_back(connect());
+    }
+  }
+  catch (std::exception const &e) {
+    std::cout << transport << " skipped: " << e.what() << std::endl;
+    return;
+  }
+
+  conns.front()->Cmd("set", "bench:uring", std::string(64, 'x'));
+
+  size_t const commands = connections * depth;
+
+  // 1. One blocking round trip per command.
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < depth; ++i) {
+    for (auto &conn : conns) {
+      conn->RawCmd("get", "bench:uring");
+    }
+  }
+
+  Report(transport, "hiredis", commands, start);
+
+  // 2. Pipelined through hiredis: write every batch, then read them back.
+  start = std::chrono::steady_clock::now();
+
+  std::vector<std::unique_ptr<Pipeline>> pipelines;
+
+  for (auto &conn : conns) {
+    pipelines.emplace_back(new Pipeline(*conn));
+
+    for (size_t i = 0; i < depth; ++i) {
+      pipelines.back()->Add("get", "bench:uring");
+    }
+
+    pipelines.back()->Write();
+  }
+
+  for (auto &pipeline : pipelines) {
+    pipeline->ReadRaw();
+  }
+
+  Report(transport, "hiredis-pipeline", commands, start);
+
+  // 3. The same batches through one io_uring.
+  UringDriver driver;
+  std::vector<size_t> indexes;
+
+  for (auto &conn : conns) {
+    indexes.push_back(driver.Attach(*conn));
+  }
+
+  size_t bytes = 0;
+  start = std::chrono::steady_clock::now();
+
+  for (size_t const index : indexes) {
+    for (size_t i = 0; i < depth; ++i) {
+      driver.Cmd(index, [&bytes](ReplyPtr reply) {
+        bytes += reply ? reply->len : 0;
+      }, "get", "bench:uring");
+    }
+  }
+
+  driver.Run();
+
+  Report(
+    transport, "io_uring", commands, start,
+    " submits=" + std::to_string(driver.stats().submits) +
+    " registered=" + (driver.registered_buffers() ? "yes" : "no") +
+    " (" + std::to_string(bytes) + " bytes)"
+  );
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  size_t const connections =
+    (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64;
+  size_t const depth =
+    (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 256;
+
+  std::string const socket = (argc > 3) ? argv[3] : "/tmp/redis.sock";
+  std::string const host   = (argc > 4) ? argv[4] : constants::kDefaultHost;
+  int const port =
+    (argc > 5) ? std::atoi(argv[5]) : constants::kDefaultPort;
+
+  if (connections == 0 || depth == 0) {
+    std::cerr << "connections and commands must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Bench("tcp", [&]() { return new Connection(host, port); }, connections, depth);
+  Bench("unix", [&]() { return new Connection(socket, "bench"); }, connections, depth);
+
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main() {
+  std::cerr <<
+    "rediswraps was built without io_uring; "
+    "configure with -DREDISWRAPS_WITH_IO_URING=ON." << std::endl;
+
+  return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef REDISWRAPS_BITMAP_HH
+#define REDISWRAPS_BITMAP_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <rediswraps/blob.hh>
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+// What the start and end of a range count, as in BITCOUNT and BITPOS.
+enum class BitUnit { kByte, kBit };
+
+enum class BitOp { kAnd, kOr, kXor };
+
+struct BitmapOptions {
+  // Threads an operation is split over; 0 for one per core.
+  size_t threads = 0;
+
+  // Bytes each thread gets at least, so that small bitmaps aren't split
+  //   into slices that cost more to hand out than to process.
+  size_t min_bytes_per_thread = constants::kBitmapMinBytesPerThread;
+
+  // Use the AVX2 kernels if the CPU has them; false forces the portable
+  //   ones, e.g. to compare the two.
+  bool simd = true;
+
+  // How Load() and Store() move the value.
+  BlobOptions transfer;
+};
+
+
+// Bitmap
+// A Redis bitmap (a string value, bit 0 being the most significant bit of
+//   its first byte) held client side, so that BITOP, BITCOUNT and BITPOS
+//   can run here rather than block the server for as long as they take
+//   over values of many megabytes:
+//
+//   Bitmap active, returning;
+//   active.Load(*redis, "active:2024-05-01");
+//   returning.Load(*redis, "active:2024-05-02");
+//
+//   returning.And(active);
+//   uint64_t const retained = returning.Count();
+//   returning.Store(*redis, "retained:2024-05-02");
+//
+// Load() and Store() go through a BlobTransfer: pipelined GETRANGEs copied
+//   straight into the bitmap's own buffer, and a SET plus APPENDs written
+//   straight from it.  The results match the server's for the same
+//   arguments: operands of different lengths are zero padded, ranges take
+//   negative offsets and are clamped the same way.
+//
+// The kernels work 32 bytes at a time with AVX2 when the CPU has it, which
+//   is checked once at run time, and 8 at a time otherwise.  Bitmaps of at
+//   least twice "min_bytes_per_thread" are split over several threads,
+//   started by each call.
+//
+// Not thread safe, though several threads may read the same bitmap.
+//
+class Bitmap {
+ public:
+  explicit Bitmap(BitmapOptions const &options = {});
+  Bitmap(std::string const &value, BitmapOptions const &options = {});
+
+  // Replaces the bitmap with the value at "key"; a missing key is an empty
+  //   bitmap.  False, leaving the bitmap empty, if the value couldn't be
+  //   read.
+  bool const Load(Connection &conn, std::string const &key);
+
+  // SETs the bitmap as the value at "key", or DELetes "key" if the bitmap
+  //   is empty, as BITOP does.
+  bool const Store(Connection &conn, std::string const &key) const;
+
+  // BITOP AND/OR/XOR with "other" in place: the bitmap grows to the longer
+  //   of the two, and the shorter one counts as zeros past its end.
+  Bitmap& Apply(BitOp const op, Bitmap const &other);
+  Bitmap& And(Bitmap const &other);
+  Bitmap& Or(Bitmap const &other);
+  Bitmap& Xor(Bitmap const &other);
+
+  // BITOP NOT in place.
+  Bitmap& Not();
+
+  // GETBIT and SETBIT; Set() grows the bitmap as needed.
+  bool const Get(uint64_t const offset) const noexcept;
+  void Set(uint64_t const offset, bool const bit = true);
+
+  // BITCOUNT, over the whole bitmap or over [start, end].
+  uint64_t const Count() const;
+  uint64_t const Count(
+      int64_t const start,
+      int64_t const end,
+      BitUnit const unit = BitUnit::kByte
+  ) const;
+
+  // BITPOS: the offset of the first "bit", or -1 if there is none.  As in
+  //   Redis, a search for a 0 that doesn't find one returns the bit past
+  //   the end of the value unless the range was given an end.
+  int64_t const Position(bool const bit) const;
+  int64_t const Position(bool const bit, int64_t const start) const;
+  int64_t const Position(
+      bool const bit,
+      int64_t const start,
+      int64_t const end,
+      BitUnit const unit = BitUnit::kByte
+  ) const;
+
+  uint8_t const* data() const noexcept;
+  size_t const size() const noexcept;
+  std::vector<uint8_t> const& bytes() const noexcept;
+
+  // Whether this process runs the AVX2 kernels when "simd" is set.
+  static bool const HasAvx2() noexcept;
+
+ private:
+  // Turns a range into the bits [first, last] of the bitmap, Redis style;
+  //   false if it is empty.
+  bool const Bits(
+      int64_t start,
+      int64_t end,
+      BitUnit const unit,
+      uint64_t &first,
+      uint64_t &last
+  ) const noexcept;
+
+  int64_t const Find(
+      bool const bit,
+      int64_t const start,
+      int64_t const end,
+      BitUnit const unit,
+      bool const end_given
+  ) const;
+
+  // Set bits in bytes [begin, end).
+  uint64_t const Popcount(size_t const begin, size_t const end) const;
+
+  // The first of bytes [begin, end) that isn't "skip"; "end" if none.
+  size_t const Scan(
+      uint8_t const skip,
+      size_t const begin,
+      size_t const end
+  ) const;
+
+  // How many slices Split() cuts "size" bytes into: one per thread.
+  size_t const Slices(size_t const size) const noexcept;
+
+  // Runs "slice(begin, end, index)" over Slices(size) consecutive slices
+  //   of [0, size), the last on the calling thread.
+  template<typename Slice>
+  void Split(size_t const size, Slice const &slice) const;
+
+  BitmapOptions        options_;
+  bool                 avx2_;
+  std::vector<uint8_t> bytes_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef REDISWRAPS_BLOB_HH
+#define REDISWRAPS_BLOB_HH
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+struct BlobOptions {
+  // Bytes per SET/APPEND or GETRANGE command.
+  size_t chunk_size = constants::kBlobChunkSize;
+
+  // Commands in flight at once: their replies are read while later chunks
+  //   are being sent.
+  size_t window = constants::kBlobWindow;
+
+  // Upload to a temporary key of its own, "{key}.uploading.<unique id>",
+  //   and RENAME it over "key" once complete, so readers never see half a
+  //   value and concurrent uploads of one key never mix.  The hash tag keeps
+  //   both keys in the same cluster slot.
+  bool atomic = true;
+
+  // Time to live of the temporary key, renewed with PEXPIRE as the upload
+  //   goes on: an upload abandoned halfway leaves nothing behind for longer.
+  //   The final key gets no TTL.  0 disables it.
+  std::chrono::milliseconds upload_ttl{constants::kBlobUploadTtlMs};
+};
+
+struct BlobStats {
+  uint64_t bytes    = 0;  // moved by the last transfer
+  size_t   commands = 0;  // sent by the last transfer, STRLEN/RENAME included
+};
+
+
+// BlobTransfer
+// Moves multi-megabyte string values between Redis and memory or files in
+//   fixed size chunks, so neither side ever holds more than a few chunks
+//   of the value on top of its source or destination:
+//
+//   BlobTransfer blobs(*redis);
+//
+//   blobs.UploadFile("features:42", "/data/features-42.bin");
+//   blobs.DownloadFile("features:42", "/tmp/features-42.bin");
+//
+//   std::vector<char> buffer(blobs.Size("features:42"));
+//   size_t size;
+//   blobs.Download("features:42", buffer.data(), buffer.size(), size);
+//
+// Uploads send a SET of the first chunk and APPENDs of the rest.  The
+//   header of each command is written right from the caller's memory
+//   (sendmsg()), so an mmapped file is sent without being copied into
+//   hiredis' output buffer.  UploadFile() does exactly that.
+//
+// Downloads ask for the value's length (STRLEN), then pipeline GETRANGE
+//   commands over consecutive windows of it and copy each reply into the
+//   destination as soon as it arrives.  The value is not read atomically:
+//   if it is shortened meanwhile the download fails, and if it grows only
+//   the first STRLEN bytes are read.
+//
+// All methods return false on failure, after logging why; the connection
+//   is dropped (and reopened by its next command) if it was left with
+//   replies in flight.  Tracing does not see these transfers.
+//
+class BlobTransfer {
+ public:
+  explicit BlobTransfer(Connection &conn, BlobOptions const &options = {});
+
+  bool const Upload(std::string const &key, char const *data, size_t size);
+  bool const UploadFile(std::string const &key, std::string const &path);
+
+  // Length of the value at "key"; 0 if it doesn't exist.
+  size_t const Size(std::string const &key);
+
+  // Fills "buffer" with the value at "key" and sets "size" to its length.
+  //   Fails if it is longer than "capacity", with "size" still set.
+  bool const Download(
+      std::string const &key,
+      char *buffer,
+      size_t const capacity,
+      size_t &size
+  );
+
+  // Creates or truncates the file at "path".
+  bool const DownloadFile(std::string const &key, std::string const &path);
+
+  BlobStats const& stats() const noexcept;
+
+ private:
+  // Receives consecutive pieces of a downloaded value.
+  using Sink = std::function<
+    bool const(char const *data, size_t const size, size_t const offset)
+  >;
+
+  // STRLEN, after Prepare().
+  bool const Length(std::string const &key, size_t &size);
+
+  // GETRANGEs "size" bytes of "key" into "sink"; the connection must have
+  //   been prepared.
+  bool const Fetch(std::string const &key, size_t const size, Sink const &sink);
+
+  // Renames a complete atomic upload over "key", without its TTL.
+  bool const Publish(std::string const &target, std::string const &key);
+
+  // Writes a SET or APPEND of data[0..size) to "key" on the socket; a SET
+  //   with a "ttl" (in milliseconds) gets a PX argument.
+  bool const SendChunk(
+      std::string const &command,
+      std::string const &key,
+      char const *data,
+      size_t const size,
+      int64_t const ttl = 0
+  );
+
+  // Writes a command encoded by Connection::EncodeCmd() on the socket.
+  bool const SendEncoded(std::string const &command);
+
+  // Reads one reply; false if it is missing or an error.  "expected_type"
+  //   of -1 accepts any other type.
+  bool const ReadReply(ReplyPtr &reply, int const expected_type = -1);
+
+  // Makes sure nothing else is in flight on the connection.
+  bool const Prepare();
+
+  bool const Fail(std::string const &what, bool const drop_connection);
+
+  Connection       &conn_;
+  BlobOptions const options_;
+  BlobStats         stats_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef REDISWRAPS_COMMANDS_HH
+#define REDISWRAPS_COMMANDS_HH
+
+#include <string>
+#include <unordered_map>
+
+
+namespace rediswraps {
+class Connection;
+
+// CommandInfo
+// What Redis reports about a command through COMMAND INFO.
+// Key positions are argument indices exactly as Redis reports them, i.e.
+//   argument 0 is the command name itself.  A negative last_key counts back
+//   from the end of the argument list (-1 == the last argument).
+//
+// NOTE
+// Kept out of namespace cmd on purpose: the catch-all comparison templates
+//   declared there for cmd::Response would otherwise be found by ADL on
+//   iterators of any container holding this type.
+//
+struct CommandInfo {
+  bool known       = false;
+  int  arity       = 0;
+  bool readonly    = false;
+  bool write       = false;
+  bool movablekeys = false;
+
+  // Identical calls may reply differently (RANDOMKEY, SRANDMEMBER...):
+  //   the "random" flag, or the "nondeterministic_output" tip since 7.0.
+  bool random = false;
+
+  // May wait for data (BLPOP, XREAD ... BLOCK...): the "blocking" flag
+  //   since 7.0, the @blocking ACL category before.
+  bool blocking = false;
+
+  int  first_key   = 0;
+  int  last_key    = 0;
+  int  key_step    = 0;
+};
+
+// DescribeCommand()
+// Returns the COMMAND INFO metadata of the command named "base".
+// The first lookup of each command name costs one round trip on "conn";
+//   afterward the answer is served from a process-wide cache shared by
+//   every Connection, so lookups are safe from any thread.
+//
+// Unknown commands (and script aliases, which Redis knows nothing about)
+//   come back with known == false.
+//
+CommandInfo const DescribeCommand(Connection &conn, std::string const &base);
+
+// DescribeAllCommands()
+// Fetches the metadata of every command the server knows, in a single
+//   COMMAND round trip on "conn", into "commands" keyed by lowercase name.
+//   DescribeCommand() then serves them from its cache too.  Returns false,
+//   leaving "commands" untouched, if the server could not be asked.
+//
+bool const DescribeAllCommands(
+    Connection &conn,
+    std::unordered_map<std::string, CommandInfo> &commands
+);
+
+// Shorthand for DescribeCommand(conn, base).readonly
+bool const IsReadOnlyCommand(Connection &conn, std::string const &base);
+
+} // namespace rediswraps
+
+#endif
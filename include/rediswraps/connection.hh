@@ -1,7 +1,12 @@
 #ifndef REDISWRAPS_CONNECTION_HH
 #define REDISWRAPS_CONNECTION_HH
 
+#include <array>         // Holds the formatted arguments of each command
+#include <chrono>        // Age of buffered discarded commands
+#include <cstdint>
 #include <deque>         // Holds all the response strings from Redis
+#include <exception>     // Carries a visitor's exception out of hiredis
+#include <functional>    // Holds the visitor of a streamed reply
 #include <memory>        // typedef for std::unique_ptr<Connection>
 #include <mutex>         // for the lock around the static scripts_ map
 #include <string>
@@ -16,21 +21,68 @@ extern "C" {
 }
 
 #include <rediswraps/constants.hh>
+#include <rediswraps/decode.hh>
+#include <rediswraps/log.hh>
 #include <rediswraps/response.hh>
+#include <rediswraps/trace.hh>
 
 
 namespace rediswraps {
-using ResponseQueueType = std::deque<std::string>;
+class Pipeline;
+class PreparedCmd;
+class SingleFlight;
+class UringDriver;
+class HotKeys;
+class CommandRecorder;
+class BlobTransfer;
+class HedgedReads;
+class ReplicationStream;
+
+using ResponseQueueType = std::deque<cmd::Response>;
+
+// Releases a hiredis reply tree when the owning ReplyPtr goes out of scope.
+struct ReplyDeleter {
+  void operator()(redisReply *reply) const noexcept {
+    if (reply != nullptr) {
+      freeReplyObject(reply);
+    }
+  }
+};
+
+using ReplyPtr = std::unique_ptr<redisReply, ReplyDeleter>;
+
+// DiscardStats
+// Outcome of the commands sent with kDiscard (CMD_VOID, CMD_CLEAR), whose
+//   replies are only read back lazily.  See Connection::FlushDiscarded().
+struct DiscardStats {
+  uint64_t sent    = 0;  // commands queued for sending
+  uint64_t replied = 0;  // replies read back, errors included
+  uint64_t errors  = 0;  // error replies, e.g. WRONGTYPE
+  uint64_t lost    = 0;  // replies never read: the connection broke first
+
+  std::string last_error;
+};
 
 class Connection {
  public:
+  // "protocol" 3 switches the connection to RESP3 with HELLO 3, for
+  //   replies typed by Redis itself: maps, sets, doubles, booleans, big
+  //   numbers and verbatim strings (see cmd::Response::Type), plus push
+  //   frames (see OnPush()).  Servers that don't know HELLO (before Redis 6)
+  //   are reported and the connection stays on RESP2; check protocol().
+  //
   Connection(
-      std::string const &host = constants::kDefaultHost,
-      int         const  port = constants::kDefaultPort,
-      std::string const &name = ""
+      std::string const &host     = constants::kDefaultHost,
+      int         const  port     = constants::kDefaultPort,
+      std::string const &name     = "",
+      int         const  protocol = constants::kDefaultProtocol
   );
 
-  Connection(std::string const &socket, std::string const &name = "");
+  Connection(
+      std::string const &socket,
+      std::string const &name     = "",
+      int         const  protocol = constants::kDefaultProtocol
+  );
 
   ~Connection();
 
@@ -45,6 +97,9 @@ class Connection {
   size_t const NumResponses() const noexcept;
   bool   const  IsConnected() const noexcept;
 
+  // Protocol version in use: 2 or 3.
+  int const protocol() const noexcept;
+
   std::string const name()   const noexcept;
   std::string const socket() const noexcept;
   std::string const host()   const noexcept;
@@ -88,6 +143,35 @@ class Connection {
       bool const flush_old_scripts = false
   );
 
+  // LoadScripts()
+  // Bulk version of LoadScriptFromFile() meant for registering many scripts
+  //   at startup.  "path" is either:
+  //
+  //   - a directory, in which case every *.lua file in it is loaded under
+  //     its file name minus the extension.  The keycount is read from a
+  //     "-- keycount: N" comment line in the script (0 if there is none).
+  //
+  //   - a manifest file with one "alias filepath [keycount]" entry per line.
+  //     Relative filepaths are resolved against the manifest's directory;
+  //     blank lines and lines starting with '#' are ignored.
+  //
+  // SHA1 digests are computed locally, one SCRIPT EXISTS finds out which
+  //   scripts Redis already has cached and all the others are sent as a
+  //   single pipeline of SCRIPT LOADs: at most two round trips no matter how
+  //   many scripts there are.  Since the alias registry is shared, every
+  //   Connection can use the new aliases as soon as this returns.
+  //
+  // Aliases that are already registered are left alone unless "reload" is
+  //   set, in which case they are re-pointed at the new script contents.
+  //
+  // Returns false if any script could not be read or loaded.  The others
+  //   are registered regardless.
+  //
+  bool const LoadScripts(std::string const &path, bool const reload = false);
+
+  // Whether a script has been registered under "alias", by any Connection.
+  static bool const HasScript(std::string const &alias);
+
   // Cmd()
   // Sends Redis a command.
   // The first argument is the command itself (e.g. "SETEX") and thus must be a
@@ -119,6 +203,101 @@ class Connection {
   >
   RetType Cmd(std::string const &base, Args&&... args) noexcept;
 
+  // Cmd(container, ...)
+  // Decodes an array reply straight into "out" (see reply::Decode() in
+  //   decode.hh for the supported containers) instead of queueing each
+  //   element as a string.  The response queue is left untouched.
+  //
+  //   std::unordered_map<std::string, int> counters;
+  //   redis->Cmd(counters, "HGETALL", "counters");
+  //
+  //   std::vector<std::pair<std::string, double>> leaders;
+  //   redis->Cmd(leaders, "ZREVRANGE", "scores", 0, 9, "WITHSCORES");
+  //
+  // Returns false if the command failed or its reply doesn't fit "out".
+  //
+  template<typename Container,
+      typename... Args,
+      typename IsDecodableContainer = typename std::enable_if<
+        reply::IsContainer<Container>::value
+      >::type
+  >
+  bool const Cmd(
+      Container &out,
+      std::string const &base,
+      Args&&... args
+  ) noexcept;
+
+  // Cmd(visitor, ...)
+  // Streams the reply instead of materializing it: "visit" is called with
+  //   each element, as a cmd::Response, as soon as the parser reaches it,
+  //   while the rest of the reply may still be in flight.  Nothing is queued
+  //   and no reply tree is built, so even a million-element LRANGE is
+  //   processed in constant client memory.  Nested arrays are flattened, in
+  //   order, just as Cmd() queues them.
+  //
+  // The visitor returns false to stop early.  The remaining elements are
+  //   still read off the connection (they are on their way regardless) but
+  //   are skipped without being converted.  An exception thrown by the
+  //   visitor stops it the same way and is rethrown once the reply has been
+  //   read, so the connection stays usable; if the reply can't be finished,
+  //   the connection is dropped first.
+  //
+  //   long long total = 0;
+  //   redis->Cmd([&total](cmd::Response const &element) {
+  //     total += static_cast<long long>(element);
+  //     return total < 1000000;
+  //   }, "LRANGE", "big", 0, -1);
+  //
+  // Returns false if the command failed (an error reply is printed, not
+  //   visited) or the connection broke partway through.
+  //
+  template<typename Visitor,
+      typename... Args,
+      typename IsElementVisitor = typename std::enable_if<
+        std::is_convertible<
+          typename std::result_of<Visitor&(cmd::Response const&)>::type,
+          bool
+        >::value
+      >::type
+  >
+  bool const Cmd(
+      Visitor &&visit,
+      std::string const &base,
+      Args&&... args
+  );
+
+  // RawCmd()
+  // Same call convention as Cmd() (script aliases included) but the hiredis
+  //   reply tree is handed back untouched instead of being parsed into the
+  //   response queue.  Use it when the nesting of a reply matters, e.g.
+  //   COMMAND INFO or SLOWLOG GET, which Cmd() would flatten.
+  //
+  // Returns nullptr if no reply could be read even after one reconnection.
+  //
+  template<typename... Args>
+  ReplyPtr RawCmd(std::string const &base, Args&&... args);
+
+  // Prepare()
+  // For command shapes issued over and over again, e.g.
+  //
+  //   auto hit = redis->Prepare("hincrby", CMD_PLACEHOLDER, "views", 1);
+  //   for (auto const &id : page_ids) {
+  //     hit.Cmd<CMD_VOID>("stats:" + id);
+  //   }
+  //
+  // The RESP encoding of the command name and of every constant argument is
+  //   done once, here; each PreparedCmd::Cmd() only formats the arguments
+  //   filling in the CMD_PLACEHOLDER slots, in order.
+  //
+  // Script aliases registered through LoadScript*() are bound to their SHA
+  //   and keycount at this point.  Prepare them again after reloading.
+  //
+  // The connection must outlive the returned PreparedCmd.  See prepared.hh.
+  //
+  template<typename... Args>
+  PreparedCmd Prepare(std::string const &base, Args&&... args);
+
   cmd::Response Response(
       bool const pop_response = true,
       bool const from_front   = false
@@ -134,10 +313,73 @@ class Connection {
       bool const from_front   = false
   );
 
+  // OnPush()
+  // Over RESP3, Redis sends "push" frames out of band: client-side caching
+  //   invalidations, pub/sub messages on a connection that also runs
+  //   commands...  They never end up in the response queue.  Instead the
+  //   handler is called with each frame as soon as it is read, which is in
+  //   the middle of some later command waiting for its own reply:
+  //
+  //   redis->OnPush([](redisReply const &frame) {
+  //     std::vector<std::string> invalidated;
+  //     if (frame.elements == 2 &&
+  //         reply::Decode(frame.element[1], invalidated)) {...}
+  //   });
+  //
+  // The frame is freed when the handler returns.  Frames arriving without
+  //   a handler, or in the middle of a streamed Cmd(), are dropped.
+  //
+  using PushHandler = std::function<void(redisReply const &frame)>;
+
+  void OnPush(PushHandler handler);
+
+  // FlushDiscarded()
+  // Commands sent with kDiscard (CMD_VOID, CMD_CLEAR) don't wait for their
+  //   replies.  They are written out as soon as the socket takes them
+  //   without blocking; if it doesn't, they stay buffered and go out with
+  //   the next command, waiting for the socket once the kDiscardMax* limits
+  //   in constants.hh are hit.  Their replies are read and counted (see
+  //   discard_stats()) just before the next reply that matters, so they
+  //   cost no extra round trip.
+  //
+  // FlushDiscarded() sends whatever is still buffered and reads back every
+  //   outstanding reply now.  Returns false if any of the replies it read
+  //   was an error or went missing.
+  //
+  bool const FlushDiscarded();
+
+  DiscardStats const& discard_stats() const noexcept;
+
+  // SampleHotKeys()
+  // Feeds the keys of every command this connection sends, pipelines and
+  //   helper classes (SingleFlight, HedgedReads, ...) included, to a hot key
+  //   sketch (see hotkeys.hh), which several connections may share.  Off by
+  //   default; nullptr turns it off again.  The first connection handed a
+  //   given sketch reads the server's command table for it with one COMMAND
+  //   round trip, so call this outside of MULTI and before subscribing.
+  //
+  void SampleHotKeys(std::shared_ptr<HotKeys> hot_keys);
+
+  // RecordCommands()
+  // Appends every command this connection sends, pipelines and helper
+  //   classes included, to a command log (see record.hh), which several
+  //   connections may share.  Off by default; nullptr turns it off again.
+  //
+  void RecordCommands(std::shared_ptr<CommandRecorder> recorder);
+
   std::string ResponsesToString() const;
   std::string Description() const;
 
  private:
+  friend class Pipeline;
+  friend class PreparedCmd;
+  friend class SingleFlight;
+  friend class UringDriver;
+  friend class BlobTransfer;
+  friend class HedgedReads;
+  friend class ReplicationStream;
+  friend class TopologyConnection;
+
   bool const UsingSocket() const noexcept;
   bool const UsingHostAndPort() const noexcept;
 
@@ -145,31 +387,181 @@ class Connection {
   void Disconnect() noexcept;
   void Reconnect();
 
+  // Sends HELLO 3 (and the client name) right after connecting.
+  void Hello();
+
+  static cmd::Response::Type const ReplyType(int const reply_type) noexcept;
+
+  // hiredis' push callback; privdata is the Connection.
+  static void PushFrame(void *privdata, void *reply);
+
   template<cmd::Flag flags>
   cmd::Response ParseReply(redisReply *&reply, bool const recursion = false);
 
-  template<int argc>
+  template<size_t argc>
   void FormatCmdArgs(
-      std::array<char*, argc> &&arg_strings,
-      int const args_index
+      std::array<std::string, argc> &arg_strings,
+      size_t const args_index
   );
 
-  template<int argc, typename Arg, typename... Args>
+  template<size_t argc, typename Arg, typename... Args>
   void FormatCmdArgs(
-      std::array<char*, argc> &&arg_strings,
-      int const args_index,
+      std::array<std::string, argc> &arg_strings,
+      size_t const args_index,
       Arg const &arg,
       Args&&... args
   );
 
+  // Appends the RESP encoding of a command to "buffer".
+  template<typename... Args>
+  void FormatCmd(std::string &buffer, Args&&... args);
+
+  static void EncodeArgv(
+      std::string &buffer,
+      std::string const *argv,
+      size_t const argc
+  );
+
+  // FormatCmd() for a command about to be sent, which is shown to
+  //   ObserveEncoded() as well.  Whatever sends commands of its own must
+  //   encode them here or observe them itself, or hot keys and recorders
+  //   miss them.
+  template<typename... Args>
+  void EncodeCmd(std::string &buffer, Args&&... args);
+
+  // Hands a command about to be sent to hot_keys_ and recorder_, if set.
+  void Observe(std::string const *argv, size_t const argc);
+
+  // Same for the command RESP-encoded at buffer[from..], e.g. a
+  //   PreparedCmd's, which is only decoded if anything is listening.
+  //   Returns where the next command in "buffer" starts.
+  size_t const ObserveEncoded(std::string const &buffer, size_t from);
+
+  // Decodes the command RESP-encoded at buffer[from..] into "argv".
+  //   Returns where the next command in "buffer" starts.
+  static size_t const DecodeArgv(
+      std::string const &buffer,
+      size_t from,
+      std::vector<std::string> &argv
+  );
+
+  bool const Observed() const noexcept;
+
+  // Hands a command's arguments to hot_keys_.
+  void SampleKeys(std::string const *argv, size_t const argc);
+
+  // Hands a command's arguments to recorder_.
+  void RecordCmd(std::string const *argv, size_t const argc);
+
+  // Formats a command into "buffer" and starts its trace event.
+  template<typename... Args>
+  void BeginCmd(std::string &buffer, trace::Event &event, Args&&... args);
+
+  // Formats and sends a command, reconnecting once if no reply comes back.
+  // The caller owns the returned reply; nullptr means the command failed.
+  template<typename... Args>
+  redisReply* CmdReply(Args&&... args);
+
+  // Same as CmdReply() for a command already RESP-encoded in "buffer".
+  redisReply* FormattedCmdReply(
+      std::string const &buffer,
+      trace::Event &event
+  );
+
   template<cmd::Flag flags, typename... Args>
   cmd::Response CmdProxy(Args&&... args);
 
+  template<cmd::Flag flags>
+  cmd::Response FormattedCmdProxy(
+      std::string const &buffer,
+      trace::Event &event
+  );
+
+  // Queues a RESP-encoded kDiscard command without waiting for its reply.
+  cmd::Response DiscardFormatted(
+      std::string const &buffer,
+      trace::Event &event
+  );
+
+  // Writes the buffered discarded commands without reading any replies.
+  //   Unless "wait" is set, only if the socket is writable right now, and
+  //   then only as much as one write takes.
+  void WriteDiscarded(bool const wait = true);
+
+  // Reads back the replies to all outstanding discarded commands, writing
+  //   out anything still buffered first.  Commands appended after them
+  //   (but not yet written) go out in the same write.
+  void ReadDiscarded();
+
+  // Number of discarded commands whose replies have not been read.
+  size_t discard_pending_ = 0;
+
+  // Bytes of discarded commands appended but not yet written, and when the
+  //   oldest of them was appended.
+  size_t discard_unwritten_ = 0;
+  std::chrono::steady_clock::time_point discard_unwritten_since_;
+
+  DiscardStats discard_stats_;
+
+  // State of a streamed reply; hiredis hands it back to the Stream*()
+  //   callbacks below through the reader's privdata.
+  struct StreamState {
+    std::function<bool(cmd::Response const&)> visit;
+
+    // Handed to hiredis in place of every reply object it asks for.
+    redisReply placeholder;
+
+    bool        stopped = false;
+    bool        failed  = false;
+    std::string error;
+
+    // Thrown by "visit": it can't unwind through hiredis' reader.
+    std::exception_ptr exception;
+  };
+
+  // Reads one reply, feeding its elements to state.visit as they are
+  //   parsed.  The command must already have been appended to context_.
+  bool const StreamReply(StreamState &state);
+
+  // True for the pieces of a push frame, which are not part of the reply.
+  static bool const InPushFrame(redisReadTask const *task) noexcept;
+
+  static void* StreamElement(
+      redisReadTask const *task,
+      cmd::Response &&element
+  );
+
+  static void* StreamString(redisReadTask const *task, char *str, size_t len);
+  static void* StreamArray(redisReadTask const *task, size_t elements);
+  static void* StreamInteger(redisReadTask const *task, long long value);
+  static void* StreamDouble(
+      redisReadTask const *task,
+      double value,
+      char *str,
+      size_t len
+  );
+  static void* StreamNil(redisReadTask const *task);
+  static void* StreamBool(redisReadTask const *task, int value);
+  static void  StreamFree(void *reply);
+
+  static redisReplyObjectFunctions stream_functions_;
+
   boost::optional<std::string> socket_;
   boost::optional<std::string> host_;
   boost::optional<int>         port_;
   boost::optional<std::string> name_;
 
+  int requested_protocol_ = constants::kDefaultProtocol;
+  int protocol_           = 2;
+
+  PushHandler  push_handler_;
+  StreamState *streaming_ = nullptr;  // the reply being streamed, if any
+
+  std::shared_ptr<HotKeys> hot_keys_;
+
+  std::shared_ptr<CommandRecorder> recorder_;
+  uint64_t                         recorder_stream_ = 0;
+
   redisContext *context_ = nullptr;
   redisReply   *reply_   = nullptr;
 
@@ -2,10 +2,7 @@
  *   Template implementations and static definitions for connection.hh
 */
 
-#include <cstring>  // strcpy() used in FormatCmdArgs()
-
-#include <array>    // used in CmdProxy()
-#include <iostream>
+#include <array>    // used in CmdReply()
 
 
 namespace rediswraps {
@@ -35,6 +32,12 @@ bool const Connection::IsConnected() const noexcept {
 }
 
 
+inline
+int const Connection::protocol() const noexcept {
+  return this->protocol_;
+}
+
+
 inline
 std::string const Connection::name() const noexcept {
   return this->name_ ? *this->name_ : constants::kUnknownStr;
@@ -117,6 +120,104 @@ RetType Connection::Cmd(
 }
 
 
+template<typename Container, typename... Args, typename IsDecodableContainer>
+bool const Connection::Cmd(
+    Container &out,
+    std::string const &base,
+    Args&&... args
+) noexcept {
+  ReplyPtr reply = this->RawCmd(base, std::forward<Args>(args)...);
+
+  if (!reply) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      "No reply from Redis to '", base, "'."
+    );
+
+    return false;
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      reply->str
+    );
+
+    return false;
+  }
+
+  return reply::Decode(reply.get(), out);
+}
+
+
+template<typename Visitor, typename... Args, typename IsElementVisitor>
+bool const Connection::Cmd(
+    Visitor &&visit,
+    std::string const &base,
+    Args&&... args
+) {
+  std::string buffer;
+
+  if (this->scripts_.count(base)) {
+    this->EncodeCmd(
+      buffer,
+      "EVALSHA",
+      this->scripts_[base].first,
+      this->scripts_[base].second,
+      std::forward<Args>(args)...
+    );
+  }
+  else {
+    this->EncodeCmd(buffer, base, std::forward<Args>(args)...);
+  }
+
+  if (!this->IsConnected()) {
+    this->Reconnect();
+  }
+
+  if (redisAppendFormattedCommand(
+        this->context_,
+        buffer.data(),
+        buffer.size()
+      ) != REDIS_OK) {
+    return false;
+  }
+
+  // Replies to earlier discarded commands arrive first.
+  this->ReadDiscarded();
+
+  trace::Event event;
+
+  if (trace::Tracer::kEnabled) {
+    trace::Begin(event, *this, &base, 1);
+    event.argc          = 1 + sizeof...(args);
+    event.request_bytes = buffer.size();
+
+    trace::Tracer::BeforeSend(event);
+  }
+
+  StreamState state;
+  state.visit = std::ref(visit);
+
+  bool const success = this->StreamReply(state);
+
+  if (trace::Tracer::kEnabled) {
+    event.replied_at = trace::Now();
+    event.success    = success;
+    event.error      = state.error;
+
+    if (success) {
+      trace::Tracer::AfterReply(event);
+    }
+    else {
+      trace::Tracer::OnError(event);
+    }
+  }
+
+  return success;
+}
+
+
 template<typename RetType, typename ReturnsAnythingButCmdResponse>
 RetType Connection::Response(
     bool const pop_response,
@@ -173,21 +274,38 @@ cmd::Response Connection::ParseReply(
     }
   }
   else {
+    response.type_ = Connection::ReplyType(reply->type);
+
     switch(reply->type) {
     case REDIS_REPLY_ERROR:
-      std::cerr << reply->str << std::endl;
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kReply,
+        reply->str
+      );
+
       response.fail();
       // break left out intentionally here.
     case REDIS_REPLY_STATUS:
     case REDIS_REPLY_STRING:
-      response.set(reply->str);
+    case REDIS_REPLY_DOUBLE:
+    case REDIS_REPLY_BIGNUM:
+    case REDIS_REPLY_VERB:
+      response.data_.assign(reply->str, reply->len);
       break;
     case REDIS_REPLY_INTEGER:
       response.set(reply->integer);
       break;
+    case REDIS_REPLY_BOOL:
+      response.set(reply->integer ? 1 : 0);
+      break;
     case REDIS_REPLY_NIL:
       response.set(constants::kNil);
       break;
+    // RESP3 aggregates are unrolled just like arrays.  Maps come out as
+    //   key, value, key, value... exactly as HGETALL does over RESP2.
+    case REDIS_REPLY_MAP:
+    case REDIS_REPLY_SET:
+    case REDIS_REPLY_PUSH:
     case REDIS_REPLY_ARRAY:
       // Do not queue THIS reply... which is just to start the array
       //   unrolling and carries no actual reply data with it.
@@ -212,7 +330,7 @@ cmd::Response Connection::ParseReply(
   }
 
   if (!is_array_reply && cmd::FlagsQueueResponses<flags>::value) {
-    this->responses_.emplace_front(response.data_);
+    this->responses_.emplace_front(response);
   }
 
   if (!recursion) {
@@ -223,89 +341,182 @@ cmd::Response Connection::ParseReply(
 }
 
 
-template<int argc>
+template<size_t argc>
 inline
 void Connection::FormatCmdArgs(
-    std::array<char*, argc> &&arg_strings,
-    int const args_index
+    std::array<std::string, argc> &arg_strings,
+    size_t const args_index
 ) {}
 
 
-template<int argc, typename Arg, typename... Args>
+template<size_t argc, typename Arg, typename... Args>
 void Connection::FormatCmdArgs(
-    std::array<char*, argc> &&arg_strings,
-    int const args_index,
+    std::array<std::string, argc> &arg_strings,
+    size_t const args_index,
     Arg const &arg,
     Args&&... args
 ) {
+  arg_strings[args_index] = utils::ToString(arg);
+
   this->FormatCmdArgs<argc>(
-    std::forward<std::array<char*, argc>>(arg_strings),
+    arg_strings,
     (args_index + 1),
     std::forward<Args>(args)...
   );
+}
+
 
-  std::string const temp(utils::ToString(arg));
+template<typename... Args>
+void Connection::FormatCmd(std::string &buffer, Args&&... args) {
+  constexpr size_t argc = sizeof...(args);
 
-  // TODO FIXME If using new and delete, they should at least
-  //   appear in the same scope
-  arg_strings[args_index] = new char[temp.size() + 1];
-  strcpy(arg_strings[args_index], temp.c_str());
+  std::array<std::string, argc> arg_strings;
+  this->FormatCmdArgs<argc>(arg_strings, 0, std::forward<Args>(args)...);
+
+  Connection::EncodeArgv(buffer, arg_strings.data(), argc);
 }
 
 
-template<cmd::Flag flags, typename... Args>
-cmd::Response Connection::CmdProxy(Args&&... args) {
-  constexpr int argc = sizeof...(args);
+template<typename... Args>
+void Connection::EncodeCmd(std::string &buffer, Args&&... args) {
+  size_t const from = buffer.size();
 
-  std::array<char*, argc> arg_strings;
+  this->FormatCmd(buffer, std::forward<Args>(args)...);
+  this->ObserveEncoded(buffer, from);
+}
 
-  this->FormatCmdArgs<argc>(
-    std::forward<std::array<char*, argc>>(arg_strings),
-    0,
-    std::forward<Args>(args)...
-  );
 
-  // if it fails maybe it disconnected?...
-  // try once to reconnect quickly before giving up
-  bool reconnection_attempted = false;
+inline
+void Connection::EncodeArgv(
+    std::string &buffer,
+    std::string const *argv,
+    size_t const argc
+) {
+  buffer += '*';
+  buffer += std::to_string(argc);
+  buffer += "\r\n";
+
+  for (size_t i = 0; i < argc; ++i) {
+    buffer += '$';
+    buffer += std::to_string(argv[i].size());
+    buffer += "\r\n";
+    buffer += argv[i];
+    buffer += "\r\n";
+  }
+}
 
-  do {
-    this->reply_ = reinterpret_cast<redisReply*>(
-      redisCommandArgv(
-        this->context_,
-        argc,
-        const_cast<char const**>(arg_strings.data()),
-        nullptr
-      )
-    );
 
-    if (this->reply_ != nullptr) {
-      break;
-    }
+template<typename... Args>
+void Connection::BeginCmd(
+    std::string &buffer,
+    trace::Event &event,
+    Args&&... args
+) {
+  constexpr size_t argc = sizeof...(args);
 
-    if (reconnection_attempted) {
-      return cmd::Response(
-        this->context_->err ?
-          this->context_->errstr :
-          "Redis reply is null and reconnection failed.",
-        false
-      );
+  std::array<std::string, argc> arg_strings;
+  this->FormatCmdArgs<argc>(arg_strings, 0, std::forward<Args>(args)...);
+
+  this->Observe(arg_strings.data(), argc);
+
+  size_t const start = buffer.size();
+  Connection::EncodeArgv(buffer, arg_strings.data(), argc);
+
+  if (trace::Tracer::kEnabled) {
+    trace::Begin(event, *this, arg_strings.data(), argc);
+
+    // arg_strings is gone by the time the hooks run, so the command name
+    //   is taken from "*<argc>\r\n$<length>\r\n<name>" in the buffer.
+    if (argc > 0) {
+      size_t const name = buffer.find('\n', buffer.find('\n', start) + 1) + 1;
+      event.command = buffer.data() + name;
     }
+  }
+}
 
-    this->Reconnect();
-    reconnection_attempted = true;
+
+inline
+void Connection::Observe(std::string const *argv, size_t const argc) {
+  if (this->hot_keys_) {
+    this->SampleKeys(argv, argc);
+  }
+
+  if (this->recorder_) {
+    this->RecordCmd(argv, argc);
+  }
+}
+
+
+inline
+bool const Connection::Observed() const noexcept {
+  return this->hot_keys_ || this->recorder_;
+}
+
+
+template<typename... Args>
+redisReply* Connection::CmdReply(Args&&... args) {
+  std::string  buffer;
+  trace::Event event;
+
+  this->BeginCmd(buffer, event, std::forward<Args>(args)...);
+
+  return this->FormattedCmdReply(buffer, event);
+}
+
+
+template<typename... Args>
+ReplyPtr Connection::RawCmd(std::string const &base, Args&&... args) {
+  if (this->scripts_.count(base)) {
+    return ReplyPtr(this->CmdReply(
+      "EVALSHA",
+      this->scripts_[base].first,
+      this->scripts_[base].second,
+      std::forward<Args>(args)...
+    ));
+  }
+
+  return ReplyPtr(this->CmdReply(base, std::forward<Args>(args)...));
+}
+
+
+template<cmd::Flag flags, typename... Args>
+cmd::Response Connection::CmdProxy(Args&&... args) {
+  std::string  buffer;
+  trace::Event event;
+
+  this->BeginCmd(buffer, event, std::forward<Args>(args)...);
+
+  return this->FormattedCmdProxy<flags>(buffer, event);
+}
+
+
+template<cmd::Flag flags>
+cmd::Response Connection::FormattedCmdProxy(
+    std::string const &buffer,
+    trace::Event &event
+) {
+  if (cmd::FlagsDiscardResponses<flags>::value) {
+    return this->DiscardFormatted(buffer, event);
   }
-  while (this->reply_ == nullptr);
 
-  auto response = this->ParseReply<flags>(this->reply_);
+  this->reply_ = this->FormattedCmdReply(buffer, event);
 
-  // TODO FIXME (same issue as above)
-  // use RAII instead of new and delete[] on char arrays
-  for (int i = 0; i < argc; ++i) {
-    delete[] arg_strings[i];
+  if (this->reply_ == nullptr) {
+    return cmd::Response(
+      (this->context_ != nullptr && this->context_->err) ?
+        this->context_->errstr :
+        "Redis reply is null and reconnection failed.",
+      false
+    );
   }
 
-  return response;
+  return this->ParseReply<flags>(this->reply_);
+}
+
+
+inline
+DiscardStats const& Connection::discard_stats() const noexcept {
+  return this->discard_stats_;
 }
 
 } // namespace rediswraps
@@ -1,6 +1,8 @@
 #ifndef REDISWRAPS_CONSTANTS_HH
 #define REDISWRAPS_CONSTANTS_HH
 
+#include <cstddef>      // size_t
+#include <cstdint>      // uint8_t
 #include <type_traits>
 
 
@@ -10,6 +12,10 @@ namespace constants {
 constexpr char const *kNil = "(nil)";
 constexpr char const *kOk  = "OK";
 
+// What Cmd() returns for commands whose reply is discarded (kDiscard):
+//   they are only queued for sending, see Connection::FlushDiscarded().
+constexpr char const *kQueued = "QUEUED";
+
 constexpr char const *kUnknownStr = "";
 constexpr int         kUnknownInt = -1;
 
@@ -19,6 +25,101 @@ constexpr size_t kScriptHashLength = 40;
 
 constexpr char const *kDefaultHost = "127.0.0.1";
 constexpr int         kDefaultPort = 6379;
+
+// Protocol version requested from Redis on connecting: 2 keeps the classic
+//   RESP2, 3 sends HELLO 3 for RESP3 (Redis 6+).
+constexpr int kDefaultProtocol = 2;
+
+// Discarded (fire-and-forget) commands are written out right away if the
+//   socket takes them without blocking, and buffered if it doesn't.  Once
+//   kDiscardMaxBytes or kDiscardMaxDelayMs worth of them are buffered, the
+//   next one waits for the socket; their replies are read and counted once
+//   kDiscardMaxPending of them are outstanding.
+constexpr size_t kDiscardMaxPending = 1024;
+constexpr size_t kDiscardMaxBytes   = 64 * 1024;
+constexpr int    kDiscardMaxDelayMs = 5;
+
+// Logging defaults.  See log.hh.
+constexpr uint32_t kLogRateLimitPerSecond = 20;    // per topic and prefix
+constexpr size_t   kLogRateLimitPrefix    = 24;    // bytes telling lines apart
+constexpr size_t   kLogRateLimitSlots     = 64;    // limits kept per topic
+constexpr size_t   kLogQueueCapacity      = 4096;  // AsyncSink records
+constexpr size_t   kLogMaxMessageLength   = 256;   // AsyncSink truncation
+constexpr int      kLogDrainIntervalMs    = 10;
+
+// Replies SingleFlight caches at most, when its cache is enabled.
+constexpr size_t kSingleFlightMaxCacheEntries = 10000;
+
+// BlobTransfer defaults.  See blob.hh.
+constexpr size_t      kBlobChunkSize    = 1024 * 1024;
+constexpr size_t      kBlobWindow       = 8;  // chunks in flight
+constexpr char const *kBlobUploadSuffix = ".uploading";
+constexpr int64_t     kBlobUploadTtlMs  = 60 * 1000;
+
+// HedgedReads defaults.  See hedge.hh.
+constexpr double kHedgePercentile    = 95.0;  // of recent latencies, the delay
+constexpr int    kHedgeMinDelayUs    = 100;   // never hedge sooner than this
+constexpr double kHedgeBudget        = 0.05;  // hedges per request, at most
+constexpr size_t kHedgeBurst         = 10;    // hedges in a row the budget allows
+constexpr size_t kHedgeWindowSamples = 1000;  // latencies per delay update
+
+// Migration defaults.  See migrate.hh.
+constexpr size_t kMigrateThreads       = 4;
+constexpr size_t kMigrateBatchKeys     = 256;  // SCAN COUNT, keys per pipeline
+constexpr size_t kMigrateQueuedBatches = 4;    // per worker, ahead of the workers
+
+// Bitmap slices no smaller than this go to a thread each.  See bitmap.hh.
+constexpr size_t kBitmapMinBytesPerThread = 1024 * 1024;
+
+// Appended to a FencedLock's key for the key of its fencing tokens.  See
+//   primitives.hh.
+constexpr char const *kFenceKeySuffix = ":fence";
+
+// CommandRecorder log buffer, written out whenever it fills up.
+constexpr size_t kRecorderBufferSize = 64 * 1024;
+
+// HotKeys defaults.  See hotkeys.hh.
+constexpr size_t   kHotKeySketchWidth     = 2048;   // counters per row
+constexpr size_t   kHotKeySketchDepth     = 4;      // rows
+constexpr size_t   kHotKeyTopK            = 32;
+constexpr uint32_t kHotKeySampleEvery     = 16;     // 1 samples every command
+constexpr int      kHotKeyDecayIntervalMs = 10000;  // counts halve this often
+
+// introspect::Collector defaults.  See introspect.hh.
+constexpr int    kCollectorIntervalMs     = 1000;
+constexpr size_t kCollectorCapacity       = 3600;  // samples per metric
+constexpr size_t kCollectorSlowlogEntries = 128;
+
+// io_uring transport defaults.  See UringDriver in uring.hh.
+constexpr unsigned kUringQueueDepth = 256;        // submission queue entries
+constexpr size_t   kUringBufferSize = 64 * 1024;  // per connection, each way
+
+// LatencyHistogram precision.  See histogram.hh.  Values are grouped into
+//   buckets 2^-(bits-1) as wide as themselves, i.e. within 0.8% for 8.
+constexpr unsigned kHistogramSubBucketBits = 8;
+
+// ReplicationStream defaults.  See replication.hh.
+constexpr int    kReplicationAckIntervalMs = 1000;   // REPLCONF ACK period
+constexpr int    kReplicationTimeoutMs     = 60000;  // silence before giving up
+constexpr int    kReplicationRetryDelayMs  = 1000;   // between reconnections
+constexpr size_t kReplicationReadSize      = 64 * 1024;
+
+// rdb::Snapshot defaults.  See rdb.hh.
+constexpr size_t kRdbBatchRecords  = 1024;  // records per ForEach() work item
+constexpr size_t kRdbQueuedBatches = 4;     // per worker, ahead of the workers
+
+// Replica routing defaults.  See TopologyOptions in topology.hh.
+constexpr int64_t kDefaultMaxReplicaLagBytes  = 1024 * 1024;
+constexpr double  kDefaultRttSmoothing        = 0.2;
+constexpr int     kDefaultTopologyRefreshMs   = 1000;
+
+// Points each node gets on a consistent hash ring, as in libketama.
+// Must be a multiple of 4 (each MD5 digest yields four points).
+constexpr size_t kKetamaPointsPerNode = 160;
+
+// Most keys ScatterGather puts in a single sub-command; larger per-shard
+//   batches are split into several pipelined sub-commands.
+constexpr size_t kScatterBatchKeys = 512;
 } // namespace constants
 
 
@@ -70,6 +171,9 @@ enum class Flag : FlagEnum {
   //   Subsequent attempts to fetch a response will be in error.
   //   response() -> returns boost::none w/ error msg attached
   //
+  // NOTE: kDiscard commands don't wait for their replies at all.
+  //   See Connection::FlushDiscarded().
+  //
   kClear = (kFlush | kDiscard),
 
   // kVoid = 0xA
@@ -123,6 +227,16 @@ template<Flag T> struct FlagsQueueResponses
     >
 {};
 
+template<Flag T> struct FlagsDiscardResponses
+  : std::integral_constant<bool, 
+      !!(static_cast<FlagEnum>(T) & static_cast<FlagEnum>(Flag::kDiscard))
+    >
+{};
+
+// Marks the variable arguments of a prepared command.
+//   See Connection::Prepare().
+struct Placeholder {};
+
 } // namespace cmd
 
 // For readability:
@@ -130,6 +244,9 @@ constexpr cmd::Flag CMD_DEFAULT = cmd::Flag::kDefault;
 constexpr cmd::Flag CMD_SAVED   = cmd::Flag::kSaved;
 constexpr cmd::Flag CMD_CLEAR   = cmd::Flag::kClear;
 constexpr cmd::Flag CMD_VOID    = cmd::Flag::kVoid;
+
+constexpr cmd::Placeholder CMD_PLACEHOLDER{};
+
 } // namespace rediswraps
 
 #endif
@@ -0,0 +1,99 @@
+#ifndef REDISWRAPS_DECODE_HH
+#define REDISWRAPS_DECODE_HH
+
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>       // std::pair
+#include <vector>
+
+#include <boost/optional.hpp>
+
+extern "C" {
+#include <hiredis/hiredis.h>
+}
+
+
+namespace rediswraps {
+namespace reply {
+
+// Decode()
+// Converts a hiredis reply tree straight into a C++ value without staging
+//   anything as strings in a response queue.  Array replies are decoded
+//   element by element into the container, whose capacity is reserved up
+//   front from reply->elements where the container supports it.
+//
+// Supported targets:
+//   - std::string and any fundamental type
+//   - boost::optional<T>, which is left empty for nil replies (e.g. MGET)
+//   - std::vector<T>, std::set<T>, std::unordered_set<T>
+//   - std::map<K, V>, std::unordered_map<K, V>    (e.g. HGETALL)
+//   - std::vector<std::pair<K, V>>                 (e.g. ZRANGE WITHSCORES)
+//
+// Pairs for the last three are read from a flat key, value, key, value...
+//   reply (RESP2 arrays, RESP3 maps) or from an array of two-element arrays,
+//   which is how RESP3 sends e.g. ZRANGE WITHSCORES.
+//
+// Containers are cleared before decoding.  Returns false if the reply does
+//   not have the shape of the target (e.g. an error reply, or a scalar
+//   reply decoded into a container).
+//
+template<typename T,
+    typename NotContainer = typename std::enable_if<
+      std::is_fundamental<T>::value ||
+      std::is_same<T, std::string>::value
+    >::type
+>
+bool const Decode(redisReply const *reply, T &out);
+
+template<typename T>
+bool const Decode(redisReply const *reply, boost::optional<T> &out);
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::vector<T> &out);
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::vector<std::pair<K, V>> &out);
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::set<T> &out);
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::unordered_set<T> &out);
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::map<K, V> &out);
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::unordered_map<K, V> &out);
+
+
+// IsContainer
+// True for the container types Decode() accepts.  Used to select the
+//   Connection::Cmd() overload that decodes into a container.
+//
+template<typename T> struct IsContainer : std::false_type {};
+
+template<typename T>
+struct IsContainer<std::vector<T>> : std::true_type {};
+
+template<typename T>
+struct IsContainer<std::set<T>> : std::true_type {};
+
+template<typename T>
+struct IsContainer<std::unordered_set<T>> : std::true_type {};
+
+template<typename K, typename V>
+struct IsContainer<std::map<K, V>> : std::true_type {};
+
+template<typename K, typename V>
+struct IsContainer<std::unordered_map<K, V>> : std::true_type {};
+
+} // namespace reply
+} // namespace rediswraps
+
+#include <rediswraps/decode.inl>
+#endif
@@ -0,0 +1,303 @@
+/* decode.inl
+ *   Template implementations and static definitions for decode.hh
+*/
+
+#include <boost/lexical_cast.hpp>
+
+
+namespace rediswraps {
+namespace reply {
+
+// Helpers for the scalar Decode() {{{
+inline
+bool const DecodeScalar(redisReply const *reply, std::string &out) {
+  switch (reply->type) {
+  case REDIS_REPLY_STRING:
+  case REDIS_REPLY_STATUS:
+  case REDIS_REPLY_DOUBLE:
+  case REDIS_REPLY_BIGNUM:
+  case REDIS_REPLY_VERB:
+    out.assign(reply->str, reply->len);
+    return true;
+  case REDIS_REPLY_INTEGER:
+    out = std::to_string(reply->integer);
+    return true;
+  case REDIS_REPLY_BOOL:
+    out = reply->integer ? "1" : "0";
+    return true;
+  case REDIS_REPLY_NIL:
+    out.clear();
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+template<typename T>
+bool const DecodeScalar(redisReply const *reply, T &out) {
+  switch (reply->type) {
+  case REDIS_REPLY_INTEGER:
+  case REDIS_REPLY_BOOL:
+    out = static_cast<T>(reply->integer);
+    return true;
+  case REDIS_REPLY_DOUBLE:
+    // RESP3 doubles come already parsed.
+    out = static_cast<T>(reply->dval);
+    return true;
+  case REDIS_REPLY_STRING:
+  case REDIS_REPLY_STATUS:
+  case REDIS_REPLY_BIGNUM:
+  case REDIS_REPLY_VERB:
+    // Converts in place: no std::string is built for the element.
+    return boost::conversion::try_lexical_convert(reply->str, reply->len, out);
+  case REDIS_REPLY_NIL:
+    out = T();
+    return true;
+  default:
+    return false;
+  }
+}
+// }}}
+
+
+// Arrays and the RESP3 aggregates, whose elements hiredis lays out the same
+//   way: a map of n entries is 2n elements, key, value, key, value...
+inline
+bool const IsAggregate(redisReply const *reply) {
+  return reply != nullptr && (
+    reply->type == REDIS_REPLY_ARRAY ||
+    reply->type == REDIS_REPLY_MAP   ||
+    reply->type == REDIS_REPLY_SET   ||
+    reply->type == REDIS_REPLY_PUSH
+  );
+}
+
+
+// Pair replies come in two layouts: flat, key, value, key, value... (RESP2
+//   arrays and RESP3 maps), or nested, one two-element array per pair (RESP3
+//   replies such as ZRANGE WITHSCORES).  Counts the pairs in either.
+inline
+bool const CountPairs(redisReply const *reply, bool &nested, size_t &pairs) {
+  if (!IsAggregate(reply)) {
+    return false;
+  }
+
+  nested = (
+    reply->type != REDIS_REPLY_MAP &&
+    reply->elements > 0 &&
+    IsAggregate(reply->element[0]) &&
+    reply->element[0]->elements == 2
+  );
+
+  if (nested) {
+    pairs = reply->elements;
+    return true;
+  }
+
+  pairs = reply->elements / 2;
+  return (reply->elements % 2) == 0;
+}
+
+
+inline
+bool const PairAt(
+    redisReply const *reply,
+    bool const nested,
+    size_t const i,
+    redisReply const *&key,
+    redisReply const *&value
+) {
+  if (!nested) {
+    key   = reply->element[2 * i];
+    value = reply->element[2 * i + 1];
+    return true;
+  }
+
+  redisReply const *pair = reply->element[i];
+
+  if (!IsAggregate(pair) || pair->elements != 2) {
+    return false;
+  }
+
+  key   = pair->element[0];
+  value = pair->element[1];
+  return true;
+}
+
+
+template<typename T, typename NotContainer>
+bool const Decode(redisReply const *reply, T &out) {
+  return reply != nullptr && DecodeScalar(reply, out);
+}
+
+
+template<typename T>
+bool const Decode(redisReply const *reply, boost::optional<T> &out) {
+  if (reply != nullptr && reply->type == REDIS_REPLY_NIL) {
+    out = boost::none;
+    return true;
+  }
+
+  T value;
+
+  if (!Decode(reply, value)) {
+    return false;
+  }
+
+  out = std::move(value);
+  return true;
+}
+
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::vector<T> &out) {
+  out.clear();
+
+  if (!IsAggregate(reply)) {
+    return false;
+  }
+
+  out.resize(reply->elements);
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    if (!Decode(reply->element[i], out[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::vector<std::pair<K, V>> &out) {
+  out.clear();
+
+  bool nested;
+  size_t pairs;
+
+  if (!CountPairs(reply, nested, pairs)) {
+    return false;
+  }
+
+  out.resize(pairs);
+
+  for (size_t i = 0; i < pairs; ++i) {
+    redisReply const *key;
+    redisReply const *value;
+
+    if (!PairAt(reply, nested, i, key, value) ||
+        !Decode(key,   out[i].first) ||
+        !Decode(value, out[i].second)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::set<T> &out) {
+  out.clear();
+
+  if (!IsAggregate(reply)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    T member;
+
+    if (!Decode(reply->element[i], member)) {
+      return false;
+    }
+
+    out.insert(out.end(), std::move(member));
+  }
+
+  return true;
+}
+
+
+template<typename T>
+bool const Decode(redisReply const *reply, std::unordered_set<T> &out) {
+  out.clear();
+
+  if (!IsAggregate(reply)) {
+    return false;
+  }
+
+  out.reserve(reply->elements);
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    T member;
+
+    if (!Decode(reply->element[i], member)) {
+      return false;
+    }
+
+    out.insert(std::move(member));
+  }
+
+  return true;
+}
+
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::map<K, V> &out) {
+  out.clear();
+
+  bool nested;
+  size_t pairs;
+
+  if (!CountPairs(reply, nested, pairs)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < pairs; ++i) {
+    redisReply const *key_reply;
+    redisReply const *value_reply;
+    K key;
+
+    if (!PairAt(reply, nested, i, key_reply, value_reply) ||
+        !Decode(key_reply, key) ||
+        !Decode(value_reply, out[std::move(key)])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+template<typename K, typename V>
+bool const Decode(redisReply const *reply, std::unordered_map<K, V> &out) {
+  out.clear();
+
+  bool nested;
+  size_t pairs;
+
+  if (!CountPairs(reply, nested, pairs)) {
+    return false;
+  }
+
+  out.reserve(pairs);
+
+  for (size_t i = 0; i < pairs; ++i) {
+    redisReply const *key_reply;
+    redisReply const *value_reply;
+    K key;
+
+    if (!PairAt(reply, nested, i, key_reply, value_reply) ||
+        !Decode(key_reply, key) ||
+        !Decode(value_reply, out[std::move(key)])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace reply
+} // namespace rediswraps
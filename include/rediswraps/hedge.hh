@@ -0,0 +1,176 @@
+#ifndef REDISWRAPS_HEDGE_HH
+#define REDISWRAPS_HEDGE_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/histogram.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+struct HedgeOptions {
+  // A command is hedged once it has waited longer than this percentile of
+  //   recent latencies, or than min_delay if that is longer.
+  double percentile = constants::kHedgePercentile;
+  std::chrono::microseconds min_delay{constants::kHedgeMinDelayUs};
+
+  // Hedges allowed per request, on average, and in a row: every request
+  //   earns "budget" of a hedge, up to "burst" hedges saved up.
+  double budget = constants::kHedgeBudget;
+  size_t burst  = constants::kHedgeBurst;
+
+  // Latencies the percentile is taken over.  Nothing is hedged before the
+  //   first "window" requests are in; after that the delay follows the
+  //   latest full window.
+  size_t window = constants::kHedgeWindowSamples;
+};
+
+struct HedgeStats {
+  uint64_t requests    = 0;  // readonly commands sent through Cmd()/RawCmd()
+  uint64_t hedged      = 0;  // also sent to the second connection
+  uint64_t hedge_wins  = 0;  // ...which answered first
+  uint64_t over_budget = 0;  // would have been hedged but for the budget
+  uint64_t failovers   = 0;  // sent to the second one since the first failed
+  uint64_t bypassed    = 0;  // not readonly (or a script): sent as usual
+
+  // Current delay before hedging; 0 until the first window is in.
+  std::chrono::microseconds delay{0};
+};
+
+
+// HedgedReads
+// Cuts the tail latency of reads by asking twice when the first answer is
+//   late, e.g. from a primary busy forking for BGSAVE or rewriting its AOF:
+//
+//   rediswraps::HedgedReads hedged;           // shared by all threads
+//   std::string user = hedged.Cmd(*primary, *replica, "get", "user:7");
+//
+// The command goes to the first connection.  If its reply hasn't come
+//   back after the hedging delay, the same command goes to the second one,
+//   and whichever reply arrives first is returned.  The other connection
+//   reads and drops the late reply before its next command, as it does for
+//   CMD_VOID commands (see Connection::FlushDiscarded()), so it costs no
+//   extra round trip.  The reply lands in the first connection's response
+//   queue, exactly as with Connection::Cmd(), or in the second one's if the
+//   first is down.
+//
+// The delay is a percentile of the latencies seen lately, so only the
+//   slowest few percent of requests are hedged, and a budget caps hedges
+//   at a fraction of all requests so that an overloaded server isn't sent
+//   twice the traffic.  When the first connection fails, the command is
+//   sent to the second one regardless of delay and budget.
+//
+// Only commands Redis flags as readonly (see IsReadOnlyCommand()) are
+//   hedged, since they may run twice; anything else goes straight to the
+//   first connection.  Both connections must use the same database and
+//   protocol, and the second one may well serve data a little behind the
+//   first (replication lag).
+//
+// Each connection belongs to one thread at a time as usual, but a single
+//   HedgedReads can be shared by all of them.
+//
+class HedgedReads {
+ public:
+  explicit HedgedReads(HedgeOptions const &options = {});
+
+  HedgedReads(HedgedReads const&) = delete;
+  HedgedReads& operator=(HedgedReads const&) = delete;
+
+  // Same contract as Connection::Cmd() on "first".
+  template<cmd::Flag flags = cmd::Flag::kDefault,
+      typename RetType = cmd::Response,
+      typename... Args
+  >
+  RetType Cmd(
+      Connection &first,
+      Connection &second,
+      std::string const &base,
+      Args&&... args
+  );
+
+  // Same contract as Connection::RawCmd() on "first".
+  template<typename... Args>
+  ReplyPtr RawCmd(
+      Connection &first,
+      Connection &second,
+      std::string const &base,
+      Args&&... args
+  );
+
+  HedgeStats const stats() const noexcept;
+
+ private:
+  // One connection's copy of a command.
+  struct Leg {
+    Connection *conn = nullptr;
+
+    // Replies to discarded commands due before ours.  They are skipped as
+    //   they come rather than waited for, since a late one may well be the
+    //   reply to a command that was hedged already.
+    size_t skip = 0;
+
+    bool sent   = false;
+    bool failed = false;
+
+    // When the command was written out, after any reconnecting.
+    std::chrono::steady_clock::time_point sent_at;
+  };
+
+  // Sends the RESP-encoded command in "buffer" to "first", hedging with
+  //   "second" as needed.  nullptr if neither could answer.
+  ReplyPtr Send(
+      Connection &first,
+      Connection &second,
+      std::string const &buffer
+  );
+
+  // Writes the command out.  False if the connection failed, which drops it.
+  bool const Start(Leg &leg, std::string const &buffer);
+
+  // Takes a complete reply, if there is one, off the connection's reader,
+  //   first reading what the socket has if "read" is set.  False if the
+  //   connection failed, which drops it.
+  bool const Receive(Leg &leg, ReplyPtr &reply, bool const read);
+
+  bool const Drop(Leg &leg, std::string const &what);
+
+  // Takes one hedge out of the budget if there is one left.
+  bool const Spend() noexcept;
+
+  // Adds a latency to the window, updating the delay once it is full.
+  void Sample(std::chrono::steady_clock::duration const latency);
+
+  HedgeOptions const options_;
+
+  // Budget left, in millionths of a hedge.
+  std::atomic<int64_t> credit_;
+  int64_t const        earned_;     // per request
+  int64_t const        max_credit_;
+
+  // Hedging delay in nanoseconds; -1 until the first window is in.
+  std::atomic<int64_t> delay_ns_;
+
+  // Taken with try_lock: a busy window loses a sample, not time.
+  std::mutex       window_lock_;
+  LatencyHistogram window_;
+
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> hedged_;
+  std::atomic<uint64_t> hedge_wins_;
+  std::atomic<uint64_t> over_budget_;
+  std::atomic<uint64_t> failovers_;
+  std::atomic<uint64_t> bypassed_;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/hedge.inl>
+
+#endif
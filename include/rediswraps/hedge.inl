@@ -0,0 +1,85 @@
+/* hedge.inl
+ *   Template implementations for hedge.hh
+*/
+
+#include <rediswraps/commands.hh>
+
+
+namespace rediswraps {
+
+template<cmd::Flag flags, typename RetType, typename... Args>
+RetType HedgedReads::Cmd(
+    Connection &first,
+    Connection &second,
+    std::string const &base,
+    Args&&... args
+) {
+  static_assert(
+    cmd::FlagsAreLegal<flags>::value,
+    "Illegal combination of cmd::Flag values."
+  );
+
+  if (
+      cmd::FlagsDiscardResponses<flags>::value ||
+      first.scripts_.count(base) ||
+      !IsReadOnlyCommand(first, base)
+  ) {
+    ++this->bypassed_;
+    return first.Cmd<flags, RetType>(base, std::forward<Args>(args)...);
+  }
+
+  if (cmd::FlagsFlushResponses<flags>::value) {
+    first.Flush();
+  }
+
+  std::string buffer;
+  first.EncodeCmd(buffer, base, args...);
+
+  ReplyPtr reply = this->Send(first, second, buffer);
+
+  if (!reply) {
+    return static_cast<RetType>(
+      cmd::Response("Redis reply is null and reconnection failed.", false)
+    );
+  }
+
+  // Parsed (and freed) as if "first" had read it itself.  A reply from
+  //   "second" after "first" failed needs "first" back up to take it, as
+  //   ParseReply() reads a broken connection as a failure; failing that,
+  //   "second" takes it.
+  Connection *parser = &first;
+
+  if (!first.IsConnected()) {
+    try {
+      first.Reconnect();
+    }
+    catch (std::exception const&) {
+      parser = &second;
+    }
+  }
+
+  parser->reply_ = reply.release();
+
+  return static_cast<RetType>(parser->ParseReply<flags>(parser->reply_));
+}
+
+
+template<typename... Args>
+ReplyPtr HedgedReads::RawCmd(
+    Connection &first,
+    Connection &second,
+    std::string const &base,
+    Args&&... args
+) {
+  if (first.scripts_.count(base) || !IsReadOnlyCommand(first, base)) {
+    ++this->bypassed_;
+    return first.RawCmd(base, std::forward<Args>(args)...);
+  }
+
+  std::string buffer;
+  first.EncodeCmd(buffer, base, args...);
+
+  return this->Send(first, second, buffer);
+}
+
+} // namespace rediswraps
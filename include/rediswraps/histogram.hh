@@ -0,0 +1,82 @@
+#ifndef REDISWRAPS_HISTOGRAM_HH
+#define REDISWRAPS_HISTOGRAM_HH
+
+#include <cstdint>
+#include <vector>
+
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+// LatencyHistogram
+// Counts values (latencies, in whatever unit suits: nanoseconds, say) in
+//   log-linear buckets, the way HdrHistogram does, so that any percentile
+//   can be read back within a fixed relative error:
+//
+//   LatencyHistogram latencies;
+//   latencies.Record(elapsed_ns);
+//   ...
+//   uint64_t const p99 = latencies.Percentile(99.0);
+//
+// Values below 2^kHistogramSubBucketBits are counted exactly; above, each
+//   power of 2 is split into 2^(kHistogramSubBucketBits - 1) buckets.  The
+//   whole uint64_t range thus fits in a few thousand counters, and
+//   recording a value is a couple of shifts and an increment.
+//
+// Not thread safe: give each thread its own and Add() them up.
+//
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void Record(uint64_t const value, uint64_t const count = 1) noexcept;
+
+  // Record()s "value", plus the values that requests stalled behind it
+  //   would have seen had they been sent every "expected_interval" as
+  //   planned: value - interval, value - 2 * interval... down to the
+  //   interval.  That makes up for coordinated omission, i.e. for a load
+  //   generator that waits for slow replies instead of sending on time,
+  //   and so under-samples exactly the periods when latency is worst.
+  //   An interval of 0 is a plain Record().
+  void RecordCorrected(
+      uint64_t const value,
+      uint64_t const expected_interval
+  ) noexcept;
+
+  // Adds the counts of "other", as they are or as if every value in it had
+  //   been RecordCorrected().
+  void Add(LatencyHistogram const &other) noexcept;
+  void AddCorrected(
+      LatencyHistogram const &other,
+      uint64_t const expected_interval
+  ) noexcept;
+
+  void Clear() noexcept;
+
+  // The value at or below which "percentile" (0 to 100) of the values fall,
+  //   rounded up to the top of its bucket.  0 if nothing was recorded.
+  uint64_t const Percentile(double const percentile) const noexcept;
+
+  uint64_t const count() const noexcept;
+  uint64_t const min() const noexcept;
+  uint64_t const max() const noexcept;
+  double   const mean() const noexcept;
+
+  // The bucket "value" is counted in, and the range of values it holds.
+  static size_t   const Index(uint64_t const value) noexcept;
+  static uint64_t const Lowest(size_t const index) noexcept;
+  static uint64_t const Highest(size_t const index) noexcept;
+
+ private:
+  std::vector<uint64_t> counts_;
+
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  double   sum_;
+};
+
+} // namespace rediswraps
+
+#endif
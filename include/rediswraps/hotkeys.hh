@@ -0,0 +1,159 @@
+#ifndef REDISWRAPS_HOTKEYS_HH
+#define REDISWRAPS_HOTKEYS_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>        // std::unique_ptr to the counters
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rediswraps/commands.hh>
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+class Connection;
+
+struct HotKeyOptions {
+  // Counters per row and rows of the count-min sketch.  Memory is
+  //   width * depth * 4 bytes; the width is rounded up to a power of 2.
+  size_t width = constants::kHotKeySketchWidth;
+  size_t depth = constants::kHotKeySketchDepth;
+
+  // Hottest keys tracked.
+  size_t top_k = constants::kHotKeyTopK;
+
+  // Only one command in this many is looked at.
+  uint32_t sample_every = constants::kHotKeySampleEvery;
+
+  // Every count is halved this often, so keys that cool down drop out.
+  std::chrono::milliseconds decay_interval{constants::kHotKeyDecayIntervalMs};
+};
+
+struct HotKey {
+  std::string key;
+  uint64_t    count      = 0;    // sampled hits counted, after decay
+  double      per_second = 0.0;  // estimated commands per second
+};
+
+
+// HotKeys
+// Finds the most frequently used keys from the client side, while they are
+//   hot rather than after the fact:
+//
+//   auto hot_keys = std::make_shared<rediswraps::HotKeys>();
+//   redis->SampleHotKeys(hot_keys);   // any number of connections
+//   ...
+//   for (auto const &hot : hot_keys->Top()) {
+//     std::cout << hot.key << " ~" << hot.per_second << "/s\n";
+//   }
+//
+// The keys of every sample_every-th command are found from its key
+//   positions, as read from one COMMAND round trip when the first
+//   connection is attached (see Learn()), or, for EVAL/EVALSHA and thus
+//   script aliases, from the keycount argument.  Sampling itself never
+//   talks to the server, so it's safe inside MULTI and in subscribe mode;
+//   commands missing from the table (or all of them, until it is filled)
+//   are skipped.  Each key then goes into a count-min sketch
+//   of atomic counters, so connections on any number of threads can feed
+//   the same HotKeys without locking.  Keys whose estimated count beats the
+//   coldest of the current top K are kept in a small heap; updating it takes
+//   a lock, but only with try_lock, so a busy heap costs an update rather
+//   than a wait.
+//
+// Counts are estimates: the sketch can only overestimate, by roughly
+//   (sampled commands / width) with a probability shrinking with depth.
+//
+class HotKeys {
+ public:
+  explicit HotKeys(HotKeyOptions const &options = {});
+
+  HotKeys(HotKeys const&) = delete;
+  HotKeys& operator=(HotKeys const&) = delete;
+
+  // Reads the key positions of every command from "conn", unless a
+  //   previous call already did.  Connection::SampleHotKeys() calls it;
+  //   the connection must not be in a transaction or subscribed then.
+  //   Returns false if the server could not be asked.
+  bool const Learn(Connection &conn);
+
+  // Called by Connection for each command it sends; argv[0] is the command
+  //   name.
+  void Sample(std::string const *argv, size_t const argc);
+
+  // Counts "weight" uses of "key" as if Sample() had picked them, i.e.
+  //   they stand for sample_every commands each.
+  void Add(std::string const &key, uint32_t const weight = 1);
+
+  // Sampled hits of "key" after decay, as estimated by the sketch.
+  uint64_t const Estimate(std::string const &key) const noexcept;
+
+  // Estimated commands per second using "key".
+  double const Rate(std::string const &key) const noexcept;
+
+  // The hottest keys, hottest first.
+  std::vector<HotKey> Top() const;
+
+  void Clear();
+
+  // Bytes taken by the sketch's counters.
+  size_t const memory() const noexcept;
+
+ private:
+  struct Entry {
+    std::string key;
+    uint64_t    count;
+  };
+
+  // Halves every count if decay_interval has passed since the last time.
+  void Decay(int64_t const now);
+
+  // Offers a key with its new estimate to the top K.
+  void Offer(std::string const &key, uint64_t const count);
+
+  double const PerSecond(
+      uint64_t const count,
+      int64_t const now
+  ) const noexcept;
+
+  size_t const Index(uint64_t const hash, size_t const row) const noexcept;
+
+  HotKeyOptions const options_;
+
+  // Key positions by lowercase command name.  Filled once by Learn(), then
+  //   only read; "learned_" says when it's safe to.
+  std::mutex                                   learn_lock_;
+  std::unordered_map<std::string, CommandInfo> commands_;
+  std::atomic<bool>                            learned_;
+
+  size_t const width_;  // a power of 2
+  size_t const depth_;
+
+  std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+
+  // Steady clock time, in nanoseconds, when counting started or counts
+  //   were last halved, whichever is later.
+  std::atomic<int64_t> since_;
+
+  // Length of time the counts made before "since_" still stand for, in
+  //   nanoseconds: halved at every decay like the counts themselves.
+  std::atomic<int64_t> carried_;
+
+  // Smallest count in a full top K; lower estimates skip the heap entirely.
+  std::atomic<uint64_t> admission_;
+
+  // Commands seen by Sample(), wrapping around: this instance's own, for
+  //   however many connections and threads feed it.
+  std::atomic<uint32_t> seen_;
+
+  // Min-heap on count.
+  mutable std::mutex heap_lock_;
+  std::vector<Entry> heap_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef REDISWRAPS_INTROSPECT_HH
+#define REDISWRAPS_INTROSPECT_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <hiredis/hiredis.h>
+}
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+namespace introspect {
+
+// Typed views of the replies to INFO, SLOWLOG GET, LATENCY LATEST and
+//   MEMORY STATS.  The parsers take replies as RawCmd() returns them, in
+//   either protocol version.
+
+struct InfoSection {
+  std::string name;  // as in its "# Name" header line, e.g. "Replication"
+
+  std::vector<std::pair<std::string, std::string>> fields;
+};
+
+struct Info {
+  std::vector<InfoSection> sections;
+
+  // Value of "field" in whichever section has it; nullptr if none does.
+  std::string const* Find(std::string const &field) const noexcept;
+
+  // Same as Find(), converted to a number; "fallback" if the field is
+  //   missing or not a number.
+  double const Number(
+      std::string const &field,
+      double const fallback = 0.0
+  ) const noexcept;
+};
+
+// Splits the text of an INFO reply into its sections and fields, in order.
+Info ParseInfo(std::string const &text);
+
+// Splits the comma separated "name=value" pairs some INFO values are made
+//   of (e.g. keyspace's "keys=10,expires=0,avg_ttl=0", or commandstats).
+std::unordered_map<std::string, std::string> ParseInfoValue(
+    std::string const &value
+);
+
+
+struct SlowlogEntry {
+  int64_t id          = 0;
+  int64_t timestamp   = 0;  // Unix time, seconds
+  int64_t duration_us = 0;
+
+  std::vector<std::string> args;
+
+  std::string client_address;  // Redis 4.0+
+  std::string client_name;     // Redis 4.0+
+};
+
+// Entries of a SLOWLOG GET reply, newest first as Redis sends them.
+std::vector<SlowlogEntry> ParseSlowlog(redisReply const &reply);
+
+
+// SlowlogCursor
+// Picks the entries not seen before out of successive SLOWLOG GET replies.
+//   Entry IDs only ever grow, until the server restarts (or another one
+//   takes over its address) and they start over from 0.  That shows as a
+//   newest ID below the last one seen, or as the last one seen coming back
+//   with another timestamp; every entry counts as new again then.
+//
+class SlowlogCursor {
+ public:
+  // Takes the entries of a reply, newest first as ParseSlowlog() returns
+  //   them, and returns the unseen ones in the same order.
+  std::vector<SlowlogEntry> Next(std::vector<SlowlogEntry> entries);
+
+ private:
+  int64_t last_id_        = -1;
+  int64_t last_timestamp_ = 0;
+};
+
+
+struct LatencyEvent {
+  std::string event;      // e.g. "command", "fork", "expire-cycle"
+  int64_t     timestamp = 0;  // Unix time of the latest spike, seconds
+  int64_t     latest_ms = 0;
+  int64_t     max_ms    = 0;
+};
+
+std::vector<LatencyEvent> ParseLatencyLatest(redisReply const &reply);
+
+
+// Numeric fields of a MEMORY STATS reply.  Nested ones are flattened with
+//   dots, e.g. "db.0.overhead.hashtable.main"; text fields are left out.
+std::map<std::string, double> ParseMemoryStats(redisReply const &reply);
+
+
+struct CollectorOptions {
+  std::chrono::milliseconds interval{constants::kCollectorIntervalMs};
+
+  // Samples kept per metric; older ones are overwritten.
+  size_t capacity = constants::kCollectorCapacity;
+
+  // INFO section(s) to sample, e.g. "all".  Empty means INFO's defaults.
+  std::string info_section;
+
+  // INFO fields to record.  Empty records every numeric one.
+  std::vector<std::string> info_fields;
+
+  bool   slowlog          = true;
+  size_t slowlog_capacity = constants::kCollectorSlowlogEntries;
+  bool   latency          = true;
+  bool   memory           = false;  // MEMORY STATS is comparatively costly
+};
+
+
+// Collector
+// Samples a server periodically on a background thread, through its own
+//   Connection, so sampling never competes with the application's
+//   connections for their sockets or response queues:
+//
+//   introspect::Collector collector(Ptr(new Connection("10.0.0.2", 6379)));
+//   collector.Start();
+//   ...
+//   auto memory = collector.Series("used_memory");      // (time, value)...
+//   auto slow   = collector.Slowlog();
+//   collector.ExportCsv(std::cout);
+//
+// Every round records, under one timestamp (Unix time, milliseconds):
+//   - the numeric INFO fields by name ("used_memory"), keyspace fields as
+//     "db0.keys" and the like;
+//   - "slowlog.new", the number of SLOWLOG entries since the last round,
+//     which are kept too (see Slowlog() and SlowlogCursor);
+//   - "latency.<event>.latest_ms" and "latency.<event>.max_ms";
+//   - "memory.<field>" for MEMORY STATS, if enabled.
+//
+// Metrics are stored column-wise in fixed size ring buffers: one timestamp
+//   per round, one double per metric per round.  Metrics missing from a
+//   round are stored as NaN and skipped by Series().
+//
+class Collector {
+ public:
+  explicit Collector(Ptr conn, CollectorOptions const &options = {});
+  ~Collector();
+
+  Collector(Collector const&) = delete;
+  Collector& operator=(Collector const&) = delete;
+
+  // Starts or stops the background thread.  Stopping waits for a round in
+  //   progress to finish.
+  void Start();
+  void Stop();
+
+  // Takes one round of samples now, on the calling thread.  Returns false
+  //   if the server could not be queried.
+  bool const Sample();
+
+  std::vector<std::string> Metrics() const;
+
+  std::vector<std::pair<int64_t, double>> Series(
+      std::string const &metric
+  ) const;
+
+  // Most recent value of a metric, or "fallback" if it has none.
+  double const Latest(
+      std::string const &metric,
+      double const fallback = 0.0
+  ) const;
+
+  // Last INFO reply, parsed.
+  Info LastInfo() const;
+
+  // Slowlog entries seen so far, newest first.
+  std::vector<SlowlogEntry> Slowlog() const;
+
+  std::vector<LatencyEvent> Latency() const;
+
+  // One header line, then one line per round: time_ms followed by every
+  //   metric in Metrics() order.  Missing values are left empty.
+  void ExportCsv(std::ostream &os) const;
+
+  size_t   const samples() const;
+  uint64_t const errors() const noexcept;
+
+ private:
+  void Run();
+
+  // Called with lock_ held.
+  void Record(std::string const &metric, double const value);
+
+  Ptr                    conn_;
+  CollectorOptions const options_;
+
+  // One round at a time on conn_, whichever thread calls Sample().
+  std::mutex sample_lock_;
+
+  // Guards everything sampled so far.
+  mutable std::mutex lock_;
+
+  // Ring buffers: "times_" and every column share the same slot indexes.
+  std::vector<int64_t>                       times_;
+  std::map<std::string, std::vector<double>> columns_;
+
+  size_t next_  = 0;  // slot the next round writes to
+  size_t count_ = 0;  // filled slots
+
+  Info                      info_;
+  std::deque<SlowlogEntry>  slowlog_;
+  SlowlogCursor             slowlog_cursor_;
+  std::vector<LatencyEvent> latency_;
+
+  std::atomic<uint64_t> errors_{0};
+
+  // Guards running_ and thread_.
+  std::mutex              control_lock_;
+  std::condition_variable wake_;
+  bool                    running_ = false;
+  std::thread             thread_;
+};
+
+} // namespace introspect
+} // namespace rediswraps
+
+#endif
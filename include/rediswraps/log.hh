@@ -0,0 +1,187 @@
+#ifndef REDISWRAPS_LOG_HH
+#define REDISWRAPS_LOG_HH
+
+#include <atomic>
+#include <cstdint>
+#include <memory>        // std::shared_ptr for sinks
+#include <string>
+#include <thread>
+
+#include <boost/lockfree/queue.hpp>
+
+#include <rediswraps/constants.hh>
+
+
+// Severities below this are compiled out of the library entirely: the calls
+//   become empty inline functions.  0 keeps everything, 4 (kOff) removes
+//   all logging, e.g. -DREDISWRAPS_LOG_LEVEL=3 keeps errors only.  Like
+//   REDISWRAPS_TRACER, it must be the same for the library and the code
+//   using it; the CMake cache variable of the same name takes care of that.
+#ifndef REDISWRAPS_LOG_LEVEL
+#define REDISWRAPS_LOG_LEVEL 0
+#endif
+
+
+namespace rediswraps {
+namespace logging {
+
+enum class Severity : uint8_t {
+  kDebug   = 0,
+  kInfo    = 1,
+  kWarning = 2,
+  kError   = 3,
+  kOff     = 4
+};
+
+// Topic
+// What a message is about.  Rate limits apply per topic and per message
+//   prefix: the first kLogRateLimitPrefix bytes of a message's first part,
+//   which is the error code for error replies and the fixed text for the
+//   library's own messages.  An error storm (say, WRONGTYPE replies on a hot
+//   key) can't drown out other errors of the same topic, nor other topics.
+//   Prefixes are hashed into kLogRateLimitSlots limits per topic; the rare
+//   prefixes that collide share one.
+enum class Topic : uint8_t {
+  kReply,       // error replies from Redis
+  kConnection,  // lost connections, lost replies, protocol negotiation
+  kScript,      // loading Lua scripts
+  kUsage,       // API misuse, e.g. wrong argument counts
+  kPush,        // RESP3 push frames
+  kCount        // number of topics; not a topic
+};
+
+char const* SeverityName(Severity const severity) noexcept;
+char const* TopicName(Topic const topic) noexcept;
+
+
+// Record
+// One message, as handed to a sink.  "suppressed" counts the messages of the
+//   same topic and prefix dropped by the rate limit just before this one.
+struct Record {
+  Severity    severity   = Severity::kInfo;
+  Topic       topic      = Topic::kReply;
+  int64_t     time       = 0;  // Unix epoch nanoseconds
+  uint32_t    suppressed = 0;
+  std::string message;
+};
+
+
+// Sink
+// Where records go.  Write() may be called from any thread, concurrently.
+//
+class Sink {
+ public:
+  virtual ~Sink() = default;
+
+  virtual void Write(Record const &record) = 0;
+  virtual void Flush() {}
+};
+
+
+// StderrSink
+// The default: one line per record, written to stderr with a single call.
+//
+class StderrSink : public Sink {
+ public:
+  void Write(Record const &record) override;
+  void Flush() override;
+};
+
+
+// AsyncSink
+// Hands records over to a background thread through a fixed-size lock-free
+//   queue and returns immediately; the thread forwards them to "target".
+//   Callers never block on the target or on each other.
+//
+// Messages are truncated to kLogMaxMessageLength bytes on the way.  When
+//   the queue is full, records are dropped and counted in dropped().
+//   Destroying the sink forwards whatever is still queued first.
+//
+class AsyncSink : public Sink {
+ public:
+  explicit AsyncSink(
+      std::shared_ptr<Sink> target,
+      size_t const capacity = constants::kLogQueueCapacity
+  );
+
+  ~AsyncSink();
+
+  void Write(Record const &record) override;
+
+  // Waits until everything queued so far reached the target.
+  void Flush() override;
+
+  uint64_t const dropped() const noexcept;
+
+ private:
+  struct Slot {
+    Severity severity;
+    Topic    topic;
+    uint16_t length;
+    uint32_t suppressed;
+    int64_t  time;
+    char     text[constants::kLogMaxMessageLength];
+  };
+
+  size_t const Drain();
+  void Run();
+
+  std::shared_ptr<Sink> target_;
+
+  boost::lockfree::queue<Slot, boost::lockfree::fixed_sized<true>> queue_;
+
+  std::atomic<uint64_t> queued_;
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<bool>     running_;
+
+  std::thread thread_;
+};
+
+
+// Configuration.  Defaults: StderrSink, kInfo, kLogRateLimitPerSecond
+//   messages per topic and prefix per second.  SetRateLimit() sets it for
+//   every prefix of the topic.
+//
+// SetSink() is meant for startup; a replaced sink is kept alive until exit
+//   since other threads may still be writing to it.  nullptr discards every
+//   message.
+//
+void SetSink(std::shared_ptr<Sink> sink);
+void SetLevel(Severity const level) noexcept;
+void SetRateLimit(Topic const topic, uint32_t const per_second) noexcept;
+
+
+// Log()
+// Checks the severity and the rate limit, then builds the message by
+//   concatenating "parts" (anything utils::ToString() accepts) and writes it.
+//   Nothing is formatted for messages that won't be written.
+//
+//   logging::Log<Severity::kError>(Topic::kReply, reply->str);
+//
+template<Severity severity, typename... Parts>
+void Log(Topic const topic, Parts const&... parts);
+
+
+// Used by Log(): whether a message passes the level and the rate limit of
+//   its topic and "prefix" (a hash, see PrefixKey()), and the number of
+//   messages suppressed before it.
+bool const Admit(
+    Severity const severity,
+    Topic const topic,
+    uint64_t const prefix,
+    uint32_t &suppressed
+) noexcept;
+
+void Write(
+    Severity const severity,
+    Topic const topic,
+    uint32_t const suppressed,
+    std::string &&message
+);
+
+} // namespace logging
+} // namespace rediswraps
+
+#include <rediswraps/log.inl>
+#endif
@@ -0,0 +1,102 @@
+/* log.inl
+ *   Template implementations and static definitions for log.hh
+*/
+
+#include <algorithm>  // std::min
+#include <cstring>    // strnlen()
+
+#include <rediswraps/utils.hh>
+
+
+namespace rediswraps {
+namespace logging {
+
+// Helpers for Log() {{{
+inline
+void AppendParts(std::string &message) {}
+
+
+template<typename Part, typename... Parts>
+void AppendParts(
+    std::string &message,
+    Part const &part,
+    Parts const&... parts
+) {
+  message += utils::ToString(part);
+  AppendParts(message, parts...);
+}
+
+
+// The rate limit key: FNV-1a over the first kLogRateLimitPrefix bytes of the
+//   first part, when it is a string.  Nothing is formatted for it.
+inline
+uint64_t const HashPrefix(char const *str, size_t const length) noexcept {
+  uint64_t hash = 14695981039346656037ull;
+
+  for (size_t i = 0; i < std::min(length, constants::kLogRateLimitPrefix); ++i) {
+    hash ^= static_cast<unsigned char>(str[i]);
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+
+inline
+uint64_t const PartKey(char const *part) noexcept {
+  return (part == nullptr) ?
+    0 : HashPrefix(part, strnlen(part, constants::kLogRateLimitPrefix));
+}
+
+
+inline
+uint64_t const PartKey(char *part) noexcept {
+  return PartKey(static_cast<char const*>(part));
+}
+
+
+inline
+uint64_t const PartKey(std::string const &part) noexcept {
+  return HashPrefix(part.data(), part.size());
+}
+
+
+template<typename Part>
+uint64_t const PartKey(Part const &part) noexcept {
+  return 0;
+}
+
+
+inline
+uint64_t const PrefixKey() noexcept {
+  return 0;
+}
+
+
+template<typename Part, typename... Parts>
+uint64_t const PrefixKey(Part const &part, Parts const&... parts) noexcept {
+  return PartKey(part);
+}
+// }}}
+
+
+template<Severity severity, typename... Parts>
+void Log(Topic const topic, Parts const&... parts) {
+  if (static_cast<int>(severity) < REDISWRAPS_LOG_LEVEL) {
+    return;
+  }
+
+  uint32_t suppressed = 0;
+
+  if (!Admit(severity, topic, PrefixKey(parts...), suppressed)) {
+    return;
+  }
+
+  std::string message;
+  AppendParts(message, parts...);
+
+  Write(severity, topic, suppressed, std::move(message));
+}
+
+} // namespace logging
+} // namespace rediswraps
@@ -0,0 +1,127 @@
+#ifndef REDISWRAPS_MAPPER_HH
+#define REDISWRAPS_MAPPER_HH
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/preprocessor/punctuation/comma_if.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/seq/for_each_i.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/preprocessor/variadic/size.hpp>
+#include <boost/preprocessor/variadic/to_seq.hpp>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/pipeline.hh>
+
+
+namespace rediswraps {
+namespace mapper {
+
+// Fields<T>
+// Which members of T are stored in its hash, and under which field names.
+//   Specialized by REDISWRAPS_MAP_HASH(); see below.
+//
+template<typename T>
+struct Fields : std::false_type {};
+
+
+// Store() / Load()
+// Map an object to the Redis hash at "key" and back, one round trip each:
+//
+//   struct User {
+//     std::string                  name;
+//     int                          age = 0;
+//     boost::optional<std::string> email;
+//   };
+//
+//   REDISWRAPS_MAP_HASH(User, name, age, email)   // at global scope
+//
+//   mapper::Store(*redis, "user:42", user);       // HSET user:42 name .. age ..
+//   mapper::Load(*redis, "user:42", user);        // HMGET user:42 name age email
+//
+// Hash fields are named after the members.  Members can be strings, any
+//   fundamental type, or boost::optional of those:
+//   - Store() writes every member with a single HSET.  Empty optionals
+//     have their field removed with an HDEL pipelined behind it.
+//   - Load() reads every field with a single HMGET in declaration order
+//     and decodes each value straight into its member.  Missing fields
+//     leave optionals empty and other members default-constructed.
+//
+// Store() returns false if a reply was missing or an error.  Load() also
+//   returns false, leaving "object" untouched, if the hash doesn't exist.
+//
+template<typename T>
+bool const Store(Connection &conn, std::string const &key, T const &object);
+
+template<typename T>
+bool const Load(Connection &conn, std::string const &key, T &object);
+
+
+// StoreMany() / LoadMany()
+// The same for many objects at once: every command is pipelined, so the
+//   whole batch takes one round trip.  objects[i] goes to, or comes from,
+//   keys[i]; LoadMany() leaves objects[i] empty if keys[i] doesn't exist.
+//
+template<typename T>
+bool const StoreMany(
+    Connection &conn,
+    std::vector<std::string> const &keys,
+    std::vector<T> const &objects
+);
+
+template<typename T>
+bool const LoadMany(
+    Connection &conn,
+    std::vector<std::string> const &keys,
+    std::vector<boost::optional<T>> &objects
+);
+
+} // namespace mapper
+} // namespace rediswraps
+
+
+// REDISWRAPS_MAP_HASH(Type, members...)
+// Registers the members of Type that Store() and Load() map to hash
+//   fields.  Must be used at global scope, after Type is complete.
+//
+#define REDISWRAPS_MAP_HASH_NAME(r, data, i, member) \
+  BOOST_PP_COMMA_IF(i) BOOST_PP_STRINGIZE(member)
+
+#define REDISWRAPS_MAP_HASH_VISIT(r, object, member) \
+  visit(BOOST_PP_STRINGIZE(member), object.member);
+
+#define REDISWRAPS_MAP_HASH(Type, ...)                                       \
+  namespace rediswraps {                                                     \
+  namespace mapper {                                                         \
+  template<>                                                                 \
+  struct Fields<Type> : std::true_type {                                     \
+    static constexpr size_t kCount = BOOST_PP_VARIADIC_SIZE(__VA_ARGS__);    \
+                                                                             \
+    static std::vector<std::string> const& Names() {                         \
+      static std::vector<std::string> const names = {                        \
+        BOOST_PP_SEQ_FOR_EACH_I(                                             \
+          REDISWRAPS_MAP_HASH_NAME,                                          \
+          _,                                                                 \
+          BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__)                              \
+        )                                                                    \
+      };                                                                     \
+      return names;                                                          \
+    }                                                                        \
+                                                                             \
+    template<typename Object, typename Visitor>                              \
+    static void Visit(Object &object, Visitor &visit) {                      \
+      BOOST_PP_SEQ_FOR_EACH(                                                 \
+        REDISWRAPS_MAP_HASH_VISIT,                                           \
+        object,                                                              \
+        BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__)                                \
+      )                                                                      \
+    }                                                                        \
+  };                                                                         \
+  }                                                                          \
+  }
+
+#include <rediswraps/mapper.inl>
+#endif
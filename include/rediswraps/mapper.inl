@@ -0,0 +1,243 @@
+/* mapper.inl
+ *   Template implementations and static definitions for mapper.hh
+*/
+
+#include <rediswraps/decode.hh>
+#include <rediswraps/utils.hh>
+
+
+namespace rediswraps {
+namespace mapper {
+
+// Helpers for Store() and Load() {{{
+// Collects "field value" pairs for HSET, and the fields of empty optionals
+//   for HDEL.
+struct FieldWriter {
+  std::vector<std::string> &hset;
+  std::vector<std::string> &hdel;
+
+  template<typename T>
+  void operator()(char const *name, T const &value) {
+    this->hset.emplace_back(name);
+    this->hset.push_back(utils::ToString(value));
+  }
+
+  template<typename T>
+  void operator()(char const *name, boost::optional<T> const &value) {
+    if (value) {
+      (*this)(name, *value);
+    }
+    else {
+      this->hdel.emplace_back(name);
+    }
+  }
+};
+
+
+// Decodes the elements of an HMGET reply into the members, in order.
+struct FieldReader {
+  redisReply const *reply;
+  size_t            index;
+  bool              decoded;
+
+  template<typename T>
+  void operator()(char const*, T &member) {
+    this->decoded =
+      reply::Decode(this->reply->element[this->index++], member) &&
+      this->decoded;
+  }
+};
+
+
+template<typename T>
+void CheckRegistered() {
+  static_assert(
+    Fields<T>::value,
+    "Register the type's members with REDISWRAPS_MAP_HASH(Type, members...)."
+  );
+}
+
+
+// Adds the commands storing "object" and returns how many there are.
+template<typename T>
+size_t const AddStore(
+    Pipeline &pipeline,
+    std::string const &key,
+    T const &object
+) {
+  std::vector<std::string> hset = {"HSET", key};
+  std::vector<std::string> hdel = {"HDEL", key};
+
+  hset.reserve(2 + 2 * Fields<T>::kCount);
+
+  FieldWriter writer = {hset, hdel};
+  Fields<T>::Visit(object, writer);
+
+  size_t commands = 0;
+
+  if (hset.size() > 2) {
+    pipeline.AddArgv(hset);
+    ++commands;
+  }
+
+  if (hdel.size() > 2) {
+    pipeline.AddArgv(hdel);
+    ++commands;
+  }
+
+  return commands;
+}
+
+
+template<typename T>
+void AddLoad(Pipeline &pipeline, std::string const &key) {
+  std::vector<std::string> hmget = {"HMGET", key};
+  std::vector<std::string> const &names = Fields<T>::Names();
+
+  hmget.insert(hmget.end(), names.begin(), names.end());
+
+  pipeline.AddArgv(hmget);
+}
+
+
+// Returns false if the reply isn't an HMGET reply for T; "found" tells
+//   whether the hash exists, in which case "object" holds it.
+template<typename T>
+bool const ReadLoad(redisReply const *reply, T &object, bool &found) {
+  found = false;
+
+  if (
+      !reply::IsAggregate(reply) ||
+      reply->elements != Fields<T>::kCount
+  ) {
+    return false;
+  }
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    found = found || reply->element[i]->type != REDIS_REPLY_NIL;
+  }
+
+  if (!found) {
+    return true;
+  }
+
+  FieldReader reader = {reply, 0, true};
+  Fields<T>::Visit(object, reader);
+
+  return reader.decoded;
+}
+
+
+inline
+bool const AllSucceeded(std::vector<ReplyPtr> const &replies) {
+  for (auto const &reply : replies) {
+    if (!reply || reply->type == REDIS_REPLY_ERROR) {
+      return false;
+    }
+  }
+
+  return true;
+}
+// }}}
+
+
+template<typename T>
+bool const Store(Connection &conn, std::string const &key, T const &object) {
+  CheckRegistered<T>();
+
+  Pipeline pipeline(conn);
+  AddStore(pipeline, key, object);
+
+  return AllSucceeded(pipeline.ExecuteRaw());
+}
+
+
+template<typename T>
+bool const Load(Connection &conn, std::string const &key, T &object) {
+  CheckRegistered<T>();
+
+  Pipeline pipeline(conn);
+  AddLoad<T>(pipeline, key);
+
+  auto const replies = pipeline.ExecuteRaw();
+
+  if (replies.size() != 1 || !replies.front()) {
+    return false;
+  }
+
+  // Decoded into a copy: a failed or missing hash leaves "object" alone.
+  T loaded(object);
+  bool found;
+
+  if (!ReadLoad(replies.front().get(), loaded, found) || !found) {
+    return false;
+  }
+
+  object = std::move(loaded);
+  return true;
+}
+
+
+template<typename T>
+bool const StoreMany(
+    Connection &conn,
+    std::vector<std::string> const &keys,
+    std::vector<T> const &objects
+) {
+  CheckRegistered<T>();
+
+  if (keys.size() != objects.size()) {
+    return false;
+  }
+
+  Pipeline pipeline(conn);
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    AddStore(pipeline, keys[i], objects[i]);
+  }
+
+  return AllSucceeded(pipeline.ExecuteRaw());
+}
+
+
+template<typename T>
+bool const LoadMany(
+    Connection &conn,
+    std::vector<std::string> const &keys,
+    std::vector<boost::optional<T>> &objects
+) {
+  CheckRegistered<T>();
+
+  objects.assign(keys.size(), boost::none);
+
+  Pipeline pipeline(conn);
+
+  for (auto const &key : keys) {
+    AddLoad<T>(pipeline, key);
+  }
+
+  auto const replies = pipeline.ExecuteRaw();
+
+  if (replies.size() != keys.size()) {
+    return false;
+  }
+
+  bool success = true;
+
+  for (size_t i = 0; i < replies.size(); ++i) {
+    T    object = T();
+    bool found;
+
+    if (!replies[i] || !ReadLoad(replies[i].get(), object, found)) {
+      success = false;
+    }
+    else if (found) {
+      objects[i] = std::move(object);
+    }
+  }
+
+  return success;
+}
+
+} // namespace mapper
+} // namespace rediswraps
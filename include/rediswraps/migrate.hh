@@ -0,0 +1,160 @@
+#ifndef REDISWRAPS_MIGRATE_HH
+#define REDISWRAPS_MIGRATE_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+struct MigrationOptions {
+  // Workers, each with its own pair of connections.
+  size_t threads = constants::kMigrateThreads;
+
+  // Keys asked for per SCAN (its COUNT hint); each SCAN reply becomes one
+  //   batch of DUMPs and RESTOREs.
+  size_t batch = constants::kMigrateBatchKeys;
+
+  // Only keys matching this glob-style pattern (SCAN MATCH); all if empty.
+  std::string match;
+
+  // Databases to read from and write to (SELECT).
+  int source_db      = 0;
+  int destination_db = 0;
+
+  // Keys per second across all workers; 0 for as fast as they go.
+  double keys_per_second = 0.0;
+
+  // Overwrite keys the destination already has.  Without it they fail with
+  //   a BUSYKEY error and are left alone.
+  bool replace = true;
+
+  // Count the keys on both sides once done; see Migration::Run().
+  bool verify = true;
+};
+
+struct MigrationStats {
+  uint64_t scanned  = 0;  // keys SCAN returned, repeats included
+  uint64_t migrated = 0;  // restored on the destination
+  uint64_t vanished = 0;  // deleted or expired before they could be dumped
+  uint64_t failed   = 0;  // not migrated: error replies or broken connections
+  uint64_t bytes    = 0;  // DUMP payloads restored
+
+  // Key counts on either side after the migration, if verified.
+  uint64_t source_keys      = 0;
+  uint64_t destination_keys = 0;
+
+  std::chrono::milliseconds elapsed{0};
+};
+
+
+// Migration
+// Copies keys from one Redis server (or database) to another, e.g. to
+//   re-shard or to move to a new version:
+//
+//   Connection old_server("10.0.0.1", 6379), new_server("10.0.0.2", 6379);
+//
+//   rediswraps::MigrationOptions options;
+//   options.match = "user:*";
+//   options.keys_per_second = 50000;
+//
+//   rediswraps::Migration migration(old_server, new_server, options);
+//   bool const ok = migration.Run();
+//
+// The calling thread SCANs the source and hands each batch of keys to one
+//   of "threads" workers.  A worker pipelines DUMP and PTTL for the whole
+//   batch on the source, then RESTORE (with REPLACE and the remaining TTL)
+//   for the whole batch on the destination: two round trips per batch no
+//   matter how many keys it holds, and the workers' batches overlap.
+//
+// Only the addresses of "source" and "destination" are used: every worker,
+//   and the scan, opens connections of its own.  Keys written to the source
+//   while it is being scanned may or may not be migrated, as SCAN itself
+//   only guarantees keys that exist throughout; keys it returns twice are
+//   simply restored twice.
+//
+// Errors are logged and counted in stats() rather than stopping the
+//   migration.  Stats are updated as it goes, so another thread may watch
+//   its progress or Stop() it.
+//
+class Migration {
+ public:
+  Migration(
+      Connection const &source,
+      Connection const &destination,
+      MigrationOptions const &options = {}
+  );
+
+  Migration(Migration const&) = delete;
+  Migration& operator=(Migration const&) = delete;
+
+  // Run()
+  // Migrates every (matching) key and returns true if none failed and, with
+  //   "verify", if both sides then hold as many (matching) keys.  The count
+  //   only adds up when nothing else writes to either side meanwhile, and
+  //   the destination held none of those keys beforehand.
+  //
+  // Returns false right away if the connections can't be opened.
+  //
+  bool const Run();
+
+  // Has Run() return as soon as the batches in progress are done.  Safe to
+  //   call from any thread.
+  void Stop() noexcept;
+
+  MigrationStats const stats() const noexcept;
+
+ private:
+  // Where to open connections, copied from those given.
+  struct Address {
+    std::string socket;
+    std::string host;
+    int         port;
+    std::string name;
+  };
+
+  static Address const AddressOf(Connection const &conn);
+  static Ptr Open(Address const &address);
+
+  // Migrates one batch of keys between a worker's connections.
+  void Migrate(
+      Connection &source,
+      Connection &destination,
+      std::vector<std::string> const &keys
+  );
+
+  // Keys in "db" (matching options_.match) on the connection.
+  bool const Count(Connection &conn, int const db, uint64_t &count);
+
+  // Waits for room to send "keys" more keys under the throttle.
+  void Pace(size_t const keys);
+
+  Address const          source_;
+  Address const          destination_;
+  MigrationOptions const options_;
+
+  std::atomic<bool> stopped_;
+
+  std::mutex                            pace_lock_;
+  std::chrono::steady_clock::time_point next_slot_;
+
+  std::atomic<uint64_t> scanned_;
+  std::atomic<uint64_t> migrated_;
+  std::atomic<uint64_t> vanished_;
+  std::atomic<uint64_t> failed_;
+  std::atomic<uint64_t> bytes_;
+  std::atomic<uint64_t> source_keys_;
+  std::atomic<uint64_t> destination_keys_;
+  std::atomic<int64_t>  elapsed_ms_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef REDISWRAPS_PIPELINE_HH
+#define REDISWRAPS_PIPELINE_HH
+
+#include <string>
+#include <vector>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/prepared.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+// Pipeline
+// Batches commands so that all of them reach Redis in a single write and
+//   their replies are read back in a single pass, i.e. one round trip for
+//   the whole batch instead of one per command.
+//
+//   Pipeline pipe(*redis);
+//   pipe.Add("set", "foo", 123).Add("incr", "foo").Add("lrange", "bar", 0, -1);
+//   auto responses = pipe.Execute();
+//
+// Commands are RESP-encoded as they are added.  Script aliases registered
+//   through Connection::LoadScript*() are expanded to EVALSHA just as Cmd()
+//   expands them.  Execute() clears the pipeline so it can be reused.
+//
+// Nothing is sent to Redis if the pipeline is destroyed before Execute().
+//
+class Pipeline {
+ public:
+  explicit Pipeline(Connection &conn);
+
+  template<typename... Args>
+  Pipeline& Add(std::string const &base, Args&&... args);
+
+  // Adds one call of a prepared command; see Connection::Prepare().
+  // Throws std::invalid_argument, adding nothing, if the number of
+  //   arguments is wrong: the replies would no longer match the commands.
+  template<typename... Args>
+  Pipeline& Add(PreparedCmd const &prepared, Args&&... args);
+
+  // For commands whose argument count is only known at runtime.
+  // argv[0] is the command itself; script aliases are not expanded.
+  Pipeline& AddArgv(std::vector<std::string> const &argv);
+
+  size_t const size()  const noexcept;
+  bool   const empty() const noexcept;
+
+  void Clear() noexcept;
+
+  // Execute()
+  // Sends every queued command and returns one cmd::Response per command,
+  //   in the order they were added.  The flags have the same meaning as for
+  //   Connection::Cmd(): kFlush empties the connection's response queue once
+  //   beforehand, and with kQueue every reply is also queued there (array
+  //   replies have their elements queued, again exactly like Cmd()).
+  //
+  // If the connection breaks partway through, the remaining commands come
+  //   back as failed responses; they are not re-sent, since some of them may
+  //   already have been applied.
+  //
+  template<cmd::Flag flags = cmd::Flag::kDefault>
+  std::vector<cmd::Response> Execute();
+
+  // ExecuteRaw()
+  // Same as Execute() but hands back each hiredis reply tree untouched.
+  //   Entries are nullptr for commands whose reply could not be read.
+  //
+  std::vector<ReplyPtr> ExecuteRaw();
+
+  // Write() / ReadRaw()
+  // ExecuteRaw() split in two, for driving pipelines on several connections
+  //   at once: Write() every pipeline first, so that all servers work on
+  //   their batches in parallel, then ReadRaw() each of them.  Total latency
+  //   then tracks the slowest server instead of the sum of all of them.
+  //
+  // Write() returns false if the commands could not be sent; ReadRaw() then
+  //   yields nullptr replies for all of them.  The pipeline may be refilled
+  //   as soon as Write() returns.
+  //
+  bool const Write();
+  std::vector<ReplyPtr> ReadRaw();
+
+ private:
+  Connection &conn_;
+
+  // RESP encoding of every command added so far.
+  std::string buffer_;
+  size_t      count_ = 0;
+
+  // Commands written but whose replies have not been read yet.
+  size_t      unread_  = 0;
+  bool        written_ = false;
+
+  // Discarded commands the connection had buffered ahead of ours.
+  size_t      discarded_ahead_ = 0;
+
+  // One trace event per command written, finished as its reply is read.
+  std::vector<trace::Event> events_;
+  std::vector<std::string>  event_commands_;
+
+  // Observes every command in buffer_ and starts its trace event.
+  void Trace();
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/pipeline.inl>
+#endif
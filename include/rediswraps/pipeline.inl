@@ -0,0 +1,102 @@
+/* pipeline.inl
+ *   Template implementations and static definitions for pipeline.hh
+*/
+
+#include <stdexcept>
+
+
+namespace rediswraps {
+
+inline
+Pipeline::Pipeline(Connection &conn)
+  : conn_(conn)
+{}
+
+
+inline
+size_t const Pipeline::size() const noexcept {
+  return this->count_;
+}
+
+
+inline
+bool const Pipeline::empty() const noexcept {
+  return this->count_ == 0;
+}
+
+
+inline
+void Pipeline::Clear() noexcept {
+  this->buffer_.clear();
+  this->count_ = 0;
+}
+
+
+template<typename... Args>
+Pipeline& Pipeline::Add(std::string const &base, Args&&... args) {
+  if (this->conn_.scripts_.count(base)) {
+    this->conn_.FormatCmd(
+      this->buffer_,
+      "EVALSHA",
+      this->conn_.scripts_[base].first,
+      this->conn_.scripts_[base].second,
+      std::forward<Args>(args)...
+    );
+  }
+  else {
+    this->conn_.FormatCmd(this->buffer_, base, std::forward<Args>(args)...);
+  }
+
+  ++this->count_;
+  return *this;
+}
+
+
+template<typename... Args>
+Pipeline& Pipeline::Add(PreparedCmd const &prepared, Args&&... args) {
+  // Encode() logged why; carrying on would shift every later reply.
+  if (!prepared.Encode(this->buffer_, std::forward<Args>(args)...)) {
+    throw std::invalid_argument(
+      "Wrong number of arguments to prepared command '" +
+      prepared.command() + "' added to a pipeline."
+    );
+  }
+
+  ++this->count_;
+  return *this;
+}
+
+
+template<cmd::Flag flags>
+std::vector<cmd::Response> Pipeline::Execute() {
+  static_assert(
+    cmd::FlagsAreLegal<flags>::value,
+    "Illegal combination of cmd::Flag values."
+  );
+
+  if (cmd::FlagsFlushResponses<flags>::value) {
+    this->conn_.Flush();
+  }
+
+  std::vector<cmd::Response> responses;
+  responses.reserve(this->count_);
+
+  for (auto &reply : this->ExecuteRaw()) {
+    if (!reply) {
+      responses.emplace_back(
+        "Redis reply is null; the pipeline was interrupted.",
+        false
+      );
+
+      continue;
+    }
+
+    // ParseReply() takes ownership of the reply it is handed.
+    this->conn_.reply_ = reply.release();
+    responses.push_back(this->conn_.ParseReply<flags>(this->conn_.reply_));
+  }
+
+  return responses;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,108 @@
+#ifndef REDISWRAPS_PREPARED_HH
+#define REDISWRAPS_PREPARED_HH
+
+#include <string>
+#include <vector>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+// PreparedCmd
+// A command shape with its constant parts already RESP-encoded; created by
+//   Connection::Prepare().
+//
+//   auto incr = redis->Prepare("hincrby", CMD_PLACEHOLDER, "views", 1);
+//   incr.Cmd("stats:42");                 // hincrby stats:42 views 1
+//   int views = incr.Cmd("stats:43");     // hincrby stats:43 views 1
+//
+// The encoded command is stored as the segments between placeholders:
+//
+//   "*5\r\n$7\r\nhincrby\r\n" <arg> "$5\r\nviews\r\n$1\r\n1\r\n"
+//
+//   so a call is a handful of appends plus the formatting of the arguments
+//   that actually vary.  Script aliases are bound to EVALSHA, their SHA and
+//   keycount when prepared.
+//
+// Calls take exactly one argument per CMD_PLACEHOLDER; anything else is
+//   reported and the command is not sent.  Replies, flags, tracing and
+//   reconnection all behave exactly as with Connection::Cmd().
+//
+class PreparedCmd {
+ public:
+  template<typename... Args>
+  PreparedCmd(Connection &conn, std::string const &base, Args&&... args);
+
+  template<cmd::Flag flags = cmd::Flag::kDefault,
+      typename RetType = cmd::Response,
+      typename... Args
+  >
+  RetType Cmd(Args&&... args) noexcept;
+
+  // Same as Connection::RawCmd(); nullptr if no reply could be read or
+  //   the number of arguments is wrong.
+  template<typename... Args>
+  ReplyPtr RawCmd(Args&&... args);
+
+  // Appends the complete RESP encoding of one call to "buffer", e.g. for
+  //   Pipeline::Add().  Returns false, leaving "buffer" untouched, if the
+  //   number of arguments is wrong.
+  template<typename... Args>
+  bool const Encode(std::string &buffer, Args&&... args) const;
+
+  // Number of CMD_PLACEHOLDER slots, i.e. arguments each call takes.
+  size_t const arity() const noexcept;
+
+  // The command as sent: "EVALSHA" for script aliases.
+  std::string const& command() const noexcept;
+
+ private:
+  void Bind() noexcept;
+
+  template<typename... Args>
+  void Bind(cmd::Placeholder const&, Args&&... args);
+
+  template<typename Arg, typename... Args>
+  void Bind(Arg const &arg, Args&&... args);
+
+  void EncodeArgs(std::string &buffer, size_t const index) const noexcept;
+
+  template<typename Arg, typename... Args>
+  void EncodeArgs(
+      std::string &buffer,
+      size_t const index,
+      Arg const &arg,
+      Args&&... args
+  ) const;
+
+  static void AppendArg(std::string &buffer, std::string const &arg);
+
+  template<typename Arg>
+  static void AppendArg(std::string &buffer, Arg const &arg);
+
+  // Formats one call and starts its trace event; false if the number of
+  //   arguments is wrong.
+  template<typename... Args>
+  bool const Begin(std::string &buffer, trace::Event &event, Args&&... args);
+
+  Connection &conn_;
+
+  std::string command_;
+  size_t      argc_ = 0;  // total, constants and placeholders alike
+
+  // Encoded bytes before the first placeholder (header included), between
+  //   each pair of placeholders, and after the last one.
+  std::vector<std::string> segments_;
+
+  // Typical size of one encoded call, to size buffers up front.
+  size_t encoded_size_ = 0;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/prepared.inl>
+
+#endif
@@ -0,0 +1,173 @@
+/* prepared.inl
+ *   Template implementations and static definitions for prepared.hh
+*/
+
+#include <rediswraps/log.hh>
+#include <rediswraps/utils.hh>
+
+
+namespace rediswraps {
+
+template<typename... Args>
+PreparedCmd Connection::Prepare(std::string const &base, Args&&... args) {
+  return PreparedCmd(*this, base, std::forward<Args>(args)...);
+}
+
+
+template<typename... Args>
+PreparedCmd::PreparedCmd(
+    Connection &conn,
+    std::string const &base,
+    Args&&... args
+)
+  : conn_(conn),
+    command_(base),
+    argc_(1 + sizeof...(args)),
+    segments_(1)
+{
+  std::string sha;
+  std::string keycount;
+
+  {
+    std::lock_guard<std::mutex> scripts_lock_guard(Connection::scripts_lock_);
+
+    auto const script = Connection::scripts_.find(base);
+
+    if (script != Connection::scripts_.end()) {
+      this->command_ = "EVALSHA";
+      this->argc_   += 2;
+
+      sha      = script->second.first;
+      keycount = utils::ToString(script->second.second);
+    }
+  }
+
+  this->segments_.back() = "*" + std::to_string(this->argc_) + "\r\n";
+  PreparedCmd::AppendArg(this->segments_.back(), this->command_);
+
+  if (!sha.empty()) {
+    PreparedCmd::AppendArg(this->segments_.back(), sha);
+    PreparedCmd::AppendArg(this->segments_.back(), keycount);
+  }
+
+  this->Bind(std::forward<Args>(args)...);
+
+  for (auto const &segment : this->segments_) {
+    this->encoded_size_ += segment.size();
+  }
+}
+
+
+template<typename... Args>
+void PreparedCmd::Bind(cmd::Placeholder const&, Args&&... args) {
+  this->segments_.emplace_back();
+  this->Bind(std::forward<Args>(args)...);
+}
+
+
+template<typename Arg, typename... Args>
+void PreparedCmd::Bind(Arg const &arg, Args&&... args) {
+  PreparedCmd::AppendArg(this->segments_.back(), arg);
+  this->Bind(std::forward<Args>(args)...);
+}
+
+
+template<typename Arg>
+void PreparedCmd::AppendArg(std::string &buffer, Arg const &arg) {
+  PreparedCmd::AppendArg(buffer, utils::ToString(arg));
+}
+
+
+template<typename Arg, typename... Args>
+void PreparedCmd::EncodeArgs(
+    std::string &buffer,
+    size_t const index,
+    Arg const &arg,
+    Args&&... args
+) const {
+  PreparedCmd::AppendArg(buffer, arg);
+  buffer += this->segments_[index];
+
+  this->EncodeArgs(buffer, index + 1, std::forward<Args>(args)...);
+}
+
+
+template<typename... Args>
+bool const PreparedCmd::Encode(std::string &buffer, Args&&... args) const {
+  if (sizeof...(args) != this->arity()) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kUsage,
+      "'", this->command_, "' was prepared with ", this->arity(),
+      " placeholder(s) but called with ", sizeof...(args), " argument(s)."
+    );
+
+    return false;
+  }
+
+  buffer.reserve(buffer.size() + this->encoded_size_ + 64);
+  buffer += this->segments_.front();
+
+  this->EncodeArgs(buffer, 1, std::forward<Args>(args)...);
+
+  return true;
+}
+
+
+template<typename... Args>
+bool const PreparedCmd::Begin(
+    std::string &buffer,
+    trace::Event &event,
+    Args&&... args
+) {
+  if (!this->Encode(buffer, std::forward<Args>(args)...)) {
+    return false;
+  }
+
+  this->conn_.ObserveEncoded(buffer, 0);
+
+  if (trace::Tracer::kEnabled) {
+    trace::Begin(event, this->conn_, &this->command_, 1);
+    event.argc          = this->argc_;
+    event.request_bytes = buffer.size();
+  }
+
+  return true;
+}
+
+
+template<cmd::Flag flags, typename RetType, typename... Args>
+RetType PreparedCmd::Cmd(Args&&... args) noexcept {
+  static_assert(
+    cmd::FlagsAreLegal<flags>::value,
+    "Illegal combination of cmd::Flag values."
+  );
+
+  if (cmd::FlagsFlushResponses<flags>::value) {
+    this->conn_.Flush();
+  }
+
+  std::string  buffer;
+  trace::Event event;
+
+  cmd::Response response =
+    this->Begin(buffer, event, std::forward<Args>(args)...) ?
+      this->conn_.FormattedCmdProxy<flags>(buffer, event) :
+      cmd::Response("Wrong number of arguments to a prepared command", false);
+
+  return static_cast<RetType>(response);
+}
+
+
+template<typename... Args>
+ReplyPtr PreparedCmd::RawCmd(Args&&... args) {
+  std::string  buffer;
+  trace::Event event;
+
+  if (!this->Begin(buffer, event, std::forward<Args>(args)...)) {
+    return nullptr;
+  }
+
+  return ReplyPtr(this->conn_.FormattedCmdReply(buffer, event));
+}
+
+} // namespace rediswraps
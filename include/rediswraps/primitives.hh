@@ -0,0 +1,301 @@
+#ifndef REDISWRAPS_PRIMITIVES_HH
+#define REDISWRAPS_PRIMITIVES_HH
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/pipeline.hh>
+
+
+namespace rediswraps {
+
+// primitives
+// Rate limiters, locks and bounded counters, each operation of which is a
+//   single Lua script run atomically by Redis, i.e. one round trip:
+//
+//   primitives::TokenBucket limiter(*redis, 100.0, 20);  // 100/s, bursts of 20
+//   primitives::Decision decision;
+//
+//   if (limiter.Take("api:" + user, decision) && !decision.allowed) {
+//     // come back in decision.retry_after
+//   }
+//
+// The scripts are registered through Connection::LoadScriptFromString()
+//   when a primitive is first constructed, under "rediswraps:" aliases,
+//   and called with EVALSHA.  If Redis has lost them (SCRIPT FLUSH, a
+//   restart, or a Connection to another server than the one they were
+//   loaded on), a call loads them again and retries once.
+//
+// Every operation also has an Add*() twin that queues it on a Pipeline, so
+//   that many of them share a round trip.  The replies ExecuteRaw() hands
+//   back are read with Parse().  The pipeline's connection must have the
+//   scripts already, e.g. through a direct call on it.
+//
+// Times are the server's (TIME), so that clients with skewed clocks agree.
+//   Keys expire once they no longer hold any state worth keeping.  Keys a
+//   single operation touches together are in the same cluster slot.
+//
+// All methods return false, after logging why, if the script failed or
+//   its reply could not be read; "out" parameters are then left alone.
+//
+namespace primitives {
+
+// What a rate limiter or semaphore decided.
+struct Decision {
+  bool    allowed   = false;
+  int64_t remaining = 0;  // tokens, requests or slots left afterwards
+
+  // If not allowed: how long until it could be, at the earliest.  -1ms if
+  //   it never can, e.g. for more tokens than the bucket holds.
+  std::chrono::milliseconds retry_after{0};
+};
+
+// What FencedLock::Acquire() got.
+struct Fence {
+  // Fencing token: increases with every acquisition of the lock, so that
+  //   whatever the lock protects can turn away writes from a holder whose
+  //   lock expired meanwhile.  0 if the lock is someone else's.
+  uint64_t token = 0;
+
+  // How long the lock is held for, or how long its holder still has.
+  std::chrono::milliseconds ttl{0};
+};
+
+// What CappedCounter::Increment() did.
+struct CounterUpdate {
+  bool    applied = false;  // false if the bounds would have been crossed
+  int64_t value   = 0;      // the counter afterwards
+};
+
+
+// TokenBucket
+// Holds up to "capacity" tokens and gains "per_second" of them every
+//   second.  Take() removes tokens if there are enough of them.  A bucket
+//   that was never used, or that refilled completely and expired, is
+//   full.  Each key is a hash of two fields.
+//
+class TokenBucket {
+ public:
+  TokenBucket(Connection &conn, double const per_second, int64_t const capacity);
+
+  bool const Take(
+      std::string const &key,
+      Decision &decision,
+      int64_t const tokens = 1
+  );
+
+  void AddTake(
+      Pipeline &pipe,
+      std::string const &key,
+      int64_t const tokens = 1
+  ) const;
+
+ private:
+  Connection   &conn_;
+  double const  per_second_;
+  int64_t const capacity_;
+};
+
+
+// SlidingWindow
+// Allows "limit" requests per "window", counting those of exactly the last
+//   window rather than of a fixed one, so that no burst twice the limit
+//   straddles a window boundary.  Each key is a sorted set holding the
+//   times of the requests in the window.
+//
+class SlidingWindow {
+ public:
+  SlidingWindow(
+      Connection &conn,
+      std::chrono::milliseconds const window,
+      int64_t const limit
+  );
+
+  bool const Take(
+      std::string const &key,
+      Decision &decision,
+      int64_t const requests = 1
+  );
+
+  void AddTake(
+      Pipeline &pipe,
+      std::string const &key,
+      int64_t const requests = 1
+  ) const;
+
+ private:
+  Connection                     &conn_;
+  std::chrono::milliseconds const window_;
+  int64_t const                   limit_;
+};
+
+
+// FencedLock
+// A lock held by an "owner" (any string that is unique to it) for "ttl"
+//   at most, with a fencing token per acquisition:
+//
+//   primitives::FencedLock lock(*redis, std::chrono::seconds(10));
+//   primitives::Fence fence;
+//
+//   if (lock.Acquire("report", worker_id, fence) && fence.token != 0) {
+//     storage.Write(data, fence.token);   // refuses tokens older than seen
+//     lock.Release("report", worker_id, fence.token);
+//   }
+//
+// Acquiring a lock one already holds extends it and keeps its token.
+//   Extend() and Release() only act on the acquisition "token" names, so a
+//   holder whose lock expired can't extend or release the next holder's.
+//   The last token given out is kept in FenceKey(key), which never expires.
+//
+class FencedLock {
+ public:
+  FencedLock(Connection &conn, std::chrono::milliseconds const ttl);
+
+  bool const Acquire(
+      std::string const &key,
+      std::string const &owner,
+      Fence &fence
+  );
+
+  // "done" is false if the lock wasn't held under "token" any more.
+  bool const Extend(
+      std::string const &key,
+      std::string const &owner,
+      uint64_t const token,
+      bool &done
+  );
+
+  bool const Release(
+      std::string const &key,
+      std::string const &owner,
+      uint64_t const token,
+      bool &done
+  );
+
+  void AddAcquire(
+      Pipeline &pipe,
+      std::string const &key,
+      std::string const &owner
+  ) const;
+
+  void AddExtend(
+      Pipeline &pipe,
+      std::string const &key,
+      std::string const &owner,
+      uint64_t const token
+  ) const;
+
+  void AddRelease(
+      Pipeline &pipe,
+      std::string const &key,
+      std::string const &owner,
+      uint64_t const token
+  ) const;
+
+  // "key" with the fence suffix, hash tagged so that both share a slot.
+  static std::string const FenceKey(std::string const &key);
+
+ private:
+  Connection                     &conn_;
+  std::chrono::milliseconds const ttl_;
+};
+
+
+// CappedCounter
+// An integer counter kept within [minimum, maximum]: an increment (or a
+//   negative one) that would take it out of bounds is not applied.  A
+//   missing counter is 0; with a "ttl", a counter expires that long after
+//   it was created, e.g. to cap actions per day.
+//
+class CappedCounter {
+ public:
+  CappedCounter(
+      Connection &conn,
+      int64_t const maximum,
+      int64_t const minimum = 0,
+      std::chrono::milliseconds const ttl = std::chrono::milliseconds(0)
+  );
+
+  bool const Increment(
+      std::string const &key,
+      CounterUpdate &update,
+      int64_t const delta = 1
+  );
+
+  void AddIncrement(
+      Pipeline &pipe,
+      std::string const &key,
+      int64_t const delta = 1
+  ) const;
+
+ private:
+  Connection                     &conn_;
+  int64_t const                   maximum_;
+  int64_t const                   minimum_;
+  std::chrono::milliseconds const ttl_;
+};
+
+
+// LeaseSemaphore
+// Lets "limit" holders in at once, each for a lease of "lease" at most, so
+//   that a holder which dies without releasing its slot only keeps it
+//   until its lease runs out.  Acquiring a slot one holds renews its lease.
+//   Each key is a sorted set of holders scored by when their leases end.
+//
+class LeaseSemaphore {
+ public:
+  LeaseSemaphore(
+      Connection &conn,
+      int64_t const limit,
+      std::chrono::milliseconds const lease
+  );
+
+  bool const Acquire(
+      std::string const &key,
+      std::string const &holder,
+      Decision &decision
+  );
+
+  // "done" is false if "holder" had no slot, or its lease had run out.
+  bool const Release(
+      std::string const &key,
+      std::string const &holder,
+      bool &done
+  );
+
+  void AddAcquire(
+      Pipeline &pipe,
+      std::string const &key,
+      std::string const &holder
+  ) const;
+
+  void AddRelease(
+      Pipeline &pipe,
+      std::string const &key,
+      std::string const &holder
+  ) const;
+
+ private:
+  Connection                     &conn_;
+  int64_t const                   limit_;
+  std::chrono::milliseconds const lease_;
+};
+
+
+// Parse()
+// Reads the reply to an Add*() call: a Decision for TokenBucket,
+//   SlidingWindow and LeaseSemaphore::AddAcquire(), a Fence for
+//   FencedLock::AddAcquire(), a CounterUpdate for AddIncrement() and
+//   "done" for the others.  False if it is an error or malformed.
+//
+bool const Parse(redisReply const *reply, Decision &decision);
+bool const Parse(redisReply const *reply, Fence &fence);
+bool const Parse(redisReply const *reply, CounterUpdate &update);
+bool const Parse(redisReply const *reply, bool &done);
+
+} // namespace primitives
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef REDISWRAPS_RDB_HH
+#define REDISWRAPS_RDB_HH
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+#include <boost/utility/string_ref.hpp>
+
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+namespace rdb {
+
+// Object types as stored in the snapshot: the logical type and how Redis
+//   encoded it.
+enum class Encoding : uint8_t {
+  kString            = 0,
+  kList              = 1,
+  kSet               = 2,
+  kSortedSet         = 3,   // scores as text
+  kHash              = 4,
+  kSortedSet2        = 5,   // scores as binary doubles
+  kModulePreGa       = 6,   // not readable
+  kModule2           = 7,
+  kHashZipmap        = 9,
+  kListZiplist       = 10,
+  kSetIntset         = 11,
+  kSortedSetZiplist  = 12,
+  kHashZiplist       = 13,
+  kListQuicklist     = 14,
+  kStreamListpacks   = 15,
+  kHashListpack      = 16,
+  kSortedSetListpack = 17,
+  kListQuicklist2    = 18,
+  kStreamListpacks2  = 19,
+  kSetListpack       = 20,
+  kStreamListpacks3  = 21,
+  kHashMetadata      = 24,  // with field expiries
+  kHashListpackEx    = 25   // with field expiries
+};
+
+enum class Type : uint8_t {
+  kString,
+  kList,
+  kSet,
+  kSortedSet,
+  kHash,
+  kStream,
+  kModule
+};
+
+char const* TypeName(Type const type) noexcept;
+
+
+// Record
+// One key of the snapshot.  "key" points into the file's mapping unless
+//   it had to be decompressed, in which case it points into the record
+//   itself: records are neither copyable nor movable, and reading another
+//   key into one changes its "key".
+//
+struct Record {
+  Record() = default;
+  Record(Record const&) = delete;
+  Record& operator=(Record const&) = delete;
+
+  boost::string_ref key;
+
+  Type     type       = Type::kString;
+  Encoding encoding   = Encoding::kString;
+  int      db         = 0;
+  int64_t  expires_ms = -1;  // Unix time in milliseconds; -1 if it has none
+
+  // Bytes the value takes in the file, a lower bound of its size in memory.
+  size_t const serialized_size() const noexcept;
+
+ private:
+  friend class Snapshot;
+
+  size_t value_begin_ = 0;
+  size_t value_end_   = 0;
+
+  std::string key_storage_;
+};
+
+
+// Element
+// One element of a value, as handed to Snapshot::Elements():
+//   - a string's value is a single element with the value as "member",
+//   - lists and sets have one element per member,
+//   - sorted sets add the "score",
+//   - hashes have the field as "member" and its "value".
+//
+// Members and values point into the mapping when they are stored plainly,
+//   and into scratch space otherwise (integers, compressed strings): either
+//   way they are only valid during the call.
+//
+struct Element {
+  boost::string_ref member;
+  boost::string_ref value;
+  double            score = 0.0;
+};
+
+using ElementVisitor = std::function<void(Element const &element)>;
+
+// "worker" numbers the thread calling, from 0, for per-thread tallies.
+using RecordVisitor =
+  std::function<void(Record const &record, size_t const worker)>;
+
+
+// Snapshot
+// Reads an RDB file (what SAVE, BGSAVE and replication produce) straight
+//   from disk, without a server:
+//
+//   rdb::Snapshot snapshot("/var/lib/redis/dump.rdb");
+//   rdb::Record   record;
+//
+//   while (snapshot.Next(record)) {
+//     snapshot.Elements(record, [](rdb::Element const &element) { ... });
+//   }
+//
+// The file is mmapped and parsed lazily: Next() reads a key, its type and
+//   expiry, and skips over its value, which costs next to nothing for the
+//   compact encodings (listpacks, ziplists, intsets) since those are stored
+//   as one string.  Only Elements() decodes a value, and only as far as the
+//   visitor is concerned; keys and elements come out as views into the
+//   mapping whenever the file stores them as plain bytes.
+//
+// ForEach() does the same over every key with several threads: the calling
+//   thread finds where records start, the workers read and visit them, a
+//   batch of kRdbBatchRecords at a time.  Whatever the visitor does with
+//   Elements() thus runs in parallel.
+//
+// Every Redis data type and encoding up to RDB version 12 (Redis 7.4) is
+//   understood.  Streams and module values are skipped over: they are
+//   reported with their size, but Elements() visits nothing for them.  Hash
+//   field expiries are not reported either, only the fields.  The trailing
+//   checksum isn't verified.
+//
+// Next() and ForEach() return false at the end of the file, or when it
+//   turns out to be malformed, in which case error() says why.  Elements()
+//   can be called from any thread.
+//
+class Snapshot {
+ public:
+  // Throws std::runtime_error if the file can't be mapped or isn't an RDB
+  //   file.
+  explicit Snapshot(std::string const &path);
+  ~Snapshot();
+
+  Snapshot(Snapshot const&) = delete;
+  Snapshot& operator=(Snapshot const&) = delete;
+
+  // Reads the next key into "record".
+  bool const Next(Record &record);
+
+  // Starts over from the first key.
+  void Rewind() noexcept;
+
+  // Visits the elements of the value of "record", which must come from this
+  //   snapshot.  Returns false if the value is malformed.
+  bool const Elements(
+      Record const &record,
+      ElementVisitor const &visit
+  ) const;
+
+  // Visits every key with "threads" workers, 0 meaning one per core.  The
+  //   visitor is called concurrently.  Returns false if the file is
+  //   malformed, after visiting the keys before the problem.  A visitor
+  //   that throws stops every worker, and its exception is rethrown here
+  //   once they have all stopped.
+  bool const ForEach(RecordVisitor const &visit, size_t threads = 0);
+
+  int const version() const noexcept;
+
+  // AUX fields from the start of the file, e.g. "redis-ver", "ctime",
+  //   "used-mem".
+  std::map<std::string, std::string> const& aux() const noexcept;
+
+  std::string const& error() const noexcept;
+
+  size_t const size() const noexcept;
+
+ private:
+  struct Cursor {
+    size_t position = 0;
+    int    db       = 0;
+  };
+
+  // Reads the record at "cursor" and moves it past the record.  Returns
+  //   false at the end of the file, or with "error" set.
+  bool const Read(
+      Cursor &cursor,
+      Record &record,
+      bool const decode_key,
+      std::string &error
+  ) const;
+
+  char const *data_;
+  size_t      size_;
+
+  int version_;
+
+  std::map<std::string, std::string> aux_;
+
+  // Where the first record starts, past the header and AUX fields.
+  size_t start_;
+
+  Cursor      cursor_;
+  std::string error_;
+};
+
+} // namespace rdb
+} // namespace rediswraps
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef REDISWRAPS_RECORD_HH
+#define REDISWRAPS_RECORD_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>        // FILE of the log
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+struct RecorderStats {
+  uint64_t commands = 0;  // recorded
+  uint64_t bytes    = 0;  // written to the log, header included
+  uint64_t errors   = 0;  // failed writes; what they held is lost
+};
+
+
+// CommandRecorder
+// Captures the commands connections send, with their timing, into a
+//   compact binary log that the rediswraps_replay tool (tools/src) can play
+//   back against another server:
+//
+//   auto recorder = std::make_shared<rediswraps::CommandRecorder>("/tmp/cmds.log");
+//   redis->RecordCommands(recorder);   // any number of connections
+//
+// Every command the connection sends is recorded, along with when it was
+//   sent and which connection sent it: through Cmd() and RawCmd(), discarded
+//   ones included, as prepared commands, in pipelines (when written) and by
+//   the helper classes that write to the socket themselves (SingleFlight,
+//   HedgedReads, UringDriver, BlobTransfer...).  Script aliases are recorded
+//   as the EVALSHA they expand to, so a replay needs the scripts loaded
+//   (which it gets if the recorder was attached before LoadScript*()).
+//
+// Records are encoded straight into an in-memory buffer and written out
+//   once it holds "buffer_size" bytes, so recording costs a lock and a
+//   copy of the arguments.  A write holds up only the thread that filled
+//   the buffer: the others carry on into a fresh one meanwhile.  Whatever
+//   is buffered is written by Flush() and the destructor.
+//
+// The log starts with an 8 byte magic, "RWCMDLOG", a version byte and the
+//   wall clock time recording started at (nanoseconds since the epoch,
+//   8 bytes, little endian).  Each record is then a sequence of unsigned
+//   LEB128 varints: nanoseconds since the record before it, the connection
+//   (numbered from 0 in the order they attached), argc, then the length of
+//   each argument followed by its bytes.
+//
+class CommandRecorder {
+ public:
+  // Creates or truncates the log at "path".  Throws std::runtime_error if
+  //   it can't be opened.
+  explicit CommandRecorder(
+      std::string const &path,
+      size_t const buffer_size = constants::kRecorderBufferSize
+  );
+
+  ~CommandRecorder();
+
+  CommandRecorder(CommandRecorder const&) = delete;
+  CommandRecorder& operator=(CommandRecorder const&) = delete;
+
+  // Numbers a connection that starts recording; see
+  //   Connection::RecordCommands().
+  uint64_t const NewStream() noexcept;
+
+  void Record(
+      uint64_t const stream,
+      std::string const *argv,
+      size_t const argc
+  );
+
+  // Writes out whatever is buffered.  False if a write failed.
+  bool const Flush();
+
+  RecorderStats const stats() const noexcept;
+
+ private:
+  // Writes "buffer" to the log; file_lock_ must be held.
+  void Write(std::string const &buffer);
+
+  FILE        *file_;
+  size_t const buffer_size_;
+
+  // Taken in that order when the buffer is full, and lock_ released as
+  //   soon as the buffer is swapped out, so that writes stay in order.
+  std::mutex lock_;
+  std::mutex file_lock_;
+
+  std::string buffer_;
+  std::chrono::steady_clock::time_point last_;
+
+  std::atomic<uint64_t> streams_;
+  std::atomic<uint64_t> commands_;
+  std::atomic<uint64_t> bytes_;
+  std::atomic<uint64_t> errors_;
+};
+
+
+struct RecordedCommand {
+  std::chrono::nanoseconds at{0};  // since recording started
+  uint64_t                 stream = 0;
+  std::vector<std::string> argv;
+};
+
+
+// CommandLog
+// Reads back a log written by CommandRecorder, one command at a time:
+//
+//   rediswraps::CommandLog log("/tmp/cmds.log");
+//   rediswraps::RecordedCommand command;
+//
+//   while (log.Next(command)) {
+//     ...
+//   }
+//
+//   if (!log.error().empty()) { ... }
+//
+// A log cut short, e.g. by a crash before the recorder's last write, reads
+//   up to its last complete record.
+//
+class CommandLog {
+ public:
+  // Throws std::runtime_error if "path" can't be opened or isn't a log.
+  explicit CommandLog(std::string const &path);
+  ~CommandLog();
+
+  CommandLog(CommandLog const&) = delete;
+  CommandLog& operator=(CommandLog const&) = delete;
+
+  // False at the end of the log, or on a corrupt record (see error()).
+  bool const Next(RecordedCommand &command);
+
+  // When recording started, in nanoseconds since the epoch.
+  std::chrono::nanoseconds started() const noexcept;
+
+  std::string const& error() const noexcept;
+
+ private:
+  // False at the end of the file, or if the varint is corrupt.
+  bool const ReadVarint(uint64_t &value);
+
+  FILE *file_;
+
+  std::chrono::nanoseconds started_{0};
+  std::chrono::nanoseconds at_{0};
+
+  std::string error_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -3,8 +3,31 @@
 
 #include <rediswraps/constants.hh>
 #include <rediswraps/utils.hh>
+#include <rediswraps/log.hh>
 #include <rediswraps/response.hh>
+#include <rediswraps/decode.hh>
+#include <rediswraps/trace.hh>
 #include <rediswraps/connection.hh>
+#include <rediswraps/commands.hh>
+#include <rediswraps/prepared.hh>
+#include <rediswraps/pipeline.hh>
+#include <rediswraps/mapper.hh>
+#include <rediswraps/blob.hh>
+#include <rediswraps/bitmap.hh>
+#include <rediswraps/rdb.hh>
+#include <rediswraps/replication.hh>
+#include <rediswraps/migrate.hh>
+#include <rediswraps/topology.hh>
+#include <rediswraps/sharded.hh>
+#include <rediswraps/scatter.hh>
+#include <rediswraps/singleflight.hh>
+#include <rediswraps/primitives.hh>
+#include <rediswraps/hedge.hh>
+#include <rediswraps/introspect.hh>
+#include <rediswraps/hotkeys.hh>
+#include <rediswraps/record.hh>
+#include <rediswraps/histogram.hh>
+#include <rediswraps/uring.hh>
 
 #endif
 
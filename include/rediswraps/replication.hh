@@ -0,0 +1,184 @@
+#ifndef REDISWRAPS_REPLICATION_HH
+#define REDISWRAPS_REPLICATION_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <hiredis/hiredis.h>
+}
+
+#include <rediswraps/constants.hh>
+
+
+namespace rediswraps {
+
+struct ReplicationOptions {
+  // Where a previous stream stopped (see replication_id() and offset()), to
+  //   pick up from there across restarts.  Empty/-1 starts with a full sync.
+  std::string replication_id;
+  int64_t     offset = -1;
+
+  // AUTH before the handshake; "user" needs Redis 6.
+  std::string user;
+  std::string password;
+
+  // Reconnect and resume after the link drops, instead of returning from
+  //   Run().
+  bool reconnect = true;
+
+  std::chrono::milliseconds ack_interval{constants::kReplicationAckIntervalMs};
+  std::chrono::milliseconds timeout{constants::kReplicationTimeoutMs};
+  std::chrono::milliseconds retry_delay{constants::kReplicationRetryDelayMs};
+};
+
+// One write as the primary propagated it.
+struct ReplicatedCommand {
+  std::vector<std::string> argv;
+
+  int     db     = 0;  // selected when it ran
+  int64_t offset = 0;  // replication offset right after it
+};
+
+struct ReplicationStats {
+  uint64_t commands      = 0;  // handed to the command handler
+  uint64_t stream_bytes  = 0;  // of the command stream
+  uint64_t rdb_bytes     = 0;  // of snapshots, streamed or dropped
+  size_t   full_syncs    = 0;
+  size_t   partial_syncs = 0;
+  size_t   reconnects    = 0;
+};
+
+
+// ReplicationStream
+// A change feed of every write to a Redis server, read off the replication
+//   link the way a replica reads it:
+//
+//   ReplicationStream stream("10.0.0.1", 6379);
+//
+//   std::thread feed([&]() {
+//     stream.Run([](ReplicatedCommand const &command) {
+//       index.Apply(command.db, command.argv);
+//     });
+//   });
+//   ...
+//   stream.Stop();
+//   feed.join();
+//
+// Run() does the replica handshake (REPLCONF capa eof psync2, then PSYNC)
+//   and hands each propagated command to the handler, in order.  SELECT
+//   only sets the "db" of the commands after it; PINGs and REPLCONF GETACKs
+//   are answered or dropped rather than handed over.  Transactions arrive
+//   wrapped in MULTI and EXEC, and scripts as the writes they made.
+//
+// A full sync comes with a snapshot of the whole dataset.  With an RDB
+//   handler it is passed on as it arrives (write it to a file and read it
+//   with rdb::Snapshot, say); without one, Redis 7+ is asked to leave the
+//   data out of it (REPLCONF rdb-filter-only), and whatever still comes is
+//   read and dropped.
+//
+// The offset of every command is tracked, and REPLCONF ACKed to the server
+//   every ack_interval, so that a new connection can ask for the stream
+//   from where the last one stopped (PSYNC <id> <offset+1>).  That works for
+//   as long as the server's replication backlog still holds the missing
+//   part; otherwise it answers with a full sync and the commands in between
+//   are lost, which is logged and counted in full_syncs.
+//
+// The server lists the stream among its replicas (INFO replication), which
+//   matters for WAIT and min-replicas-to-write.
+//
+class ReplicationStream {
+ public:
+  using CommandHandler = std::function<void(ReplicatedCommand const &command)>;
+
+  // Gets the snapshot in pieces, in order; false aborts the sync.
+  using RdbHandler = std::function<bool const(char const *data, size_t const size)>;
+
+  explicit ReplicationStream(
+      std::string const &host = constants::kDefaultHost,
+      int const port = constants::kDefaultPort,
+      ReplicationOptions const &options = {}
+  );
+
+  ReplicationStream(std::string const &socket, ReplicationOptions const &options);
+
+  ~ReplicationStream();
+
+  ReplicationStream(ReplicationStream const&) = delete;
+  ReplicationStream& operator=(ReplicationStream const&) = delete;
+
+  // Streams until Stop() (returns true) or until the link fails and
+  //   "reconnect" is off (returns false, after logging why).  Calling it
+  //   again resumes from offset().
+  bool const Run(
+      CommandHandler const &on_command,
+      RdbHandler const &on_rdb = nullptr
+  );
+
+  // Makes Run() return shortly; safe from any thread.
+  void Stop() noexcept;
+
+  // Where the stream is: the primary's replication ID and the offset of the
+  //   last command handled.  offset() is safe from any thread.
+  std::string const& replication_id() const noexcept;
+  int64_t const offset() const noexcept;
+
+  ReplicationStats const& stats() const noexcept;
+
+ private:
+  // Connects, handshakes and gets past the snapshot of a full sync.
+  bool const Sync(RdbHandler const &on_rdb);
+
+  bool const ReceiveRdb(RdbHandler const &on_rdb);
+
+  // Reads commands until Stop() (true) or a failure (false).
+  bool const Stream(CommandHandler const &on_command);
+
+  bool const Dispatch(redisReply const *reply, CommandHandler const &on_command);
+
+  // Sends a command and reads its one line reply; false if the link failed.
+  bool const Exchange(std::vector<std::string> const &argv, std::string &reply);
+
+  bool const Send(std::vector<std::string> const &argv);
+  bool const SendAck();
+
+  // Reads a reply line, skipping the newlines sent as keepalives.
+  bool const ReadLine(std::string &line);
+
+  // Reads more into input_; false on EOF, errors and timeouts.
+  bool const Fill();
+
+  bool const Fail(std::string const &what);
+  void Close() noexcept;
+
+  std::string const Description() const;
+
+  std::string const host_;
+  int const         port_;
+  std::string const socket_;
+
+  ReplicationOptions const options_;
+
+  redisContext *context_;
+
+  std::atomic<bool>    stop_;
+  std::atomic<int64_t> offset_;
+  std::string          replication_id_;
+
+  // Bytes read but not yet used, from input_pos_ on.
+  std::string input_;
+  size_t      input_pos_;
+
+  std::chrono::steady_clock::time_point last_ack_;
+
+  ReplicatedCommand command_;
+  ReplicationStats  stats_;
+};
+
+} // namespace rediswraps
+
+#endif
@@ -16,6 +16,27 @@ class Response {
 friend class rediswraps::Connection;
 
  public:
+  // Type
+  // The kind of reply the data came from.  Over RESP2 (the default) Redis
+  //   only sends strings, statuses, errors, integers and nils; the other
+  //   types only show up on connections speaking RESP3 (see Connection).
+  //
+  // A kBool holds "1" or "0", so it converts to any numeric type and its
+  //   boolean() is exact, skipping the string heuristics of Convert<bool>.
+  //   A kDouble holds Redis' own text for the value ("inf" included).
+  //
+  enum class Type : char {
+    kString,
+    kStatus,
+    kError,
+    kInteger,
+    kNil,
+    kDouble,
+    kBool,
+    kBigNumber,
+    kVerbatim
+  };
+
   Response() = default;
 
   template<typename T>
@@ -42,6 +63,8 @@ friend class rediswraps::Connection;
   bool const  boolean() const noexcept;
   // returns true if there was not an error
   bool const& success() const noexcept;
+  // the kind of reply this came from
+  Type const type() const noexcept;
 
   // Response comparison operators {{{
   // operator ==
@@ -102,6 +125,7 @@ friend class rediswraps::Connection;
  private:
   std::string data_;
   bool success_ = true;
+  Type type_    = Type::kString;
 
   // set() and fail() need to be used from class Connection
   friend class Connection;
@@ -31,6 +31,11 @@ bool const& Response::success() const noexcept {
   return this->success_;
 }
 
+inline
+Response::Type const Response::type() const noexcept {
+  return this->type_;
+}
+
 template<typename T>
 void Response::set(T new_data) noexcept {
   this->data_ = utils::ToString(new_data);
@@ -0,0 +1,98 @@
+#ifndef REDISWRAPS_SCATTER_HH
+#define REDISWRAPS_SCATTER_HH
+
+#include <functional>
+#include <string>
+#include <utility>   // std::pair
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+#include <rediswraps/sharded.hh>
+
+
+namespace rediswraps {
+
+// ScatterGather
+// Runs multi-key commands whose keys are spread over the shards of a
+//   ShardedConnection.  Keys are grouped by owning shard, each group is
+//   sent as one or more sub-commands (at most max_batch_keys keys each)
+//   pipelined on that shard's connection, and every shard's pipeline is
+//   written before any reply is read so the shards all work at the same
+//   time.  Latency therefore tracks the slowest shard rather than the sum.
+//
+// Results come back in the caller's key order.
+//
+// A shard that can't be reached fails the call, which returns false (or a
+//   failed response) rather than throwing, once every other shard has been
+//   served and read back: their connections are left ready for the next
+//   command.
+//
+//   ScatterGather scatter(sharded);
+//
+//   std::vector<boost::optional<int>> counts;
+//   scatter.MGet({"a", "b", "c"}, counts);
+//
+//   int const deleted = scatter.Del({"a", "b", "c"});
+//
+class ScatterGather {
+ public:
+  explicit ScatterGather(
+      ShardedConnection &sharded,
+      size_t const max_batch_keys = constants::kScatterBatchKeys
+  );
+
+  // values[i] is the value of keys[i], or empty if it doesn't exist.
+  template<typename T = std::string>
+  bool const MGet(
+      std::vector<std::string> const &keys,
+      std::vector<boost::optional<T>> &values
+  );
+
+  bool const MSet(
+      std::vector<std::pair<std::string, std::string>> const &pairs
+  );
+
+  // These return the total over all shards, e.g. the number of keys
+  //   deleted.  The response fails if any shard failed.
+  cmd::Response Del(std::vector<std::string> const &keys);
+  cmd::Response Exists(std::vector<std::string> const &keys);
+  cmd::Response Unlink(std::vector<std::string> const &keys);
+
+ private:
+  // The keys of one sub-command: indices into the caller's key list.
+  struct Batch {
+    size_t              shard;
+    std::vector<size_t> positions;
+  };
+
+  using Gatherer = std::function<
+    bool const(Batch const &batch, redisReply const *reply)
+  >;
+
+  // Splits "args" (one key followed by stride - 1 more arguments, repeated)
+  //   into per-shard "command" sub-commands, runs them and hands each reply
+  //   to "gather".  Returns false if any sub-command or shard failed.
+  bool const Scatter(
+      std::string const &command,
+      std::vector<std::string> const &args,
+      size_t const stride,
+      Gatherer const &gather
+  );
+
+  cmd::Response Sum(
+      std::string const &command,
+      std::vector<std::string> const &keys
+  );
+
+  ShardedConnection &sharded_;
+  size_t const max_batch_keys_;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/scatter.inl>
+#endif
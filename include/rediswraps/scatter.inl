@@ -0,0 +1,63 @@
+/* scatter.inl
+ *   Template implementations and static definitions for scatter.hh
+*/
+
+#include <rediswraps/decode.hh>
+
+
+namespace rediswraps {
+
+inline
+ScatterGather::ScatterGather(
+    ShardedConnection &sharded,
+    size_t const max_batch_keys
+)
+  : sharded_(sharded),
+    max_batch_keys_(max_batch_keys > 0 ? max_batch_keys : 1)
+{}
+
+
+template<typename T>
+bool const ScatterGather::MGet(
+    std::vector<std::string> const &keys,
+    std::vector<boost::optional<T>> &values
+) {
+  values.assign(keys.size(), boost::none);
+
+  return this->Scatter("MGET", keys, 1,
+    [&values](Batch const &batch, redisReply const *reply) -> bool const {
+      if (reply->type != REDIS_REPLY_ARRAY ||
+          reply->elements != batch.positions.size()) {
+        return false;
+      }
+
+      for (size_t i = 0; i < reply->elements; ++i) {
+        if (!reply::Decode(reply->element[i], values[batch.positions[i]])) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  );
+}
+
+
+inline
+cmd::Response ScatterGather::Del(std::vector<std::string> const &keys) {
+  return this->Sum("DEL", keys);
+}
+
+
+inline
+cmd::Response ScatterGather::Exists(std::vector<std::string> const &keys) {
+  return this->Sum("EXISTS", keys);
+}
+
+
+inline
+cmd::Response ScatterGather::Unlink(std::vector<std::string> const &keys) {
+  return this->Sum("UNLINK", keys);
+}
+
+} // namespace rediswraps
@@ -0,0 +1,132 @@
+#ifndef REDISWRAPS_SHARDED_HH
+#define REDISWRAPS_SHARDED_HH
+
+#include <cstdint>
+#include <string>
+#include <utility>   // std::pair
+#include <vector>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+// HashRing
+// Ketama-style consistent hash ring.  Each node is placed on a 32-bit ring
+//   at points_per_node pseudo-random points derived from MD5 digests of
+//   "<node>-<n>", four points per digest, and a key belongs to the first
+//   node point at or after the key's own MD5-derived position.  Adding or
+//   removing a node therefore only moves the keys that land on that node's
+//   points (about 1/N of them); every other key stays where it was.
+//
+// Like Redis Cluster, only the part of a key between the first '{' and the
+//   following '}' is hashed when that part is non-empty, so "{user:1}:name"
+//   and "{user:1}:email" are guaranteed to land on the same node.
+//
+class HashRing {
+ public:
+  explicit HashRing(
+      size_t const points_per_node = constants::kKetamaPointsPerNode
+  );
+
+  // Returns the index the node will have in Locate()'s results.
+  size_t const Add(std::string const &node);
+
+  // Removes a node.  Nodes after it shift down one index.
+  bool const Remove(std::string const &node);
+
+  // Index of the node that owns "key", in order of Add().
+  // The ring must not be empty.
+  size_t const Locate(std::string const &key) const;
+
+  size_t const size() const noexcept;
+  std::string const& node(size_t const index) const;
+
+  // The position of "key" on the ring (hash tags applied).
+  static uint32_t const Position(std::string const &key);
+
+ private:
+  void Rebuild();
+
+  size_t const points_per_node_;
+
+  std::vector<std::string> nodes_;
+
+  // (position, node index) sorted by position
+  std::vector<std::pair<uint32_t, size_t>> points_;
+};
+
+
+// ShardedConnection
+// Spreads keys over several independent Redis servers (not Redis Cluster)
+//   using a HashRing.  Shards are placed on the ring by "host:port" (or their
+//   socket path), so the order in which they are added does not matter and
+//   other ketama clients sharing that naming agree on key placement.
+//
+// Cmd() routes on its first argument after the command name, which is the
+//   key for nearly every keyed command, and also KEYS[1] for script aliases.
+//   Multi-key commands are only correct when all their keys live on one
+//   shard, e.g. by sharing a hash tag.  Use Shard() to reach a particular
+//   server directly (e.g. for keyless commands such as PING).
+//
+// As with TopologyConnection, Response()/HasResponse() refer to the shard
+//   that served the most recent Cmd().
+//
+class ShardedConnection {
+ public:
+  explicit ShardedConnection(
+      std::vector<Ptr> shards,
+      size_t const points_per_node = constants::kKetamaPointsPerNode
+  );
+
+  friend std::ostream& operator<< (
+      std::ostream &os,
+      ShardedConnection const &sharded
+  );
+
+  void AddShard(Ptr shard);
+
+  // "id" is the shard's "host:port" or socket path.
+  bool const RemoveShard(std::string const &id);
+
+  template<
+      cmd::Flag flags = cmd::Flag::kDefault,
+      typename RetType = cmd::Response,
+      typename Key,
+      typename... Args
+  >
+  RetType Cmd(std::string const &base, Key const &key, Args&&... args) noexcept;
+
+  cmd::Response Response(
+      bool const pop_response = true,
+      bool const from_front   = false
+  );
+
+  bool   const  HasResponse() const noexcept;
+  size_t const NumResponses() const noexcept;
+
+  // The shard that owns "key", or its index.
+  Connection& Shard(std::string const &key);
+  size_t const ShardIndex(std::string const &key) const;
+
+  Connection& shard(size_t const index);
+  size_t const NumShards() const noexcept;
+
+  std::string Description() const;
+
+  // The ring name of a Connection: its "host:port" or socket path.
+  static std::string const ShardId(Connection const &conn);
+
+ private:
+  HashRing         ring_;
+  std::vector<Ptr> shards_;  // in ring_ index order
+
+  Connection *last_ = nullptr;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/sharded.inl>
+#endif
@@ -0,0 +1,101 @@
+/* sharded.inl
+ *   Template implementations and static definitions for sharded.hh
+*/
+
+#include <stdexcept>
+
+
+namespace rediswraps {
+
+inline
+size_t const HashRing::size() const noexcept {
+  return this->nodes_.size();
+}
+
+
+inline
+std::string const& HashRing::node(size_t const index) const {
+  return this->nodes_.at(index);
+}
+
+
+inline
+size_t const ShardedConnection::NumShards() const noexcept {
+  return this->shards_.size();
+}
+
+
+inline
+Connection& ShardedConnection::shard(size_t const index) {
+  return *this->shards_.at(index);
+}
+
+
+inline
+Connection& ShardedConnection::Shard(std::string const &key) {
+  return *this->shards_[this->ShardIndex(key)];
+}
+
+
+inline
+size_t const ShardedConnection::ShardIndex(std::string const &key) const {
+  if (this->shards_.empty()) {
+    throw std::logic_error("ShardedConnection has no shards.");
+  }
+
+  return this->ring_.Locate(key);
+}
+
+
+inline
+bool const ShardedConnection::HasResponse() const noexcept {
+  return this->last_ != nullptr && this->last_->HasResponse();
+}
+
+
+inline
+size_t const ShardedConnection::NumResponses() const noexcept {
+  return this->last_ == nullptr ? 0 : this->last_->NumResponses();
+}
+
+
+inline
+cmd::Response ShardedConnection::Response(
+    bool const pop_response,
+    bool const from_front
+) {
+  if (this->last_ == nullptr) {
+    return cmd::Response(
+      "Redis has not previously queued any further responses.",
+      false
+    );
+  }
+
+  return this->last_->Response(pop_response, from_front);
+}
+
+
+template<cmd::Flag flags, typename RetType, typename Key, typename... Args>
+RetType ShardedConnection::Cmd(
+    std::string const &base,
+    Key const &key,
+    Args&&... args
+) noexcept {
+  if (this->shards_.empty()) {
+    return static_cast<RetType>(
+      cmd::Response("ShardedConnection has no shards.", false)
+    );
+  }
+
+  std::string const key_string(utils::ToString(key));
+
+  this->last_ = this->shards_[this->ring_.Locate(key_string)].get();
+
+  return this->last_->Cmd<flags, RetType>(
+    base,
+    key_string,
+    std::forward<Args>(args)...
+  );
+}
+
+} // namespace rediswraps
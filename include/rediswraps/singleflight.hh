@@ -0,0 +1,123 @@
+#ifndef REDISWRAPS_SINGLEFLIGHT_HH
+#define REDISWRAPS_SINGLEFLIGHT_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>        // std::shared_ptr to replies shared by waiters
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+struct SingleFlightOptions {
+  // How long a reply stays cached for identical commands issued after it
+  //   arrived.  0 disables the cache: only commands in flight at the same
+  //   time are collapsed.
+  std::chrono::milliseconds cache_ttl{0};
+
+  // Cached replies kept at most; expired ones are purged first, then the
+  //   whole cache is dropped if that wasn't enough.
+  size_t max_cache_entries = constants::kSingleFlightMaxCacheEntries;
+};
+
+struct SingleFlightStats {
+  uint64_t requests   = 0;  // every Cmd() call
+  uint64_t sent       = 0;  // readonly commands actually sent to Redis
+  uint64_t collapsed  = 0;  // served by a command another thread had in flight
+  uint64_t cache_hits = 0;  // served from the cache
+  uint64_t bypassed   = 0;  // not collapsible (see below): sent as usual
+};
+
+
+// SingleFlight
+// Collapses identical readonly commands issued concurrently from different
+//   threads, each through its own Connection, into a single round trip:
+//
+//   rediswraps::SingleFlight flights;             // shared by all threads
+//   std::string page = flights.Cmd(*redis, "get", "page:home");
+//
+// The first thread to issue a given command sends it; threads issuing the
+//   same command (same server, same arguments) before its reply arrives
+//   wait for that reply instead of sending their own.  Each of them then
+//   gets the reply exactly as if Cmd() had been called on its own
+//   connection, response queue included.
+//
+// Only commands Redis flags as readonly (see IsReadOnlyCommand()) are
+//   collapsed, and not even those whose reply may differ between identical
+//   calls (RANDOMKEY, SRANDMEMBER, HRANDFIELD...) or that may block (XREAD
+//   with BLOCK...); see CommandInfo::random and blocking.  Anything else
+//   goes straight to Connection::Cmd().  Error
+//   replies are shared with the waiters but never cached.
+//
+// Connections sharing a SingleFlight must all use the same database (see
+//   SELECT) and protocol version, since replies are matched by server
+//   address and command only.
+//
+class SingleFlight {
+ public:
+  explicit SingleFlight(SingleFlightOptions const &options = {});
+
+  template<cmd::Flag flags = cmd::Flag::kDefault,
+      typename RetType = cmd::Response,
+      typename... Args
+  >
+  RetType Cmd(Connection &conn, std::string const &base, Args&&... args);
+
+  SingleFlightStats const stats() const noexcept;
+
+  // Drops every cached reply.
+  void ClearCache();
+
+ private:
+  using SharedReply = std::shared_ptr<redisReply>;
+
+  struct Flight {
+    bool        done = false;
+    SharedReply reply;
+
+    std::condition_variable landed;
+  };
+
+  struct CacheEntry {
+    SharedReply reply;
+
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  // Returns the reply to the command encoded as "key", either by joining
+  //   a flight or by sending "send" as the leader of a new one.
+  template<typename Send>
+  SharedReply Join(std::string const &key, Send &&send);
+
+  void Cache(std::string const &key, SharedReply const &reply);
+
+  // Whether identical calls of the command "base" may share one reply.
+  static bool const Collapsible(Connection &conn, std::string const &base);
+
+  SingleFlightOptions const options_;
+
+  std::mutex lock_;
+
+  std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+  std::unordered_map<std::string, CacheEntry>              cache_;
+
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> sent_;
+  std::atomic<uint64_t> collapsed_;
+  std::atomic<uint64_t> cache_hits_;
+  std::atomic<uint64_t> bypassed_;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/singleflight.inl>
+
+#endif
@@ -0,0 +1,125 @@
+/* singleflight.inl
+ *   Template implementations and static definitions for singleflight.hh
+*/
+
+#include <rediswraps/commands.hh>
+#include <rediswraps/sharded.hh>   // ShardedConnection::ShardId()
+
+
+namespace rediswraps {
+
+template<cmd::Flag flags, typename RetType, typename... Args>
+RetType SingleFlight::Cmd(
+    Connection &conn,
+    std::string const &base,
+    Args&&... args
+) {
+  static_assert(
+    cmd::FlagsAreLegal<flags>::value,
+    "Illegal combination of cmd::Flag values."
+  );
+
+  ++this->requests_;
+
+  if (
+      cmd::FlagsDiscardResponses<flags>::value ||
+      conn.scripts_.count(base) ||
+      !SingleFlight::Collapsible(conn, base)
+  ) {
+    ++this->bypassed_;
+    return conn.Cmd<flags, RetType>(base, std::forward<Args>(args)...);
+  }
+
+  // Same server, same protocol, same bytes on the wire.
+  std::string key = ShardedConnection::ShardId(conn);
+  key += '/';
+  key += std::to_string(conn.protocol());
+  key += '/';
+  conn.FormatCmd(key, base, args...);
+
+  if (cmd::FlagsFlushResponses<flags>::value) {
+    conn.Flush();
+  }
+
+  SharedReply const reply = this->Join(key, [&]() {
+    return conn.RawCmd(base, args...);
+  });
+
+  redisReply *shared = reply.get();
+
+  // Parsed as a nested reply: other waiters are reading the same tree, so
+  //   it must not be freed here.
+  cmd::Response response = (shared == nullptr) ?
+    cmd::Response("Redis reply is null and reconnection failed.", false) :
+    conn.ParseReply<flags>(shared, true);
+
+  return static_cast<RetType>(response);
+}
+
+
+template<typename Send>
+SingleFlight::SharedReply SingleFlight::Join(
+    std::string const &key,
+    Send &&send
+) {
+  std::shared_ptr<Flight> flight;
+
+  {
+    std::unique_lock<std::mutex> flights_lock(this->lock_);
+
+    if (this->options_.cache_ttl.count() > 0) {
+      auto const cached = this->cache_.find(key);
+
+      if (cached != this->cache_.end()) {
+        if (cached->second.expires > std::chrono::steady_clock::now()) {
+          ++this->cache_hits_;
+          return cached->second.reply;
+        }
+
+        this->cache_.erase(cached);
+      }
+    }
+
+    auto const in_flight = this->flights_.find(key);
+
+    if (in_flight != this->flights_.end()) {
+      flight = in_flight->second;
+      ++this->collapsed_;
+
+      flight->landed.wait(flights_lock, [&flight]() { return flight->done; });
+      return flight->reply;
+    }
+
+    flight = std::make_shared<Flight>();
+    this->flights_.emplace(key, flight);
+  }
+
+  ++this->sent_;
+
+  // Lands the flight however sending ends, so waiters are always released.
+  struct Landing {
+    SingleFlight            &flights;
+    std::string const       &key;
+    std::shared_ptr<Flight> &flight;
+    SharedReply              reply;
+
+    ~Landing() {
+      std::lock_guard<std::mutex> flights_lock_guard(this->flights.lock_);
+
+      this->flight->reply = this->reply;
+      this->flight->done  = true;
+      this->flights.flights_.erase(this->key);
+
+      if (this->reply && this->reply->type != REDIS_REPLY_ERROR) {
+        this->flights.Cache(this->key, this->reply);
+      }
+
+      this->flight->landed.notify_all();
+    }
+  } landing = {*this, key, flight, nullptr};
+
+  landing.reply = SharedReply(send().release(), ReplyDeleter());
+  return landing.reply;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,124 @@
+#ifndef REDISWRAPS_TOPOLOGY_HH
+#define REDISWRAPS_TOPOLOGY_HH
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rediswraps/commands.hh>
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+
+
+namespace rediswraps {
+
+struct TopologyOptions {
+  // Replicas that are further behind the primary than this many bytes of
+  //   its replication stream (master_repl_offset less the replica's own
+  //   offset, both from INFO replication) are not read from.
+  int64_t max_lag_bytes = constants::kDefaultMaxReplicaLagBytes;
+
+  // Weight given to each new round trip sample in a replica's moving
+  //   average RTT.  Higher values react faster but are noisier.
+  double rtt_smoothing = constants::kDefaultRttSmoothing;
+
+  // How often replica health (link status, lag, RTT) is probed again.
+  // Probing happens lazily inside Cmd(), never on a background thread.
+  std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(
+    constants::kDefaultTopologyRefreshMs
+  );
+};
+
+
+// TopologyConnection
+// Wraps one primary and any number of its replicas.  Commands that Redis
+//   flags as "readonly" (per COMMAND INFO, see commands.hh) are sent to the
+//   healthy replica with the lowest moving-average RTT; everything else,
+//   including Lua script aliases, goes to the primary.  If no replica is
+//   healthy, or the chosen one drops its connection mid-command and can't
+//   be reconnected to, the command falls back to the primary and that
+//   replica is skipped until it passes a probe again.
+//
+// The response queue belongs to whichever Connection served the most
+//   recent command, so Response()/HasResponse() always refer to the replies
+//   of the last Cmd().  Mixing CMD_SAVED with commands that are routed to
+//   different servers will therefore not accumulate one shared queue.
+//
+class TopologyConnection {
+ public:
+  TopologyConnection(
+      Ptr primary,
+      std::vector<Ptr> replicas,
+      TopologyOptions const &options = TopologyOptions()
+  );
+
+  friend std::ostream& operator<< (
+      std::ostream &os,
+      TopologyConnection const &topology
+  );
+
+  // Same contract as Connection::Cmd().
+  template<
+      cmd::Flag flags = cmd::Flag::kDefault,
+      typename RetType = cmd::Response,
+      typename... Args
+  >
+  RetType Cmd(std::string const &base, Args&&... args) noexcept;
+
+  cmd::Response Response(
+      bool const pop_response = true,
+      bool const from_front   = false
+  );
+
+  bool   const  HasResponse() const noexcept;
+  size_t const NumResponses() const noexcept;
+
+  size_t const NumReplicas() const noexcept;
+  size_t const NumHealthyReplicas() const noexcept;
+
+  Connection& primary() noexcept;
+
+  // Probes every replica now instead of waiting for the refresh interval.
+  void Refresh();
+
+  std::string Description() const;
+
+ private:
+  struct Replica {
+    Ptr    conn;
+    double rtt_us  = 0.0;
+    bool   healthy = false;
+  };
+
+  // What the primary's INFO replication says about its replication stream.
+  struct PrimaryOffsets {
+    int64_t master = -1;  // master_repl_offset; -1 if it could not be read
+
+    // The offset each replica last acknowledged, by "ip:port".
+    std::unordered_map<std::string, int64_t> replicas;
+  };
+
+  void RefreshIfStale();
+  PrimaryOffsets ReadPrimaryOffsets();
+  void Probe(Replica &replica, PrimaryOffsets const &primary);
+  void Sample(Replica &replica, std::chrono::steady_clock::duration elapsed);
+
+  Replica* FastestReplica() noexcept;
+
+  Ptr                  primary_;
+  std::vector<Replica> replicas_;
+  TopologyOptions      options_;
+
+  // The Connection whose response queue Response() reads from.
+  Connection *last_ = nullptr;
+
+  std::chrono::steady_clock::time_point refreshed_at_;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/topology.inl>
+#endif
@@ -0,0 +1,94 @@
+/* topology.inl
+ *   Template implementations and static definitions for topology.hh
+*/
+
+#include <stdexcept>
+
+#include <rediswraps/log.hh>
+
+
+namespace rediswraps {
+
+inline
+bool const TopologyConnection::HasResponse() const noexcept {
+  return this->last_->HasResponse();
+}
+
+
+inline
+size_t const TopologyConnection::NumResponses() const noexcept {
+  return this->last_->NumResponses();
+}
+
+
+inline
+size_t const TopologyConnection::NumReplicas() const noexcept {
+  return this->replicas_.size();
+}
+
+
+inline
+Connection& TopologyConnection::primary() noexcept {
+  return *this->primary_;
+}
+
+
+inline
+cmd::Response TopologyConnection::Response(
+    bool const pop_response,
+    bool const from_front
+) {
+  return this->last_->Response(pop_response, from_front);
+}
+
+
+template<cmd::Flag flags, typename RetType, typename... Args>
+RetType TopologyConnection::Cmd(
+    std::string const &base,
+    Args&&... args
+) noexcept {
+  this->RefreshIfStale();
+
+  Replica *replica = IsReadOnlyCommand(*this->primary_, base) ?
+    this->FastestReplica() :
+    nullptr;
+
+  if (replica != nullptr) {
+    Connection &conn = *replica->conn;
+
+    if (cmd::FlagsFlushResponses<flags>::value) {
+      conn.Flush();
+    }
+
+    auto const sent_at = std::chrono::steady_clock::now();
+
+    // Sent through CmdProxy() rather than the noexcept Cmd(): a replica
+    //   that is down makes the reconnection attempt throw.  args are
+    //   deliberately not forwarded: they may be needed again below.
+    try {
+      cmd::Response response = conn.CmdProxy<flags>(base, args...);
+
+      if (response || conn.IsConnected()) {
+        this->Sample(*replica, std::chrono::steady_clock::now() - sent_at);
+        this->last_ = &conn;
+
+        return static_cast<RetType>(response);
+      }
+    }
+    catch (std::exception const &e) {
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kConnection,
+        "Replica unreachable, reading from the primary instead: ", e.what()
+      );
+    }
+
+    // The replica went away mid-command; stop using it until it passes the
+    //   next probe and retry on the primary.
+    replica->healthy = false;
+  }
+
+  this->last_ = this->primary_.get();
+  return this->primary_->Cmd<flags, RetType>(base, args...);
+}
+
+} // namespace rediswraps
@@ -0,0 +1,149 @@
+#ifndef REDISWRAPS_TRACE_HH
+#define REDISWRAPS_TRACE_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <hiredis/hiredis.h>
+}
+
+
+namespace rediswraps {
+class Connection;
+
+namespace trace {
+
+// Event
+// Everything a tracer learns about one command.  Timestamps are Unix epoch
+//   nanoseconds.  "command" points into the command's formatted arguments
+//   and is only valid for the duration of the hook call.
+struct Event {
+  Connection const *connection = nullptr;
+
+  char const *command        = "";
+  size_t      command_length = 0;
+  size_t      argc           = 0;
+
+  size_t request_bytes = 0;  // total size of all arguments
+  size_t reply_bytes   = 0;  // total size of all strings in the reply
+
+  int64_t sent_at    = 0;
+  int64_t replied_at = 0;
+
+  bool        success = false;
+  std::string error;
+};
+
+
+// Tracer policy
+// A tracer is any type providing these static members:
+//
+//   static constexpr bool kEnabled;
+//   static void BeforeSend(Event const &event);
+//   static void AfterReply(Event const &event);  // reply arrived, not an error
+//   static void OnError(Event const &event);     // no reply, or an error reply
+//   static void OnReconnect(Connection const &conn);
+//
+// Every command sent through Connection::Cmd() or RawCmd() triggers
+//   BeforeSend() and then exactly one of AfterReply() or OnError().  So
+//   does every command of a Pipeline, and with it of everything built on
+//   one (ScatterGather, Mapper batches, migrations, LoadScripts()...):
+//   BeforeSend() when the batch is written, the other hook as each reply
+//   is read.
+//   Commands that helpers write to the socket themselves are not traced:
+//   HedgedReads' legs, BlobTransfer's chunks and whatever a UringDriver
+//   sends.
+//   Commands sent with kDiscard get AfterReply() as soon as they are queued
+//   for sending, with reply_bytes left at 0; their error replies only show
+//   up later in Connection::discard_stats().
+//
+// The tracer is chosen at compile time by defining REDISWRAPS_TRACER to its
+//   type name, both when building the library and the code using it (the
+//   CMake cache variable of the same name takes care of the former).
+//   Without it, NullTracer is used: all hooks sit behind
+//   "if (Tracer::kEnabled)", so not even the Event is filled in.
+//
+struct NullTracer {
+  static constexpr bool kEnabled = false;
+
+  static void BeforeSend(Event const &event) noexcept {}
+  static void AfterReply(Event const &event) noexcept {}
+  static void OnError(Event const &event) noexcept {}
+  static void OnReconnect(Connection const &conn) noexcept {}
+};
+
+
+// SpanRecorder
+// Ready-made tracer that turns each command into an OpenTelemetry-style
+//   client span, serialized as one line of JSON (OTLP/JSON field names), and
+//   writes it to a file and/or keeps the latest ones in a ring buffer.
+//
+//   -DREDISWRAPS_TRACER=rediswraps::trace::SpanRecorder
+//
+//   trace::SpanRecorder::ToRingBuffer(4096);
+//   trace::SpanRecorder::SetParent(request.trace_id, request.span_id);
+//   redis->Cmd("get", "foo");
+//   for (auto const &span : trace::SpanRecorder::Spans()) {...}
+//
+// SetParent() is per thread: spans recorded on that thread become children
+//   of the given span, which is how Redis time is attributed to the
+//   upstream request being served.
+//
+class SpanRecorder {
+ public:
+  static constexpr bool kEnabled = true;
+
+  // Appends spans to "path".  An empty path stops writing to a file.
+  static bool const ToFile(std::string const &path);
+
+  // Keeps the last "capacity" spans in memory.  0 disables the buffer.
+  static void ToRingBuffer(size_t const capacity);
+
+  // The spans currently in the ring buffer, oldest first.
+  static std::vector<std::string> Spans();
+
+  // Hex ids: 32 digits for the trace, 16 for the span.  Empty ids make
+  //   each following span the root of a new trace.
+  static void SetParent(
+      std::string const &trace_id,
+      std::string const &parent_span_id
+  );
+
+  static void BeforeSend(Event const &event) noexcept;
+  static void AfterReply(Event const &event) noexcept;
+  static void OnError(Event const &event) noexcept;
+  static void OnReconnect(Connection const &conn) noexcept;
+
+ private:
+  static void Record(Event const &event) noexcept;
+};
+
+
+#ifdef REDISWRAPS_TRACER
+using Tracer = REDISWRAPS_TRACER;
+#else
+using Tracer = NullTracer;
+#endif
+
+
+// Fill in the request side of an event from formatted arguments.
+void Begin(
+    Event &event,
+    Connection const &conn,
+    std::string const *argv,
+    size_t const argc
+);
+
+// Fill in the reply side of an event.
+void Finish(Event &event, redisReply const *reply);
+
+// Current time in Unix epoch nanoseconds.
+int64_t const Now() noexcept;
+
+} // namespace trace
+} // namespace rediswraps
+
+#include <rediswraps/trace.inl>
+#endif
@@ -0,0 +1,73 @@
+/* trace.inl
+ *   Template implementations and static definitions for trace.hh
+*/
+
+#include <chrono>
+
+
+namespace rediswraps {
+namespace trace {
+
+inline
+int64_t const Now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+}
+
+
+inline
+void Begin(
+    Event &event,
+    Connection const &conn,
+    std::string const *argv,
+    size_t const argc
+) {
+  event.connection = &conn;
+  event.argc       = argc;
+
+  if (argc > 0) {
+    event.command        = argv[0].data();
+    event.command_length = argv[0].size();
+  }
+
+  for (size_t i = 0; i < argc; ++i) {
+    event.request_bytes += argv[i].size();
+  }
+
+  event.sent_at = Now();
+}
+
+
+inline
+size_t const ReplyBytes(redisReply const *reply) {
+  size_t bytes = (reply->str != nullptr) ? reply->len : 0;
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    bytes += ReplyBytes(reply->element[i]);
+  }
+
+  return bytes;
+}
+
+
+inline
+void Finish(Event &event, redisReply const *reply) {
+  event.replied_at = Now();
+
+  if (reply == nullptr) {
+    event.success = false;
+    event.error   = "Redis reply is null";
+    return;
+  }
+
+  event.reply_bytes = ReplyBytes(reply);
+  event.success     = (reply->type != REDIS_REPLY_ERROR);
+
+  if (!event.success) {
+    event.error.assign(reply->str, reply->len);
+  }
+}
+
+} // namespace trace
+} // namespace rediswraps
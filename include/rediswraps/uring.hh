@@ -0,0 +1,180 @@
+#ifndef REDISWRAPS_URING_HH
+#define REDISWRAPS_URING_HH
+
+// Only available when the library was built with -DREDISWRAPS_WITH_IO_URING=ON
+//   on Linux; see CMakeLists.txt.  Needs kernel 5.6 or later at run time.
+#ifdef REDISWRAPS_WITH_IO_URING
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>        // std::unique_ptr to the ring and buffers
+#include <string>
+#include <vector>
+
+#include <rediswraps/connection.hh>
+#include <rediswraps/constants.hh>
+#include <rediswraps/response.hh>
+
+// <linux/io_uring.h> itself is only included by uring.cc.
+struct io_uring_sqe;
+
+
+namespace rediswraps {
+
+class PreparedCmd;
+
+struct UringStats {
+  uint64_t submits = 0;  // io_uring_enter() calls, i.e. syscalls
+  uint64_t writes  = 0;  // write completions
+  uint64_t reads   = 0;  // read completions
+  uint64_t replies = 0;  // replies handed to callbacks
+  uint64_t failed  = 0;  // replies lost to socket errors or disconnects
+};
+
+
+// UringDriver
+// Drives the sockets of many Connections from one thread through a single
+//   Linux io_uring, instead of one blocking write() and read() per command
+//   and connection:
+//
+//   rediswraps::UringDriver driver;
+//   size_t const a = driver.Attach(*redis_a);
+//   size_t const b = driver.Attach(*redis_b);
+//
+//   driver.Cmd(a, [](rediswraps::ReplyPtr reply) { ... }, "get", "foo");
+//   driver.Cmd(b, [](rediswraps::ReplyPtr reply) { ... }, "incr", "bar");
+//
+//   driver.Run();  // both commands go out in one submission
+//
+// Commands are RESP-encoded the same way Connection::Cmd() encodes them
+//   (script aliases included) and buffered per connection.  Run() copies
+//   each buffer into that connection's registered write buffer, queues
+//   writes and reads for every connection with work, submits them all in
+//   one system call and feeds whatever arrives into the connection's own
+//   hiredis reader.  Replies reach their callbacks in the order their
+//   commands were queued on that connection; a null ReplyPtr means the
+//   connection failed before its reply arrived.  RESP3 push frames go to
+//   the connection's OnPush() handler as usual.
+//
+// Buffers are registered with the kernel (IORING_REGISTER_BUFFERS) so
+//   reads and writes skip the per-call page pinning; if the registration
+//   is refused (RLIMIT_MEMLOCK), plain reads and writes are used instead.
+//
+// Not thread safe: one driver per thread.  While a connection is attached,
+//   commands must not be sent through it directly while Run() has replies
+//   outstanding on it, since both would read the same socket.
+//
+class UringDriver {
+ public:
+  // Receives the reply to one command.
+  using ReplyHandler = std::function<void(ReplyPtr)>;
+
+  explicit UringDriver(
+      unsigned const queue_depth = constants::kUringQueueDepth,
+      size_t const buffer_size = constants::kUringBufferSize
+  );
+
+  ~UringDriver();
+
+  UringDriver(UringDriver const&) = delete;
+  UringDriver& operator=(UringDriver const&) = delete;
+
+  // Hands a connection's socket over to the driver and returns the index
+  //   to queue commands with.  Outstanding discarded commands are flushed
+  //   first.  Throws std::runtime_error if the connection is down and can't
+  //   be reestablished.  Not to be called from a reply callback.
+  size_t const Attach(Connection &conn);
+
+  template<typename... Args>
+  void Cmd(
+      size_t const index,
+      ReplyHandler handler,
+      std::string const &base,
+      Args&&... args
+  );
+
+  template<typename... Args>
+  void Cmd(
+      size_t const index,
+      ReplyHandler handler,
+      PreparedCmd const &prepared,
+      Args&&... args
+  );
+
+  // Submits every queued command and waits until all their replies have
+  //   been handed to their callbacks, including commands the callbacks
+  //   queue themselves.  Returns the number of replies handed over.
+  size_t const Run();
+
+  // Commands queued and not yet answered, across all connections.
+  size_t const pending() const noexcept;
+
+  bool const registered_buffers() const noexcept;
+
+  UringStats const& stats() const noexcept;
+
+ private:
+  struct Ring;
+
+  struct Channel {
+    Connection *conn  = nullptr;
+    size_t      index = 0;
+
+    std::string output;       // encoded commands not yet written
+    size_t      written = 0;  // bytes of "output" already written
+
+    std::unique_ptr<char[]> write_buffer;
+    std::unique_ptr<char[]> read_buffer;
+
+    bool writing = false;
+    bool reading = false;
+    bool failed  = false;  // completions still in flight are ignored
+
+    std::deque<ReplyHandler> handlers;
+  };
+
+  // Queues the next write or read of a channel, if it needs one.
+  void QueueWrite(Channel &channel);
+  void QueueRead(Channel &channel);
+
+  void Completed(uintptr_t const user_data, int const result);
+
+  // Hands the replies fed to a channel's reader to their callbacks.
+  void Deliver(Channel &channel);
+
+  // Fails every outstanding reply of a channel.  Its socket is closed once
+  //   no read or write is in flight on it any more (see Settle()) and
+  //   reopened when it gets new commands.
+  void Fail(Channel &channel, char const *what);
+  void Settle(Channel &channel) noexcept;
+
+  // Queues writes and reads for every channel with work.
+  void QueueAll();
+
+  struct io_uring_sqe* NextSqe();
+
+  void RegisterBuffers();
+
+  std::unique_ptr<Ring> ring_;
+
+  size_t const buffer_size_;
+
+  // unique_ptr: a Channel's address is its io_uring user data.
+  std::vector<std::unique_ptr<Channel>> channels_;
+
+  size_t registered_ = 0;  // channels whose buffers are registered
+  bool   fixed_      = true;
+  size_t in_flight_  = 0;  // submitted reads and writes not completed yet
+  size_t delivered_  = 0;
+
+  UringStats stats_;
+};
+
+} // namespace rediswraps
+
+#include <rediswraps/uring.inl>
+
+#endif // REDISWRAPS_WITH_IO_URING
+
+#endif
@@ -0,0 +1,54 @@
+/* uring.inl
+ *   Template implementations and static definitions for uring.hh
+*/
+
+#include <rediswraps/prepared.hh>
+
+
+namespace rediswraps {
+
+template<typename... Args>
+void UringDriver::Cmd(
+    size_t const index,
+    ReplyHandler handler,
+    std::string const &base,
+    Args&&... args
+) {
+  Channel &channel = *this->channels_.at(index);
+  Connection &conn = *channel.conn;
+
+  if (conn.scripts_.count(base)) {
+    conn.EncodeCmd(
+      channel.output,
+      "EVALSHA",
+      conn.scripts_[base].first,
+      conn.scripts_[base].second,
+      std::forward<Args>(args)...
+    );
+  }
+  else {
+    conn.EncodeCmd(channel.output, base, std::forward<Args>(args)...);
+  }
+
+  channel.handlers.push_back(std::move(handler));
+}
+
+
+template<typename... Args>
+void UringDriver::Cmd(
+    size_t const index,
+    ReplyHandler handler,
+    PreparedCmd const &prepared,
+    Args&&... args
+) {
+  Channel &channel = *this->channels_.at(index);
+
+  if (prepared.Encode(channel.output, std::forward<Args>(args)...)) {
+    channel.handlers.push_back(std::move(handler));
+  }
+  else if (handler) {
+    handler(nullptr);
+  }
+}
+
+} // namespace rediswraps
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 
 
 namespace rediswraps {
@@ -33,6 +34,23 @@ TargetType Convert(std::string const &target);
 
 std::string const ReadFile(std::string const &filepath);
 
+// Lowercase hex SHA1 digest of "data", identical to the hash Redis assigns
+//   to a script passed to SCRIPT LOAD.
+std::string const Sha1Hex(std::string const &data);
+
+// Splits the "field:value" lines of an INFO reply into a map.
+// Section headers (e.g. "# Replication") and blank lines are skipped.
+std::unordered_map<std::string, std::string> ParseInfo(
+    std::string const &info
+);
+
+// "key" followed by "suffix", hash tagged so that both keys share a cluster
+//   slot: "key" is wrapped in braces unless it has a hash tag already.
+std::string const SameSlotKey(
+    std::string const &key,
+    std::string const &suffix
+);
+
 } // namespace utils
 } // namespace rediswraps
 
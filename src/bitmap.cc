@@ -0,0 +1,732 @@
+#include <rediswraps/bitmap.hh>
+
+#include <algorithm>  // std::min(), std::max()
+#include <cstring>    // memcpy(), memset()
+#include <thread>
+
+#include <rediswraps/log.hh>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REDISWRAPS_BITMAP_AVX2
+#include <immintrin.h>
+#endif
+
+
+namespace rediswraps {
+namespace {
+
+// Replicates a byte over a word.
+constexpr uint64_t kOnes = 0x0101010101010101ull;
+
+
+uint64_t const LoadWord(uint8_t const *data) noexcept {
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+
+  return word;
+}
+
+
+void StoreWord(uint8_t *data, uint64_t const word) noexcept {
+  memcpy(data, &word, sizeof(word));
+}
+
+
+// Offset of the first set bit of a byte, most significant bit first.
+unsigned const FirstBit(uint8_t const byte) noexcept {
+  return __builtin_clz(byte) - (8 * sizeof(unsigned) - 8);
+}
+
+
+void CombinePortable(
+    BitOp const op,
+    uint8_t *destination,
+    uint8_t const *source,
+    size_t const size
+) noexcept {
+  size_t i = 0;
+
+  for (; i + 8 <= size; i += 8) {
+    uint64_t const a = LoadWord(destination + i);
+    uint64_t const b = LoadWord(source + i);
+
+    switch (op) {
+      case BitOp::kAnd: StoreWord(destination + i, a & b); break;
+      case BitOp::kOr:  StoreWord(destination + i, a | b); break;
+      case BitOp::kXor: StoreWord(destination + i, a ^ b); break;
+    }
+  }
+
+  for (; i < size; ++i) {
+    switch (op) {
+      case BitOp::kAnd: destination[i] &= source[i]; break;
+      case BitOp::kOr:  destination[i] |= source[i]; break;
+      case BitOp::kXor: destination[i] ^= source[i]; break;
+    }
+  }
+}
+
+
+void InvertPortable(uint8_t *data, size_t const size) noexcept {
+  size_t i = 0;
+
+  for (; i + 8 <= size; i += 8) {
+    StoreWord(data + i, ~LoadWord(data + i));
+  }
+
+  for (; i < size; ++i) {
+    data[i] = ~data[i];
+  }
+}
+
+
+uint64_t const PopcountPortable(uint8_t const *data, size_t const size) noexcept {
+  uint64_t count = 0;
+  size_t i = 0;
+
+  for (; i + 8 <= size; i += 8) {
+    count += __builtin_popcountll(LoadWord(data + i));
+  }
+
+  for (; i < size; ++i) {
+    count += __builtin_popcount(data[i]);
+  }
+
+  return count;
+}
+
+
+size_t const ScanPortable(
+    uint8_t const *data,
+    size_t const size,
+    uint8_t const skip
+) noexcept {
+  uint64_t const skipped = kOnes * skip;
+  size_t i = 0;
+
+  while (i + 8 <= size && LoadWord(data + i) == skipped) {
+    i += 8;
+  }
+
+  while (i < size && data[i] == skip) {
+    ++i;
+  }
+
+  return i;
+}
+
+
+#ifdef REDISWRAPS_BITMAP_AVX2
+
+__attribute__((target("avx2")))
+void CombineAvx2(
+    BitOp const op,
+    uint8_t *destination,
+    uint8_t const *source,
+    size_t const size
+) noexcept {
+  size_t i = 0;
+
+  for (; i + 32 <= size; i += 32) {
+    __m256i *const out = reinterpret_cast<__m256i*>(destination + i);
+
+    __m256i const a = _mm256_loadu_si256(out);
+    __m256i const b =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i));
+
+    switch (op) {
+      case BitOp::kAnd: _mm256_storeu_si256(out, _mm256_and_si256(a, b)); break;
+      case BitOp::kOr:  _mm256_storeu_si256(out, _mm256_or_si256(a, b));  break;
+      case BitOp::kXor: _mm256_storeu_si256(out, _mm256_xor_si256(a, b)); break;
+    }
+  }
+
+  CombinePortable(op, destination + i, source + i, size - i);
+}
+
+
+// Counts the bits of each nibble with a 16 entry table lookup (vpshufb),
+//   adds the byte counts up over several vectors and only then widens them
+//   into 64 bit lanes (vpsadbw).  See Mula, Kurz and Lemire, "Faster
+//   Population Counts Using AVX2 Instructions".
+__attribute__((target("avx2")))
+uint64_t const PopcountAvx2(uint8_t const *data, size_t const size) noexcept {
+  __m256i const table = _mm256_setr_epi8(
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+  );
+  __m256i const low  = _mm256_set1_epi8(0x0f);
+  __m256i const zero = _mm256_setzero_si256();
+
+  __m256i total = zero;
+  size_t i = 0;
+
+  while (i + 32 <= size) {
+    // Each byte gains 8 at most per vector, so 31 vectors fit in it.
+    size_t const stop = std::min(size - (size - i) % 32, i + 31 * 32);
+    __m256i bytes = zero;
+
+    for (; i < stop; i += 32) {
+      __m256i const block =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+
+      __m256i const lo = _mm256_shuffle_epi8(table, _mm256_and_si256(block, low));
+      __m256i const hi = _mm256_shuffle_epi8(
+        table, _mm256_and_si256(_mm256_srli_epi16(block, 4), low)
+      );
+
+      bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(lo, hi));
+    }
+
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, zero));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+    PopcountPortable(data + i, size - i);
+}
+
+
+__attribute__((target("avx2")))
+size_t const ScanAvx2(
+    uint8_t const *data,
+    size_t const size,
+    uint8_t const skip
+) noexcept {
+  __m256i const skipped = _mm256_set1_epi8(static_cast<char>(skip));
+  size_t i = 0;
+
+  for (; i + 32 <= size; i += 32) {
+    __m256i const block =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+
+    uint32_t const same = static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, skipped))
+    );
+
+    if (same != 0xffffffffu) {
+      return i + __builtin_ctz(~same);
+    }
+  }
+
+  return i + ScanPortable(data + i, size - i, skip);
+}
+
+#endif
+
+
+bool const DetectAvx2() noexcept {
+#ifdef REDISWRAPS_BITMAP_AVX2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+
+void Combine(
+    bool const avx2,
+    BitOp const op,
+    uint8_t *destination,
+    uint8_t const *source,
+    size_t const size
+) noexcept {
+#ifdef REDISWRAPS_BITMAP_AVX2
+  if (avx2) {
+    return CombineAvx2(op, destination, source, size);
+  }
+#endif
+
+  CombinePortable(op, destination, source, size);
+}
+
+} // namespace
+
+
+Bitmap::Bitmap(BitmapOptions const &options)
+  : options_(options),
+    avx2_(options.simd && HasAvx2())
+{}
+
+
+Bitmap::Bitmap(std::string const &value, BitmapOptions const &options)
+  : options_(options),
+    avx2_(options.simd && HasAvx2()),
+    bytes_(value.begin(), value.end())
+{}
+
+
+bool const Bitmap::Load(Connection &conn, std::string const &key) {
+  BlobTransfer blobs(conn, this->options_.transfer);
+
+  size_t capacity = blobs.Size(key);
+
+  // Tried again if the value grew between its STRLEN and its download.
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    this->bytes_.resize(capacity);
+
+    size_t size = 0;
+
+    bool const downloaded = blobs.Download(
+      key,
+      reinterpret_cast<char*>(this->bytes_.data()),
+      capacity,
+      size
+    );
+
+    if (downloaded) {
+      this->bytes_.resize(size);
+      return true;
+    }
+
+    if (size <= capacity) {
+      break;
+    }
+
+    capacity = size;
+  }
+
+  this->bytes_.clear();
+  return false;
+}
+
+
+bool const Bitmap::Store(Connection &conn, std::string const &key) const {
+  if (this->bytes_.empty()) {
+    ReplyPtr const reply = conn.RawCmd("DEL", key);
+
+    if (!reply || reply->type == REDIS_REPLY_ERROR) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kReply,
+        "Bitmap: could not delete ", key
+      );
+
+      return false;
+    }
+
+    return true;
+  }
+
+  BlobTransfer blobs(conn, this->options_.transfer);
+
+  return blobs.Upload(
+    key,
+    reinterpret_cast<char const*>(this->bytes_.data()),
+    this->bytes_.size()
+  );
+}
+
+
+Bitmap& Bitmap::Apply(BitOp const op, Bitmap const &other) {
+  size_t const size   = this->bytes_.size();
+  size_t const common = std::min(size, other.bytes_.size());
+
+  if (other.bytes_.size() > size) {
+    this->bytes_.resize(other.bytes_.size(), 0);
+  }
+
+  uint8_t *const       destination = this->bytes_.data();
+  uint8_t const *const source      = other.bytes_.data();
+  bool const           avx2        = this->avx2_;
+
+  this->Split(
+    common,
+    [=](size_t const begin, size_t const end, size_t const) {
+      Combine(avx2, op, destination + begin, source + begin, end - begin);
+    }
+  );
+
+  // Past the shorter operand, the other one meets zeros.
+  if (op == BitOp::kAnd) {
+    std::fill(this->bytes_.begin() + common, this->bytes_.end(), 0);
+  }
+  else if (other.bytes_.size() > size) {
+    std::copy(
+      other.bytes_.begin() + common,
+      other.bytes_.end(),
+      this->bytes_.begin() + common
+    );
+  }
+
+  return *this;
+}
+
+
+Bitmap& Bitmap::And(Bitmap const &other) {
+  return this->Apply(BitOp::kAnd, other);
+}
+
+
+Bitmap& Bitmap::Or(Bitmap const &other) {
+  return this->Apply(BitOp::kOr, other);
+}
+
+
+Bitmap& Bitmap::Xor(Bitmap const &other) {
+  return this->Apply(BitOp::kXor, other);
+}
+
+
+Bitmap& Bitmap::Not() {
+  uint8_t *const data = this->bytes_.data();
+
+  // Memory bound: the portable loop keeps up with AVX2 here.
+  this->Split(
+    this->bytes_.size(),
+    [=](size_t const begin, size_t const end, size_t const) {
+      InvertPortable(data + begin, end - begin);
+    }
+  );
+
+  return *this;
+}
+
+
+bool const Bitmap::Get(uint64_t const offset) const noexcept {
+  uint64_t const byte = offset >> 3;
+
+  return byte < this->bytes_.size() &&
+    (this->bytes_[byte] & (0x80 >> (offset & 7))) != 0;
+}
+
+
+void Bitmap::Set(uint64_t const offset, bool const bit) {
+  uint64_t const byte = offset >> 3;
+  uint8_t const  mask = 0x80 >> (offset & 7);
+
+  if (byte >= this->bytes_.size()) {
+    this->bytes_.resize(byte + 1, 0);
+  }
+
+  if (bit) {
+    this->bytes_[byte] |= mask;
+  }
+  else {
+    this->bytes_[byte] &= ~mask;
+  }
+}
+
+
+uint64_t const Bitmap::Count() const {
+  return this->Popcount(0, this->bytes_.size());
+}
+
+
+uint64_t const Bitmap::Count(
+    int64_t const start,
+    int64_t const end,
+    BitUnit const unit
+) const {
+  uint64_t first, last;
+
+  if (!this->Bits(start, end, unit, first, last)) {
+    return 0;
+  }
+
+  size_t const first_byte = first >> 3;
+  size_t const last_byte  = last >> 3;
+
+  uint8_t const head = 0xff >> (first & 7);
+  uint8_t const tail = 0xff << (7 - (last & 7));
+
+  if (first_byte == last_byte) {
+    return __builtin_popcount(this->bytes_[first_byte] & head & tail);
+  }
+
+  return __builtin_popcount(this->bytes_[first_byte] & head) +
+    this->Popcount(first_byte + 1, last_byte) +
+    __builtin_popcount(this->bytes_[last_byte] & tail);
+}
+
+
+int64_t const Bitmap::Position(bool const bit) const {
+  return this->Find(bit, 0, -1, BitUnit::kByte, false);
+}
+
+
+int64_t const Bitmap::Position(bool const bit, int64_t const start) const {
+  return this->Find(bit, start, -1, BitUnit::kByte, false);
+}
+
+
+int64_t const Bitmap::Position(
+    bool const bit,
+    int64_t const start,
+    int64_t const end,
+    BitUnit const unit
+) const {
+  return this->Find(bit, start, end, unit, true);
+}
+
+
+uint8_t const* Bitmap::data() const noexcept {
+  return this->bytes_.data();
+}
+
+
+size_t const Bitmap::size() const noexcept {
+  return this->bytes_.size();
+}
+
+
+std::vector<uint8_t> const& Bitmap::bytes() const noexcept {
+  return this->bytes_;
+}
+
+
+bool const Bitmap::HasAvx2() noexcept {
+  static bool const avx2 = DetectAvx2();
+  return avx2;
+}
+
+
+bool const Bitmap::Bits(
+    int64_t start,
+    int64_t end,
+    BitUnit const unit,
+    uint64_t &first,
+    uint64_t &last
+) const noexcept {
+  int64_t const length = static_cast<int64_t>(this->bytes_.size()) *
+    (unit == BitUnit::kBit ? 8 : 1);
+
+  if (start < 0) {
+    start += length;
+  }
+
+  if (end < 0) {
+    end += length;
+  }
+
+  start = std::max<int64_t>(start, 0);
+  end   = std::min<int64_t>(std::max<int64_t>(end, 0), length - 1);
+
+  if (length == 0 || start > end) {
+    return false;
+  }
+
+  if (unit == BitUnit::kBit) {
+    first = start;
+    last  = end;
+  }
+  else {
+    first = start * 8;
+    last  = end * 8 + 7;
+  }
+
+  return true;
+}
+
+
+int64_t const Bitmap::Find(
+    bool const bit,
+    int64_t const start,
+    int64_t const end,
+    BitUnit const unit,
+    bool const end_given
+) const {
+  // A missing key, as far as Redis is concerned.
+  if (this->bytes_.empty()) {
+    return bit ? -1 : 0;
+  }
+
+  uint64_t first, last;
+
+  if (!this->Bits(start, end, unit, first, last)) {
+    return -1;
+  }
+
+  size_t const first_byte = first >> 3;
+  size_t const last_byte  = last >> 3;
+
+  // Bits outside the range read as the ones that aren't looked for.
+  auto const masked = [&](size_t const index) -> uint8_t {
+    uint8_t mask = 0xff;
+
+    if (index == first_byte) {
+      mask &= 0xff >> (first & 7);
+    }
+
+    if (index == last_byte) {
+      mask &= 0xff << (7 - (last & 7));
+    }
+
+    uint8_t const byte = this->bytes_[index];
+
+    return bit ? (byte & mask) : static_cast<uint8_t>(~(byte | ~mask));
+  };
+
+  size_t found = last_byte + 1;
+
+  if (masked(first_byte) != 0) {
+    found = first_byte;
+  }
+  else if (first_byte != last_byte) {
+    found = this->Scan(bit ? 0x00 : 0xff, first_byte + 1, last_byte);
+
+    if (found == last_byte && masked(last_byte) == 0) {
+      found = last_byte + 1;
+    }
+  }
+
+  if (found <= last_byte) {
+    // Set bits of masked() are the ones looked for, either way.
+    uint8_t const byte = (found == first_byte || found == last_byte)
+      ? masked(found)
+      : static_cast<uint8_t>(bit ? this->bytes_[found] : ~this->bytes_[found]);
+
+    return found * 8 + FirstBit(byte);
+  }
+
+  if (!bit && !end_given) {
+    return last + 1;
+  }
+
+  return -1;
+}
+
+
+uint64_t const Bitmap::Popcount(size_t const begin, size_t const end) const {
+  if (begin >= end) {
+    return 0;
+  }
+
+  uint8_t const *const data = this->bytes_.data() + begin;
+  bool const           avx2 = this->avx2_;
+
+  std::vector<uint64_t> counts(this->Slices(end - begin), 0);
+
+  this->Split(
+    end - begin,
+    [&](size_t const from, size_t const to, size_t const index) {
+#ifdef REDISWRAPS_BITMAP_AVX2
+      if (avx2) {
+        counts[index] = PopcountAvx2(data + from, to - from);
+        return;
+      }
+#endif
+
+      counts[index] = PopcountPortable(data + from, to - from);
+    }
+  );
+
+  uint64_t count = 0;
+
+  for (uint64_t const slice : counts) {
+    count += slice;
+  }
+
+  return count;
+}
+
+
+size_t const Bitmap::Scan(
+    uint8_t const skip,
+    size_t const begin,
+    size_t const end
+) const {
+  if (begin >= end) {
+    return end;
+  }
+
+  uint8_t const *const data = this->bytes_.data() + begin;
+  bool const           avx2 = this->avx2_;
+
+  // What is looked for is usually near the start: look there first, as
+  //   the slices below are each scanned in full.
+  size_t const head = std::min(end - begin, this->options_.min_bytes_per_thread);
+
+#ifdef REDISWRAPS_BITMAP_AVX2
+  size_t const offset = avx2
+    ? ScanAvx2(data, head, skip)
+    : ScanPortable(data, head, skip);
+#else
+  size_t const offset = ScanPortable(data, head, skip);
+#endif
+
+  if (offset < head || head == end - begin) {
+    return begin + offset;
+  }
+
+  // Past it, the first slice with a hit wins.
+  uint8_t const *const rest = data + head;
+  size_t const         size = end - begin - head;
+
+  std::vector<size_t> hits(this->Slices(size), size);
+
+  this->Split(
+    size,
+    [&](size_t const from, size_t const to, size_t const index) {
+      size_t hit;
+
+#ifdef REDISWRAPS_BITMAP_AVX2
+      if (avx2) {
+        hit = ScanAvx2(rest + from, to - from, skip);
+      }
+      else
+#endif
+      {
+        hit = ScanPortable(rest + from, to - from, skip);
+      }
+
+      if (hit < to - from) {
+        hits[index] = from + hit;
+      }
+    }
+  );
+
+  return begin + head + *std::min_element(hits.begin(), hits.end());
+}
+
+
+size_t const Bitmap::Slices(size_t const size) const noexcept {
+  size_t threads = this->options_.threads;
+
+  if (threads == 0) {
+    threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  size_t const per_thread = std::max<size_t>(this->options_.min_bytes_per_thread, 1);
+
+  return std::max<size_t>(std::min(threads, size / per_thread), 1);
+}
+
+
+template<typename Slice>
+void Bitmap::Split(size_t const size, Slice const &slice) const {
+  size_t const slices = this->Slices(size);
+
+  if (slices == 1) {
+    slice(0, size, 0);
+    return;
+  }
+
+  // Whole cache lines to each, so that no two threads write to one.
+  size_t const per_slice = ((size / slices) + 63) & ~size_t(63);
+
+  std::vector<std::thread> workers;
+  workers.reserve(slices - 1);
+
+  size_t begin = 0;
+
+  for (size_t index = 0; index + 1 < slices; ++index) {
+    size_t const end = std::min(begin + per_slice, size);
+
+    workers.emplace_back([&slice, begin, end, index]() {
+      slice(begin, end, index);
+    });
+
+    begin = end;
+  }
+
+  slice(begin, size, slices - 1);
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+} // namespace rediswraps
@@ -0,0 +1,604 @@
+#include <rediswraps/blob.hh>
+
+#include <algorithm>   // std::min(), std::max()
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>   // PRIx64, PRIu64
+#include <cstdio>      // snprintf()
+#include <cstring>     // memcpy(), strerror()
+#include <exception>
+#include <random>      // std::random_device
+#include <stdexcept>   // std::invalid_argument
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>  // sendmsg()
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/pipeline.hh>
+#include <rediswraps/sharded.hh>  // ShardedConnection::ShardId()
+#include <rediswraps/utils.hh>    // utils::SameSlotKey()
+
+
+namespace rediswraps {
+namespace {
+
+// Writes every byte described by "iov", resuming after partial writes.
+//   A socket the server closed fails with EPIPE rather than raising SIGPIPE.
+bool const WriteAll(int const fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+
+    message.msg_iov    = iov;
+    message.msg_iovlen = count;
+
+    ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
+  }
+
+  return true;
+}
+
+
+bool const PwriteAll(
+    int const fd,
+    char const *data,
+    size_t size,
+    off_t offset
+) {
+  while (size > 0) {
+    ssize_t const written = pwrite(fd, data, size, offset);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    data   += written;
+    size   -= written;
+    offset += written;
+  }
+
+  return true;
+}
+
+
+// A key no other upload uses, in the same slot as "key":
+//   "{key}.uploading.<process nonce>.<counter>".  The nonce tells processes
+//   apart, even across hosts, the counter uploads within this one.
+std::string const UploadKey(std::string const &key) {
+  static uint64_t const nonce = []() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+  }();
+
+  static std::atomic<uint64_t> counter{0};
+
+  char suffix[64];
+  snprintf(
+    suffix, sizeof(suffix), "%s.%016" PRIx64 ".%" PRIu64,
+    constants::kBlobUploadSuffix, nonce, ++counter
+  );
+
+  return utils::SameSlotKey(key, suffix);
+}
+
+} // namespace
+
+
+BlobTransfer::BlobTransfer(Connection &conn, BlobOptions const &options)
+  : conn_(conn),
+    options_(options)
+{
+  if (this->options_.chunk_size == 0 || this->options_.window == 0) {
+    throw std::invalid_argument(
+      "BlobTransfer needs a chunk_size and a window of at least 1."
+    );
+  }
+}
+
+
+bool const BlobTransfer::Upload(
+    std::string const &key,
+    char const *data,
+    size_t size
+) {
+  this->stats_ = BlobStats();
+
+  if (!this->Prepare()) {
+    return false;
+  }
+
+  bool const atomic = this->options_.atomic;
+  std::string const target = atomic ? UploadKey(key) : key;
+
+  // The temporary key expires unless the upload keeps it alive, so one
+  //   abandoned halfway doesn't leak.
+  int64_t const ttl = atomic ? this->options_.upload_ttl.count() : 0;
+
+  auto refreshed = std::chrono::steady_clock::now();
+
+  size_t      offset  = 0;
+  size_t      pending = 0;
+  std::string error;
+
+  // An empty value still takes one SET.
+  do {
+    size_t const chunk = std::min(this->options_.chunk_size, size - offset);
+
+    bool const sent = offset == 0
+      ? this->SendChunk("SET", target, data, chunk, ttl)
+      : this->SendChunk("APPEND", target, data + offset, chunk);
+
+    if (!sent) {
+      return this->Fail(
+        std::string("Could not send a chunk of ") + key + ": " + strerror(errno),
+        true
+      );
+    }
+
+    offset += chunk;
+    ++pending;
+    ++this->stats_.commands;
+
+    auto const now = std::chrono::steady_clock::now();
+
+    if (ttl > 0 && now - refreshed >= this->options_.upload_ttl / 2) {
+      std::string command;
+      this->conn_.EncodeCmd(command, "PEXPIRE", target, ttl);
+
+      if (!this->SendEncoded(command)) {
+        return this->Fail(
+          std::string("Could not send a PEXPIRE of ") + target + ": " +
+          strerror(errno),
+          true
+        );
+      }
+
+      refreshed = now;
+      ++pending;
+      ++this->stats_.commands;
+    }
+
+    if (pending > this->options_.window) {
+      ReplyPtr reply;
+      --pending;
+
+      if (!this->ReadReply(reply)) {
+        if (!reply) {
+          return this->Fail("No reply while uploading " + key, true);
+        }
+
+        error.assign(reply->str, reply->len);
+        break;
+      }
+    }
+  } while (offset < size);
+
+  // Drained even after an error, so the connection stays usable.
+  while (pending > 0) {
+    ReplyPtr reply;
+    --pending;
+
+    if (!this->ReadReply(reply)) {
+      if (!reply) {
+        return this->Fail("No reply while uploading " + key, true);
+      }
+
+      if (error.empty()) {
+        error.assign(reply->str, reply->len);
+      }
+    }
+  }
+
+  if (!error.empty()) {
+    if (atomic) {
+      this->conn_.RawCmd("DEL", target);
+    }
+
+    return this->Fail("Could not upload " + key + ": " + error, false);
+  }
+
+  this->stats_.bytes = size;
+
+  return atomic ? this->Publish(target, key) : true;
+}
+
+
+bool const BlobTransfer::UploadFile(
+    std::string const &key,
+    std::string const &path
+) {
+  int const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    this->stats_ = BlobStats();
+    return this->Fail("Could not open " + path + ": " + strerror(errno), false);
+  }
+
+  struct stat status;
+
+  if (fstat(fd, &status) != 0) {
+    std::string const reason = strerror(errno);
+    close(fd);
+
+    this->stats_ = BlobStats();
+    return this->Fail("Could not stat " + path + ": " + reason, false);
+  }
+
+  size_t const size = static_cast<size_t>(status.st_size);
+
+  if (size == 0) {
+    close(fd);
+    return this->Upload(key, "", 0);
+  }
+
+  void *const mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  std::string const reason = strerror(errno);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    this->stats_ = BlobStats();
+    return this->Fail("Could not map " + path + ": " + reason, false);
+  }
+
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  bool const uploaded = this->Upload(key, static_cast<char const*>(mapped), size);
+
+  munmap(mapped, size);
+  return uploaded;
+}
+
+
+size_t const BlobTransfer::Size(std::string const &key) {
+  size_t size = 0;
+  this->Length(key, size);
+
+  return size;
+}
+
+
+bool const BlobTransfer::Download(
+    std::string const &key,
+    char *buffer,
+    size_t const capacity,
+    size_t &size
+) {
+  this->stats_ = BlobStats();
+
+  if (!this->Length(key, size)) {
+    return false;
+  }
+
+  if (size > capacity) {
+    return this->Fail(
+      key + " holds " + std::to_string(size) + " bytes, more than the " +
+      std::to_string(capacity) + " available",
+      false
+    );
+  }
+
+  return this->Fetch(
+    key,
+    size,
+    [buffer](char const *data, size_t const length, size_t const offset) {
+      memcpy(buffer + offset, data, length);
+      return true;
+    }
+  );
+}
+
+
+bool const BlobTransfer::DownloadFile(
+    std::string const &key,
+    std::string const &path
+) {
+  this->stats_ = BlobStats();
+
+  int const fd = open(
+    path.c_str(),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (fd < 0) {
+    return this->Fail("Could not open " + path + ": " + strerror(errno), false);
+  }
+
+  size_t size;
+
+  if (!this->Length(key, size)) {
+    close(fd);
+    return false;
+  }
+
+  bool const fetched = this->Fetch(
+    key,
+    size,
+    [fd](char const *data, size_t const length, size_t const offset) {
+      return PwriteAll(fd, data, length, static_cast<off_t>(offset));
+    }
+  );
+
+  if (close(fd) != 0 && fetched) {
+    return this->Fail("Could not write " + path + ": " + strerror(errno), false);
+  }
+
+  return fetched;
+}
+
+
+BlobStats const& BlobTransfer::stats() const noexcept {
+  return this->stats_;
+}
+
+
+bool const BlobTransfer::Fetch(
+    std::string const &key,
+    size_t const size,
+    Sink const &sink
+) {
+  size_t requested = 0;
+  size_t received  = 0;
+  size_t pending   = 0;
+
+  std::string command;
+
+  while (received < size) {
+    // Keep the window full; redisGetReply() sends what was appended.
+    while (pending < this->options_.window && requested < size) {
+      size_t const chunk = std::min(this->options_.chunk_size, size - requested);
+
+      command.clear();
+      this->conn_.EncodeCmd(
+        command,
+        "GETRANGE", key, requested, requested + chunk - 1
+      );
+
+      if (
+          redisAppendFormattedCommand(
+            this->conn_.context_,
+            command.data(),
+            command.size()
+          ) != REDIS_OK
+      ) {
+        return this->Fail("Could not queue a GETRANGE of " + key, true);
+      }
+
+      requested += chunk;
+      ++pending;
+      ++this->stats_.commands;
+    }
+
+    size_t const expected = std::min(this->options_.chunk_size, size - received);
+
+    ReplyPtr reply;
+    --pending;
+
+    if (!this->ReadReply(reply, REDIS_REPLY_STRING)) {
+      return this->Fail(
+        "Could not download " + key +
+        (reply && reply->type == REDIS_REPLY_ERROR
+          ? ": " + std::string(reply->str, reply->len)
+          : ": missing or unexpected reply"),
+        true
+      );
+    }
+
+    if (reply->len != expected) {
+      return this->Fail(key + " was shortened during its download", pending > 0);
+    }
+
+    if (!sink(reply->str, reply->len, received)) {
+      return this->Fail(
+        "Could not store a chunk of " + key + ": " + strerror(errno),
+        pending > 0
+      );
+    }
+
+    received += reply->len;
+    this->stats_.bytes = received;
+  }
+
+  return true;
+}
+
+
+bool const BlobTransfer::Length(std::string const &key, size_t &size) {
+  size = 0;
+
+  if (!this->Prepare()) {
+    return false;
+  }
+
+  ReplyPtr const reply = this->conn_.RawCmd("STRLEN", key);
+  ++this->stats_.commands;
+
+  if (!reply || reply->type != REDIS_REPLY_INTEGER) {
+    return this->Fail(
+      "Could not get the length of " + key +
+      (reply && reply->type == REDIS_REPLY_ERROR
+        ? ": " + std::string(reply->str, reply->len)
+        : ""),
+      false
+    );
+  }
+
+  size = static_cast<size_t>(reply->integer);
+  return true;
+}
+
+
+bool const BlobTransfer::Publish(
+    std::string const &target,
+    std::string const &key
+) {
+  // One transaction, so "key" never shows up with the temporary key's TTL.
+  Pipeline publish(this->conn_);
+  publish
+    .Add("MULTI")
+    .Add("PERSIST", target)
+    .Add("RENAME", target, key)
+    .Add("EXEC");
+
+  std::vector<ReplyPtr> const replies = publish.ExecuteRaw();
+  this->stats_.commands += replies.size();
+
+  ReplyPtr const &exec = replies.back();
+
+  if (
+      exec && exec->type == REDIS_REPLY_ARRAY && exec->elements == 2 &&
+      exec->element[1]->type != REDIS_REPLY_ERROR
+  ) {
+    return true;
+  }
+
+  std::string reason;
+
+  if (exec && exec->type == REDIS_REPLY_ERROR) {
+    reason.assign(exec->str, exec->len);
+  }
+  else if (exec && exec->type == REDIS_REPLY_ARRAY && exec->elements == 2) {
+    reason.assign(exec->element[1]->str, exec->element[1]->len);
+  }
+
+  return this->Fail(
+    "Could not rename " + target + " to " + key +
+    (reason.empty() ? "" : ": " + reason),
+    false
+  );
+}
+
+
+bool const BlobTransfer::SendChunk(
+    std::string const &command,
+    std::string const &key,
+    char const *data,
+    size_t const size,
+    int64_t const ttl
+) {
+  std::string const header =
+    (ttl > 0 ? "*5" : "*3") +
+    std::string("\r\n$") + std::to_string(command.size()) + "\r\n" + command +
+    "\r\n$" + std::to_string(key.size()) + "\r\n" + key +
+    "\r\n$" + std::to_string(size) + "\r\n";
+
+  std::string trailer = "\r\n";
+  std::string const milliseconds = std::to_string(ttl);
+
+  if (ttl > 0) {
+    trailer +=
+      "$2\r\nPX\r\n$" + std::to_string(milliseconds.size()) + "\r\n" +
+      milliseconds + "\r\n";
+  }
+
+  // Only copied for hot keys and recorders, which are shown what is sent.
+  if (this->conn_.Observed()) {
+    std::string const argv[] = {
+      command, key, std::string(data, size), "PX", milliseconds
+    };
+
+    this->conn_.Observe(argv, ttl > 0 ? 5 : 3);
+  }
+
+  struct iovec iov[3];
+
+  iov[0].iov_base = const_cast<char*>(header.data());
+  iov[0].iov_len  = header.size();
+  iov[1].iov_base = const_cast<char*>(data);
+  iov[1].iov_len  = size;
+  iov[2].iov_base = const_cast<char*>(trailer.data());
+  iov[2].iov_len  = trailer.size();
+
+  return WriteAll(this->conn_.context_->fd, iov, 3);
+}
+
+
+bool const BlobTransfer::SendEncoded(std::string const &command) {
+  struct iovec iov;
+
+  iov.iov_base = const_cast<char*>(command.data());
+  iov.iov_len  = command.size();
+
+  return WriteAll(this->conn_.context_->fd, &iov, 1);
+}
+
+
+bool const BlobTransfer::ReadReply(ReplyPtr &reply, int const expected_type) {
+  void *raw = nullptr;
+
+  if (redisGetReply(this->conn_.context_, &raw) != REDIS_OK || raw == nullptr) {
+    reply.reset();
+    return false;
+  }
+
+  reply.reset(static_cast<redisReply*>(raw));
+
+  return
+    reply->type != REDIS_REPLY_ERROR &&
+    (expected_type < 0 || reply->type == expected_type);
+}
+
+
+bool const BlobTransfer::Prepare() {
+  try {
+    if (!this->conn_.IsConnected()) {
+      this->conn_.Reconnect();
+    }
+  }
+  catch (std::exception const &e) {
+    return this->Fail(e.what(), false);
+  }
+
+  // Replies of discarded commands must not be mistaken for ours, and the
+  //   chunks bypass hiredis' output buffer, which must be empty by now.
+  this->conn_.FlushDiscarded();
+
+  if (!this->conn_.IsConnected()) {
+    return this->Fail("Lost the connection", false);
+  }
+
+  return true;
+}
+
+
+bool const BlobTransfer::Fail(std::string const &what, bool const drop_connection) {
+  logging::Log<logging::Severity::kError>(
+    logging::Topic::kConnection,
+    "BlobTransfer on ", ShardedConnection::ShardId(this->conn_), ": ", what
+  );
+
+  if (drop_connection) {
+    this->conn_.Disconnect();
+  }
+
+  return false;
+}
+
+} // namespace rediswraps
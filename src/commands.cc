@@ -0,0 +1,162 @@
+#include <rediswraps/commands.hh>
+
+#include <algorithm>     // std::transform() to lowercase command names
+#include <cctype>        // tolower()
+#include <mutex>
+#include <unordered_map>
+
+#include <rediswraps/connection.hh>
+
+
+namespace rediswraps {
+namespace {
+
+std::unordered_map<std::string, CommandInfo> info_cache;
+std::mutex info_cache_lock;
+
+
+CommandInfo const ParseCommandInfo(redisReply const *entry) {
+  CommandInfo info;
+
+  // An unknown command comes back as a nil entry.
+  if (entry == nullptr || entry->type != REDIS_REPLY_ARRAY ||
+      entry->elements < 6) {
+    return info;
+  }
+
+  info.known     = true;
+  info.arity     = static_cast<int>(entry->element[1]->integer);
+  info.first_key = static_cast<int>(entry->element[3]->integer);
+  info.last_key  = static_cast<int>(entry->element[4]->integer);
+  info.key_step  = static_cast<int>(entry->element[5]->integer);
+
+  redisReply const *flags = entry->element[2];
+
+  for (size_t i = 0; i < flags->elements; ++i) {
+    std::string const flag(flags->element[i]->str, flags->element[i]->len);
+
+    if (flag == "readonly") {
+      info.readonly = true;
+    }
+    else if (flag == "write") {
+      info.write = true;
+    }
+    else if (flag == "movablekeys") {
+      info.movablekeys = true;
+    }
+    else if (flag == "random") {
+      info.random = true;
+    }
+    else if (flag == "blocking") {
+      info.blocking = true;
+    }
+  }
+
+  // ACL categories (6.0+), then command tips (7.0+).
+  if (entry->elements > 6 && entry->element[6]->type == REDIS_REPLY_ARRAY) {
+    redisReply const *categories = entry->element[6];
+
+    for (size_t i = 0; i < categories->elements; ++i) {
+      redisReply const *category = categories->element[i];
+
+      if (std::string(category->str, category->len) == "@blocking") {
+        info.blocking = true;
+      }
+    }
+  }
+
+  if (entry->elements > 7 && entry->element[7]->type == REDIS_REPLY_ARRAY) {
+    redisReply const *tips = entry->element[7];
+
+    for (size_t i = 0; i < tips->elements; ++i) {
+      redisReply const *tip = tips->element[i];
+
+      if (std::string(tip->str, tip->len) == "nondeterministic_output") {
+        info.random = true;
+      }
+    }
+  }
+
+  return info;
+}
+
+} // namespace
+
+
+CommandInfo const DescribeCommand(Connection &conn, std::string const &base) {
+  std::string name(base);
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+  {
+    std::lock_guard<std::mutex> info_cache_lock_guard(info_cache_lock);
+
+    auto const cached = info_cache.find(name);
+
+    if (cached != info_cache.end()) {
+      return cached->second;
+    }
+  }
+
+  // The round trip happens outside the lock; two threads racing on the same
+  //   uncached name will simply both ask and store the same answer.
+  ReplyPtr reply = conn.RawCmd("COMMAND", "INFO", name);
+
+  if (!reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != 1) {
+    // Don't cache: the connection may simply be down right now.
+    return CommandInfo();
+  }
+
+  CommandInfo const info = ParseCommandInfo(reply->element[0]);
+
+  std::lock_guard<std::mutex> info_cache_lock_guard(info_cache_lock);
+  info_cache[name] = info;
+
+  return info;
+}
+
+
+bool const DescribeAllCommands(
+    Connection &conn,
+    std::unordered_map<std::string, CommandInfo> &commands
+) {
+  ReplyPtr reply = conn.RawCmd("COMMAND");
+
+  if (!reply || reply->type != REDIS_REPLY_ARRAY) {
+    return false;
+  }
+
+  std::unordered_map<std::string, CommandInfo> described;
+  described.reserve(reply->elements);
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    redisReply const *entry = reply->element[i];
+    CommandInfo const info  = ParseCommandInfo(entry);
+
+    if (!info.known) {
+      continue;
+    }
+
+    std::string name(entry->element[0]->str, entry->element[0]->len);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    described[std::move(name)] = info;
+  }
+
+  {
+    std::lock_guard<std::mutex> info_cache_lock_guard(info_cache_lock);
+
+    for (auto const &command : described) {
+      info_cache[command.first] = command.second;
+    }
+  }
+
+  commands.swap(described);
+  return true;
+}
+
+
+bool const IsReadOnlyCommand(Connection &conn, std::string const &base) {
+  return DescribeCommand(conn, base).readonly;
+}
+
+} // namespace rediswraps
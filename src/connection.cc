@@ -1,5 +1,17 @@
 #include <rediswraps/connection.hh>
 
+#include <cstdlib>       // strtoul() for script keycounts
+#include <sstream>       // parsing LoadScripts() manifests
+#include <vector>
+
+#include <dirent.h>      // listing LoadScripts() directories
+#include <poll.h>        // writing discarded commands without blocking
+#include <sys/stat.h>
+
+#include <rediswraps/hotkeys.hh>
+#include <rediswraps/pipeline.hh>
+#include <rediswraps/record.hh>
+
 
 namespace rediswraps {
 
@@ -10,36 +22,258 @@ std::unordered_map<std::string, std::pair<std::string, size_t>>
 // static
 std::mutex Connection::scripts_lock_;
 
+// static
+redisReplyObjectFunctions Connection::stream_functions_ = {
+  Connection::StreamString,
+  Connection::StreamArray,
+  Connection::StreamInteger,
+  Connection::StreamDouble,
+  Connection::StreamNil,
+  Connection::StreamBool,
+  Connection::StreamFree
+};
+
 
 Connection::Connection(
     std::string const &host,
     int const port,
-    std::string const &name
+    std::string const &name,
+    int const protocol
 )
   : socket_(boost::none),
     host_(boost::make_optional(!host.empty(), host)),
     port_(boost::make_optional(port > 0, port)),
-    name_(boost::make_optional(!name.empty(), name))
+    name_(boost::make_optional(!name.empty(), name)),
+    requested_protocol_(protocol)
 {
   this->Connect();
 }
 
 
-Connection::Connection(std::string const &socket, std::string const &name)
+Connection::Connection(
+    std::string const &socket,
+    std::string const &name,
+    int const protocol
+)
   : socket_(boost::make_optional(!socket.empty(), socket)),
     host_(boost::none),
     port_(boost::none),
-    name_(boost::make_optional(!name.empty(), name))
+    name_(boost::make_optional(!name.empty(), name)),
+    requested_protocol_(protocol)
 {
   this->Connect();
 }
 
 
 Connection::~Connection() {
+  try {
+    this->FlushDiscarded();
+  }
+  catch (...) {}
+
   this->Disconnect();
 }
 
 
+bool const Connection::FlushDiscarded() {
+  uint64_t const failures =
+    this->discard_stats_.errors + this->discard_stats_.lost;
+
+  if (this->discard_pending_ > 0 && this->IsConnected()) {
+    this->ReadDiscarded();
+  }
+
+  return failures == this->discard_stats_.errors + this->discard_stats_.lost;
+}
+
+
+redisReply* Connection::FormattedCmdReply(
+    std::string const &buffer,
+    trace::Event &event
+) {
+  if (this->context_ == nullptr) {
+    this->Reconnect();
+  }
+
+  if (trace::Tracer::kEnabled) {
+    trace::Tracer::BeforeSend(event);
+  }
+
+  void *reply = nullptr;
+
+  // if it fails maybe it disconnected?...
+  // try once to reconnect quickly before giving up
+  for (bool reconnection_attempted = false; ; reconnection_attempted = true) {
+    // Appending rather than sending right away lets any buffered discarded
+    //   commands go out in the same write; their replies come first.
+    if (
+        redisAppendFormattedCommand(
+          this->context_,
+          buffer.data(),
+          buffer.size()
+        ) == REDIS_OK
+    ) {
+      this->ReadDiscarded();
+
+      if (redisGetReply(this->context_, &reply) != REDIS_OK) {
+        reply = nullptr;
+      }
+    }
+
+    if (reply != nullptr || reconnection_attempted) {
+      break;
+    }
+
+    this->Reconnect();
+  }
+
+  if (trace::Tracer::kEnabled) {
+    trace::Finish(event, reinterpret_cast<redisReply*>(reply));
+
+    if (event.success) {
+      trace::Tracer::AfterReply(event);
+    }
+    else {
+      trace::Tracer::OnError(event);
+    }
+  }
+
+  return reinterpret_cast<redisReply*>(reply);
+}
+
+
+cmd::Response Connection::DiscardFormatted(
+    std::string const &buffer,
+    trace::Event &event
+) {
+  if (this->context_ == nullptr) {
+    this->Reconnect();
+  }
+
+  if (trace::Tracer::kEnabled) {
+    trace::Tracer::BeforeSend(event);
+  }
+
+  if (
+      redisAppendFormattedCommand(
+        this->context_,
+        buffer.data(),
+        buffer.size()
+      ) != REDIS_OK
+  ) {
+    if (trace::Tracer::kEnabled) {
+      event.replied_at = trace::Now();
+      event.error      = this->context_->errstr;
+      trace::Tracer::OnError(event);
+    }
+
+    return cmd::Response(this->context_->errstr, false);
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+
+  if (this->discard_unwritten_ == 0) {
+    this->discard_unwritten_since_ = now;
+  }
+
+  ++this->discard_pending_;
+  ++this->discard_stats_.sent;
+  this->discard_unwritten_ += buffer.size();
+
+  if (this->discard_pending_ >= constants::kDiscardMaxPending) {
+    this->ReadDiscarded();
+  }
+  else {
+    // Nothing else may come along to carry it out, so it goes now if the
+    //   socket takes it; only once it has piled up is that waited for.
+    this->WriteDiscarded(
+      this->discard_unwritten_ >= constants::kDiscardMaxBytes ||
+      now - this->discard_unwritten_since_ >=
+        std::chrono::milliseconds(constants::kDiscardMaxDelayMs)
+    );
+  }
+
+  // The reply is not known yet; tracers see the command as done once queued.
+  if (trace::Tracer::kEnabled) {
+    event.replied_at = trace::Now();
+    event.success    = true;
+    trace::Tracer::AfterReply(event);
+  }
+
+  return cmd::Response(constants::kQueued);
+}
+
+
+void Connection::WriteDiscarded(bool const wait) {
+  if (!wait) {
+    pollfd socket = {this->context_->fd, POLLOUT, 0};
+
+    if (poll(&socket, 1, 0) != 1 || !(socket.revents & POLLOUT)) {
+      return;
+    }
+  }
+
+  for (int done = 0; !done; ) {
+    if (redisBufferWrite(this->context_, &done) != REDIS_OK) {
+      // Leave the context in error; the next command reconnects.
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kConnection,
+        "Lost ", this->discard_pending_, " discarded command(s): ",
+        this->context_->errstr
+      );
+
+      this->discard_stats_.lost += this->discard_pending_;
+      this->discard_pending_   = 0;
+      this->discard_unwritten_ = 0;
+      return;
+    }
+
+    if (!wait && !done) {
+      return;
+    }
+  }
+
+  this->discard_unwritten_ = 0;
+}
+
+
+void Connection::ReadDiscarded() {
+  size_t const pending = this->discard_pending_;
+
+  this->discard_pending_   = 0;
+  this->discard_unwritten_ = 0;
+
+  // redisGetReply() writes out everything appended so far before reading.
+  for (size_t i = 0; i < pending; ++i) {
+    void *reply = nullptr;
+
+    if (redisGetReply(this->context_, &reply) != REDIS_OK || reply == nullptr) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kConnection,
+        "Lost ", (pending - i), " discarded command(s): ",
+        this->context_->errstr
+      );
+
+      this->discard_stats_.lost += pending - i;
+      return;
+    }
+
+    ReplyPtr const discarded(reinterpret_cast<redisReply*>(reply));
+    ++this->discard_stats_.replied;
+
+    if (discarded->type == REDIS_REPLY_ERROR) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kReply,
+        discarded->str
+      );
+
+      ++this->discard_stats_.errors;
+      this->discard_stats_.last_error.assign(discarded->str, discarded->len);
+    }
+  }
+}
+
+
 bool const Connection::LoadScriptFromString(
     std::string const &alias,
     std::string const &script_contents,
@@ -51,25 +285,28 @@ bool const Connection::LoadScriptFromString(
 
   if (reload) {
     if (this->Cmd("SCRIPT", "FLUSH")) {
-      std::cout <<
-        "Warning: The Redis script cache has been flushed due to the request "
-        "for reload of script '" << alias << "'.  Any previously loaded "
-        "scripts will need to be loaded again."
-      << std::endl;
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kScript,
+        "The Redis script cache has been flushed due to the request for "
+        "reload of script '", alias, "'.  Any previously loaded scripts "
+        "will need to be loaded again."
+      );
     }
     else {
-      std::cerr <<
-        "Error: Couldn't flush old Lua scripts from Redis."
-      << std::endl;
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kScript,
+        "Couldn't flush old Lua scripts from Redis."
+      );
     }
   }
 
   if (this->scripts_.count(alias)) {
-    std::cerr <<
-      "Warning: Script named '" << alias << "' has already been loaded into "
-      "memory.  An explicit request must be issued in order to reload this "
-      "script, i.e. the \"reload\" parameter must be set."
-    << std::endl;
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kScript,
+      "Script named '", alias, "' has already been loaded into memory.  An "
+      "explicit request must be issued in order to reload this script, i.e. "
+      "the \"reload\" parameter must be set."
+    );
 
     return false;
   }
@@ -81,10 +318,11 @@ bool const Connection::LoadScriptFromString(
   }
 
   if (hashval.length() != constants::kScriptHashLength) {
-    std::cerr <<
-      "Error: Could not properly load Lua script '" << alias << "' into Redis."
-      "  Invalid hash length."
-    << std::endl;
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kScript,
+      "Could not properly load Lua script '", alias, "' into Redis.  "
+      "Invalid hash length."
+    );
 
     return false;
   }
@@ -101,16 +339,250 @@ bool const Connection::LoadScriptFromString(
 }
 
 
+namespace {
+
+struct ScriptFile {
+  std::string alias;
+  std::string filepath;
+  size_t      keycount = 0;
+  std::string contents;
+  std::string hashval;
+};
+
+
+// Reads N from the first "-- keycount: N" comment line of a script.
+size_t const KeycountFromComment(std::string const &script_contents) {
+  std::istringstream lines(script_contents);
+
+  for (std::string line; std::getline(lines, line); ) {
+    if (line.compare(0, 2, "--") != 0) {
+      continue;
+    }
+
+    auto const tag = line.find("keycount:");
+
+    if (tag != std::string::npos) {
+      return std::strtoul(line.c_str() + tag + 9, nullptr, 10);
+    }
+  }
+
+  return 0;
+}
+
+
+bool const ListScriptDirectory(
+    std::string const &dirpath,
+    std::vector<ScriptFile> &files
+) {
+  DIR *dir = opendir(dirpath.c_str());
+
+  if (dir == nullptr) {
+    return false;
+  }
+
+  while (dirent *entry = readdir(dir)) {
+    std::string const filename(entry->d_name);
+
+    if (filename.size() > 4 &&
+        filename.compare(filename.size() - 4, 4, ".lua") == 0) {
+      ScriptFile file;
+      file.alias    = filename.substr(0, filename.size() - 4);
+      file.filepath = dirpath + "/" + filename;
+
+      files.push_back(std::move(file));
+    }
+  }
+
+  closedir(dir);
+  return true;
+}
+
+
+bool const ListScriptManifest(
+    std::string const &manifest_path,
+    std::vector<ScriptFile> &files
+) {
+  std::istringstream lines(utils::ReadFile(manifest_path));
+
+  auto const slash = manifest_path.rfind('/');
+  std::string const basedir = (slash == std::string::npos) ?
+    "." :
+    manifest_path.substr(0, slash);
+
+  for (std::string line; std::getline(lines, line); ) {
+    std::istringstream fields(line);
+    ScriptFile file;
+
+    if (!(fields >> file.alias) || file.alias[0] == '#') {
+      continue;
+    }
+
+    if (!(fields >> file.filepath)) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kScript,
+        "Script manifest entry for '", file.alias, "' in '", manifest_path,
+        "' has no filepath."
+      );
+
+      return false;
+    }
+
+    fields >> file.keycount;
+
+    if (file.filepath[0] != '/') {
+      file.filepath = basedir + "/" + file.filepath;
+    }
+
+    files.push_back(std::move(file));
+  }
+
+  return true;
+}
+
+} // namespace
+
+
+bool const Connection::LoadScripts(
+    std::string const &path,
+    bool const reload
+) {
+  struct stat path_stat;
+  std::vector<ScriptFile> files;
+
+  bool const found        = (stat(path.c_str(), &path_stat) == 0);
+  bool const is_directory = (found && S_ISDIR(path_stat.st_mode));
+
+  if (!found || !(is_directory ?
+        ListScriptDirectory(path, files) :
+        ListScriptManifest(path, files))) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kScript,
+      "Couldn't list Lua scripts at '", path, "'."
+    );
+
+    return false;
+  }
+
+  bool all_loaded = true;
+
+  for (auto file = files.begin(); file != files.end(); ) {
+    file->contents = utils::ReadFile(file->filepath);
+
+    if (file->contents.empty()) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kScript,
+        "Couldn't read Lua script '", file->alias, "' from '",
+        file->filepath, "'."
+      );
+
+      all_loaded = false;
+      file = files.erase(file);
+      continue;
+    }
+
+    if (is_directory) {
+      file->keycount = KeycountFromComment(file->contents);
+    }
+
+    file->hashval = utils::Sha1Hex(file->contents);
+    ++file;
+  }
+
+  // Fetch scripts data structure mutex
+  std::lock_guard<std::mutex> scripts_lock_guard(Connection::scripts_lock_);
+
+  if (!reload) {
+    for (auto file = files.begin(); file != files.end(); ) {
+      file = this->scripts_.count(file->alias) ? files.erase(file) : file + 1;
+    }
+  }
+
+  if (files.empty()) {
+    return all_loaded;
+  }
+
+  // Round trip 1: which of these does Redis already have cached?
+  std::vector<std::string> exists_argv = {"SCRIPT", "EXISTS"};
+
+  for (auto const &file : files) {
+    exists_argv.push_back(file.hashval);
+  }
+
+  Pipeline pipeline(*this);
+  auto exists = pipeline.AddArgv(exists_argv).ExecuteRaw();
+
+  ReplyPtr const &cached = exists.front();
+
+  bool const know_cached = (
+    cached &&
+    cached->type == REDIS_REPLY_ARRAY &&
+    cached->elements == files.size()
+  );
+
+  // Round trip 2: load everything that isn't.
+  std::vector<size_t> loading;
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!know_cached || cached->element[i]->integer == 0) {
+      pipeline.Add("SCRIPT", "LOAD", files[i].contents);
+      loading.push_back(i);
+    }
+  }
+
+  auto loaded = pipeline.ExecuteRaw();
+  std::vector<bool> failed(files.size(), false);
+
+  for (size_t i = 0; i < loading.size(); ++i) {
+    ScriptFile const &file = files[loading[i]];
+    ReplyPtr const &reply = loaded[i];
+
+    if (!reply ||
+        reply->type != REDIS_REPLY_STRING ||
+        file.hashval.compare(0, std::string::npos, reply->str, reply->len)) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kScript,
+        "Could not properly load Lua script '", file.alias, "' into Redis",
+        ((reply && reply->type == REDIS_REPLY_ERROR) ? ": " : "."),
+        ((reply && reply->type == REDIS_REPLY_ERROR) ? reply->str : "")
+      );
+
+      failed[loading[i]] = true;
+      all_loaded = false;
+    }
+  }
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!failed[i]) {
+      this->scripts_[files[i].alias] = std::pair<std::string, size_t>(
+        files[i].hashval,
+        files[i].keycount
+      );
+    }
+  }
+
+  return all_loaded;
+}
+
+
+// static
+bool const Connection::HasScript(std::string const &alias) {
+  std::lock_guard<std::mutex> scripts_lock_guard(Connection::scripts_lock_);
+
+  return Connection::scripts_.count(alias) > 0;
+}
+
+
 cmd::Response Connection::Response(
     bool const pop_response,
     bool const from_front
 ) {
   if (pop_response && from_front) {
-    std::cerr <<
-      "WARNING: You are popping from the front of the Redis response "
-      "queue.  This is not recommended.  See RedisWraps README for more "
-      "details on why this is dangerous."
-    << std::endl;
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kUsage,
+      "You are popping from the front of the Redis response queue.  This is "
+      "not recommended.  See RedisWraps README for more details on why this "
+      "is dangerous."
+    );
   }
 
   if (!this->HasResponse()) {
@@ -143,6 +615,174 @@ cmd::Response Connection::Response(
 }
 
 
+bool const Connection::StreamReply(StreamState &state) {
+  redisReader *reader = this->context_->reader;
+
+  bool read = false;
+
+  {
+    // Swap in callbacks that visit elements instead of building a tree, and
+    //   put the default ones back no matter how this ends.
+    struct ReaderGuard {
+      redisReader               *reader;
+      redisReplyObjectFunctions *functions;
+      void                      *privdata;
+      Connection                *conn;
+
+      ~ReaderGuard() {
+        this->reader->fn       = this->functions;
+        this->reader->privdata = this->privdata;
+        this->conn->streaming_ = nullptr;
+      }
+    } const reader_guard = {reader, reader->fn, reader->privdata, this};
+
+    state.placeholder = redisReply();
+    reader->fn        = &Connection::stream_functions_;
+    reader->privdata  = &state;
+    this->streaming_  = &state;
+
+    // "reply" is &state.placeholder: there is nothing to free.
+    void *reply = nullptr;
+
+    read = (
+      redisGetReply(this->context_, &reply) == REDIS_OK &&
+      reply != nullptr
+    );
+  }
+
+  // Only once the reader is restored: reconnecting frees it.
+  if (state.exception) {
+    if (!read) {
+      this->Disconnect();
+    }
+
+    std::rethrow_exception(state.exception);
+  }
+
+  if (!read) {
+    state.failed = true;
+    state.error  = this->context_->errstr;
+
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      state.error
+    );
+
+    this->Reconnect();
+  }
+
+  return !state.failed;
+}
+
+
+void* Connection::StreamElement(
+    redisReadTask const *task,
+    cmd::Response &&element
+) {
+  auto *state = static_cast<StreamState*>(task->privdata);
+
+  // Same placeholder type as the real reply so that hiredis' own checks
+  //   on the returned object (e.g. for RESP3 push replies) still work.
+  if (task->parent == nullptr) {
+    state->placeholder.type = task->type;
+  }
+
+  if (Connection::InPushFrame(task)) {
+    return &state->placeholder;
+  }
+
+  element.type_ = Connection::ReplyType(task->type);
+
+  if (task->type == REDIS_REPLY_ERROR && task->parent == nullptr) {
+    // An error instead of a reply: report it, there is nothing to visit.
+    state->failed = true;
+    state->error  = element.data_;
+
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      state->error
+    );
+  }
+  else if (!state->stopped) {
+    // Unwinding from here would leave the reader halfway through the reply;
+    //   StreamReply() rethrows once it is done with it.
+    try {
+      state->stopped = !state->visit(element);
+    }
+    catch (...) {
+      state->exception = std::current_exception();
+      state->stopped   = true;
+    }
+  }
+
+  return &state->placeholder;
+}
+
+
+bool const Connection::InPushFrame(redisReadTask const *task) noexcept {
+  while (task->parent != nullptr) {
+    task = task->parent;
+  }
+
+  return task->type == REDIS_REPLY_PUSH;
+}
+
+
+void* Connection::StreamString(
+    redisReadTask const *task,
+    char *str,
+    size_t len
+) {
+  return Connection::StreamElement(
+    task,
+    cmd::Response(
+      std::string(str, len),
+      task->type != REDIS_REPLY_ERROR
+    )
+  );
+}
+
+
+void* Connection::StreamArray(redisReadTask const *task, size_t elements) {
+  auto *state = static_cast<StreamState*>(task->privdata);
+
+  // Arrays themselves carry no data; their elements follow one by one.
+  if (task->parent == nullptr) {
+    state->placeholder.type = task->type;
+  }
+
+  return &state->placeholder;
+}
+
+
+void* Connection::StreamInteger(redisReadTask const *task, long long value) {
+  return Connection::StreamElement(task, cmd::Response(value));
+}
+
+
+void* Connection::StreamDouble(
+    redisReadTask const *task,
+    double value,
+    char *str,
+    size_t len
+) {
+  return Connection::StreamElement(task, cmd::Response(std::string(str, len)));
+}
+
+
+void* Connection::StreamNil(redisReadTask const *task) {
+  return Connection::StreamElement(task, cmd::Response(constants::kNil));
+}
+
+
+void* Connection::StreamBool(redisReadTask const *task, int value) {
+  return Connection::StreamElement(task, cmd::Response(value ? 1 : 0));
+}
+
+
+void Connection::StreamFree(void *reply) {}
+
+
 void Connection::Connect() {
   if (!this->IsConnected()) {
     // sockets are fastest, try that first
@@ -164,25 +804,232 @@ void Connection::Connect() {
       );
     }
 
-    if (this->name_) {
+    this->protocol_ = 2;
+
+    if (this->requested_protocol_ == 3) {
+      this->Hello();
+    }
+
+    if (this->protocol_ == 2 && this->name_) {
       this->Cmd<cmd::Flag::kClear>("CLIENT", "SETNAME", this->name());
     }
   }
 }
 
 
+void Connection::Hello() {
+  // Sent by hand: the usual command path reconnects on failure, which
+  //   would land right back here.
+  //   Nor is it observed: it is part of connecting, which replays and hot
+  //   keys have no use for.
+  std::string buffer;
+
+  if (this->name_) {
+    this->FormatCmd(buffer, "HELLO", 3, "SETNAME", this->name());
+  }
+  else {
+    this->FormatCmd(buffer, "HELLO", 3);
+  }
+
+  void *reply = nullptr;
+
+  if (
+      redisAppendFormattedCommand(
+        this->context_,
+        buffer.data(),
+        buffer.size()
+      ) != REDIS_OK ||
+      redisGetReply(this->context_, &reply) != REDIS_OK ||
+      reply == nullptr
+  ) {
+    throw std::runtime_error(
+      this->Description() + "HELLO 3 failed: " + this->context_->errstr
+    );
+  }
+
+  ReplyPtr const hello(reinterpret_cast<redisReply*>(reply));
+
+  if (hello->type == REDIS_REPLY_ERROR) {
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "RESP3 unavailable, staying on RESP2: ", hello->str
+    );
+
+    return;
+  }
+
+  this->protocol_ = 3;
+
+  this->context_->privdata = this;
+  redisSetPushCallback(this->context_, &Connection::PushFrame);
+}
+
+
+void Connection::OnPush(PushHandler handler) {
+  this->push_handler_ = std::move(handler);
+}
+
+
+void Connection::SampleHotKeys(std::shared_ptr<HotKeys> hot_keys) {
+  if (hot_keys && !hot_keys->Learn(*this)) {
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "Could not read command key positions; hot keys are only sampled "
+      "from scripts until a connection can."
+    );
+  }
+
+  this->hot_keys_ = std::move(hot_keys);
+}
+
+
+void Connection::SampleKeys(std::string const *argv, size_t const argc) {
+  this->hot_keys_->Sample(argv, argc);
+}
+
+
+void Connection::RecordCommands(std::shared_ptr<CommandRecorder> recorder) {
+  if (recorder) {
+    this->recorder_stream_ = recorder->NewStream();
+  }
+
+  this->recorder_ = std::move(recorder);
+}
+
+
+void Connection::RecordCmd(std::string const *argv, size_t const argc) {
+  this->recorder_->Record(this->recorder_stream_, argv, argc);
+}
+
+
+size_t const Connection::ObserveEncoded(
+    std::string const &buffer,
+    size_t from
+) {
+  if (!this->Observed()) {
+    return buffer.size();
+  }
+
+  std::vector<std::string> argv;
+  from = DecodeArgv(buffer, from, argv);
+
+  this->Observe(argv.data(), argv.size());
+  return from;
+}
+
+
+size_t const Connection::DecodeArgv(
+    std::string const &buffer,
+    size_t from,
+    std::vector<std::string> &argv
+) {
+  // "*<argc>\r\n", then "$<length>\r\n<bytes>\r\n" per argument, as
+  //   EncodeArgv() and PreparedCmd write them.
+  auto const number = [&buffer, &from]() {
+    size_t value = 0;
+
+    for (++from; from < buffer.size() && buffer[from] != '\r'; ++from) {
+      value = value * 10 + static_cast<size_t>(buffer[from] - '0');
+    }
+
+    from += 2;
+    return value;
+  };
+
+  argv.resize(number());
+
+  for (auto &arg : argv) {
+    size_t const length = number();
+
+    arg.assign(buffer, from, length);
+    from += length + 2;
+  }
+
+  return from;
+}
+
+
+void Connection::PushFrame(void *privdata, void *reply) {
+  auto *conn = static_cast<Connection*>(privdata);
+
+  // A push frame read while streaming only ever built the placeholder.
+  if (
+      conn->streaming_ != nullptr &&
+      reply == &conn->streaming_->placeholder
+  ) {
+    conn->streaming_->placeholder = redisReply();
+    return;
+  }
+
+  ReplyPtr const frame(reinterpret_cast<redisReply*>(reply));
+
+  if (!conn->push_handler_) {
+    return;
+  }
+
+  // hiredis calls this from C: nothing may be thrown through it.
+  try {
+    conn->push_handler_(*frame);
+  }
+  catch (std::exception const &e) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kPush,
+      "Push handler threw: ", e.what()
+    );
+  }
+  catch (...) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kPush,
+      "Push handler threw."
+    );
+  }
+}
+
+
+cmd::Response::Type const Connection::ReplyType(
+    int const reply_type
+) noexcept {
+  using Type = cmd::Response::Type;
+
+  switch (reply_type) {
+  case REDIS_REPLY_STATUS:  return Type::kStatus;
+  case REDIS_REPLY_ERROR:   return Type::kError;
+  case REDIS_REPLY_INTEGER: return Type::kInteger;
+  case REDIS_REPLY_NIL:     return Type::kNil;
+  case REDIS_REPLY_DOUBLE:  return Type::kDouble;
+  case REDIS_REPLY_BOOL:    return Type::kBool;
+  case REDIS_REPLY_BIGNUM:  return Type::kBigNumber;
+  case REDIS_REPLY_VERB:    return Type::kVerbatim;
+  default:                  return Type::kString;
+  }
+}
+
+
 void Connection::Disconnect() noexcept {
   if (this->IsConnected()) {
     redisFree(this->context_);
   }
 
+  this->discard_stats_.lost += this->discard_pending_;
+  this->discard_pending_   = 0;
+  this->discard_unwritten_ = 0;
+
   this->context_ = nullptr;
 }
 
 
 void Connection::Reconnect() {
   this->Disconnect();
-  this->Connect();
+
+  try {
+    this->Connect();
+  }
+  catch (...) {
+    trace::Tracer::OnReconnect(*this);
+    throw;
+  }
+
+  trace::Tracer::OnReconnect(*this);
 }
 
 
@@ -201,7 +1048,7 @@ std::string Connection::ResponsesToString() const {
       desc += "\n  [";
       desc += i;
       desc += "] => '";
-      desc += tmp_queue.front();
+      desc += tmp_queue.front().data_;
       desc += "'";
 
       tmp_queue.pop_front();
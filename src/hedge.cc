@@ -0,0 +1,402 @@
+#include <rediswraps/hedge.hh>
+
+#include <algorithm>  // std::min(), std::max()
+#include <cerrno>
+#include <cstring>    // strerror()
+
+#include <poll.h>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/sharded.hh>   // ShardedConnection::ShardId()
+
+
+namespace rediswraps {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The budget counts in millionths of a hedge.
+constexpr int64_t kHedge = 1000000;
+
+
+// Waits until one of "fds" is readable or "timeout" passes; forever if the
+//   timeout is negative.  Hedging delays are often well under a millisecond,
+//   hence ppoll() where there is one.
+int const WaitReadable(
+    pollfd *fds,
+    nfds_t const count,
+    Clock::duration const timeout
+) {
+  int64_t const ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+
+#ifdef __linux__
+  if (ns < 0) {
+    return ppoll(fds, count, nullptr, nullptr);
+  }
+
+  timespec const limit = {
+    static_cast<time_t>(ns / 1000000000),
+    static_cast<long>(ns % 1000000000)
+  };
+
+  return ppoll(fds, count, &limit, nullptr);
+#else
+  return poll(
+    fds,
+    count,
+    (ns < 0) ? -1 : static_cast<int>((ns + 999999) / 1000000)
+  );
+#endif
+}
+
+} // namespace
+
+
+HedgedReads::HedgedReads(HedgeOptions const &options)
+  : options_(options),
+    credit_(0),
+    earned_(static_cast<int64_t>(std::max(options.budget, 0.0) * kHedge)),
+    max_credit_(static_cast<int64_t>(options.burst) * kHedge),
+    delay_ns_(-1),
+    requests_(0),
+    hedged_(0),
+    hedge_wins_(0),
+    over_budget_(0),
+    failovers_(0),
+    bypassed_(0)
+{}
+
+
+HedgeStats const HedgedReads::stats() const noexcept {
+  HedgeStats stats;
+
+  stats.requests    = this->requests_;
+  stats.hedged      = this->hedged_;
+  stats.hedge_wins  = this->hedge_wins_;
+  stats.over_budget = this->over_budget_;
+  stats.failovers   = this->failovers_;
+  stats.bypassed    = this->bypassed_;
+
+  int64_t const delay_ns = this->delay_ns_;
+
+  if (delay_ns > 0) {
+    stats.delay = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::nanoseconds(delay_ns)
+    );
+  }
+
+  return stats;
+}
+
+
+ReplyPtr HedgedReads::Send(
+    Connection &first,
+    Connection &second,
+    std::string const &buffer
+) {
+  ++this->requests_;
+
+  // Every request earns its share of a hedge, up to the burst.
+  for (int64_t credit = this->credit_; credit < this->max_credit_; ) {
+    int64_t const earned = std::min(credit + this->earned_, this->max_credit_);
+
+    if (this->credit_.compare_exchange_weak(credit, earned)) {
+      break;
+    }
+  }
+
+  int64_t const delay_ns = this->delay_ns_;
+
+  Leg legs[2];
+  legs[0].conn = &first;
+  legs[1].conn = &second;
+
+  if (!this->Start(legs[0], buffer)) {
+    ++this->failovers_;
+
+    if (!this->Start(legs[1], buffer)) {
+      return nullptr;
+    }
+  }
+
+  // Until the first window is in there is no telling what's late.
+  bool hedge = (delay_ns >= 0) && !legs[1].sent;
+  bool hedged = false;
+
+  // Latencies are sampled from the first connection's send, and so is the
+  //   delay counted.
+  Clock::time_point const hedge_at =
+    legs[0].sent_at + std::chrono::nanoseconds(delay_ns);
+
+  ReplyPtr reply;
+  size_t   winner = 0;
+
+  while (!reply) {
+    pollfd fds[2];
+    size_t leg_of[2];
+    nfds_t count = 0;
+
+    for (size_t i = 0; i < 2; ++i) {
+      Leg &leg = legs[i];
+
+      // A reply may be in already, e.g. read along with discarded ones.
+      if (!leg.sent || leg.failed || !this->Receive(leg, reply, false)) {
+        continue;
+      }
+
+      if (reply) {
+        winner = i;
+        break;
+      }
+
+      fds[count]    = {leg.conn->context_->fd, POLLIN, 0};
+      leg_of[count] = i;
+      ++count;
+    }
+
+    if (reply) {
+      break;
+    }
+
+    if (count == 0) {
+      // Whatever was sent failed: last resort, the second connection.
+      if (!legs[1].sent) {
+        ++this->failovers_;
+        hedge = false;
+
+        if (this->Start(legs[1], buffer)) {
+          continue;
+        }
+      }
+
+      return nullptr;
+    }
+
+    Clock::duration timeout = Clock::duration(-1);
+
+    if (hedge) {
+      timeout = std::max(hedge_at - Clock::now(), Clock::duration::zero());
+    }
+
+    int const ready = WaitReadable(fds, count, timeout);
+
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kConnection,
+        "Hedged read: poll() failed: ", strerror(errno)
+      );
+
+      for (size_t i = 0; i < count; ++i) {
+        this->Drop(legs[leg_of[i]], "poll() failed");
+      }
+
+      return nullptr;
+    }
+
+    if (ready == 0) {
+      hedge = false;
+
+      if (this->Spend()) {
+        ++this->hedged_;
+        hedged = true;
+
+        this->Start(legs[1], buffer);
+      }
+      else {
+        ++this->over_budget_;
+      }
+
+      continue;
+    }
+
+    for (size_t i = 0; i < count && !reply; ++i) {
+      if (
+          fds[i].revents != 0 &&
+          this->Receive(legs[leg_of[i]], reply, true) &&
+          reply
+      ) {
+        winner = leg_of[i];
+      }
+    }
+  }
+
+  // The loser's reply is still to come: its connection reads and drops it
+  //   before its next command, like the reply to a CMD_VOID command.
+  Leg &loser = legs[1 - winner];
+
+  if (loser.sent && !loser.failed) {
+    loser.conn->discard_pending_ += loser.skip + 1;
+    ++loser.conn->discard_stats_.sent;
+  }
+
+  if (hedged && winner == 1) {
+    ++this->hedge_wins_;
+  }
+
+  // How long the first connection took since its send, or at least took
+  //   when it lost: never the second one's own time, which would drag the
+  //   delay down to the latency of hedges.
+  if (!legs[0].failed) {
+    this->Sample(Clock::now() - legs[0].sent_at);
+  }
+
+  return reply;
+}
+
+
+bool const HedgedReads::Start(Leg &leg, std::string const &buffer) {
+  Connection &conn = *leg.conn;
+  leg.sent = true;
+
+  if (!conn.IsConnected()) {
+    try {
+      conn.Reconnect();
+    }
+    catch (std::exception const &e) {
+      leg.failed = true;
+
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kConnection,
+        "Hedged read: ", e.what()
+      );
+
+      return false;
+    }
+  }
+
+  if (
+      redisAppendFormattedCommand(
+        conn.context_,
+        buffer.data(),
+        buffer.size()
+      ) != REDIS_OK
+  ) {
+    return this->Drop(leg, conn.context_->errstr);
+  }
+
+  // Discarded commands still buffered go out with this one.
+  leg.skip = conn.discard_pending_;
+  conn.discard_pending_   = 0;
+  conn.discard_unwritten_ = 0;
+
+  for (int done = 0; !done; ) {
+    if (redisBufferWrite(conn.context_, &done) != REDIS_OK) {
+      return this->Drop(leg, conn.context_->errstr);
+    }
+  }
+
+  leg.sent_at = Clock::now();
+  return true;
+}
+
+
+bool const HedgedReads::Receive(Leg &leg, ReplyPtr &reply, bool const read) {
+  redisContext *context = leg.conn->context_;
+
+  if (read && redisBufferRead(context) != REDIS_OK) {
+    return this->Drop(leg, context->errstr);
+  }
+
+  for (;;) {
+    void *received = nullptr;
+
+    if (redisGetReplyFromReader(context, &received) != REDIS_OK) {
+      return this->Drop(leg, context->errstr);
+    }
+
+    if (received == nullptr) {
+      return true;
+    }
+
+    if (static_cast<redisReply*>(received)->type == REDIS_REPLY_PUSH) {
+      Connection::PushFrame(leg.conn, received);
+      continue;
+    }
+
+    ReplyPtr next(static_cast<redisReply*>(received));
+
+    if (leg.skip == 0) {
+      reply = std::move(next);
+      return true;
+    }
+
+    // A discarded reply, accounted for as ReadDiscarded() would.
+    --leg.skip;
+    ++leg.conn->discard_stats_.replied;
+
+    if (next->type == REDIS_REPLY_ERROR) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kReply,
+        next->str
+      );
+
+      ++leg.conn->discard_stats_.errors;
+      leg.conn->discard_stats_.last_error.assign(next->str, next->len);
+    }
+  }
+}
+
+
+bool const HedgedReads::Drop(Leg &leg, std::string const &what) {
+  logging::Log<logging::Severity::kWarning>(
+    logging::Topic::kConnection,
+    "Hedged read from ", ShardedConnection::ShardId(*leg.conn), ": ", what
+  );
+
+  leg.failed = true;
+
+  // Lost along with the connection.
+  leg.conn->discard_pending_ += leg.skip;
+  leg.skip = 0;
+
+  leg.conn->Disconnect();
+
+  return false;
+}
+
+
+bool const HedgedReads::Spend() noexcept {
+  for (int64_t credit = this->credit_; credit >= kHedge; ) {
+    if (this->credit_.compare_exchange_weak(credit, credit - kHedge)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void HedgedReads::Sample(Clock::duration const latency) {
+  std::unique_lock<std::mutex> window_lock(this->window_lock_, std::try_to_lock);
+
+  if (!window_lock.owns_lock()) {
+    return;
+  }
+
+  this->window_.Record(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()
+  );
+
+  if (this->window_.count() < std::max<size_t>(this->options_.window, 1)) {
+    return;
+  }
+
+  int64_t const min_delay_ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      this->options_.min_delay
+    ).count();
+
+  this->delay_ns_ = std::max<int64_t>(
+    min_delay_ns,
+    this->window_.Percentile(this->options_.percentile)
+  );
+
+  this->window_.Clear();
+}
+
+} // namespace rediswraps
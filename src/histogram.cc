@@ -0,0 +1,212 @@
+#include <rediswraps/histogram.hh>
+
+#include <algorithm>  // std::min(), std::max()
+#include <cmath>      // std::ceil()
+#include <limits>
+
+
+namespace rediswraps {
+namespace {
+
+constexpr unsigned kBits = constants::kHistogramSubBucketBits;
+
+static_assert(kBits >= 2 && kBits < 32, "kHistogramSubBucketBits out of range");
+
+// Values below this are counted exactly, one bucket each.
+constexpr uint64_t kExact = uint64_t(1) << kBits;
+
+// Buckets per power of 2 above that.
+constexpr uint64_t kHalf = kExact / 2;
+
+// Exact buckets, then one group per power of 2 from 2^kBits to 2^63.
+constexpr size_t kBuckets = kExact + (64 - kBits) * kHalf;
+
+
+unsigned const Log2(uint64_t const value) noexcept {
+  return 63 - __builtin_clzll(value);
+}
+
+} // namespace
+
+
+LatencyHistogram::LatencyHistogram()
+  : counts_(kBuckets, 0)
+{
+  this->Clear();
+}
+
+
+size_t const LatencyHistogram::Index(uint64_t const value) noexcept {
+  if (value < kExact) {
+    return value;
+  }
+
+  // Bucket groups double in width: the g-th one spans [2^(kBits+g-1),
+  //   2^(kBits+g)) with buckets 2^g wide.
+  unsigned const group = Log2(value) - kBits + 1;
+
+  return kExact + (group - 1) * kHalf + ((value >> group) - kHalf);
+}
+
+
+uint64_t const LatencyHistogram::Lowest(size_t const index) noexcept {
+  if (index < kExact) {
+    return index;
+  }
+
+  unsigned const group = (index - kExact) / kHalf + 1;
+  return (kHalf + (index - kExact) % kHalf) << group;
+}
+
+
+uint64_t const LatencyHistogram::Highest(size_t const index) noexcept {
+  if (index + 1 >= kBuckets) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+
+  return Lowest(index + 1) - 1;
+}
+
+
+void LatencyHistogram::Record(
+    uint64_t const value,
+    uint64_t const count
+) noexcept {
+  if (count == 0) {
+    return;
+  }
+
+  this->counts_[Index(value)] += count;
+
+  this->count_ += count;
+  this->min_    = std::min(this->min_, value);
+  this->max_    = std::max(this->max_, value);
+  this->sum_   += static_cast<double>(value) * count;
+}
+
+
+void LatencyHistogram::RecordCorrected(
+    uint64_t const value,
+    uint64_t const expected_interval
+) noexcept {
+  this->Record(value);
+
+  if (expected_interval == 0 || value <= expected_interval) {
+    return;
+  }
+
+  for (uint64_t missed = value - expected_interval;
+       missed >= expected_interval;
+       missed -= expected_interval) {
+    this->Record(missed);
+  }
+}
+
+
+void LatencyHistogram::Add(LatencyHistogram const &other) noexcept {
+  if (other.count_ == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < kBuckets; ++i) {
+    this->counts_[i] += other.counts_[i];
+  }
+
+  this->count_ += other.count_;
+  this->min_    = std::min(this->min_, other.min_);
+  this->max_    = std::max(this->max_, other.max_);
+  this->sum_   += other.sum_;
+}
+
+
+void LatencyHistogram::AddCorrected(
+    LatencyHistogram const &other,
+    uint64_t const expected_interval
+) noexcept {
+  if (expected_interval == 0) {
+    this->Add(other);
+    return;
+  }
+
+  // Bucket by bucket, standing in for each value with the top of its
+  //   bucket, as Percentile() does.
+  for (size_t i = 0; i < kBuckets; ++i) {
+    uint64_t const count = other.counts_[i];
+
+    if (count == 0) {
+      continue;
+    }
+
+    uint64_t const value = std::min(Highest(i), other.max_);
+    this->Record(value, count);
+
+    if (value <= expected_interval) {
+      continue;
+    }
+
+    for (uint64_t missed = value - expected_interval;
+         missed >= expected_interval;
+         missed -= expected_interval) {
+      this->Record(missed, count);
+    }
+  }
+}
+
+
+void LatencyHistogram::Clear() noexcept {
+  std::fill(this->counts_.begin(), this->counts_.end(), 0);
+
+  this->count_ = 0;
+  this->min_   = std::numeric_limits<uint64_t>::max();
+  this->max_   = 0;
+  this->sum_   = 0.0;
+}
+
+
+uint64_t const LatencyHistogram::Percentile(
+    double const percentile
+) const noexcept {
+  if (this->count_ == 0) {
+    return 0;
+  }
+
+  double const fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+
+  uint64_t const rank = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(fraction * this->count_))
+  );
+
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < kBuckets; ++i) {
+    seen += this->counts_[i];
+
+    if (seen >= rank) {
+      return std::min(Highest(i), this->max_);
+    }
+  }
+
+  return this->max_;
+}
+
+
+uint64_t const LatencyHistogram::count() const noexcept {
+  return this->count_;
+}
+
+
+uint64_t const LatencyHistogram::min() const noexcept {
+  return (this->count_ == 0) ? 0 : this->min_;
+}
+
+
+uint64_t const LatencyHistogram::max() const noexcept {
+  return this->max_;
+}
+
+
+double const LatencyHistogram::mean() const noexcept {
+  return (this->count_ == 0) ? 0.0 : this->sum_ / this->count_;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,352 @@
+#include <rediswraps/hotkeys.hh>
+
+#include <algorithm>   // std::push_heap(), std::sort()...
+#include <cctype>      // tolower()
+#include <cstdlib>     // strtoul() for script keycounts
+#include <functional>  // std::hash
+#include <limits>
+#include <strings.h>   // strcasecmp()
+
+#include <rediswraps/commands.hh>
+
+
+namespace rediswraps {
+namespace {
+
+int64_t const Now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+
+uint64_t const Mix(uint64_t x) noexcept {
+  // splitmix64 finalizer
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+
+size_t const RoundUpToPowerOf2(size_t const n) noexcept {
+  size_t power = 1;
+
+  while (power < n) {
+    power <<= 1;
+  }
+
+  return power;
+}
+
+
+// Commands whose keys follow a keycount argument (argv[2]).  Script aliases
+//   are sent as EVALSHA with the keycount they were loaded with.
+bool const TakesKeycount(std::string const &name) noexcept {
+  for (char const *command : {
+      "EVALSHA", "EVAL", "EVALSHA_RO", "EVAL_RO", "FCALL", "FCALL_RO"
+  }) {
+    if (strcasecmp(name.c_str(), command) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace
+
+
+HotKeys::HotKeys(HotKeyOptions const &options)
+  : options_(options),
+    learned_(false),
+    width_(RoundUpToPowerOf2(std::max<size_t>(options.width, 1))),
+    depth_(std::max<size_t>(options.depth, 1)),
+    counters_(new std::atomic<uint32_t>[width_ * depth_]),
+    since_(Now()),
+    carried_(0),
+    admission_(0),
+    seen_(0)
+{
+  for (size_t i = 0; i < this->width_ * this->depth_; ++i) {
+    this->counters_[i].store(0, std::memory_order_relaxed);
+  }
+
+  this->heap_.reserve(this->options_.top_k + 1);
+}
+
+
+bool const HotKeys::Learn(Connection &conn) {
+  if (this->learned_.load(std::memory_order_acquire)) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> learn_lock_guard(this->learn_lock_);
+
+  if (this->learned_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+
+  if (!DescribeAllCommands(conn, this->commands_)) {
+    return false;
+  }
+
+  this->learned_.store(true, std::memory_order_release);
+  return true;
+}
+
+
+void HotKeys::Sample(std::string const *argv, size_t const argc) {
+  if (argc == 0) {
+    return;
+  }
+
+  uint32_t const every = std::max<uint32_t>(this->options_.sample_every, 1);
+  uint32_t const seen  = this->seen_.fetch_add(1, std::memory_order_relaxed);
+
+  if (seen % every != every - 1) {
+    return;
+  }
+
+  if (TakesKeycount(argv[0])) {
+    if (argc < 3) {
+      return;
+    }
+
+    size_t const keycount = std::strtoul(argv[2].c_str(), nullptr, 10);
+
+    for (size_t i = 3; i < argc && i < 3 + keycount; ++i) {
+      this->Add(argv[i]);
+    }
+
+    return;
+  }
+
+  // No round trip here: this runs while the command is being sent.
+  if (!this->learned_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::string name(argv[0]);
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+  auto const command = this->commands_.find(name);
+
+  if (command == this->commands_.end() || command->second.first_key <= 0) {
+    return;
+  }
+
+  CommandInfo const &info = command->second;
+
+  int const last = (info.last_key < 0) ?
+    static_cast<int>(argc) + info.last_key :
+    info.last_key;
+  int const step = std::max(info.key_step, 1);
+
+  for (
+      int i = info.first_key;
+      i <= last && i < static_cast<int>(argc);
+      i += step
+  ) {
+    this->Add(argv[i]);
+  }
+}
+
+
+void HotKeys::Add(std::string const &key, uint32_t const weight) {
+  int64_t const now = Now();
+  this->Decay(now);
+
+  uint64_t const hash = Mix(std::hash<std::string>()(key));
+  uint64_t estimate   = std::numeric_limits<uint64_t>::max();
+
+  for (size_t row = 0; row < this->depth_; ++row) {
+    uint32_t const count = weight + this->counters_[this->Index(hash, row)]
+      .fetch_add(weight, std::memory_order_relaxed);
+
+    estimate = std::min<uint64_t>(estimate, count);
+  }
+
+  if (estimate > this->admission_.load(std::memory_order_relaxed)) {
+    this->Offer(key, estimate);
+  }
+}
+
+
+uint64_t const HotKeys::Estimate(std::string const &key) const noexcept {
+  uint64_t const hash = Mix(std::hash<std::string>()(key));
+  uint64_t estimate   = std::numeric_limits<uint64_t>::max();
+
+  for (size_t row = 0; row < this->depth_; ++row) {
+    estimate = std::min<uint64_t>(
+      estimate,
+      this->counters_[this->Index(hash, row)].load(std::memory_order_relaxed)
+    );
+  }
+
+  return estimate;
+}
+
+
+double const HotKeys::Rate(std::string const &key) const noexcept {
+  return this->PerSecond(this->Estimate(key), Now());
+}
+
+
+std::vector<HotKey> HotKeys::Top() const {
+  std::vector<HotKey> top;
+
+  {
+    std::lock_guard<std::mutex> heap_lock_guard(this->heap_lock_);
+
+    top.reserve(this->heap_.size());
+
+    for (auto const &entry : this->heap_) {
+      top.emplace_back();
+      top.back().key = entry.key;
+    }
+  }
+
+  int64_t const now = Now();
+
+  // Fresh estimates: the heap only learns a count when its key is used.
+  for (auto &hot : top) {
+    hot.count      = this->Estimate(hot.key);
+    hot.per_second = this->PerSecond(hot.count, now);
+  }
+
+  std::sort(top.begin(), top.end(), [](HotKey const &a, HotKey const &b) {
+    return a.count > b.count;
+  });
+
+  return top;
+}
+
+
+void HotKeys::Clear() {
+  std::lock_guard<std::mutex> heap_lock_guard(this->heap_lock_);
+
+  for (size_t i = 0; i < this->width_ * this->depth_; ++i) {
+    this->counters_[i].store(0, std::memory_order_relaxed);
+  }
+
+  this->heap_.clear();
+  this->admission_ = 0;
+  this->carried_   = 0;
+  this->since_     = Now();
+}
+
+
+size_t const HotKeys::memory() const noexcept {
+  return this->width_ * this->depth_ * sizeof(std::atomic<uint32_t>);
+}
+
+
+void HotKeys::Decay(int64_t const now) {
+  int64_t since = this->since_.load(std::memory_order_relaxed);
+  int64_t const interval = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    this->options_.decay_interval
+  ).count();
+
+  if (interval <= 0 || now - since < interval) {
+    return;
+  }
+
+  // Only the thread that moves since_ on does the halving.
+  if (!this->since_.compare_exchange_strong(since, now)) {
+    return;
+  }
+
+  this->carried_ = (this->carried_ + (now - since)) / 2;
+
+  // fetch_sub rather than store: increments racing with this one survive.
+  for (size_t i = 0; i < this->width_ * this->depth_; ++i) {
+    uint32_t const count = this->counters_[i].load(std::memory_order_relaxed);
+
+    if (count > 0) {
+      this->counters_[i].fetch_sub(
+        count - count / 2,
+        std::memory_order_relaxed
+      );
+    }
+  }
+
+  std::lock_guard<std::mutex> heap_lock_guard(this->heap_lock_);
+
+  for (auto &entry : this->heap_) {
+    entry.count /= 2;
+  }
+
+  this->admission_ = (this->heap_.size() < this->options_.top_k) ?
+    0 : this->heap_.front().count;
+}
+
+
+void HotKeys::Offer(std::string const &key, uint64_t const count) {
+  std::unique_lock<std::mutex> heap_lock(this->heap_lock_, std::try_to_lock);
+
+  if (!heap_lock.owns_lock() || this->options_.top_k == 0) {
+    return;
+  }
+
+  auto const colder = [](Entry const &a, Entry const &b) {
+    return a.count > b.count;
+  };
+
+  auto &heap = this->heap_;
+
+  auto const known = std::find_if(heap.begin(), heap.end(),
+    [&key](Entry const &entry) { return entry.key == key; }
+  );
+
+  if (known != heap.end()) {
+    known->count = count;
+    std::make_heap(heap.begin(), heap.end(), colder);
+  }
+  else if (heap.size() < this->options_.top_k) {
+    heap.push_back({key, count});
+    std::push_heap(heap.begin(), heap.end(), colder);
+  }
+  else if (count > heap.front().count) {
+    std::pop_heap(heap.begin(), heap.end(), colder);
+    heap.back() = {key, count};
+    std::push_heap(heap.begin(), heap.end(), colder);
+  }
+
+  this->admission_ = (heap.size() < this->options_.top_k) ?
+    0 : heap.front().count;
+}
+
+
+double const HotKeys::PerSecond(
+    uint64_t const count,
+    int64_t const now
+) const noexcept {
+  // With counts halved every interval, a steady rate r leaves r times
+  //   this much time in the counters.
+  int64_t const window =
+    this->carried_.load(std::memory_order_relaxed) +
+    (now - this->since_.load(std::memory_order_relaxed));
+
+  if (window <= 0) {
+    return 0.0;
+  }
+
+  uint32_t const every = std::max<uint32_t>(this->options_.sample_every, 1);
+
+  return static_cast<double>(count) * every * 1e9 / window;
+}
+
+
+size_t const HotKeys::Index(
+    uint64_t const hash,
+    size_t const row
+) const noexcept {
+  // Double hashing: row i probes h1 + i * h2.
+  uint64_t const h1 = hash;
+  uint64_t const h2 = Mix(hash) | 1;
+
+  return row * this->width_ + ((h1 + row * h2) & (this->width_ - 1));
+}
+
+} // namespace rediswraps
@@ -0,0 +1,672 @@
+#include <rediswraps/introspect.hh>
+
+#include <algorithm>  // std::find, std::min
+#include <cmath>      // std::isnan()
+#include <cstdlib>    // strtod(), strtoll()
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/sharded.hh>  // ShardedConnection::ShardId()
+
+
+namespace rediswraps {
+namespace introspect {
+namespace {
+
+double const kMissing = std::numeric_limits<double>::quiet_NaN();
+
+
+// True if all of "text" is a number.
+bool const ToNumber(std::string const &text, double &number) noexcept {
+  if (text.empty()) {
+    return false;
+  }
+
+  char *end = nullptr;
+  number = std::strtod(text.c_str(), &end);
+
+  return end == text.c_str() + text.size();
+}
+
+
+bool const IsAggregate(redisReply const *reply) noexcept {
+  return reply->type == REDIS_REPLY_ARRAY ||
+    reply->type == REDIS_REPLY_MAP ||
+    reply->type == REDIS_REPLY_SET ||
+    reply->type == REDIS_REPLY_PUSH;
+}
+
+
+std::string Text(redisReply const *reply) {
+  switch (reply->type) {
+  case REDIS_REPLY_STRING:
+  case REDIS_REPLY_STATUS:
+  case REDIS_REPLY_ERROR:
+  case REDIS_REPLY_VERB:
+  case REDIS_REPLY_BIGNUM:
+  case REDIS_REPLY_DOUBLE:
+    return std::string(reply->str, reply->len);
+  case REDIS_REPLY_INTEGER:
+    return std::to_string(reply->integer);
+  default:
+    return "";
+  }
+}
+
+
+int64_t const Integer(redisReply const *reply) noexcept {
+  if (reply->type == REDIS_REPLY_INTEGER) {
+    return reply->integer;
+  }
+
+  if (reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_STATUS) {
+    return std::strtoll(reply->str, nullptr, 10);
+  }
+
+  return 0;
+}
+
+
+bool const Number(redisReply const *reply, double &number) {
+  switch (reply->type) {
+  case REDIS_REPLY_INTEGER:
+    number = static_cast<double>(reply->integer);
+    return true;
+  case REDIS_REPLY_DOUBLE:
+    number = reply->dval;
+    return true;
+  case REDIS_REPLY_STRING:
+  case REDIS_REPLY_STATUS:
+  case REDIS_REPLY_BIGNUM:
+    return ToNumber(std::string(reply->str, reply->len), number);
+  default:
+    return false;
+  }
+}
+
+
+// Flattens name/value pairs, nested ones included, into "stats".
+void FlattenStats(
+    redisReply const *reply,
+    std::string const &prefix,
+    std::map<std::string, double> &stats
+) {
+  for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+    std::string name = Text(reply->element[i]);
+
+    if (!prefix.empty()) {
+      name = prefix + "." + name;
+    }
+
+    redisReply const *value = reply->element[i + 1];
+    double number;
+
+    if (IsAggregate(value)) {
+      FlattenStats(value, name, stats);
+    }
+    else if (Number(value, number)) {
+      stats[name] = number;
+    }
+  }
+}
+
+
+int64_t const NowMs() noexcept {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+}
+
+} // namespace
+
+
+std::string const* Info::Find(std::string const &field) const noexcept {
+  for (auto const &section : this->sections) {
+    for (auto const &entry : section.fields) {
+      if (entry.first == field) {
+        return &entry.second;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+
+double const Info::Number(
+    std::string const &field,
+    double const fallback
+) const noexcept {
+  std::string const *value = this->Find(field);
+  double number;
+
+  return (value != nullptr && ToNumber(*value, number)) ? number : fallback;
+}
+
+
+Info ParseInfo(std::string const &text) {
+  Info info;
+  std::istringstream lines(text);
+
+  for (std::string line; std::getline(lines, line); ) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    if (line.empty()) {
+      continue;
+    }
+
+    if (line[0] == '#') {
+      auto const name = line.find_first_not_of("# ");
+
+      info.sections.emplace_back();
+      info.sections.back().name =
+        (name == std::string::npos) ? "" : line.substr(name);
+      continue;
+    }
+
+    auto const colon = line.find(':');
+
+    if (colon == std::string::npos) {
+      continue;
+    }
+
+    // Fields ahead of any header go to an unnamed section.
+    if (info.sections.empty()) {
+      info.sections.emplace_back();
+    }
+
+    info.sections.back().fields.emplace_back(
+      line.substr(0, colon),
+      line.substr(colon + 1)
+    );
+  }
+
+  return info;
+}
+
+
+std::unordered_map<std::string, std::string> ParseInfoValue(
+    std::string const &value
+) {
+  std::unordered_map<std::string, std::string> pairs;
+  std::istringstream items(value);
+
+  for (std::string item; std::getline(items, item, ','); ) {
+    auto const equals = item.find('=');
+
+    if (equals != std::string::npos) {
+      pairs[item.substr(0, equals)] = item.substr(equals + 1);
+    }
+  }
+
+  return pairs;
+}
+
+
+std::vector<SlowlogEntry> ParseSlowlog(redisReply const &reply) {
+  std::vector<SlowlogEntry> entries;
+
+  if (!IsAggregate(&reply)) {
+    return entries;
+  }
+
+  entries.reserve(reply.elements);
+
+  for (size_t i = 0; i < reply.elements; ++i) {
+    redisReply const *item = reply.element[i];
+
+    if (!IsAggregate(item) || item->elements < 4) {
+      continue;
+    }
+
+    entries.emplace_back();
+    SlowlogEntry &entry = entries.back();
+
+    entry.id          = Integer(item->element[0]);
+    entry.timestamp   = Integer(item->element[1]);
+    entry.duration_us = Integer(item->element[2]);
+
+    redisReply const *args = item->element[3];
+
+    if (IsAggregate(args)) {
+      for (size_t j = 0; j < args->elements; ++j) {
+        entry.args.push_back(Text(args->element[j]));
+      }
+    }
+
+    if (item->elements > 5) {
+      entry.client_address = Text(item->element[4]);
+      entry.client_name    = Text(item->element[5]);
+    }
+  }
+
+  return entries;
+}
+
+
+std::vector<LatencyEvent> ParseLatencyLatest(redisReply const &reply) {
+  std::vector<LatencyEvent> events;
+
+  if (!IsAggregate(&reply)) {
+    return events;
+  }
+
+  for (size_t i = 0; i < reply.elements; ++i) {
+    redisReply const *item = reply.element[i];
+
+    if (!IsAggregate(item) || item->elements < 4) {
+      continue;
+    }
+
+    LatencyEvent event;
+
+    event.event     = Text(item->element[0]);
+    event.timestamp = Integer(item->element[1]);
+    event.latest_ms = Integer(item->element[2]);
+    event.max_ms    = Integer(item->element[3]);
+
+    events.push_back(std::move(event));
+  }
+
+  return events;
+}
+
+
+std::map<std::string, double> ParseMemoryStats(redisReply const &reply) {
+  std::map<std::string, double> stats;
+
+  if (IsAggregate(&reply)) {
+    FlattenStats(&reply, "", stats);
+  }
+
+  return stats;
+}
+
+
+std::vector<SlowlogEntry> SlowlogCursor::Next(
+    std::vector<SlowlogEntry> entries
+) {
+  bool restarted = !entries.empty() && entries.front().id < this->last_id_;
+
+  for (auto const &entry : entries) {
+    if (entry.id == this->last_id_) {
+      restarted = (entry.timestamp != this->last_timestamp_);
+      break;
+    }
+  }
+
+  if (restarted) {
+    this->last_id_ = -1;
+  }
+
+  // Newest first: the unseen ones are a prefix.
+  size_t fresh = 0;
+
+  while (fresh < entries.size() && entries[fresh].id > this->last_id_) {
+    ++fresh;
+  }
+
+  entries.resize(fresh);
+
+  if (!entries.empty()) {
+    this->last_id_        = entries.front().id;
+    this->last_timestamp_ = entries.front().timestamp;
+  }
+
+  return entries;
+}
+
+
+Collector::Collector(Ptr conn, CollectorOptions const &options)
+  : conn_(std::move(conn)),
+    options_(options),
+    times_(std::max<size_t>(options.capacity, 1), 0)
+{
+  if (!this->conn_) {
+    throw std::invalid_argument("Collector needs a Connection.");
+  }
+}
+
+
+Collector::~Collector() {
+  this->Stop();
+}
+
+
+void Collector::Start() {
+  std::lock_guard<std::mutex> control_lock_guard(this->control_lock_);
+
+  if (this->running_) {
+    return;
+  }
+
+  this->running_ = true;
+  this->thread_  = std::thread(&Collector::Run, this);
+}
+
+
+void Collector::Stop() {
+  std::thread thread;
+
+  {
+    std::lock_guard<std::mutex> control_lock_guard(this->control_lock_);
+
+    this->running_ = false;
+    thread.swap(this->thread_);
+  }
+
+  this->wake_.notify_all();
+
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+
+void Collector::Run() {
+  std::unique_lock<std::mutex> control_lock(this->control_lock_);
+
+  while (this->running_) {
+    control_lock.unlock();
+    this->Sample();
+    control_lock.lock();
+
+    this->wake_.wait_for(control_lock, this->options_.interval, [this]() {
+      return !this->running_;
+    });
+  }
+}
+
+
+bool const Collector::Sample() {
+  std::lock_guard<std::mutex> sample_lock_guard(this->sample_lock_);
+
+  int64_t const now = NowMs();
+
+  Info                          info;
+  std::vector<SlowlogEntry>     slowlog;
+  std::vector<LatencyEvent>     latency;
+  std::map<std::string, double> memory;
+
+  try {
+    ReplyPtr reply = this->options_.info_section.empty() ?
+      this->conn_->RawCmd("INFO") :
+      this->conn_->RawCmd("INFO", this->options_.info_section);
+
+    if (
+        !reply ||
+        (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_VERB)
+    ) {
+      throw std::runtime_error("INFO failed.");
+    }
+
+    info = ParseInfo(std::string(reply->str, reply->len));
+
+    if (this->options_.slowlog) {
+      reply = this->conn_->RawCmd(
+        "SLOWLOG", "GET", this->options_.slowlog_capacity
+      );
+
+      if (reply) {
+        slowlog = ParseSlowlog(*reply);
+      }
+    }
+
+    if (this->options_.latency) {
+      reply = this->conn_->RawCmd("LATENCY", "LATEST");
+
+      if (reply) {
+        latency = ParseLatencyLatest(*reply);
+      }
+    }
+
+    if (this->options_.memory) {
+      reply = this->conn_->RawCmd("MEMORY", "STATS");
+
+      if (reply) {
+        memory = ParseMemoryStats(*reply);
+      }
+    }
+  }
+  catch (std::exception const &e) {
+    ++this->errors_;
+
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      ShardedConnection::ShardId(*this->conn_), ": sampling failed: ", e.what()
+    );
+
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+  size_t const slot = this->next_;
+
+  this->times_[slot] = now;
+
+  for (auto &column : this->columns_) {
+    column.second[slot] = kMissing;
+  }
+
+  auto const &wanted = this->options_.info_fields;
+
+  for (auto const &section : info.sections) {
+    for (auto const &field : section.fields) {
+      if (
+          !wanted.empty() &&
+          std::find(wanted.begin(), wanted.end(), field.first) == wanted.end()
+      ) {
+        continue;
+      }
+
+      double number;
+
+      if (ToNumber(field.second, number)) {
+        this->Record(field.first, number);
+        continue;
+      }
+
+      // "db0:keys=1,expires=0,avg_ttl=0" and the like
+      for (auto const &pair : ParseInfoValue(field.second)) {
+        if (ToNumber(pair.second, number)) {
+          this->Record(field.first + "." + pair.first, number);
+        }
+      }
+    }
+  }
+
+  if (this->options_.slowlog) {
+    std::vector<SlowlogEntry> fresh =
+      this->slowlog_cursor_.Next(std::move(slowlog));
+
+    // Oldest first, so the newest ends up in front.
+    for (auto entry = fresh.rbegin(); entry != fresh.rend(); ++entry) {
+      this->slowlog_.push_front(std::move(*entry));
+    }
+
+    while (this->slowlog_.size() > this->options_.slowlog_capacity) {
+      this->slowlog_.pop_back();
+    }
+
+    this->Record("slowlog.new", static_cast<double>(fresh.size()));
+  }
+
+  for (auto const &event : latency) {
+    this->Record("latency." + event.event + ".latest_ms",
+      static_cast<double>(event.latest_ms));
+    this->Record("latency." + event.event + ".max_ms",
+      static_cast<double>(event.max_ms));
+  }
+
+  if (this->options_.latency) {
+    this->latency_ = std::move(latency);
+  }
+
+  for (auto const &stat : memory) {
+    this->Record("memory." + stat.first, stat.second);
+  }
+
+  this->info_  = std::move(info);
+  this->next_  = (slot + 1) % this->times_.size();
+  this->count_ = std::min(this->count_ + 1, this->times_.size());
+
+  return true;
+}
+
+
+// Called with lock_ held.
+void Collector::Record(std::string const &metric, double const value) {
+  auto column = this->columns_.find(metric);
+
+  if (column == this->columns_.end()) {
+    column = this->columns_.emplace(
+      metric,
+      std::vector<double>(this->times_.size(), kMissing)
+    ).first;
+  }
+
+  column->second[this->next_] = value;
+}
+
+
+std::vector<std::string> Collector::Metrics() const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+  std::vector<std::string> metrics;
+  metrics.reserve(this->columns_.size());
+
+  for (auto const &column : this->columns_) {
+    metrics.push_back(column.first);
+  }
+
+  return metrics;
+}
+
+
+std::vector<std::pair<int64_t, double>> Collector::Series(
+    std::string const &metric
+) const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+  std::vector<std::pair<int64_t, double>> series;
+  auto const column = this->columns_.find(metric);
+
+  if (column == this->columns_.end()) {
+    return series;
+  }
+
+  size_t const capacity = this->times_.size();
+  size_t const oldest   = (this->next_ + capacity - this->count_) % capacity;
+
+  series.reserve(this->count_);
+
+  for (size_t i = 0; i < this->count_; ++i) {
+    size_t const slot = (oldest + i) % capacity;
+
+    if (!std::isnan(column->second[slot])) {
+      series.emplace_back(this->times_[slot], column->second[slot]);
+    }
+  }
+
+  return series;
+}
+
+
+double const Collector::Latest(
+    std::string const &metric,
+    double const fallback
+) const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+  auto const column = this->columns_.find(metric);
+
+  if (column == this->columns_.end()) {
+    return fallback;
+  }
+
+  size_t const capacity = this->times_.size();
+
+  for (size_t i = 1; i <= this->count_; ++i) {
+    double const value = column->second[(this->next_ + capacity - i) % capacity];
+
+    if (!std::isnan(value)) {
+      return value;
+    }
+  }
+
+  return fallback;
+}
+
+
+Info Collector::LastInfo() const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+  return this->info_;
+}
+
+
+std::vector<SlowlogEntry> Collector::Slowlog() const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+  return std::vector<SlowlogEntry>(this->slowlog_.begin(), this->slowlog_.end());
+}
+
+
+std::vector<LatencyEvent> Collector::Latency() const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+  return this->latency_;
+}
+
+
+void Collector::ExportCsv(std::ostream &os) const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+  // Counters such as total_net_input_bytes need more than 6 digits.
+  auto const precision = os.precision(15);
+
+  os << "time_ms";
+
+  for (auto const &column : this->columns_) {
+    os << ',' << column.first;
+  }
+
+  os << '\n';
+
+  size_t const capacity = this->times_.size();
+  size_t const oldest   = (this->next_ + capacity - this->count_) % capacity;
+
+  for (size_t i = 0; i < this->count_; ++i) {
+    size_t const slot = (oldest + i) % capacity;
+
+    os << this->times_[slot];
+
+    for (auto const &column : this->columns_) {
+      os << ',';
+
+      if (!std::isnan(column.second[slot])) {
+        os << column.second[slot];
+      }
+    }
+
+    os << '\n';
+  }
+
+  os.precision(precision);
+}
+
+
+size_t const Collector::samples() const {
+  std::lock_guard<std::mutex> lock_guard(this->lock_);
+  return this->count_;
+}
+
+
+uint64_t const Collector::errors() const noexcept {
+  return this->errors_;
+}
+
+} // namespace introspect
+} // namespace rediswraps
@@ -0,0 +1,300 @@
+#include <rediswraps/log.hh>
+
+#include <algorithm>  // std::min
+#include <chrono>
+#include <cstdio>     // fwrite() to stderr
+#include <cstring>    // memcpy()
+#include <mutex>
+#include <vector>
+
+
+namespace rediswraps {
+namespace logging {
+namespace {
+
+// Rate limit state of one message prefix: messages admitted in the current
+//   one second window, and messages suppressed since the last one admitted.
+struct Limit {
+  std::atomic<int64_t>  window{-1};
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> suppressed{0};
+};
+
+// The limits of one topic, one per prefix hash slot.
+struct TopicLimits {
+  std::atomic<uint32_t> per_second{constants::kLogRateLimitPerSecond};
+  Limit                 prefixes[constants::kLogRateLimitSlots];
+};
+
+TopicLimits limits[static_cast<size_t>(Topic::kCount)];
+
+std::atomic<uint8_t> level{static_cast<uint8_t>(Severity::kInfo)};
+
+
+// Every sink ever set stays here until exit; see SetSink().
+struct Sinks {
+  std::mutex                         lock;
+  std::vector<std::shared_ptr<Sink>> all;
+  std::atomic<Sink*>                 current{nullptr};
+
+  Sinks() {
+    this->all.push_back(std::make_shared<StderrSink>());
+    this->current = this->all.back().get();
+  }
+};
+
+
+Sinks& GetSinks() {
+  static Sinks sinks;
+  return sinks;
+}
+
+
+int64_t const Now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+}
+
+} // namespace
+
+
+char const* SeverityName(Severity const severity) noexcept {
+  switch (severity) {
+  case Severity::kDebug:   return "DEBUG";
+  case Severity::kInfo:    return "INFO";
+  case Severity::kWarning: return "WARNING";
+  case Severity::kError:   return "ERROR";
+  default:                 return "OFF";
+  }
+}
+
+
+char const* TopicName(Topic const topic) noexcept {
+  switch (topic) {
+  case Topic::kReply:      return "reply";
+  case Topic::kConnection: return "connection";
+  case Topic::kScript:     return "script";
+  case Topic::kUsage:      return "usage";
+  case Topic::kPush:       return "push";
+  default:                 return "unknown";
+  }
+}
+
+
+void SetSink(std::shared_ptr<Sink> sink) {
+  Sinks &sinks = GetSinks();
+  std::lock_guard<std::mutex> sinks_lock_guard(sinks.lock);
+
+  sinks.current = sink.get();
+
+  if (sink) {
+    sinks.all.push_back(std::move(sink));
+  }
+}
+
+
+void SetLevel(Severity const new_level) noexcept {
+  level = static_cast<uint8_t>(new_level);
+}
+
+
+void SetRateLimit(Topic const topic, uint32_t const per_second) noexcept {
+  limits[static_cast<size_t>(topic)].per_second = per_second;
+}
+
+
+bool const Admit(
+    Severity const severity,
+    Topic const topic,
+    uint64_t const prefix,
+    uint32_t &suppressed
+) noexcept {
+  if (static_cast<uint8_t>(severity) < level.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  TopicLimits &topic_limits = limits[static_cast<size_t>(topic)];
+  Limit &limit = topic_limits.prefixes[prefix % constants::kLogRateLimitSlots];
+
+  uint32_t const per_second =
+    topic_limits.per_second.load(std::memory_order_relaxed);
+
+  // 0 means unlimited.
+  if (per_second > 0) {
+    int64_t const now = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+
+    int64_t window = limit.window.load(std::memory_order_relaxed);
+
+    // Whoever moves the window on resets the count; losing a few increments
+    //   to the race only lets a message or two more through.
+    if (window != now && limit.window.compare_exchange_strong(window, now)) {
+      limit.count = 0;
+    }
+
+    if (++limit.count > per_second) {
+      ++limit.suppressed;
+      return false;
+    }
+  }
+
+  suppressed = limit.suppressed.exchange(0);
+  return true;
+}
+
+
+void Write(
+    Severity const severity,
+    Topic const topic,
+    uint32_t const suppressed,
+    std::string &&message
+) {
+  Sink *sink = GetSinks().current.load(std::memory_order_acquire);
+
+  if (sink == nullptr) {
+    return;
+  }
+
+  Record record;
+  record.severity   = severity;
+  record.topic      = topic;
+  record.time       = Now();
+  record.suppressed = suppressed;
+  record.message    = std::move(message);
+
+  sink->Write(record);
+}
+
+
+void StderrSink::Write(Record const &record) {
+  std::string line("rediswraps ");
+
+  line += SeverityName(record.severity);
+  line += " [";
+  line += TopicName(record.topic);
+  line += "] ";
+  line += record.message;
+
+  if (record.suppressed > 0) {
+    line += " (";
+    line += std::to_string(record.suppressed);
+    line += " similar message(s) suppressed)";
+  }
+
+  line += '\n';
+
+  // One call per line: lines from different threads don't interleave.
+  std::fwrite(line.data(), 1, line.size(), stderr);
+}
+
+
+void StderrSink::Flush() {
+  std::fflush(stderr);
+}
+
+
+AsyncSink::AsyncSink(std::shared_ptr<Sink> target, size_t const capacity)
+  : target_(std::move(target)),
+    queue_(capacity),
+    queued_(0),
+    written_(0),
+    dropped_(0),
+    running_(true),
+    thread_(&AsyncSink::Run, this)
+{}
+
+
+AsyncSink::~AsyncSink() {
+  this->running_ = false;
+
+  if (this->thread_.joinable()) {
+    this->thread_.join();
+  }
+}
+
+
+void AsyncSink::Write(Record const &record) {
+  Slot slot;
+  slot.severity   = record.severity;
+  slot.topic      = record.topic;
+  slot.suppressed = record.suppressed;
+  slot.time       = record.time;
+  slot.length     = static_cast<uint16_t>(
+    std::min(record.message.size(), sizeof(slot.text))
+  );
+
+  std::memcpy(slot.text, record.message.data(), slot.length);
+
+  if (this->queue_.push(slot)) {
+    ++this->queued_;
+  }
+  else {
+    ++this->dropped_;
+  }
+}
+
+
+void AsyncSink::Flush() {
+  uint64_t const queued = this->queued_;
+
+  while (this->written_ < queued && this->running_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  if (this->target_) {
+    this->target_->Flush();
+  }
+}
+
+
+uint64_t const AsyncSink::dropped() const noexcept {
+  return this->dropped_;
+}
+
+
+size_t const AsyncSink::Drain() {
+  size_t drained = 0;
+
+  Slot   slot;
+  Record record;
+
+  while (this->queue_.pop(slot)) {
+    record.severity   = slot.severity;
+    record.topic      = slot.topic;
+    record.suppressed = slot.suppressed;
+    record.time       = slot.time;
+    record.message.assign(slot.text, slot.length);
+
+    if (this->target_) {
+      this->target_->Write(record);
+    }
+
+    ++this->written_;
+    ++drained;
+  }
+
+  return drained;
+}
+
+
+void AsyncSink::Run() {
+  while (this->running_) {
+    if (this->Drain() == 0) {
+      std::this_thread::sleep_for(
+        std::chrono::milliseconds(constants::kLogDrainIntervalMs)
+      );
+    }
+  }
+
+  // Whatever was queued before destruction still goes out.
+  this->Drain();
+
+  if (this->target_) {
+    this->target_->Flush();
+  }
+}
+
+} // namespace logging
+} // namespace rediswraps
@@ -0,0 +1,541 @@
+#include <rediswraps/migrate.hh>
+
+#include <algorithm>  // std::max()
+#include <condition_variable>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/pipeline.hh>
+#include <rediswraps/utils.hh>
+
+
+namespace rediswraps {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Keys  = std::vector<std::string>;
+
+
+// SELECT goes along with every batch: a connection that had to reconnect is
+//   back in db 0.  Returns the number of replies it adds.
+size_t const Select(Pipeline &pipe, int const db) {
+  if (db == 0) {
+    return 0;
+  }
+
+  pipe.Add("SELECT", db);
+  return 1;
+}
+
+
+// Describes what went wrong, if anything, in "error".
+bool const Failed(
+    redisReply const *reply,
+    char const *command,
+    std::string &error
+) {
+  if (reply == nullptr) {
+    error = std::string("no reply to ") + command;
+    return true;
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {
+    error = std::string(command) + ": " + std::string(reply->str, reply->len);
+    return true;
+  }
+
+  return false;
+}
+
+
+// The same, logging it.
+bool const Failed(redisReply const *reply, char const *command) {
+  std::string error;
+
+  if (!Failed(reply, command, error)) {
+    return false;
+  }
+
+  logging::Log<logging::Severity::kError>(
+    (reply == nullptr) ? logging::Topic::kConnection : logging::Topic::kReply,
+    "Migration: ", error
+  );
+
+  return true;
+}
+
+
+// One SCAN step on "db": moves "cursor" along and fills "keys".  False on
+//   failure.
+bool const Scan(
+    Connection &conn,
+    int const db,
+    std::string const &match,
+    size_t const count,
+    std::string &cursor,
+    Keys &keys
+) {
+  Keys argv = {"SCAN", cursor, "COUNT", utils::ToString(count)};
+
+  if (!match.empty()) {
+    argv.push_back("MATCH");
+    argv.push_back(match);
+  }
+
+  Pipeline pipe(conn);
+  size_t const skip = Select(pipe, db);
+  pipe.AddArgv(argv);
+
+  std::vector<ReplyPtr> const replies = pipe.ExecuteRaw();
+
+  for (size_t i = 0; i < skip; ++i) {
+    if (Failed(replies[i].get(), "SELECT")) {
+      return false;
+    }
+  }
+
+  redisReply const *reply = replies[skip].get();
+
+  if (Failed(reply, "SCAN")) {
+    return false;
+  }
+
+  if (
+      reply->type != REDIS_REPLY_ARRAY ||
+      reply->elements != 2 ||
+      reply->element[1]->type != REDIS_REPLY_ARRAY
+  ) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      "Migration: unexpected reply to SCAN"
+    );
+
+    return false;
+  }
+
+  cursor.assign(reply->element[0]->str, reply->element[0]->len);
+
+  keys.clear();
+  keys.reserve(reply->element[1]->elements);
+
+  for (size_t i = 0; i < reply->element[1]->elements; ++i) {
+    redisReply const *key = reply->element[1]->element[i];
+    keys.emplace_back(key->str, key->len);
+  }
+
+  return true;
+}
+
+} // namespace
+
+
+Migration::Migration(
+    Connection const &source,
+    Connection const &destination,
+    MigrationOptions const &options
+)
+  : source_(Migration::AddressOf(source)),
+    destination_(Migration::AddressOf(destination)),
+    options_(options),
+    stopped_(false),
+    scanned_(0),
+    migrated_(0),
+    vanished_(0),
+    failed_(0),
+    bytes_(0),
+    source_keys_(0),
+    destination_keys_(0),
+    elapsed_ms_(0)
+{}
+
+
+Migration::Address const Migration::AddressOf(Connection const &conn) {
+  Address address;
+
+  address.socket = conn.socket();
+  address.host   = conn.host();
+  address.port   = conn.port();
+  address.name   = conn.name();
+
+  return address;
+}
+
+
+Ptr Migration::Open(Address const &address) {
+  if (!address.socket.empty()) {
+    return Ptr(new Connection(address.socket, address.name));
+  }
+
+  return Ptr(new Connection(address.host, address.port, address.name));
+}
+
+
+bool const Migration::Run() {
+  Clock::time_point const start = Clock::now();
+
+  this->stopped_   = false;
+  this->next_slot_ = start;
+
+  this->scanned_          = 0;
+  this->migrated_         = 0;
+  this->vanished_         = 0;
+  this->failed_           = 0;
+  this->bytes_            = 0;
+  this->source_keys_      = 0;
+  this->destination_keys_ = 0;
+
+  size_t const threads = std::max<size_t>(this->options_.threads, 1);
+
+  // Every connection is opened up front, so a bad address fails right away
+  //   rather than leaving the scan with no one to take its batches.
+  Ptr scanner;
+  std::vector<Ptr> sources;
+  std::vector<Ptr> destinations;
+
+  try {
+    scanner = Migration::Open(this->source_);
+
+    for (size_t i = 0; i < threads; ++i) {
+      sources.push_back(Migration::Open(this->source_));
+      destinations.push_back(Migration::Open(this->destination_));
+    }
+  }
+  catch (std::exception const &e) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      "Migration: ", e.what()
+    );
+
+    return false;
+  }
+
+  std::mutex              lock;
+  std::condition_variable changed;
+  std::deque<Keys>        batches;
+  bool                    finished = false;
+
+  size_t const capacity = threads * constants::kMigrateQueuedBatches;
+
+  std::vector<std::thread> workers;
+
+  for (size_t worker = 0; worker < threads; ++worker) {
+    workers.emplace_back([&, worker]() {
+      for (;;) {
+        Keys keys;
+
+        {
+          std::unique_lock<std::mutex> guard(lock);
+          changed.wait(guard, [&]() { return finished || !batches.empty(); });
+
+          if (batches.empty()) {
+            return;
+          }
+
+          keys = std::move(batches.front());
+          batches.pop_front();
+        }
+
+        changed.notify_all();
+
+        if (this->stopped_) {
+          continue;
+        }
+
+        this->Pace(keys.size());
+
+        try {
+          this->Migrate(*sources[worker], *destinations[worker], keys);
+        }
+        catch (std::exception const &e) {
+          // Reconnecting failed: the batch is lost, the next one retries.
+          logging::Log<logging::Severity::kError>(
+            logging::Topic::kConnection,
+            "Migration: ", e.what()
+          );
+
+          this->failed_ += keys.size();
+        }
+      }
+    });
+  }
+
+  bool scanned = true;
+  std::string cursor = "0";
+
+  do {
+    Keys keys;
+
+    try {
+      scanned = Scan(
+        *scanner,
+        this->options_.source_db,
+        this->options_.match,
+        std::max<size_t>(this->options_.batch, 1),
+        cursor,
+        keys
+      );
+    }
+    catch (std::exception const &e) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kConnection,
+        "Migration: ", e.what()
+      );
+
+      scanned = false;
+    }
+
+    if (!scanned || keys.empty()) {
+      continue;
+    }
+
+    this->scanned_ += keys.size();
+
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [&]() {
+      return batches.size() < capacity || this->stopped_;
+    });
+
+    batches.push_back(std::move(keys));
+    changed.notify_all();
+  } while (scanned && cursor != "0" && !this->stopped_);
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    finished = true;
+  }
+
+  changed.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  bool ok = scanned && !this->stopped_ && this->failed_ == 0;
+
+  if (ok && this->options_.verify) {
+    uint64_t source_keys = 0;
+    uint64_t destination_keys = 0;
+
+    ok = this->Count(*scanner, this->options_.source_db, source_keys) &&
+      this->Count(
+        *destinations[0],
+        this->options_.destination_db,
+        destination_keys
+      );
+
+    this->source_keys_      = source_keys;
+    this->destination_keys_ = destination_keys;
+
+    if (ok && source_keys != destination_keys) {
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kUsage,
+        "Migration: the source holds ", source_keys,
+        " keys but the destination ", destination_keys
+      );
+
+      ok = false;
+    }
+  }
+
+  this->elapsed_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+    Clock::now() - start
+  ).count();
+
+  return ok;
+}
+
+
+void Migration::Stop() noexcept {
+  this->stopped_ = true;
+}
+
+
+MigrationStats const Migration::stats() const noexcept {
+  MigrationStats stats;
+
+  stats.scanned          = this->scanned_;
+  stats.migrated         = this->migrated_;
+  stats.vanished         = this->vanished_;
+  stats.failed           = this->failed_;
+  stats.bytes            = this->bytes_;
+  stats.source_keys      = this->source_keys_;
+  stats.destination_keys = this->destination_keys_;
+  stats.elapsed          = std::chrono::milliseconds(this->elapsed_ms_);
+
+  return stats;
+}
+
+
+void Migration::Migrate(
+    Connection &source,
+    Connection &destination,
+    Keys const &keys
+) {
+  // Failures are logged once per batch: one error tends to hit every key.
+  size_t failed = 0;
+  std::string error;
+
+  Pipeline reads(source);
+  size_t const read_skip = Select(reads, this->options_.source_db);
+
+  for (auto const &key : keys) {
+    reads.Add("DUMP", key).Add("PTTL", key);
+  }
+
+  std::vector<ReplyPtr> const dumps = reads.ExecuteRaw();
+
+  Pipeline writes(destination);
+  size_t const write_skip = Select(writes, this->options_.destination_db);
+
+  // Keys sent for RESTORE, and the size of each payload.
+  std::vector<size_t> restoring;
+  std::vector<size_t> sizes;
+
+  if (read_skip > 0 && Failed(dumps[0].get(), "SELECT", error)) {
+    failed = keys.size();
+  }
+
+  for (size_t i = 0; i < keys.size() && failed < keys.size(); ++i) {
+    redisReply const *dump = dumps[read_skip + 2 * i].get();
+    redisReply const *ttl  = dumps[read_skip + 2 * i + 1].get();
+
+    if (Failed(dump, "DUMP", error) || Failed(ttl, "PTTL", error)) {
+      ++failed;
+      continue;
+    }
+
+    // Gone since the SCAN, or expired between DUMP and PTTL.
+    if (dump->type == REDIS_REPLY_NIL || ttl->integer == -2) {
+      ++this->vanished_;
+      continue;
+    }
+
+    Keys argv = {
+      "RESTORE",
+      keys[i],
+      utils::ToString(std::max<long long>(ttl->integer, 0)),
+      std::string(dump->str, dump->len)
+    };
+
+    if (this->options_.replace) {
+      argv.push_back("REPLACE");
+    }
+
+    writes.AddArgv(argv);
+
+    restoring.push_back(i);
+    sizes.push_back(dump->len);
+  }
+
+  if (!restoring.empty()) {
+    std::vector<ReplyPtr> const restored = writes.ExecuteRaw();
+
+    if (write_skip > 0 && Failed(restored[0].get(), "SELECT", error)) {
+      failed += restoring.size();
+      restoring.clear();
+    }
+
+    for (size_t i = 0; i < restoring.size(); ++i) {
+      if (Failed(restored[write_skip + i].get(), "RESTORE", error)) {
+        ++failed;
+        continue;
+      }
+
+      ++this->migrated_;
+      this->bytes_ += sizes[i];
+    }
+  }
+
+  if (failed > 0) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      "Migration: ", failed, " of ", keys.size(), " keys failed, e.g. ", error
+    );
+
+    this->failed_ += failed;
+  }
+}
+
+
+bool const Migration::Count(Connection &conn, int const db, uint64_t &count) {
+  try {
+    if (this->options_.match.empty()) {
+      Pipeline pipe(conn);
+      size_t const skip = Select(pipe, db);
+      pipe.Add("DBSIZE");
+
+      std::vector<ReplyPtr> const replies = pipe.ExecuteRaw();
+
+      if (
+          (skip > 0 && Failed(replies[0].get(), "SELECT")) ||
+          Failed(replies[skip].get(), "DBSIZE")
+      ) {
+        return false;
+      }
+
+      count = replies[skip]->integer;
+      return true;
+    }
+
+    // SCAN may return a key more than once.
+    std::unordered_set<std::string> matching;
+    std::string cursor = "0";
+    Keys keys;
+
+    do {
+      if (
+          !Scan(
+            conn,
+            db,
+            this->options_.match,
+            std::max<size_t>(this->options_.batch, 1),
+            cursor,
+            keys
+          )
+      ) {
+        return false;
+      }
+
+      matching.insert(keys.begin(), keys.end());
+    } while (cursor != "0");
+
+    count = matching.size();
+    return true;
+  }
+  catch (std::exception const &e) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      "Migration: ", e.what()
+    );
+
+    return false;
+  }
+}
+
+
+void Migration::Pace(size_t const keys) {
+  if (this->options_.keys_per_second <= 0.0) {
+    return;
+  }
+
+  Clock::duration const per_key = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1.0 / this->options_.keys_per_second)
+  );
+
+  Clock::time_point slot;
+
+  {
+    std::lock_guard<std::mutex> guard(this->pace_lock_);
+
+    // Time spent behind schedule isn't made up for with a burst.
+    slot = std::max(this->next_slot_, Clock::now());
+    this->next_slot_ = slot + per_key * static_cast<int64_t>(keys);
+  }
+
+  std::this_thread::sleep_until(slot);
+}
+
+} // namespace rediswraps
@@ -0,0 +1,145 @@
+#include <rediswraps/pipeline.hh>
+
+
+namespace rediswraps {
+
+Pipeline& Pipeline::AddArgv(std::vector<std::string> const &argv) {
+  Connection::EncodeArgv(this->buffer_, argv.data(), argv.size());
+
+  ++this->count_;
+  return *this;
+}
+
+
+std::vector<ReplyPtr> Pipeline::ExecuteRaw() {
+  this->Write();
+  return this->ReadRaw();
+}
+
+
+bool const Pipeline::Write() {
+  this->unread_  = this->count_;
+  this->written_ = false;
+
+  if (this->count_ == 0) {
+    return true;
+  }
+
+  if (!this->conn_.IsConnected()) {
+    this->conn_.Reconnect();
+  }
+
+  if (trace::Tracer::kEnabled) {
+    this->Trace();
+  }
+  else if (this->conn_.Observed()) {
+    for (size_t from = 0; from < this->buffer_.size(); ) {
+      from = this->conn_.ObserveEncoded(this->buffer_, from);
+    }
+  }
+
+  redisContext *context = this->conn_.context_;
+
+  // hiredis accepts any number of commands in one formatted buffer.
+  this->written_ = (
+    redisAppendFormattedCommand(
+      context,
+      this->buffer_.data(),
+      this->buffer_.size()
+    ) == REDIS_OK
+  );
+
+  // Discarded commands appended before ours went out in the same write;
+  //   their replies are read ahead of ours in ReadRaw().
+  this->discarded_ahead_ = this->conn_.discard_pending_;
+  this->conn_.discard_pending_   = 0;
+  this->conn_.discard_unwritten_ = 0;
+
+  for (int done = 0; this->written_ && !done; ) {
+    this->written_ = (redisBufferWrite(context, &done) == REDIS_OK);
+  }
+
+  this->Clear();
+  return this->written_;
+}
+
+
+void Pipeline::Trace() {
+  this->events_.clear();
+  this->event_commands_.clear();
+
+  std::vector<std::string> argv;
+
+  for (size_t from = 0; from < this->buffer_.size(); ) {
+    from = Connection::DecodeArgv(this->buffer_, from, argv);
+    this->conn_.Observe(argv.data(), argv.size());
+
+    this->events_.emplace_back();
+    trace::Begin(this->events_.back(), this->conn_, argv.data(), argv.size());
+
+    // The event outlives "argv", so it keeps a copy of the command name.
+    this->event_commands_.emplace_back(argv.empty() ? "" : argv[0]);
+    this->events_.back().command = this->event_commands_.back().data();
+
+    trace::Tracer::BeforeSend(this->events_.back());
+  }
+}
+
+
+std::vector<ReplyPtr> Pipeline::ReadRaw() {
+  std::vector<ReplyPtr> replies;
+  replies.reserve(this->unread_);
+
+  bool intact = this->written_;
+
+  if (this->discarded_ahead_ > 0) {
+    if (intact) {
+      this->conn_.discard_pending_ = this->discarded_ahead_;
+      this->conn_.ReadDiscarded();
+    }
+    else {
+      this->conn_.discard_stats_.lost += this->discarded_ahead_;
+    }
+
+    this->discarded_ahead_ = 0;
+  }
+
+  for (size_t i = 0; i < this->unread_; ++i) {
+    void *reply = nullptr;
+
+    if (intact && redisGetReply(this->conn_.context_, &reply) != REDIS_OK) {
+      intact = false;
+    }
+
+    replies.emplace_back(intact ? reinterpret_cast<redisReply*>(reply) : nullptr);
+
+    // No events if Write() threw before getting to them.
+    if (trace::Tracer::kEnabled && i < this->events_.size()) {
+      trace::Event &event = this->events_[i];
+      event.command = this->event_commands_[i].data();
+
+      trace::Finish(event, replies.back().get());
+
+      if (event.success) {
+        trace::Tracer::AfterReply(event);
+      }
+      else {
+        trace::Tracer::OnError(event);
+      }
+    }
+  }
+
+  this->events_.clear();
+  this->event_commands_.clear();
+
+  if (!intact && this->unread_ > 0) {
+    this->conn_.Reconnect();
+  }
+
+  this->unread_  = 0;
+  this->written_ = false;
+
+  return replies;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,33 @@
+#include <rediswraps/prepared.hh>
+
+
+namespace rediswraps {
+
+size_t const PreparedCmd::arity() const noexcept {
+  return this->segments_.size() - 1;
+}
+
+
+std::string const& PreparedCmd::command() const noexcept {
+  return this->command_;
+}
+
+
+void PreparedCmd::Bind() noexcept {}
+
+
+void PreparedCmd::EncodeArgs(
+    std::string &buffer,
+    size_t const index
+) const noexcept {}
+
+
+void PreparedCmd::AppendArg(std::string &buffer, std::string const &arg) {
+  buffer += '$';
+  buffer += std::to_string(arg.size());
+  buffer += "\r\n";
+  buffer += arg;
+  buffer += "\r\n";
+}
+
+} // namespace rediswraps
@@ -0,0 +1,606 @@
+#include <rediswraps/primitives.hh>
+
+#include <cstring>  // strncmp()
+#include <mutex>
+
+#include <rediswraps/constants.hh>
+#include <rediswraps/log.hh>
+
+
+namespace rediswraps {
+namespace primitives {
+namespace {
+
+struct Script {
+  char const  *alias;
+  size_t       keycount;
+  std::string  source;
+};
+
+
+// The server's clock, in "now" (milliseconds).  Before Redis 5, scripts
+//   that write after reading it must be replicated as their effects.
+std::string const kClock = R"lua(
+redis.replicate_commands()
+local time = redis.call('TIME')
+local now = tonumber(time[1]) * 1000 + math.floor(tonumber(time[2]) / 1000)
+)lua";
+
+// KEYS: bucket.  ARGV: per second, capacity, tokens.
+Script const kTokenBucket = {
+  "rediswraps:token_bucket", 1,
+  kClock + R"lua(
+local per_second = tonumber(ARGV[1])
+local capacity   = tonumber(ARGV[2])
+local requested  = tonumber(ARGV[3])
+
+local state  = redis.call('HMGET', KEYS[1], 'tokens', 'at')
+local tokens = tonumber(state[1]) or capacity
+local at     = tonumber(state[2]) or now
+
+tokens = math.min(capacity, tokens + math.max(0, now - at) * per_second / 1000)
+
+local allowed, retry_after = 0, 0
+
+if requested > capacity then
+  retry_after = -1
+elseif tokens >= requested then
+  tokens, allowed = tokens - requested, 1
+else
+  retry_after = math.ceil((requested - tokens) * 1000 / per_second)
+end
+
+-- Once full again, the bucket is as good as missing.
+redis.call('HSET', KEYS[1], 'tokens', tokens, 'at', now)
+redis.call('PEXPIRE', KEYS[1], math.ceil((capacity - tokens) * 1000 / per_second) + 1)
+
+return {allowed, math.floor(tokens), retry_after}
+)lua"
+};
+
+// KEYS: window.  ARGV: window in milliseconds, limit, requests.
+Script const kSlidingWindow = {
+  "rediswraps:sliding_window", 1,
+  kClock + R"lua(
+local window    = tonumber(ARGV[1]) * 1000
+local limit     = tonumber(ARGV[2])
+local requested = tonumber(ARGV[3])
+local micros    = tonumber(time[1]) * 1000000 + tonumber(time[2])
+
+redis.call('ZREMRANGEBYSCORE', KEYS[1], '-inf', micros - window)
+local count = redis.call('ZCARD', KEYS[1])
+
+if requested > limit then
+  return {0, math.max(limit - count, 0), -1}
+end
+
+if count + requested <= limit then
+  for i = 1, requested do
+    redis.call('ZADD', KEYS[1], micros, time[1] .. '.' .. time[2] .. ':' .. (count + i))
+  end
+
+  redis.call('PEXPIRE', KEYS[1], ARGV[1])
+  return {1, limit - count - requested, 0}
+end
+
+-- Room is made as the oldest requests leave the window.
+local last = count + requested - limit - 1
+local oldest = redis.call('ZRANGE', KEYS[1], last, last, 'WITHSCORES')
+
+return {0, math.max(limit - count, 0), math.ceil((tonumber(oldest[2]) + window - micros) / 1000)}
+)lua"
+};
+
+// KEYS: lock, fence.  ARGV: owner, ttl in milliseconds.
+Script const kLockAcquire = {
+  "rediswraps:lock_acquire", 2,
+  R"lua(
+local state = redis.call('HMGET', KEYS[1], 'owner', 'token')
+
+if state[1] == ARGV[1] then
+  redis.call('PEXPIRE', KEYS[1], ARGV[2])
+  return {tonumber(state[2]), tonumber(ARGV[2])}
+end
+
+if state[1] then
+  return {0, redis.call('PTTL', KEYS[1])}
+end
+
+local token = redis.call('INCR', KEYS[2])
+
+redis.call('HSET', KEYS[1], 'owner', ARGV[1], 'token', token)
+redis.call('PEXPIRE', KEYS[1], ARGV[2])
+
+return {token, tonumber(ARGV[2])}
+)lua"
+};
+
+// KEYS: lock.  ARGV: owner, token, ttl in milliseconds.
+Script const kLockExtend = {
+  "rediswraps:lock_extend", 1,
+  R"lua(
+local state = redis.call('HMGET', KEYS[1], 'owner', 'token')
+
+if state[1] == ARGV[1] and state[2] == ARGV[2] then
+  redis.call('PEXPIRE', KEYS[1], ARGV[3])
+  return 1
+end
+
+return 0
+)lua"
+};
+
+// KEYS: lock.  ARGV: owner, token.
+Script const kLockRelease = {
+  "rediswraps:lock_release", 1,
+  R"lua(
+local state = redis.call('HMGET', KEYS[1], 'owner', 'token')
+
+if state[1] == ARGV[1] and state[2] == ARGV[2] then
+  redis.call('DEL', KEYS[1])
+  return 1
+end
+
+return 0
+)lua"
+};
+
+// KEYS: counter.  ARGV: delta, minimum, maximum, ttl in milliseconds.
+Script const kCappedCounter = {
+  "rediswraps:capped_counter", 1,
+  R"lua(
+local current = redis.call('GET', KEYS[1])
+local value   = tonumber(current) or 0
+local next    = value + tonumber(ARGV[1])
+
+if next < tonumber(ARGV[2]) or next > tonumber(ARGV[3]) then
+  return {0, value}
+end
+
+next = redis.call('INCRBY', KEYS[1], ARGV[1])
+
+if not current and tonumber(ARGV[4]) > 0 then
+  redis.call('PEXPIRE', KEYS[1], ARGV[4])
+end
+
+return {1, next}
+)lua"
+};
+
+// KEYS: semaphore.  ARGV: holder, limit, lease in milliseconds.
+Script const kSemaphoreAcquire = {
+  "rediswraps:semaphore_acquire", 1,
+  kClock + R"lua(
+local limit = tonumber(ARGV[2])
+local lease = tonumber(ARGV[3])
+
+redis.call('ZREMRANGEBYSCORE', KEYS[1], '-inf', now)
+local count = redis.call('ZCARD', KEYS[1])
+
+if not redis.call('ZSCORE', KEYS[1], ARGV[1]) then
+  if limit <= 0 then
+    return {0, 0, -1}
+  end
+
+  if count >= limit then
+    local first = redis.call('ZRANGE', KEYS[1], 0, 0, 'WITHSCORES')
+    return {0, 0, tonumber(first[2]) - now}
+  end
+
+  count = count + 1
+end
+
+redis.call('ZADD', KEYS[1], now + lease, ARGV[1])
+
+if redis.call('PTTL', KEYS[1]) < lease then
+  redis.call('PEXPIRE', KEYS[1], lease)
+end
+
+return {1, math.max(limit - count, 0), 0}
+)lua"
+};
+
+// KEYS: semaphore.  ARGV: holder.
+Script const kSemaphoreRelease = {
+  "rediswraps:semaphore_release", 1,
+  kClock + R"lua(
+local lease_end = tonumber(redis.call('ZSCORE', KEYS[1], ARGV[1]))
+redis.call('ZREM', KEYS[1], ARGV[1])
+
+if lease_end and lease_end > now then
+  return 1
+end
+
+return 0
+)lua"
+};
+
+
+void Register(Connection &conn, Script const &script) {
+  // Only so that two first uses at once don't both load it.
+  static std::mutex lock;
+  std::lock_guard<std::mutex> guard(lock);
+
+  if (!Connection::HasScript(script.alias)) {
+    conn.LoadScriptFromString(script.alias, script.source, script.keycount);
+  }
+}
+
+
+template<typename... Args>
+ReplyPtr Call(Connection &conn, Script const &script, Args const&... args) {
+  if (!Connection::HasScript(script.alias)) {
+    Register(conn, script);
+  }
+
+  ReplyPtr reply = conn.RawCmd(script.alias, args...);
+
+  if (
+      reply &&
+      reply->type == REDIS_REPLY_ERROR &&
+      strncmp(reply->str, "NOSCRIPT", 8) == 0
+  ) {
+    logging::Log<logging::Severity::kInfo>(
+      logging::Topic::kScript,
+      "Reloading ", script.alias, ", which Redis no longer has."
+    );
+
+    conn.RawCmd("SCRIPT", "LOAD", script.source);
+    reply = conn.RawCmd(script.alias, args...);
+  }
+
+  return reply;
+}
+
+
+// An array reply of "size" integers.
+bool const Integers(redisReply const *reply, size_t const size) {
+  if (!reply) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      "primitives: no reply from Redis."
+    );
+
+    return false;
+  }
+
+  if (reply->type == REDIS_REPLY_ERROR) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      "primitives: ", std::string(reply->str, reply->len)
+    );
+
+    return false;
+  }
+
+  bool valid = reply->type == REDIS_REPLY_ARRAY && reply->elements == size;
+
+  for (size_t i = 0; valid && i < size; ++i) {
+    valid = reply->element[i]->type == REDIS_REPLY_INTEGER;
+  }
+
+  if (!valid) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply,
+      "primitives: unexpected reply from a script."
+    );
+  }
+
+  return valid;
+}
+
+} // namespace
+
+
+bool const Parse(redisReply const *reply, Decision &decision) {
+  if (!Integers(reply, 3)) {
+    return false;
+  }
+
+  decision.allowed     = reply->element[0]->integer != 0;
+  decision.remaining   = reply->element[1]->integer;
+  decision.retry_after = std::chrono::milliseconds(reply->element[2]->integer);
+
+  return true;
+}
+
+
+bool const Parse(redisReply const *reply, Fence &fence) {
+  if (!Integers(reply, 2)) {
+    return false;
+  }
+
+  fence.token = static_cast<uint64_t>(reply->element[0]->integer);
+  fence.ttl   = std::chrono::milliseconds(reply->element[1]->integer);
+
+  return true;
+}
+
+
+bool const Parse(redisReply const *reply, CounterUpdate &update) {
+  if (!Integers(reply, 2)) {
+    return false;
+  }
+
+  update.applied = reply->element[0]->integer != 0;
+  update.value   = reply->element[1]->integer;
+
+  return true;
+}
+
+
+bool const Parse(redisReply const *reply, bool &done) {
+  if (!reply || reply->type != REDIS_REPLY_INTEGER) {
+    // Logs why.
+    Integers(reply, 0);
+    return false;
+  }
+
+  done = reply->integer != 0;
+  return true;
+}
+
+
+TokenBucket::TokenBucket(
+    Connection &conn,
+    double const per_second,
+    int64_t const capacity
+)
+  : conn_(conn),
+    per_second_(per_second),
+    capacity_(capacity)
+{
+  Register(this->conn_, kTokenBucket);
+}
+
+
+bool const TokenBucket::Take(
+    std::string const &key,
+    Decision &decision,
+    int64_t const tokens
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kTokenBucket,
+    key, this->per_second_, this->capacity_, tokens
+  );
+
+  return Parse(reply.get(), decision);
+}
+
+
+void TokenBucket::AddTake(
+    Pipeline &pipe,
+    std::string const &key,
+    int64_t const tokens
+) const {
+  pipe.Add(kTokenBucket.alias, key, this->per_second_, this->capacity_, tokens);
+}
+
+
+SlidingWindow::SlidingWindow(
+    Connection &conn,
+    std::chrono::milliseconds const window,
+    int64_t const limit
+)
+  : conn_(conn),
+    window_(window),
+    limit_(limit)
+{
+  Register(this->conn_, kSlidingWindow);
+}
+
+
+bool const SlidingWindow::Take(
+    std::string const &key,
+    Decision &decision,
+    int64_t const requests
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kSlidingWindow,
+    key, this->window_.count(), this->limit_, requests
+  );
+
+  return Parse(reply.get(), decision);
+}
+
+
+void SlidingWindow::AddTake(
+    Pipeline &pipe,
+    std::string const &key,
+    int64_t const requests
+) const {
+  pipe.Add(
+    kSlidingWindow.alias,
+    key, this->window_.count(), this->limit_, requests
+  );
+}
+
+
+FencedLock::FencedLock(Connection &conn, std::chrono::milliseconds const ttl)
+  : conn_(conn),
+    ttl_(ttl)
+{
+  Register(this->conn_, kLockAcquire);
+  Register(this->conn_, kLockExtend);
+  Register(this->conn_, kLockRelease);
+}
+
+
+bool const FencedLock::Acquire(
+    std::string const &key,
+    std::string const &owner,
+    Fence &fence
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kLockAcquire,
+    key, FenceKey(key), owner, this->ttl_.count()
+  );
+
+  return Parse(reply.get(), fence);
+}
+
+
+bool const FencedLock::Extend(
+    std::string const &key,
+    std::string const &owner,
+    uint64_t const token,
+    bool &done
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kLockExtend,
+    key, owner, token, this->ttl_.count()
+  );
+
+  return Parse(reply.get(), done);
+}
+
+
+bool const FencedLock::Release(
+    std::string const &key,
+    std::string const &owner,
+    uint64_t const token,
+    bool &done
+) {
+  ReplyPtr const reply = Call(this->conn_, kLockRelease, key, owner, token);
+
+  return Parse(reply.get(), done);
+}
+
+
+void FencedLock::AddAcquire(
+    Pipeline &pipe,
+    std::string const &key,
+    std::string const &owner
+) const {
+  pipe.Add(kLockAcquire.alias, key, FenceKey(key), owner, this->ttl_.count());
+}
+
+
+void FencedLock::AddExtend(
+    Pipeline &pipe,
+    std::string const &key,
+    std::string const &owner,
+    uint64_t const token
+) const {
+  pipe.Add(kLockExtend.alias, key, owner, token, this->ttl_.count());
+}
+
+
+void FencedLock::AddRelease(
+    Pipeline &pipe,
+    std::string const &key,
+    std::string const &owner,
+    uint64_t const token
+) const {
+  pipe.Add(kLockRelease.alias, key, owner, token);
+}
+
+
+// static
+std::string const FencedLock::FenceKey(std::string const &key) {
+  return utils::SameSlotKey(key, constants::kFenceKeySuffix);
+}
+
+
+CappedCounter::CappedCounter(
+    Connection &conn,
+    int64_t const maximum,
+    int64_t const minimum,
+    std::chrono::milliseconds const ttl
+)
+  : conn_(conn),
+    maximum_(maximum),
+    minimum_(minimum),
+    ttl_(ttl)
+{
+  Register(this->conn_, kCappedCounter);
+}
+
+
+bool const CappedCounter::Increment(
+    std::string const &key,
+    CounterUpdate &update,
+    int64_t const delta
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kCappedCounter,
+    key, delta, this->minimum_, this->maximum_, this->ttl_.count()
+  );
+
+  return Parse(reply.get(), update);
+}
+
+
+void CappedCounter::AddIncrement(
+    Pipeline &pipe,
+    std::string const &key,
+    int64_t const delta
+) const {
+  pipe.Add(
+    kCappedCounter.alias,
+    key, delta, this->minimum_, this->maximum_, this->ttl_.count()
+  );
+}
+
+
+LeaseSemaphore::LeaseSemaphore(
+    Connection &conn,
+    int64_t const limit,
+    std::chrono::milliseconds const lease
+)
+  : conn_(conn),
+    limit_(limit),
+    lease_(lease)
+{
+  Register(this->conn_, kSemaphoreAcquire);
+  Register(this->conn_, kSemaphoreRelease);
+}
+
+
+bool const LeaseSemaphore::Acquire(
+    std::string const &key,
+    std::string const &holder,
+    Decision &decision
+) {
+  ReplyPtr const reply = Call(
+    this->conn_, kSemaphoreAcquire,
+    key, holder, this->limit_, this->lease_.count()
+  );
+
+  return Parse(reply.get(), decision);
+}
+
+
+bool const LeaseSemaphore::Release(
+    std::string const &key,
+    std::string const &holder,
+    bool &done
+) {
+  ReplyPtr const reply = Call(this->conn_, kSemaphoreRelease, key, holder);
+
+  return Parse(reply.get(), done);
+}
+
+
+void LeaseSemaphore::AddAcquire(
+    Pipeline &pipe,
+    std::string const &key,
+    std::string const &holder
+) const {
+  pipe.Add(
+    kSemaphoreAcquire.alias,
+    key, holder, this->limit_, this->lease_.count()
+  );
+}
+
+
+void LeaseSemaphore::AddRelease(
+    Pipeline &pipe,
+    std::string const &key,
+    std::string const &holder
+) const {
+  pipe.Add(kSemaphoreRelease.alias, key, holder);
+}
+
+} // namespace primitives
+} // namespace rediswraps
@@ -0,0 +1,1619 @@
+#include <rediswraps/rdb.hh>
+
+#include <algorithm>  // std::min
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>    // strtod()
+#include <cstring>    // memcpy(), strerror()
+#include <deque>
+#include <exception>  // std::exception_ptr
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace rediswraps {
+namespace rdb {
+namespace {
+
+enum Opcode : uint8_t {
+  kOpSlotInfo      = 0xF4,
+  kOpFunction2     = 0xF5,
+  kOpFunctionPreGa = 0xF6,
+  kOpModuleAux     = 0xF7,
+  kOpIdle          = 0xF8,
+  kOpFreq          = 0xF9,
+  kOpAux           = 0xFA,
+  kOpResizeDb      = 0xFB,
+  kOpExpireTimeMs  = 0xFC,
+  kOpExpireTime    = 0xFD,
+  kOpSelectDb      = 0xFE,
+  kOpEof           = 0xFF
+};
+
+// Special string encodings, in the low bits of a length's first byte.
+enum : uint64_t {
+  kEncodedInt8  = 0,
+  kEncodedInt16 = 1,
+  kEncodedInt32 = 2,
+  kEncodedLzf   = 3
+};
+
+// Module value opcodes.
+enum : uint64_t {
+  kModuleEof    = 0,
+  kModuleSint   = 1,
+  kModuleUint   = 2,
+  kModuleFloat  = 3,
+  kModuleDouble = 4,
+  kModuleString = 5
+};
+
+// Quicklist 2 node containers.
+enum : uint64_t {
+  kContainerPlain  = 1,
+  kContainerPacked = 2
+};
+
+// The most LZF expands a byte to: a 3-byte back reference copies up to 264
+//   bytes.  Bounds the length a compressed string may claim to have.
+constexpr uint64_t kLzfMaxExpansion = 88;
+
+
+uint64_t const LoadLittleEndian(char const *p, size_t const bytes) noexcept {
+  uint64_t value = 0;
+
+  for (size_t i = bytes; i > 0; --i) {
+    value = (value << 8) | static_cast<uint8_t>(p[i - 1]);
+  }
+
+  return value;
+}
+
+
+uint64_t const LoadBigEndian(char const *p, size_t const bytes) noexcept {
+  uint64_t value = 0;
+
+  for (size_t i = 0; i < bytes; ++i) {
+    value = (value << 8) | static_cast<uint8_t>(p[i]);
+  }
+
+  return value;
+}
+
+
+// Sign-extends the low "bits" bits of "value".
+int64_t const SignExtend(uint64_t const value, unsigned const bits) noexcept {
+  uint64_t const sign = uint64_t(1) << (bits - 1);
+  uint64_t const mask = (bits == 64) ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+
+  return static_cast<int64_t>(((value & mask) ^ sign) - sign);
+}
+
+
+// Bounds-checked reading through part of the mapping.
+struct Input {
+  char const *p;
+  char const *end;
+
+  bool const Has(uint64_t const bytes) const noexcept {
+    return bytes <= static_cast<uint64_t>(this->end - this->p);
+  }
+
+  bool const Skip(uint64_t const bytes) noexcept {
+    if (!this->Has(bytes)) {
+      return false;
+    }
+
+    this->p += bytes;
+    return true;
+  }
+
+  bool const Byte(uint8_t &byte) noexcept {
+    if (!this->Has(1)) {
+      return false;
+    }
+
+    byte = static_cast<uint8_t>(*this->p++);
+    return true;
+  }
+
+  bool const LittleEndian(uint64_t &value, size_t const bytes) noexcept {
+    if (!this->Has(bytes)) {
+      return false;
+    }
+
+    value = LoadLittleEndian(this->p, bytes);
+    this->p += bytes;
+    return true;
+  }
+
+  // A length, or a special string encoding if "special" comes back true.
+  bool const Length(uint64_t &length, bool &special) noexcept {
+    uint8_t byte;
+
+    if (!this->Byte(byte)) {
+      return false;
+    }
+
+    special = false;
+
+    switch (byte >> 6) {
+    case 0:
+      length = byte & 0x3F;
+      return true;
+    case 1:
+      if (!this->Has(1)) {
+        return false;
+      }
+
+      length = (static_cast<uint64_t>(byte & 0x3F) << 8) |
+        static_cast<uint8_t>(*this->p++);
+      return true;
+    case 2:
+      if (byte == 0x80 || byte == 0x81) {
+        size_t const bytes = (byte == 0x80) ? 4 : 8;
+
+        if (!this->Has(bytes)) {
+          return false;
+        }
+
+        length = LoadBigEndian(this->p, bytes);
+        this->p += bytes;
+        return true;
+      }
+
+      return false;
+    default:
+      special = true;
+      length  = byte & 0x3F;
+      return true;
+    }
+  }
+
+  bool const Length(uint64_t &length) noexcept {
+    bool special;
+    return this->Length(length, special) && !special;
+  }
+};
+
+
+// Standard LZF decompression, as in lzf_d.c.
+bool const Decompress(
+    char const *in,
+    size_t const in_size,
+    char *out,
+    size_t const out_size
+) noexcept {
+  uint8_t const *ip     = reinterpret_cast<uint8_t const*>(in);
+  uint8_t const *in_end = ip + in_size;
+
+  size_t written = 0;
+
+  while (ip < in_end) {
+    unsigned const control = *ip++;
+
+    if (control < 32) {
+      size_t const run = control + 1;
+
+      if (static_cast<size_t>(in_end - ip) < run || out_size - written < run) {
+        return false;
+      }
+
+      memcpy(out + written, ip, run);
+      ip      += run;
+      written += run;
+    }
+    else {
+      size_t length = control >> 5;
+
+      if (length == 7) {
+        if (ip >= in_end) {
+          return false;
+        }
+
+        length += *ip++;
+      }
+
+      if (ip >= in_end) {
+        return false;
+      }
+
+      size_t const back = ((control & 0x1F) << 8) + *ip++ + 1;
+      length += 2;
+
+      if (back > written || out_size - written < length) {
+        return false;
+      }
+
+      // Byte by byte: the reference may overlap what it produces.
+      for (size_t i = 0; i < length; ++i, ++written) {
+        out[written] = out[written - back];
+      }
+    }
+  }
+
+  return written == out_size;
+}
+
+
+// Reads a string, decoding it into "storage" if it isn't stored plainly.
+//   "out" may be null to skip it.
+bool const ReadString(
+    Input &in,
+    boost::string_ref *out,
+    std::string &storage
+) {
+  uint64_t length;
+  bool     special;
+
+  if (!in.Length(length, special)) {
+    return false;
+  }
+
+  if (!special) {
+    if (!in.Has(length)) {
+      return false;
+    }
+
+    if (out) {
+      *out = boost::string_ref(in.p, length);
+    }
+
+    in.p += length;
+    return true;
+  }
+
+  uint64_t value;
+
+  switch (length) {
+  case kEncodedInt8:
+  case kEncodedInt16:
+  case kEncodedInt32: {
+    size_t const bytes = size_t(1) << length;
+
+    if (!in.LittleEndian(value, bytes)) {
+      return false;
+    }
+
+    if (out) {
+      storage = std::to_string(SignExtend(value, bytes * 8));
+      *out = storage;
+    }
+
+    return true;
+  }
+  case kEncodedLzf: {
+    uint64_t compressed;
+    uint64_t size;
+
+    if (!in.Length(compressed) || !in.Length(size) || !in.Has(compressed)) {
+      return false;
+    }
+
+    if (size > compressed * kLzfMaxExpansion) {
+      return false;
+    }
+
+    if (out) {
+      storage.resize(size);
+
+      if (!Decompress(in.p, compressed, &storage[0], size)) {
+        return false;
+      }
+
+      *out = storage;
+    }
+
+    in.p += compressed;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+
+bool const SkipString(Input &in) {
+  std::string unused;
+  return ReadString(in, nullptr, unused);
+}
+
+
+// The serialized data of a module type or module AUX field, up to its EOF
+//   opcode.
+bool const SkipModuleData(Input &in) {
+  for (;;) {
+    uint64_t opcode;
+    uint64_t unused;
+
+    if (!in.Length(opcode)) {
+      return false;
+    }
+
+    switch (opcode) {
+    case kModuleEof:
+      return true;
+    case kModuleSint:
+    case kModuleUint:
+      if (!in.Length(unused)) {
+        return false;
+      }
+      break;
+    case kModuleFloat:
+      if (!in.Skip(4)) {
+        return false;
+      }
+      break;
+    case kModuleDouble:
+      if (!in.Skip(8)) {
+        return false;
+      }
+      break;
+    case kModuleString:
+      if (!SkipString(in)) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+}
+
+
+bool const SkipStream(Input &in, Encoding const encoding) {
+  bool const v2 = encoding != Encoding::kStreamListpacks;
+  bool const v3 = encoding == Encoding::kStreamListpacks3;
+
+  uint64_t count;
+  uint64_t unused;
+
+  // Listpacks, each under the ID of its master entry.
+  if (!in.Length(count)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    if (!SkipString(in) || !SkipString(in)) {
+      return false;
+    }
+  }
+
+  // Length and last ID; then first ID, max deleted ID and entries added.
+  for (int i = 0, fields = v2 ? 8 : 3; i < fields; ++i) {
+    if (!in.Length(unused)) {
+      return false;
+    }
+  }
+
+  // Consumer groups.
+  if (!in.Length(count)) {
+    return false;
+  }
+
+  for (uint64_t group = 0; group < count; ++group) {
+    if (!SkipString(in) || !in.Length(unused) || !in.Length(unused)) {
+      return false;
+    }
+
+    if (v2 && !in.Length(unused)) {
+      return false;
+    }
+
+    // Pending entries: ID, delivery time, delivery count.
+    uint64_t pending;
+
+    if (!in.Length(pending)) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < pending; ++i) {
+      if (!in.Skip(16 + 8) || !in.Length(unused)) {
+        return false;
+      }
+    }
+
+    uint64_t consumers;
+
+    if (!in.Length(consumers)) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < consumers; ++i) {
+      // Name, seen time, active time (v3), then the IDs it has pending.
+      if (!SkipString(in) || !in.Skip(v3 ? 16 : 8) || !in.Length(pending)) {
+        return false;
+      }
+
+      if (pending > std::numeric_limits<uint64_t>::max() / 16 ||
+          !in.Skip(pending * 16)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+// One entry of an encoded aggregate, which Group turns into Elements.
+struct Item {
+  boost::string_ref text;
+  std::string       storage;
+
+  bool   real  = false;  // "number" holds a binary score
+  double number = 0.0;
+
+  char digits[24];
+
+  void SetInteger(int64_t const value) noexcept {
+    uint64_t magnitude = (value < 0)
+      ? ~static_cast<uint64_t>(value) + 1
+      : static_cast<uint64_t>(value);
+
+    char *end   = this->digits + sizeof(this->digits);
+    char *begin = end;
+
+    do {
+      *--begin = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0) {
+      *--begin = '-';
+    }
+
+    this->text = boost::string_ref(begin, end - begin);
+    this->real = false;
+  }
+
+  void SetText(boost::string_ref const text) noexcept {
+    this->text = text;
+    this->real = false;
+  }
+
+  double const Score() {
+    if (this->real) {
+      return this->number;
+    }
+
+    this->storage.assign(this->text.data(), this->text.size());
+    return std::strtod(this->storage.c_str(), nullptr);
+  }
+};
+
+
+// Gathers entries into members, member/score or field/value pairs, and
+//   field/value/TTL triplets, and visits each complete group.
+class Group {
+ public:
+  Group(size_t const arity, bool const scored, ElementVisitor const &visit)
+    : arity_(arity),
+      scored_(scored),
+      visit_(visit),
+      filled_(0)
+  {}
+
+  Item& Slot() noexcept {
+    return this->items_[this->filled_];
+  }
+
+  void Push() {
+    if (++this->filled_ < this->arity_) {
+      return;
+    }
+
+    this->filled_ = 0;
+
+    Element element;
+    element.member = this->items_[0].text;
+
+    if (this->arity_ > 1) {
+      if (this->scored_) {
+        element.score = this->items_[1].Score();
+      }
+      else {
+        element.value = this->items_[1].text;
+      }
+    }
+
+    this->visit_(element);
+  }
+
+  // No group left half filled.
+  bool const Complete() const noexcept {
+    return this->filled_ == 0;
+  }
+
+ private:
+  size_t const          arity_;
+  bool const            scored_;
+  ElementVisitor const &visit_;
+
+  size_t filled_;
+  Item   items_[3];
+};
+
+
+bool const ReadItem(Input &in, Group &group) {
+  Item &item = group.Slot();
+  boost::string_ref text;
+
+  if (!ReadString(in, &text, item.storage)) {
+    return false;
+  }
+
+  item.SetText(text);
+  group.Push();
+  return true;
+}
+
+
+bool const ParseZiplist(boost::string_ref const blob, Group &group) {
+  Input in = {blob.data(), blob.data() + blob.size()};
+
+  // zlbytes, zltail, zllen
+  if (!in.Skip(10)) {
+    return false;
+  }
+
+  for (;;) {
+    uint8_t byte;
+
+    if (!in.Byte(byte)) {
+      return false;
+    }
+
+    if (byte == 0xFF) {
+      return group.Complete();
+    }
+
+    // Length of the previous entry.
+    if (byte == 0xFE && !in.Skip(4)) {
+      return false;
+    }
+
+    uint8_t encoding;
+
+    if (!in.Byte(encoding)) {
+      return false;
+    }
+
+    Item &item = group.Slot();
+    uint64_t value;
+
+    switch (encoding >> 6) {
+    case 0:
+      value = encoding & 0x3F;
+      break;
+    case 1:
+      if (!in.Has(1)) {
+        return false;
+      }
+
+      value = (static_cast<uint64_t>(encoding & 0x3F) << 8) |
+        static_cast<uint8_t>(*in.p++);
+      break;
+    case 2:
+      if (!in.Has(4)) {
+        return false;
+      }
+
+      value = LoadBigEndian(in.p, 4);
+      in.p += 4;
+      break;
+    default: {
+      size_t bytes = 0;
+
+      switch (encoding) {
+      case 0xC0: bytes = 2; break;
+      case 0xD0: bytes = 4; break;
+      case 0xE0: bytes = 8; break;
+      case 0xF0: bytes = 3; break;
+      case 0xFE: bytes = 1; break;
+      default:
+        // 4 bit immediates 0 to 12, stored plus one.
+        if (encoding < 0xF1 || encoding > 0xFD) {
+          return false;
+        }
+
+        item.SetInteger((encoding & 0x0F) - 1);
+        group.Push();
+        continue;
+      }
+
+      if (!in.LittleEndian(value, bytes)) {
+        return false;
+      }
+
+      item.SetInteger(SignExtend(value, bytes * 8));
+      group.Push();
+      continue;
+    }
+    }
+
+    if (!in.Has(value)) {
+      return false;
+    }
+
+    item.SetText(boost::string_ref(in.p, value));
+    in.p += value;
+    group.Push();
+  }
+}
+
+
+bool const ParseListpack(boost::string_ref const blob, Group &group) {
+  Input in = {blob.data(), blob.data() + blob.size()};
+
+  // total bytes, number of elements
+  if (!in.Skip(6)) {
+    return false;
+  }
+
+  for (;;) {
+    if (!in.Has(1)) {
+      return false;
+    }
+
+    uint8_t const byte = static_cast<uint8_t>(*in.p);
+
+    if (byte == 0xFF) {
+      return group.Complete();
+    }
+
+    Item &item = group.Slot();
+
+    size_t   header;
+    uint64_t length  = 0;  // of a string
+    size_t   integer = 0;  // bytes of an integer, after the header
+    int64_t  value   = 0;
+
+    if ((byte & 0x80) == 0) {
+      header = 1;
+      value  = byte & 0x7F;
+    }
+    else if ((byte & 0xC0) == 0x80) {
+      header = 1;
+      length = byte & 0x3F;
+    }
+    else if ((byte & 0xE0) == 0xC0) {
+      header = 2;
+
+      if (!in.Has(2)) {
+        return false;
+      }
+
+      value = SignExtend(
+        (static_cast<uint64_t>(byte & 0x1F) << 8) | static_cast<uint8_t>(in.p[1]),
+        13
+      );
+    }
+    else if ((byte & 0xF0) == 0xE0) {
+      header = 2;
+
+      if (!in.Has(2)) {
+        return false;
+      }
+
+      length =
+        (static_cast<uint64_t>(byte & 0x0F) << 8) | static_cast<uint8_t>(in.p[1]);
+    }
+    else {
+      switch (byte) {
+      case 0xF0:
+        header = 5;
+
+        if (!in.Has(5)) {
+          return false;
+        }
+
+        length = LoadLittleEndian(in.p + 1, 4);
+        break;
+      case 0xF1: header = 1; integer = 2; break;
+      case 0xF2: header = 1; integer = 3; break;
+      case 0xF3: header = 1; integer = 4; break;
+      case 0xF4: header = 1; integer = 8; break;
+      default:
+        return false;
+      }
+    }
+
+    uint64_t const entry = header + length + integer;
+
+    if (!in.Has(entry)) {
+      return false;
+    }
+
+    bool const text = (byte & 0xC0) == 0x80 || (byte & 0xF0) == 0xE0 || byte == 0xF0;
+
+    if (text) {
+      item.SetText(boost::string_ref(in.p + header, length));
+    }
+    else {
+      if (integer > 0) {
+        value = SignExtend(LoadLittleEndian(in.p + header, integer), integer * 8);
+      }
+
+      item.SetInteger(value);
+    }
+
+    // The entry is followed by its own length, for walking backwards.
+    size_t const backlen =
+      (entry <= 127)       ? 1 :
+      (entry < 16383)      ? 2 :
+      (entry < 2097151)    ? 3 :
+      (entry < 268435455)  ? 4 : 5;
+
+    if (!in.Skip(entry + backlen)) {
+      return false;
+    }
+
+    group.Push();
+  }
+}
+
+
+bool const ParseIntset(boost::string_ref const blob, Group &group) {
+  Input in = {blob.data(), blob.data() + blob.size()};
+
+  uint64_t width;
+  uint64_t count;
+
+  if (!in.LittleEndian(width, 4) || !in.LittleEndian(count, 4)) {
+    return false;
+  }
+
+  if ((width != 2 && width != 4 && width != 8) || !in.Has(width * count)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t value;
+
+    if (!in.LittleEndian(value, width)) {
+      return false;
+    }
+
+    group.Slot().SetInteger(SignExtend(value, width * 8));
+    group.Push();
+  }
+
+  return true;
+}
+
+
+bool const ParseZipmap(boost::string_ref const blob, Group &group) {
+  Input in = {blob.data(), blob.data() + blob.size()};
+
+  // Lengths below 254 take a byte, others 254 then 4 bytes.
+  auto const length = [&in](uint8_t const first, uint64_t &length) {
+    if (first < 254) {
+      length = first;
+      return true;
+    }
+
+    return first == 254 && in.LittleEndian(length, 4);
+  };
+
+  if (!in.Skip(1)) {
+    return false;
+  }
+
+  for (;;) {
+    uint8_t  byte;
+    uint64_t size;
+
+    if (!in.Byte(byte)) {
+      return false;
+    }
+
+    if (byte == 0xFF) {
+      return group.Complete();
+    }
+
+    // Field
+    if (!length(byte, size) || !in.Has(size)) {
+      return false;
+    }
+
+    group.Slot().SetText(boost::string_ref(in.p, size));
+    in.p += size;
+    group.Push();
+
+    // Value, followed by unused bytes
+    uint8_t free;
+
+    if (!in.Byte(byte) || !length(byte, size) || !in.Byte(free)) {
+      return false;
+    }
+
+    if (!in.Has(size + free)) {
+      return false;
+    }
+
+    group.Slot().SetText(boost::string_ref(in.p, size));
+    in.p += size + free;
+    group.Push();
+  }
+}
+
+
+// Reads the value of a record, visiting its elements if "visit" isn't
+//   null and merely skipping over it otherwise.
+bool const ParseValue(
+    Encoding const encoding,
+    Input &in,
+    ElementVisitor const *visit
+) {
+  // A blob parsed by one of the Parse*() functions above.
+  auto const blob = [&in, visit](
+      size_t const arity,
+      bool const scored,
+      bool const (* const parse)(boost::string_ref const, Group&)
+  ) {
+    if (!visit) {
+      return SkipString(in);
+    }
+
+    std::string       storage;
+    boost::string_ref data;
+
+    if (!ReadString(in, &data, storage)) {
+      return false;
+    }
+
+    Group group(arity, scored, *visit);
+    return parse(data, group);
+  };
+
+  // "count" entries (or pairs) stored as strings one after the other.
+  auto const plain = [&in, visit](size_t const arity) {
+    uint64_t count;
+
+    if (!in.Length(count)) {
+      return false;
+    }
+
+    if (!visit) {
+      for (uint64_t i = 0; i < count * arity; ++i) {
+        if (!SkipString(in)) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    Group group(arity, false, *visit);
+
+    for (uint64_t i = 0; i < count * arity; ++i) {
+      if (!ReadItem(in, group)) {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  switch (encoding) {
+  case Encoding::kString: {
+    if (!visit) {
+      return SkipString(in);
+    }
+
+    std::string storage;
+    Element     element;
+
+    if (!ReadString(in, &element.member, storage)) {
+      return false;
+    }
+
+    (*visit)(element);
+    return true;
+  }
+
+  case Encoding::kList:
+  case Encoding::kSet:
+    return plain(1);
+
+  case Encoding::kHash:
+    return plain(2);
+
+  case Encoding::kSortedSet:
+  case Encoding::kSortedSet2: {
+    bool const binary = encoding == Encoding::kSortedSet2;
+    uint64_t   count;
+
+    if (!in.Length(count)) {
+      return false;
+    }
+
+    ElementVisitor const ignore = [](Element const&) {};
+    Group group(2, true, visit ? *visit : ignore);
+
+    for (uint64_t i = 0; i < count; ++i) {
+      if (!visit) {
+        if (!SkipString(in)) {
+          return false;
+        }
+      }
+      else if (!ReadItem(in, group)) {
+        return false;
+      }
+
+      Item &score = group.Slot();
+
+      if (binary) {
+        uint64_t bits;
+
+        if (!in.LittleEndian(bits, 8)) {
+          return false;
+        }
+
+        memcpy(&score.number, &bits, sizeof(bits));
+      }
+      else {
+        // One byte of length, or 253 NaN, 254 +inf, 255 -inf.
+        uint8_t length;
+
+        if (!in.Byte(length)) {
+          return false;
+        }
+
+        switch (length) {
+        case 253:
+          score.number = std::numeric_limits<double>::quiet_NaN();
+          break;
+        case 254:
+          score.number = std::numeric_limits<double>::infinity();
+          break;
+        case 255:
+          score.number = -std::numeric_limits<double>::infinity();
+          break;
+        default:
+          if (!in.Has(length)) {
+            return false;
+          }
+
+          score.storage.assign(in.p, length);
+          score.number = std::strtod(score.storage.c_str(), nullptr);
+          in.p += length;
+        }
+      }
+
+      if (visit) {
+        score.real = true;
+        group.Push();
+      }
+    }
+
+    return true;
+  }
+
+  case Encoding::kHashZipmap:
+    return blob(2, false, ParseZipmap);
+
+  case Encoding::kListZiplist:
+    return blob(1, false, ParseZiplist);
+
+  case Encoding::kSetIntset:
+    return blob(1, false, ParseIntset);
+
+  case Encoding::kSortedSetZiplist:
+    return blob(2, true, ParseZiplist);
+
+  case Encoding::kHashZiplist:
+    return blob(2, false, ParseZiplist);
+
+  case Encoding::kHashListpack:
+    return blob(2, false, ParseListpack);
+
+  case Encoding::kSortedSetListpack:
+    return blob(2, true, ParseListpack);
+
+  case Encoding::kSetListpack:
+    return blob(1, false, ParseListpack);
+
+  case Encoding::kListQuicklist:
+  case Encoding::kListQuicklist2: {
+    bool const containers = encoding == Encoding::kListQuicklist2;
+    uint64_t   nodes;
+
+    if (!in.Length(nodes)) {
+      return false;
+    }
+
+    for (uint64_t i = 0; i < nodes; ++i) {
+      uint64_t container = kContainerPacked;
+
+      if (containers && !in.Length(container)) {
+        return false;
+      }
+
+      if (container == kContainerPlain) {
+        // A single large element.
+        if (!visit) {
+          if (!SkipString(in)) {
+            return false;
+          }
+
+          continue;
+        }
+
+        Group group(1, false, *visit);
+
+        if (!ReadItem(in, group)) {
+          return false;
+        }
+      }
+      else if (container != kContainerPacked) {
+        return false;
+      }
+      else if (!blob(1, false, containers ? ParseListpack : ParseZiplist)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  case Encoding::kHashMetadata: {
+    uint64_t unused;
+    uint64_t count;
+
+    // Earliest field expiry, then TTL, field, value for each field.
+    if (!in.Skip(8) || !in.Length(count)) {
+      return false;
+    }
+
+    ElementVisitor const ignore = [](Element const&) {};
+    Group group(2, false, visit ? *visit : ignore);
+
+    for (uint64_t i = 0; i < count; ++i) {
+      if (!in.Length(unused)) {
+        return false;
+      }
+
+      for (int j = 0; j < 2; ++j) {
+        if (visit ? !ReadItem(in, group) : !SkipString(in)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  case Encoding::kHashListpackEx: {
+    // Earliest field expiry, then a listpack of field, value, TTL.
+    if (!in.Skip(8)) {
+      return false;
+    }
+
+    if (!visit) {
+      return SkipString(in);
+    }
+
+    std::string       storage;
+    boost::string_ref data;
+
+    if (!ReadString(in, &data, storage)) {
+      return false;
+    }
+
+    // The group visits field and value; the TTL is left out.
+    Group group(3, false, *visit);
+    return ParseListpack(data, group);
+  }
+
+  case Encoding::kStreamListpacks:
+  case Encoding::kStreamListpacks2:
+  case Encoding::kStreamListpacks3:
+    return SkipStream(in, encoding);
+
+  case Encoding::kModule2: {
+    uint64_t id;
+    return in.Length(id) && SkipModuleData(in);
+  }
+
+  default:
+    return false;
+  }
+}
+
+
+bool const TypeOf(uint8_t const byte, Encoding &encoding, Type &type) noexcept {
+  encoding = static_cast<Encoding>(byte);
+
+  switch (encoding) {
+  case Encoding::kString:
+    type = Type::kString;
+    return true;
+  case Encoding::kList:
+  case Encoding::kListZiplist:
+  case Encoding::kListQuicklist:
+  case Encoding::kListQuicklist2:
+    type = Type::kList;
+    return true;
+  case Encoding::kSet:
+  case Encoding::kSetIntset:
+  case Encoding::kSetListpack:
+    type = Type::kSet;
+    return true;
+  case Encoding::kSortedSet:
+  case Encoding::kSortedSet2:
+  case Encoding::kSortedSetZiplist:
+  case Encoding::kSortedSetListpack:
+    type = Type::kSortedSet;
+    return true;
+  case Encoding::kHash:
+  case Encoding::kHashZipmap:
+  case Encoding::kHashZiplist:
+  case Encoding::kHashListpack:
+  case Encoding::kHashMetadata:
+  case Encoding::kHashListpackEx:
+    type = Type::kHash;
+    return true;
+  case Encoding::kStreamListpacks:
+  case Encoding::kStreamListpacks2:
+  case Encoding::kStreamListpacks3:
+    type = Type::kStream;
+    return true;
+  case Encoding::kModule2:
+    type = Type::kModule;
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+
+char const* TypeName(Type const type) noexcept {
+  switch (type) {
+  case Type::kString:    return "string";
+  case Type::kList:      return "list";
+  case Type::kSet:       return "set";
+  case Type::kSortedSet: return "zset";
+  case Type::kHash:      return "hash";
+  case Type::kStream:    return "stream";
+  case Type::kModule:    return "module";
+  }
+
+  return "unknown";
+}
+
+
+size_t const Record::serialized_size() const noexcept {
+  return this->value_end_ - this->value_begin_;
+}
+
+
+Snapshot::Snapshot(std::string const &path)
+  : data_(nullptr),
+    size_(0),
+    version_(0),
+    start_(0)
+{
+  int const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    throw std::runtime_error("Could not open " + path + ": " + strerror(errno));
+  }
+
+  struct stat status;
+
+  if (fstat(fd, &status) != 0) {
+    std::string const reason = strerror(errno);
+    close(fd);
+
+    throw std::runtime_error("Could not stat " + path + ": " + reason);
+  }
+
+  this->size_ = static_cast<size_t>(status.st_size);
+
+  if (this->size_ < 9) {
+    close(fd);
+    throw std::runtime_error(path + " is not an RDB file.");
+  }
+
+  void *const mapped =
+    mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  std::string const reason = strerror(errno);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Could not map " + path + ": " + reason);
+  }
+
+  this->data_ = static_cast<char const*>(mapped);
+
+  // "REDIS" and a 4 digit version.
+  bool valid = memcmp(this->data_, "REDIS", 5) == 0;
+
+  for (size_t i = 5; valid && i < 9; ++i) {
+    valid = this->data_[i] >= '0' && this->data_[i] <= '9';
+    this->version_ = this->version_ * 10 + (this->data_[i] - '0');
+  }
+
+  if (!valid) {
+    munmap(mapped, this->size_);
+    throw std::runtime_error(path + " is not an RDB file.");
+  }
+
+  Input in = {this->data_ + 9, this->data_ + this->size_};
+
+  while (in.Has(1) && static_cast<uint8_t>(*in.p) == kOpAux) {
+    std::string       storage[2];
+    boost::string_ref field[2];
+
+    ++in.p;
+
+    if (
+        !ReadString(in, &field[0], storage[0]) ||
+        !ReadString(in, &field[1], storage[1])
+    ) {
+      munmap(mapped, this->size_);
+      throw std::runtime_error(path + " has a malformed AUX field.");
+    }
+
+    this->aux_[field[0].to_string()] = field[1].to_string();
+  }
+
+  this->start_ = in.p - this->data_;
+  this->Rewind();
+
+  madvise(mapped, this->size_, MADV_SEQUENTIAL);
+}
+
+
+Snapshot::~Snapshot() {
+  munmap(const_cast<char*>(this->data_), this->size_);
+}
+
+
+bool const Snapshot::Next(Record &record) {
+  return this->Read(this->cursor_, record, true, this->error_);
+}
+
+
+void Snapshot::Rewind() noexcept {
+  this->cursor_.position = this->start_;
+  this->cursor_.db       = 0;
+  this->error_.clear();
+}
+
+
+bool const Snapshot::Elements(
+    Record const &record,
+    ElementVisitor const &visit
+) const {
+  if (record.value_end_ > this->size_ || record.value_begin_ > record.value_end_) {
+    return false;
+  }
+
+  Input in = {
+    this->data_ + record.value_begin_,
+    this->data_ + record.value_end_
+  };
+
+  return ParseValue(record.encoding, in, &visit);
+}
+
+
+bool const Snapshot::ForEach(RecordVisitor const &visit, size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  this->error_.clear();
+
+  Cursor cursor;
+  cursor.position = this->start_;
+
+  if (threads == 1) {
+    Record record;
+
+    while (this->Read(cursor, record, true, this->error_)) {
+      visit(record, 0);
+    }
+
+    return this->error_.empty();
+  }
+
+  // Batches of consecutive records, each starting where the record before
+  //   it ended.
+  struct Batch {
+    Cursor start;
+    size_t records;
+  };
+
+  std::mutex              lock;
+  std::condition_variable changed;
+  std::deque<Batch>       batches;
+  bool                    finished = false;
+
+  size_t const capacity = threads * constants::kRdbQueuedBatches;
+
+  std::vector<std::string> errors(threads);
+  std::vector<std::thread> workers;
+
+  // The first exception a visitor threw, which stops everything.
+  std::exception_ptr thrown;
+
+  for (size_t worker = 0; worker < threads; ++worker) {
+    workers.emplace_back([&, worker]() {
+      Record record;
+
+      for (;;) {
+        Batch batch;
+
+        {
+          std::unique_lock<std::mutex> guard(lock);
+          changed.wait(guard, [&]() {
+            return finished || thrown || !batches.empty();
+          });
+
+          if (thrown || batches.empty()) {
+            return;
+          }
+
+          batch = batches.front();
+          batches.pop_front();
+        }
+
+        changed.notify_all();
+
+        for (size_t i = 0; i < batch.records; ++i) {
+          if (!this->Read(batch.start, record, true, errors[worker])) {
+            break;
+          }
+
+          try {
+            visit(record, worker);
+          }
+          catch (...) {
+            {
+              std::lock_guard<std::mutex> guard(lock);
+
+              if (!thrown) {
+                thrown = std::current_exception();
+              }
+            }
+
+            changed.notify_all();
+            return;
+          }
+        }
+      }
+    });
+  }
+
+  // Only finds where records start: keys aren't decoded, values skipped.
+  Record record;
+  Batch  batch = {cursor, 0};
+
+  // False once a visitor has thrown: there is no point reading on.
+  auto const hand_over = [&]() {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      changed.wait(guard, [&]() {
+        return thrown || batches.size() < capacity;
+      });
+
+      if (thrown) {
+        return false;
+      }
+
+      batches.push_back(batch);
+    }
+
+    changed.notify_all();
+    return true;
+  };
+
+  bool handed_over = true;
+
+  while (handed_over && this->Read(cursor, record, false, this->error_)) {
+    if (++batch.records == constants::kRdbBatchRecords) {
+      handed_over = hand_over();
+      batch = {cursor, 0};
+    }
+  }
+
+  if (handed_over && batch.records > 0) {
+    hand_over();
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    finished = true;
+  }
+
+  changed.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  if (thrown) {
+    std::rethrow_exception(thrown);
+  }
+
+  for (auto const &error : errors) {
+    if (this->error_.empty() && !error.empty()) {
+      this->error_ = error;
+    }
+  }
+
+  return this->error_.empty();
+}
+
+
+int const Snapshot::version() const noexcept {
+  return this->version_;
+}
+
+
+std::map<std::string, std::string> const& Snapshot::aux() const noexcept {
+  return this->aux_;
+}
+
+
+std::string const& Snapshot::error() const noexcept {
+  return this->error_;
+}
+
+
+size_t const Snapshot::size() const noexcept {
+  return this->size_;
+}
+
+
+bool const Snapshot::Read(
+    Cursor &cursor,
+    Record &record,
+    bool const decode_key,
+    std::string &error
+) const {
+  Input in = {this->data_ + cursor.position, this->data_ + this->size_};
+
+  int64_t expires_ms = -1;
+
+  // Says where, and stops reading.
+  auto const fail = [&](char const *what) {
+    error = std::string(what) + " at offset " + std::to_string(in.p - this->data_);
+    cursor.position = this->size_;
+    return false;
+  };
+
+  for (;;) {
+    uint8_t  opcode;
+    uint64_t value;
+
+    // Every file ends with an EOF opcode.
+    if (!in.Byte(opcode)) {
+      return fail("Truncated file");
+    }
+
+    switch (opcode) {
+    case kOpEof:
+      cursor.position = this->size_;
+      return false;
+
+    case kOpSelectDb:
+      if (!in.Length(value)) {
+        return fail("Malformed SELECTDB");
+      }
+
+      cursor.db = static_cast<int>(value);
+      continue;
+
+    case kOpExpireTimeMs:
+      if (!in.LittleEndian(value, 8)) {
+        return fail("Malformed expiry");
+      }
+
+      expires_ms = static_cast<int64_t>(value);
+      continue;
+
+    case kOpExpireTime:
+      if (!in.LittleEndian(value, 4)) {
+        return fail("Malformed expiry");
+      }
+
+      expires_ms = static_cast<int64_t>(static_cast<int32_t>(value)) * 1000;
+      continue;
+
+    case kOpResizeDb:
+      if (!in.Length(value) || !in.Length(value)) {
+        return fail("Malformed RESIZEDB");
+      }
+      continue;
+
+    case kOpSlotInfo:
+      if (!in.Length(value) || !in.Length(value) || !in.Length(value)) {
+        return fail("Malformed SLOT_INFO");
+      }
+      continue;
+
+    case kOpAux:
+      if (!SkipString(in) || !SkipString(in)) {
+        return fail("Malformed AUX field");
+      }
+      continue;
+
+    case kOpIdle:
+      if (!in.Length(value)) {
+        return fail("Malformed IDLE");
+      }
+      continue;
+
+    case kOpFreq:
+      if (!in.Skip(1)) {
+        return fail("Malformed FREQ");
+      }
+      continue;
+
+    case kOpFunction2:
+      if (!SkipString(in)) {
+        return fail("Malformed FUNCTION");
+      }
+      continue;
+
+    case kOpModuleAux:
+      // Module ID, "when" opcode and value, then the module's data.
+      if (
+          !in.Length(value) || !in.Length(value) || !in.Length(value) ||
+          !SkipModuleData(in)
+      ) {
+        return fail("Malformed MODULE_AUX");
+      }
+      continue;
+
+    case kOpFunctionPreGa:
+      return fail("Unsupported pre-release FUNCTION");
+
+    default:
+      break;
+    }
+
+    if (!TypeOf(opcode, record.encoding, record.type)) {
+      return fail(("Unsupported object type " + std::to_string(opcode)).c_str());
+    }
+
+    boost::string_ref key;
+
+    if (!ReadString(in, decode_key ? &key : nullptr, record.key_storage_)) {
+      return fail("Malformed key");
+    }
+
+    record.key        = key;
+    record.db         = cursor.db;
+    record.expires_ms = expires_ms;
+
+    record.value_begin_ = in.p - this->data_;
+
+    if (!ParseValue(record.encoding, in, nullptr)) {
+      return fail("Malformed value");
+    }
+
+    record.value_end_ = in.p - this->data_;
+    cursor.position   = record.value_end_;
+
+    return true;
+  }
+}
+
+} // namespace rdb
+} // namespace rediswraps
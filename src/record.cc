@@ -0,0 +1,287 @@
+#include <rediswraps/record.hh>
+
+#include <algorithm>  // std::max()
+#include <cerrno>
+#include <cstring>    // memcmp(), strerror()
+#include <stdexcept>
+
+#include <rediswraps/log.hh>
+
+
+namespace rediswraps {
+namespace {
+
+constexpr char     kMagic[]   = "RWCMDLOG";
+constexpr size_t   kMagicSize = sizeof(kMagic) - 1;
+constexpr uint8_t  kVersion   = 1;
+
+// Sanity limits on what a record may claim, past which the log is corrupt.
+constexpr uint64_t kMaxArgc      = 1 << 20;
+constexpr uint64_t kMaxArgLength = 512 * 1024 * 1024;  // Redis' own limit
+
+
+void PutVarint(std::string &buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+
+  buffer += static_cast<char>(value);
+}
+
+} // namespace
+
+
+CommandRecorder::CommandRecorder(
+    std::string const &path,
+    size_t const buffer_size
+)
+  : file_(fopen(path.c_str(), "wb")),
+    buffer_size_(std::max<size_t>(buffer_size, 1)),
+    last_(std::chrono::steady_clock::now()),
+    streams_(0),
+    commands_(0),
+    bytes_(0),
+    errors_(0)
+{
+  if (this->file_ == nullptr) {
+    throw std::runtime_error(
+      "Could not open " + path + " for recording: " + strerror(errno)
+    );
+  }
+
+  // Records are buffered here already.
+  setvbuf(this->file_, nullptr, _IONBF, 0);
+
+  this->buffer_.reserve(this->buffer_size_ + this->buffer_size_ / 4);
+  this->buffer_.append(kMagic, kMagicSize);
+  this->buffer_ += static_cast<char>(kVersion);
+
+  uint64_t const started = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()
+  ).count();
+
+  for (size_t i = 0; i < 8; ++i) {
+    this->buffer_ += static_cast<char>((started >> (8 * i)) & 0xff);
+  }
+}
+
+
+CommandRecorder::~CommandRecorder() {
+  this->Flush();
+  fclose(this->file_);
+}
+
+
+uint64_t const CommandRecorder::NewStream() noexcept {
+  return this->streams_++;
+}
+
+
+void CommandRecorder::Record(
+    uint64_t const stream,
+    std::string const *argv,
+    size_t const argc
+) {
+  std::unique_lock<std::mutex> guard(this->lock_);
+
+  auto const now = std::chrono::steady_clock::now();
+
+  PutVarint(
+    this->buffer_,
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - this->last_
+    ).count()
+  );
+
+  this->last_ = now;
+
+  PutVarint(this->buffer_, stream);
+  PutVarint(this->buffer_, argc);
+
+  for (size_t i = 0; i < argc; ++i) {
+    PutVarint(this->buffer_, argv[i].size());
+    this->buffer_ += argv[i];
+  }
+
+  ++this->commands_;
+
+  if (this->buffer_.size() < this->buffer_size_) {
+    return;
+  }
+
+  std::string full;
+  full.reserve(this->buffer_.capacity());
+  full.swap(this->buffer_);
+
+  std::lock_guard<std::mutex> file_guard(this->file_lock_);
+  guard.unlock();
+
+  this->Write(full);
+}
+
+
+bool const CommandRecorder::Flush() {
+  std::unique_lock<std::mutex> guard(this->lock_);
+  std::lock_guard<std::mutex> file_guard(this->file_lock_);
+
+  std::string full;
+  full.swap(this->buffer_);
+  this->buffer_.reserve(full.capacity());
+
+  guard.unlock();
+
+  uint64_t const errors = this->errors_;
+  this->Write(full);
+
+  return this->errors_ == errors;
+}
+
+
+RecorderStats const CommandRecorder::stats() const noexcept {
+  RecorderStats stats;
+
+  stats.commands = this->commands_;
+  stats.bytes    = this->bytes_;
+  stats.errors   = this->errors_;
+
+  return stats;
+}
+
+
+void CommandRecorder::Write(std::string const &buffer) {
+  if (buffer.empty()) {
+    return;
+  }
+
+  size_t const written = fwrite(buffer.data(), 1, buffer.size(), this->file_);
+  this->bytes_ += written;
+
+  if (written != buffer.size()) {
+    ++this->errors_;
+
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kUsage,
+      "CommandRecorder: writing the log failed: ", strerror(errno)
+    );
+  }
+}
+
+
+CommandLog::CommandLog(std::string const &path)
+  : file_(fopen(path.c_str(), "rb"))
+{
+  if (this->file_ == nullptr) {
+    throw std::runtime_error(
+      "Could not open " + path + ": " + strerror(errno)
+    );
+  }
+
+  setvbuf(this->file_, nullptr, _IOFBF, constants::kRecorderBufferSize);
+
+  unsigned char header[kMagicSize + 1 + 8];
+
+  if (
+      fread(header, 1, sizeof(header), this->file_) != sizeof(header) ||
+      memcmp(header, kMagic, kMagicSize) != 0 ||
+      header[kMagicSize] != kVersion
+  ) {
+    fclose(this->file_);
+    throw std::runtime_error(path + " is not a command log.");
+  }
+
+  uint64_t started = 0;
+
+  for (size_t i = 0; i < 8; ++i) {
+    started |= uint64_t(header[kMagicSize + 1 + i]) << (8 * i);
+  }
+
+  this->started_ = std::chrono::nanoseconds(started);
+}
+
+
+CommandLog::~CommandLog() {
+  fclose(this->file_);
+}
+
+
+bool const CommandLog::Next(RecordedCommand &command) {
+  uint64_t delta, stream, argc;
+
+  // A record cut short ends the log as cleanly as one that wasn't.
+  if (
+      !this->ReadVarint(delta) ||
+      !this->ReadVarint(stream) ||
+      !this->ReadVarint(argc)
+  ) {
+    return false;
+  }
+
+  if (argc == 0 || argc > kMaxArgc) {
+    this->error_ = "Corrupt command log: " + std::to_string(argc) + " arguments";
+    return false;
+  }
+
+  command.argv.resize(argc);
+
+  for (auto &arg : command.argv) {
+    uint64_t length;
+
+    if (!this->ReadVarint(length)) {
+      return false;
+    }
+
+    if (length > kMaxArgLength) {
+      this->error_ = "Corrupt command log: argument of " +
+        std::to_string(length) + " bytes";
+      return false;
+    }
+
+    arg.resize(length);
+
+    if (length > 0 && fread(&arg[0], 1, length, this->file_) != length) {
+      return false;
+    }
+  }
+
+  this->at_ += std::chrono::nanoseconds(delta);
+
+  command.at     = this->at_;
+  command.stream = stream;
+
+  return true;
+}
+
+
+std::chrono::nanoseconds CommandLog::started() const noexcept {
+  return this->started_;
+}
+
+
+std::string const& CommandLog::error() const noexcept {
+  return this->error_;
+}
+
+
+bool const CommandLog::ReadVarint(uint64_t &value) {
+  value = 0;
+
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    int const byte = getc(this->file_);
+
+    if (byte == EOF) {
+      return false;
+    }
+
+    value |= uint64_t(byte & 0x7f) << shift;
+
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+
+  this->error_ = "Corrupt command log: varint too long";
+  return false;
+}
+
+} // namespace rediswraps
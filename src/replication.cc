@@ -0,0 +1,624 @@
+#include <rediswraps/replication.hh>
+
+#include <algorithm>  // std::min
+#include <cerrno>
+#include <cstdlib>    // strtoll()
+#include <cstring>    // strerror()
+#include <memory>
+#include <thread>
+
+#include <poll.h>
+#include <strings.h>  // strcasecmp()
+#include <unistd.h>
+
+#include <rediswraps/connection.hh>  // Connection::EncodeArgv()
+#include <rediswraps/log.hh>
+
+
+namespace rediswraps {
+namespace {
+
+// Length of the marks around a diskless snapshot ("$EOF:<mark>").
+constexpr size_t kEofMarkSize = 40;
+
+using Clock = std::chrono::steady_clock;
+
+int const Milliseconds(Clock::duration const duration) noexcept {
+  return static_cast<int>(
+    std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()
+  );
+}
+
+
+bool const WriteAll(int const fd, char const *data, size_t size) {
+  while (size > 0) {
+    ssize_t const written = write(fd, data, size);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    data += written;
+    size -= written;
+  }
+
+  return true;
+}
+
+} // namespace
+
+
+ReplicationStream::ReplicationStream(
+    std::string const &host,
+    int const port,
+    ReplicationOptions const &options
+)
+  : host_(host),
+    port_(port),
+    options_(options),
+    context_(nullptr),
+    stop_(false),
+    offset_(options.offset),
+    replication_id_(options.replication_id),
+    input_pos_(0)
+{}
+
+
+ReplicationStream::ReplicationStream(
+    std::string const &socket,
+    ReplicationOptions const &options
+)
+  : port_(0),
+    socket_(socket),
+    options_(options),
+    context_(nullptr),
+    stop_(false),
+    offset_(options.offset),
+    replication_id_(options.replication_id),
+    input_pos_(0)
+{}
+
+
+ReplicationStream::~ReplicationStream() {
+  this->Close();
+}
+
+
+bool const ReplicationStream::Run(
+    CommandHandler const &on_command,
+    RdbHandler const &on_rdb
+) {
+  this->stop_ = false;
+
+  for (;;) {
+    if (this->Sync(on_rdb) && this->Stream(on_command)) {
+      this->Close();
+      return true;
+    }
+
+    this->Close();
+
+    if (this->stop_) {
+      return true;
+    }
+
+    if (!this->options_.reconnect) {
+      return false;
+    }
+
+    // Sleeps in short steps to notice Stop().
+    auto const retry = Clock::now() + this->options_.retry_delay;
+
+    while (!this->stop_ && Clock::now() < retry) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (this->stop_) {
+      return true;
+    }
+
+    ++this->stats_.reconnects;
+  }
+}
+
+
+void ReplicationStream::Stop() noexcept {
+  this->stop_ = true;
+}
+
+
+std::string const& ReplicationStream::replication_id() const noexcept {
+  return this->replication_id_;
+}
+
+
+int64_t const ReplicationStream::offset() const noexcept {
+  return this->offset_;
+}
+
+
+ReplicationStats const& ReplicationStream::stats() const noexcept {
+  return this->stats_;
+}
+
+
+bool const ReplicationStream::Sync(RdbHandler const &on_rdb) {
+  this->context_ = this->socket_.empty()
+    ? redisConnect(this->host_.c_str(), this->port_)
+    : redisConnectUnix(this->socket_.c_str());
+
+  if (this->context_ == nullptr || this->context_->err) {
+    return this->Fail(
+      this->context_ ? this->context_->errstr : "Unknown error connecting"
+    );
+  }
+
+  this->input_.clear();
+  this->input_pos_ = 0;
+
+  std::string reply;
+
+  // A status reply, or the end of the stream.
+  auto const require = [&](std::vector<std::string> const &argv) {
+    return
+      this->Exchange(argv, reply) &&
+      (reply.compare(0, 1, "+") == 0 || this->Fail(argv[0] + " failed: " + reply));
+  };
+
+  if (!this->options_.password.empty()) {
+    std::vector<std::string> auth = {"AUTH", this->options_.password};
+
+    if (!this->options_.user.empty()) {
+      auth.insert(auth.begin() + 1, this->options_.user);
+    }
+
+    if (!require(auth)) {
+      return false;
+    }
+  }
+
+  if (!require({"PING"}) || !require({"REPLCONF", "capa", "eof", "capa", "psync2"})) {
+    return false;
+  }
+
+  // Redis 7+ can leave the keys out of the snapshot; older servers send
+  //   them anyway.
+  if (!on_rdb) {
+    if (!this->Exchange({"REPLCONF", "rdb-filter-only", ""}, reply)) {
+      return false;
+    }
+
+    if (reply.compare(0, 1, "+") != 0) {
+      logging::Log<logging::Severity::kDebug>(
+        logging::Topic::kConnection,
+        "ReplicationStream from ", this->Description(),
+        ": snapshots will be read and dropped (", reply, ")"
+      );
+    }
+  }
+
+  bool const resuming = !this->replication_id_.empty() && this->offset_ >= 0;
+
+  std::vector<std::string> const psync = {
+    "PSYNC",
+    resuming ? this->replication_id_ : "?",
+    std::to_string(resuming ? this->offset_ + 1 : -1)
+  };
+
+  if (!this->Exchange(psync, reply)) {
+    return false;
+  }
+
+  if (reply.compare(0, 9, "+CONTINUE") == 0) {
+    // "+CONTINUE <new id>" after a failover.
+    if (reply.size() > 10) {
+      this->replication_id_ = reply.substr(10);
+    }
+
+    ++this->stats_.partial_syncs;
+  }
+  else if (reply.compare(0, 12, "+FULLRESYNC ") == 0) {
+    size_t const space = reply.find(' ', 12);
+
+    if (space == std::string::npos) {
+      return this->Fail("Malformed PSYNC reply: " + reply);
+    }
+
+    if (resuming) {
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kConnection,
+        "ReplicationStream from ", this->Description(),
+        ": could not resume at offset ", this->offset_.load(),
+        "; writes since then are lost"
+      );
+    }
+
+    this->replication_id_ = reply.substr(12, space - 12);
+    this->offset_ = std::strtoll(reply.c_str() + space + 1, nullptr, 10);
+
+    ++this->stats_.full_syncs;
+
+    if (!this->ReceiveRdb(on_rdb)) {
+      return false;
+    }
+  }
+  else {
+    return this->Fail("PSYNC failed: " + reply);
+  }
+
+  // Puts a diskless replica online; reports the offset otherwise.
+  return this->SendAck();
+}
+
+
+bool const ReplicationStream::ReceiveRdb(RdbHandler const &on_rdb) {
+  std::string header;
+
+  if (!this->ReadLine(header)) {
+    return false;
+  }
+
+  if (header.empty() || header[0] != '$') {
+    return this->Fail("Malformed snapshot header: " + header);
+  }
+
+  // Either "$<length>", or "$EOF:<mark>" with the mark repeated at the end
+  //   of a diskless snapshot.
+  bool const diskless = header.compare(0, 5, "$EOF:") == 0;
+  std::string const mark = diskless ? header.substr(5) : "";
+
+  if (diskless && mark.size() != kEofMarkSize) {
+    return this->Fail("Malformed snapshot header: " + header);
+  }
+
+  int64_t remaining = diskless ? -1 : std::strtoll(header.c_str() + 1, nullptr, 10);
+
+  if (!diskless && remaining < 0) {
+    return this->Fail("Malformed snapshot header: " + header);
+  }
+
+  auto const deliver = [&](size_t const size) {
+    char const *data = this->input_.data() + this->input_pos_;
+
+    this->input_pos_ += size;
+    this->stats_.rdb_bytes += size;
+
+    return !on_rdb || on_rdb(data, size);
+  };
+
+  for (;;) {
+    size_t available = this->input_.size() - this->input_pos_;
+
+    if (!diskless) {
+      size_t const size = std::min(static_cast<size_t>(remaining), available);
+
+      if (size > 0 && !deliver(size)) {
+        return this->Fail("Snapshot handler failed");
+      }
+
+      remaining -= size;
+
+      if (remaining == 0) {
+        return true;
+      }
+    }
+    else {
+      // Holds back what could be the end mark.
+      if (available > kEofMarkSize) {
+        if (!deliver(available - kEofMarkSize)) {
+          return this->Fail("Snapshot handler failed");
+        }
+
+        available = kEofMarkSize;
+      }
+
+      if (
+          available == kEofMarkSize &&
+          this->input_.compare(this->input_pos_, kEofMarkSize, mark) == 0
+      ) {
+        this->input_pos_ += kEofMarkSize;
+        return true;
+      }
+    }
+
+    if (!this->Fill()) {
+      return false;
+    }
+  }
+}
+
+
+bool const ReplicationStream::Stream(CommandHandler const &on_command) {
+  std::unique_ptr<redisReader, void (*)(redisReader*)> reader(
+    redisReaderCreate(),
+    redisReaderFree
+  );
+
+  if (!reader) {
+    return this->Fail("Out of memory");
+  }
+
+  // Offset of the first byte not fed to the reader.
+  int64_t fed = this->offset_;
+
+  auto const feed = [&](char const *data, size_t const size) {
+    fed += size;
+    this->stats_.stream_bytes += size;
+
+    return redisReaderFeed(reader.get(), data, size) == REDIS_OK;
+  };
+
+  // What came in with the end of the snapshot or the PSYNC reply.
+  if (this->input_.size() > this->input_pos_) {
+    if (!feed(
+        this->input_.data() + this->input_pos_,
+        this->input_.size() - this->input_pos_
+    )) {
+      return this->Fail("Out of memory");
+    }
+  }
+
+  this->input_.clear();
+  this->input_pos_ = 0;
+
+  std::vector<char> buffer(constants::kReplicationReadSize);
+  Clock::time_point last_read = Clock::now();
+
+  while (!this->stop_) {
+    void *raw = nullptr;
+
+    while (redisReaderGetReply(reader.get(), &raw) == REDIS_OK && raw) {
+      ReplyPtr const reply(static_cast<redisReply*>(raw));
+
+      // Bytes fed but still unparsed belong to later commands.
+      this->offset_ = fed -
+        static_cast<int64_t>(reader->len - reader->pos);
+
+      if (!this->Dispatch(reply.get(), on_command)) {
+        return false;
+      }
+
+      raw = nullptr;
+    }
+
+    if (reader->err) {
+      return this->Fail(std::string("Protocol error: ") + reader->errstr);
+    }
+
+    auto const now = Clock::now();
+
+    if (now - this->last_ack_ >= this->options_.ack_interval && !this->SendAck()) {
+      return false;
+    }
+
+    if (now - last_read >= this->options_.timeout) {
+      return this->Fail("Timed out");
+    }
+
+    // Short polls, so that Stop() is noticed.
+    struct pollfd readable = {this->context_->fd, POLLIN, 0};
+    int const wait = std::min(
+      100,
+      std::max(0, Milliseconds(this->last_ack_ + this->options_.ack_interval - now))
+    );
+
+    int const ready = poll(&readable, 1, wait);
+
+    if (ready < 0 && errno != EINTR) {
+      return this->Fail(std::string("poll() failed: ") + strerror(errno));
+    }
+
+    if (ready <= 0) {
+      continue;
+    }
+
+    ssize_t const size = read(this->context_->fd, buffer.data(), buffer.size());
+
+    if (size == 0) {
+      return this->Fail("Connection closed");
+    }
+
+    if (size < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+
+      return this->Fail(std::string("read() failed: ") + strerror(errno));
+    }
+
+    last_read = Clock::now();
+
+    if (!feed(buffer.data(), static_cast<size_t>(size))) {
+      return this->Fail("Out of memory");
+    }
+  }
+
+  return true;
+}
+
+
+bool const ReplicationStream::Dispatch(
+    redisReply const *reply,
+    CommandHandler const &on_command
+) {
+  if (reply->type != REDIS_REPLY_ARRAY || reply->elements == 0) {
+    return this->Fail("Unexpected data in the command stream");
+  }
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    if (reply->element[i]->type != REDIS_REPLY_STRING) {
+      return this->Fail("Unexpected data in the command stream");
+    }
+  }
+
+  char const *name = reply->element[0]->str;
+
+  if (strcasecmp(name, "SELECT") == 0 && reply->elements == 2) {
+    this->command_.db = std::atoi(reply->element[1]->str);
+    return true;
+  }
+
+  if (strcasecmp(name, "PING") == 0) {
+    return true;
+  }
+
+  if (strcasecmp(name, "REPLCONF") == 0) {
+    // GETACK, from WAIT and failovers.
+    return reply->elements < 2 ||
+      strcasecmp(reply->element[1]->str, "GETACK") != 0 ||
+      this->SendAck();
+  }
+
+  // Reuses the strings' storage from one command to the next.
+  this->command_.argv.resize(reply->elements);
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    this->command_.argv[i].assign(reply->element[i]->str, reply->element[i]->len);
+  }
+
+  this->command_.offset = this->offset_;
+  ++this->stats_.commands;
+
+  on_command(this->command_);
+  return true;
+}
+
+
+bool const ReplicationStream::Exchange(
+    std::vector<std::string> const &argv,
+    std::string &reply
+) {
+  return this->Send(argv) && this->ReadLine(reply);
+}
+
+
+bool const ReplicationStream::Send(std::vector<std::string> const &argv) {
+  std::string buffer;
+  Connection::EncodeArgv(buffer, argv.data(), argv.size());
+
+  if (!WriteAll(this->context_->fd, buffer.data(), buffer.size())) {
+    return this->Fail(std::string("write() failed: ") + strerror(errno));
+  }
+
+  return true;
+}
+
+
+bool const ReplicationStream::SendAck() {
+  this->last_ack_ = Clock::now();
+  return this->Send({"REPLCONF", "ACK", std::to_string(this->offset_)});
+}
+
+
+bool const ReplicationStream::ReadLine(std::string &line) {
+  for (;;) {
+    // Keepalives: a bare "\n" every second while a snapshot is prepared.
+    while (
+        this->input_pos_ < this->input_.size() &&
+        this->input_[this->input_pos_] == '\n'
+    ) {
+      ++this->input_pos_;
+    }
+
+    size_t const end = this->input_.find("\r\n", this->input_pos_);
+
+    if (end != std::string::npos) {
+      line.assign(this->input_, this->input_pos_, end - this->input_pos_);
+      this->input_pos_ = end + 2;
+      return true;
+    }
+
+    if (!this->Fill()) {
+      return false;
+    }
+  }
+}
+
+
+bool const ReplicationStream::Fill() {
+  // Drops what was used up, now and then.
+  if (this->input_pos_ > 0 && this->input_pos_ >= this->input_.size() / 2) {
+    this->input_.erase(0, this->input_pos_);
+    this->input_pos_ = 0;
+  }
+
+  struct pollfd readable = {this->context_->fd, POLLIN, 0};
+  auto const deadline = Clock::now() + this->options_.timeout;
+
+  for (;;) {
+    if (this->stop_) {
+      return this->Fail("Stopped");
+    }
+
+    int const wait = std::min(100, std::max(0, Milliseconds(deadline - Clock::now())));
+    int const ready = poll(&readable, 1, wait);
+
+    if (ready > 0) {
+      break;
+    }
+
+    if (ready < 0 && errno != EINTR) {
+      return this->Fail(std::string("poll() failed: ") + strerror(errno));
+    }
+
+    if (Clock::now() >= deadline) {
+      return this->Fail("Timed out");
+    }
+  }
+
+  size_t const used = this->input_.size();
+  this->input_.resize(used + constants::kReplicationReadSize);
+
+  ssize_t size;
+
+  do {
+    size = read(this->context_->fd, &this->input_[used], constants::kReplicationReadSize);
+  } while (size < 0 && errno == EINTR);
+
+  this->input_.resize(used + std::max<ssize_t>(size, 0));
+
+  if (size == 0) {
+    return this->Fail("Connection closed");
+  }
+
+  if (size < 0) {
+    return this->Fail(std::string("read() failed: ") + strerror(errno));
+  }
+
+  return true;
+}
+
+
+bool const ReplicationStream::Fail(std::string const &what) {
+  // Stop() makes the stream fail on purpose.
+  if (!this->stop_) {
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "ReplicationStream from ", this->Description(), ": ", what
+    );
+  }
+
+  this->Close();
+  return false;
+}
+
+
+void ReplicationStream::Close() noexcept {
+  if (this->context_) {
+    redisFree(this->context_);
+    this->context_ = nullptr;
+  }
+}
+
+
+std::string const ReplicationStream::Description() const {
+  return this->socket_.empty()
+    ? this->host_ + ":" + std::to_string(this->port_)
+    : this->socket_;
+}
+
+} // namespace rediswraps
@@ -7,11 +7,18 @@ namespace cmd {
 // NOTE
 // L-val version of operator bool() in .inl file
 Response::operator bool() && noexcept {
-  return this->success_ && utils::Convert<bool>(this->data_);
+  return this->success_ && this->boolean();
 }
 
 bool const Response::boolean() const noexcept {
-  return utils::Convert<bool>(this->data_);
+  switch (this->type_) {
+  case Type::kBool:
+    return this->data_ == "1";
+  case Type::kNil:
+    return false;
+  default:
+    return utils::Convert<bool>(this->data_);
+  }
 }
 
 std::ostream& operator<<(std::ostream &os, Response const &response) {
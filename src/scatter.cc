@@ -0,0 +1,173 @@
+#include <rediswraps/scatter.hh>
+
+#include <exception>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/pipeline.hh>
+
+
+namespace rediswraps {
+
+bool const ScatterGather::MSet(
+    std::vector<std::pair<std::string, std::string>> const &pairs
+) {
+  std::vector<std::string> args;
+  args.reserve(pairs.size() * 2);
+
+  for (auto const &pair : pairs) {
+    args.push_back(pair.first);
+    args.push_back(pair.second);
+  }
+
+  return this->Scatter("MSET", args, 2,
+    [](Batch const &batch, redisReply const *reply) -> bool const {
+      return reply->type == REDIS_REPLY_STATUS;
+    }
+  );
+}
+
+
+cmd::Response ScatterGather::Sum(
+    std::string const &command,
+    std::vector<std::string> const &keys
+) {
+  long long total = 0;
+
+  bool const success = this->Scatter(command, keys, 1,
+    [&total](Batch const &batch, redisReply const *reply) -> bool const {
+      if (reply->type != REDIS_REPLY_INTEGER) {
+        return false;
+      }
+
+      total += reply->integer;
+      return true;
+    }
+  );
+
+  return cmd::Response(total, success);
+}
+
+
+bool const ScatterGather::Scatter(
+    std::string const &command,
+    std::vector<std::string> const &args,
+    size_t const stride,
+    Gatherer const &gather
+) {
+  size_t const num_keys   = args.size() / stride;
+  size_t const num_shards = this->sharded_.NumShards();
+
+  if (num_keys == 0) {
+    return true;
+  }
+
+  // Group the keys by owning shard, keeping the caller's order within
+  //   each group.
+  std::vector<std::vector<Batch>> batches(num_shards);
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    size_t const shard = this->sharded_.ShardIndex(args[i * stride]);
+    auto &shard_batches = batches[shard];
+
+    if (shard_batches.empty() ||
+        shard_batches.back().positions.size() == this->max_batch_keys_) {
+      shard_batches.push_back(Batch{shard, {}});
+    }
+
+    shard_batches.back().positions.push_back(i);
+  }
+
+  // A shard that can't be reached fails on its own: the others, written
+  //   already or not, are still sent their commands and read back, so that
+  //   no reply is left behind on a connection shared with other callers.
+  bool success = true;
+
+  auto const unreachable = [&](size_t const shard, std::exception const &e) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kConnection,
+      "Could not scatter ", command, " to shard ",
+      ShardedConnection::ShardId(this->sharded_.shard(shard)), ": ", e.what()
+    );
+
+    success = false;
+  };
+
+  // Put every shard's sub-commands on the wire first...
+  std::vector<Pipeline> pipelines;
+  pipelines.reserve(num_shards);
+
+  std::vector<bool> written(num_shards, false);
+
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    pipelines.emplace_back(this->sharded_.shard(shard));
+
+    for (auto const &batch : batches[shard]) {
+      std::vector<std::string> argv;
+      argv.reserve(1 + batch.positions.size() * stride);
+      argv.push_back(command);
+
+      for (auto const position : batch.positions) {
+        for (size_t arg = 0; arg < stride; ++arg) {
+          argv.push_back(args[position * stride + arg]);
+        }
+      }
+
+      pipelines.back().AddArgv(argv);
+    }
+
+    try {
+      pipelines.back().Write();
+      written[shard] = true;
+    }
+    catch (std::exception const &e) {
+      unreachable(shard, e);
+    }
+  }
+
+  // ...then collect the replies while the others are still being served,
+  //   all of them before any is gathered, which may throw.
+  std::vector<std::vector<ReplyPtr>> replies(num_shards);
+
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    if (!written[shard]) {
+      continue;
+    }
+
+    try {
+      replies[shard] = pipelines[shard].ReadRaw();
+    }
+    catch (std::exception const &e) {
+      unreachable(shard, e);
+    }
+  }
+
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    for (size_t i = 0; i < replies[shard].size(); ++i) {
+      redisReply const *reply = replies[shard][i].get();
+
+      if (reply == nullptr) {
+        logging::Log<logging::Severity::kError>(
+          logging::Topic::kConnection,
+          "No reply to ", command, " from shard ",
+          ShardedConnection::ShardId(this->sharded_.shard(shard)), "."
+        );
+
+        success = false;
+      }
+      else if (reply->type == REDIS_REPLY_ERROR) {
+        logging::Log<logging::Severity::kError>(
+          logging::Topic::kReply,
+          reply->str
+        );
+        success = false;
+      }
+      else if (!gather(batches[shard][i], reply)) {
+        success = false;
+      }
+    }
+  }
+
+  return success;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,192 @@
+#include <rediswraps/sharded.hh>
+
+#include <algorithm>   // std::sort(), std::lower_bound()
+
+#include <boost/uuid/detail/md5.hpp>
+
+
+namespace rediswraps {
+namespace {
+
+// MD5 digest of "data" as raw bytes.  Boost's digest_type has been words
+//   and bytes at different versions, but MD5_Final always writes the 16
+//   digest bytes in order into it either way.
+void Md5(std::string const &data, unsigned char (&bytes)[16]) {
+  boost::uuids::detail::md5 md5;
+  boost::uuids::detail::md5::digest_type digest;
+
+  md5.process_bytes(data.data(), data.size());
+  md5.get_digest(digest);
+
+  static_assert(sizeof(digest) == 16, "MD5 digests are 16 bytes.");
+  std::copy(
+    reinterpret_cast<unsigned char const*>(&digest[0]),
+    reinterpret_cast<unsigned char const*>(&digest[0]) + 16,
+    bytes
+  );
+}
+
+
+// The n'th little-endian 32-bit word of a digest, as libketama reads it.
+uint32_t const DigestWord(unsigned char const (&bytes)[16], size_t const n) {
+  return
+    (static_cast<uint32_t>(bytes[4 * n + 3]) << 24) |
+    (static_cast<uint32_t>(bytes[4 * n + 2]) << 16) |
+    (static_cast<uint32_t>(bytes[4 * n + 1]) <<  8) |
+     static_cast<uint32_t>(bytes[4 * n]);
+}
+
+} // namespace
+
+
+HashRing::HashRing(size_t const points_per_node)
+  : points_per_node_(points_per_node < 4 ? 4 : points_per_node)
+{}
+
+
+size_t const HashRing::Add(std::string const &node) {
+  this->nodes_.push_back(node);
+
+  size_t const index = this->nodes_.size() - 1;
+  unsigned char digest[16];
+
+  for (size_t i = 0; i < this->points_per_node_ / 4; ++i) {
+    Md5(node + "-" + std::to_string(i), digest);
+
+    for (size_t word = 0; word < 4; ++word) {
+      this->points_.emplace_back(DigestWord(digest, word), index);
+    }
+  }
+
+  std::sort(this->points_.begin(), this->points_.end());
+  return index;
+}
+
+
+bool const HashRing::Remove(std::string const &node) {
+  auto const found = std::find(this->nodes_.begin(), this->nodes_.end(), node);
+
+  if (found == this->nodes_.end()) {
+    return false;
+  }
+
+  this->nodes_.erase(found);
+  this->Rebuild();
+
+  return true;
+}
+
+
+void HashRing::Rebuild() {
+  std::vector<std::string> nodes;
+  nodes.swap(this->nodes_);
+
+  this->points_.clear();
+
+  for (auto const &node : nodes) {
+    this->Add(node);
+  }
+}
+
+
+size_t const HashRing::Locate(std::string const &key) const {
+  auto const position = HashRing::Position(key);
+
+  // First point at or after the position, wrapping past the top.
+  auto point = std::lower_bound(
+    this->points_.begin(),
+    this->points_.end(),
+    std::make_pair(position, size_t(0))
+  );
+
+  if (point == this->points_.end()) {
+    point = this->points_.begin();
+  }
+
+  return point->second;
+}
+
+
+uint32_t const HashRing::Position(std::string const &key) {
+  auto const open = key.find('{');
+
+  if (open != std::string::npos) {
+    auto const close = key.find('}', open + 1);
+
+    if (close != std::string::npos && close > open + 1) {
+      return HashRing::Position(key.substr(open + 1, close - open - 1));
+    }
+  }
+
+  unsigned char digest[16];
+  Md5(key, digest);
+
+  return DigestWord(digest, 0);
+}
+
+
+ShardedConnection::ShardedConnection(
+    std::vector<Ptr> shards,
+    size_t const points_per_node
+)
+  : ring_(points_per_node)
+{
+  for (auto &shard : shards) {
+    this->AddShard(std::move(shard));
+  }
+}
+
+
+std::string const ShardedConnection::ShardId(Connection const &conn) {
+  return conn.socket().empty() ?
+    conn.host() + ":" + utils::ToString(conn.port()) :
+    conn.socket();
+}
+
+
+void ShardedConnection::AddShard(Ptr shard) {
+  if (!shard) {
+    return;
+  }
+
+  this->ring_.Add(ShardedConnection::ShardId(*shard));
+  this->shards_.push_back(std::move(shard));
+}
+
+
+bool const ShardedConnection::RemoveShard(std::string const &id) {
+  for (size_t i = 0; i < this->shards_.size(); ++i) {
+    if (ShardedConnection::ShardId(*this->shards_[i]) == id) {
+      if (this->last_ == this->shards_[i].get()) {
+        this->last_ = nullptr;
+      }
+
+      this->shards_.erase(this->shards_.begin() + i);
+      this->ring_.Remove(id);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+std::ostream& operator<< (std::ostream &os, ShardedConnection const &sharded) {
+  return os << sharded.Description();
+}
+
+
+std::string ShardedConnection::Description() const {
+  std::string desc("Redis Shards {");
+
+  for (size_t i = 0; i < this->shards_.size(); ++i) {
+    desc += "\nShard ["; desc += utils::ToString(i); desc += "] : ";
+    desc += this->shards_[i]->Description();
+  }
+
+  desc += "\n}";
+  return desc;
+}
+
+} // namespace rediswraps
@@ -0,0 +1,68 @@
+#include <rediswraps/singleflight.hh>
+
+
+namespace rediswraps {
+
+SingleFlight::SingleFlight(SingleFlightOptions const &options)
+  : options_(options),
+    requests_(0),
+    sent_(0),
+    collapsed_(0),
+    cache_hits_(0),
+    bypassed_(0)
+{}
+
+
+SingleFlightStats const SingleFlight::stats() const noexcept {
+  SingleFlightStats stats;
+
+  stats.requests   = this->requests_;
+  stats.sent       = this->sent_;
+  stats.collapsed  = this->collapsed_;
+  stats.cache_hits = this->cache_hits_;
+  stats.bypassed   = this->bypassed_;
+
+  return stats;
+}
+
+
+void SingleFlight::ClearCache() {
+  std::lock_guard<std::mutex> flights_lock_guard(this->lock_);
+  this->cache_.clear();
+}
+
+
+bool const SingleFlight::Collapsible(
+    Connection &conn,
+    std::string const &base
+) {
+  CommandInfo const info = DescribeCommand(conn, base);
+  return info.readonly && !info.random && !info.blocking;
+}
+
+
+// Called with lock_ held.
+void SingleFlight::Cache(std::string const &key, SharedReply const &reply) {
+  if (this->options_.cache_ttl.count() <= 0) {
+    return;
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+
+  if (this->cache_.size() >= this->options_.max_cache_entries) {
+    for (auto entry = this->cache_.begin(); entry != this->cache_.end(); ) {
+      entry = (entry->second.expires <= now) ? this->cache_.erase(entry) : ++entry;
+    }
+
+    if (this->cache_.size() >= this->options_.max_cache_entries) {
+      this->cache_.clear();
+    }
+  }
+
+  CacheEntry &entry = this->cache_[key];
+
+  entry.reply   = reply;
+  entry.expires = now + this->options_.cache_ttl;
+}
+
+} // namespace rediswraps
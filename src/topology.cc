@@ -0,0 +1,285 @@
+#include <rediswraps/topology.hh>
+
+#include <algorithm>  // std::max()
+#include <cstdlib>    // strtoll() for INFO fields
+#include <sstream>
+#include <stdexcept>
+
+#include <rediswraps/log.hh>
+
+
+namespace rediswraps {
+namespace {
+
+// The fields of INFO replication, which is a verbatim string over RESP3.
+bool const ReadInfoReplication(
+    Connection &conn,
+    std::unordered_map<std::string, std::string> &fields
+) {
+  ReplyPtr reply = conn.RawCmd("INFO", "replication");
+
+  if (!reply || (
+        reply->type != REDIS_REPLY_STRING &&
+        reply->type != REDIS_REPLY_VERB
+      )) {
+    return false;
+  }
+
+  fields = utils::ParseInfo(std::string(reply->str, reply->len));
+  return true;
+}
+
+
+// "name=value,name=value" as in the slaveN lines.
+std::unordered_map<std::string, std::string> SplitInfoValue(
+    std::string const &value
+) {
+  std::unordered_map<std::string, std::string> pairs;
+  std::istringstream items(value);
+
+  for (std::string item; std::getline(items, item, ','); ) {
+    auto const equals = item.find('=');
+
+    if (equals != std::string::npos) {
+      pairs[item.substr(0, equals)] = item.substr(equals + 1);
+    }
+  }
+
+  return pairs;
+}
+
+} // namespace
+
+
+TopologyConnection::TopologyConnection(
+    Ptr primary,
+    std::vector<Ptr> replicas,
+    TopologyOptions const &options
+)
+  : primary_(std::move(primary)),
+    options_(options),
+    last_(primary_.get())
+{
+  if (!this->primary_) {
+    throw std::invalid_argument(
+      "TopologyConnection requires a primary Connection."
+    );
+  }
+
+  for (auto &conn : replicas) {
+    if (conn) {
+      Replica replica;
+      replica.conn = std::move(conn);
+
+      this->replicas_.push_back(std::move(replica));
+    }
+  }
+
+  this->Refresh();
+}
+
+
+size_t const TopologyConnection::NumHealthyReplicas() const noexcept {
+  size_t healthy = 0;
+
+  for (auto const &replica : this->replicas_) {
+    healthy += replica.healthy ? 1 : 0;
+  }
+
+  return healthy;
+}
+
+
+void TopologyConnection::Refresh() {
+  PrimaryOffsets const primary = this->ReadPrimaryOffsets();
+
+  for (auto &replica : this->replicas_) {
+    this->Probe(replica, primary);
+  }
+
+  this->refreshed_at_ = std::chrono::steady_clock::now();
+}
+
+
+void TopologyConnection::RefreshIfStale() {
+  if (std::chrono::steady_clock::now() - this->refreshed_at_ >=
+      this->options_.refresh_interval) {
+    this->Refresh();
+  }
+}
+
+
+TopologyConnection::PrimaryOffsets TopologyConnection::ReadPrimaryOffsets() {
+  PrimaryOffsets offsets;
+  std::unordered_map<std::string, std::string> fields;
+
+  // Without the primary's offset no replica's lag is known.
+  try {
+    if (!ReadInfoReplication(*this->primary_, fields)) {
+      return offsets;
+    }
+  }
+  catch (std::exception const &e) {
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "Primary is unreachable, not reading from replicas: ", e.what()
+    );
+
+    return offsets;
+  }
+
+  auto const master = fields.find("master_repl_offset");
+
+  if (master == fields.end()) {
+    return offsets;
+  }
+
+  offsets.master = std::strtoll(master->second.c_str(), nullptr, 10);
+
+  // slave0:ip=127.0.0.1,port=6380,state=online,offset=1234,lag=0
+  for (auto const &field : fields) {
+    if (field.first.compare(0, 5, "slave") != 0 ||
+        field.first.find_first_not_of("0123456789", 5) != std::string::npos) {
+      continue;
+    }
+
+    auto const values = SplitInfoValue(field.second);
+
+    auto const ip     = values.find("ip");
+    auto const port   = values.find("port");
+    auto const offset = values.find("offset");
+
+    if (ip != values.end() && port != values.end() && offset != values.end()) {
+      offsets.replicas[ip->second + ":" + port->second] =
+        std::strtoll(offset->second.c_str(), nullptr, 10);
+    }
+  }
+
+  return offsets;
+}
+
+
+void TopologyConnection::Probe(Replica &replica, PrimaryOffsets const &primary) {
+  replica.healthy = false;
+
+  if (primary.master < 0) {
+    return;
+  }
+
+  std::unordered_map<std::string, std::string> fields;
+
+  // The probes must not disturb whatever the caller has queued.
+  auto const sent_at = std::chrono::steady_clock::now();
+
+  try {
+    if (!replica.conn->RawCmd("PING")) {
+      return;
+    }
+
+    this->Sample(replica, std::chrono::steady_clock::now() - sent_at);
+
+    if (!ReadInfoReplication(*replica.conn, fields)) {
+      return;
+    }
+  }
+  catch (std::exception const &e) {
+    // A replica that is down: reconnecting to it throws.
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "Replica ", replica.conn->host(), ":", replica.conn->port(),
+      " is unreachable: ", e.what()
+    );
+
+    return;
+  }
+
+  auto const role   = fields.find("role");
+  auto const link   = fields.find("master_link_status");
+  auto const offset = fields.find("slave_repl_offset");
+
+  if (role == fields.end() || role->second != "slave" ||
+      link == fields.end() || link->second != "up") {
+    return;
+  }
+
+  // How far the replica got: what it says it processed, or what it last
+  //   acknowledged to the primary, whichever is newer.  The primary only
+  //   knows it by the address it sees, which may not be the one used here.
+  int64_t replicated = (offset == fields.end()) ?
+    -1 :
+    std::strtoll(offset->second.c_str(), nullptr, 10);
+
+  auto const acked = primary.replicas.find(
+    replica.conn->host() + ":" + utils::ToString(replica.conn->port())
+  );
+
+  if (acked != primary.replicas.end()) {
+    replicated = std::max(replicated, acked->second);
+  }
+
+  if (replicated < 0) {
+    return;
+  }
+
+  // The primary was read first, so the replica may have moved past it.
+  int64_t const lag = std::max<int64_t>(0, primary.master - replicated);
+
+  replica.healthy = (lag <= this->options_.max_lag_bytes);
+}
+
+
+void TopologyConnection::Sample(
+    Replica &replica,
+    std::chrono::steady_clock::duration elapsed
+) {
+  double const sample_us = static_cast<double>(
+    std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+  );
+
+  replica.rtt_us = (replica.rtt_us == 0.0) ?
+    sample_us :
+    (
+      this->options_.rtt_smoothing * sample_us +
+      (1.0 - this->options_.rtt_smoothing) * replica.rtt_us
+    );
+}
+
+
+TopologyConnection::Replica* TopologyConnection::FastestReplica() noexcept {
+  Replica *fastest = nullptr;
+
+  for (auto &replica : this->replicas_) {
+    if (replica.healthy && replica.conn->IsConnected() &&
+        (fastest == nullptr || replica.rtt_us < fastest->rtt_us)) {
+      fastest = &replica;
+    }
+  }
+
+  return fastest;
+}
+
+
+std::ostream& operator<< (std::ostream &os, TopologyConnection const &topology) {
+  return os << topology.Description();
+}
+
+
+std::string TopologyConnection::Description() const {
+  std::string desc("Redis Topology {");
+
+  desc += "\nPrimary : "; desc += this->primary_->Description();
+
+  for (size_t i = 0; i < this->replicas_.size(); ++i) {
+    auto const &replica = this->replicas_[i];
+
+    desc += "\nReplica ["; desc += utils::ToString(i); desc += "] : ";
+    desc += replica.healthy ? "healthy" : "unhealthy";
+    desc += ", rtt_us = "; desc += utils::ToString(replica.rtt_us);
+    desc += "\n"; desc += replica.conn->Description();
+  }
+
+  desc += "\n}";
+  return desc;
+}
+
+} // namespace rediswraps
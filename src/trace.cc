@@ -0,0 +1,232 @@
+#include <rediswraps/trace.hh>
+
+#include <cstdio>     // snprintf() for hex ids
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+
+#include <rediswraps/connection.hh>
+
+
+namespace rediswraps {
+namespace trace {
+namespace {
+
+std::mutex    recorder_lock;
+std::ofstream recorder_file;
+
+std::deque<std::string> recorder_ring;
+size_t                  recorder_ring_capacity = 0;
+
+thread_local std::string parent_trace_id;
+thread_local std::string parent_span_id;
+
+
+std::string const RandomHex(size_t const digits) {
+  thread_local std::mt19937_64 generator(std::random_device{}());
+
+  std::string hex;
+  char chunk[17];
+
+  while (hex.size() < digits) {
+    std::snprintf(
+      chunk,
+      sizeof(chunk),
+      "%016llx",
+      static_cast<unsigned long long>(generator())
+    );
+
+    hex += chunk;
+  }
+
+  hex.resize(digits);
+  return hex;
+}
+
+
+// Minimal JSON string escaping for command names and error messages.
+void AppendJsonString(std::string &json, char const *data, size_t const length) {
+  json += '"';
+
+  for (size_t i = 0; i < length; ++i) {
+    char const c = data[i];
+
+    switch (c) {
+    case '"':  json += "\\\""; break;
+    case '\\': json += "\\\\"; break;
+    case '\n': json += "\\n";  break;
+    case '\r': json += "\\r";  break;
+    case '\t': json += "\\t";  break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[7];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        json += escaped;
+      }
+      else {
+        json += c;
+      }
+    }
+  }
+
+  json += '"';
+}
+
+
+void AppendJsonString(std::string &json, std::string const &text) {
+  AppendJsonString(json, text.data(), text.size());
+}
+
+
+void Emit(std::string const &span) {
+  std::lock_guard<std::mutex> recorder_lock_guard(recorder_lock);
+
+  if (recorder_file.is_open()) {
+    recorder_file << span << '\n';
+  }
+
+  if (recorder_ring_capacity > 0) {
+    if (recorder_ring.size() == recorder_ring_capacity) {
+      recorder_ring.pop_front();
+    }
+
+    recorder_ring.push_back(span);
+  }
+}
+
+} // namespace
+
+
+bool const SpanRecorder::ToFile(std::string const &path) {
+  std::lock_guard<std::mutex> recorder_lock_guard(recorder_lock);
+
+  if (recorder_file.is_open()) {
+    recorder_file.close();
+  }
+
+  if (path.empty()) {
+    return true;
+  }
+
+  recorder_file.open(path, std::ios::out | std::ios::app);
+  return recorder_file.is_open();
+}
+
+
+void SpanRecorder::ToRingBuffer(size_t const capacity) {
+  std::lock_guard<std::mutex> recorder_lock_guard(recorder_lock);
+
+  recorder_ring_capacity = capacity;
+
+  while (recorder_ring.size() > capacity) {
+    recorder_ring.pop_front();
+  }
+}
+
+
+std::vector<std::string> SpanRecorder::Spans() {
+  std::lock_guard<std::mutex> recorder_lock_guard(recorder_lock);
+  return std::vector<std::string>(recorder_ring.begin(), recorder_ring.end());
+}
+
+
+void SpanRecorder::SetParent(
+    std::string const &trace_id,
+    std::string const &span_id
+) {
+  parent_trace_id = trace_id;
+  parent_span_id  = span_id;
+}
+
+
+void SpanRecorder::BeforeSend(Event const &event) noexcept {}
+
+
+void SpanRecorder::AfterReply(Event const &event) noexcept {
+  SpanRecorder::Record(event);
+}
+
+
+void SpanRecorder::OnError(Event const &event) noexcept {
+  SpanRecorder::Record(event);
+}
+
+
+void SpanRecorder::OnReconnect(Connection const &conn) noexcept {
+  Event event;
+  event.connection     = &conn;
+  event.command        = "RECONNECT";
+  event.command_length = 9;
+  event.sent_at        = Now();
+  event.replied_at     = event.sent_at;
+  event.success        = conn.IsConnected();
+
+  if (!event.success) {
+    event.error = "reconnection failed";
+  }
+
+  SpanRecorder::Record(event);
+}
+
+
+void SpanRecorder::Record(Event const &event) noexcept {
+  try {
+    std::string const operation(event.command, event.command_length);
+    std::string span("{");
+
+    span += "\"traceId\":\"";
+    span += parent_trace_id.empty() ? RandomHex(32) : parent_trace_id;
+    span += "\",\"spanId\":\"";
+    span += RandomHex(16);
+    span += "\",\"parentSpanId\":\"";
+    span += parent_span_id;
+    span += "\",\"name\":";
+    AppendJsonString(span, "redis " + operation);
+    span += ",\"kind\":\"SPAN_KIND_CLIENT\"";
+    span += ",\"startTimeUnixNano\":\"";
+    span += std::to_string(event.sent_at);
+    span += "\",\"endTimeUnixNano\":\"";
+    span += std::to_string(event.replied_at);
+    span += "\",\"attributes\":{";
+    span += "\"db.system\":\"redis\",\"db.operation\":";
+    AppendJsonString(span, operation);
+
+    if (event.connection != nullptr) {
+      if (!event.connection->socket().empty()) {
+        span += ",\"net.sock.peer.addr\":";
+        AppendJsonString(span, event.connection->socket());
+      }
+      else {
+        span += ",\"net.peer.name\":";
+        AppendJsonString(span, event.connection->host());
+        span += ",\"net.peer.port\":";
+        span += std::to_string(event.connection->port());
+      }
+    }
+
+    span += ",\"rediswraps.argc\":";
+    span += std::to_string(event.argc);
+    span += ",\"rediswraps.request_bytes\":";
+    span += std::to_string(event.request_bytes);
+    span += ",\"rediswraps.reply_bytes\":";
+    span += std::to_string(event.reply_bytes);
+    span += "},\"status\":{\"code\":";
+    span += event.success ? "\"STATUS_CODE_OK\"" : "\"STATUS_CODE_ERROR\"";
+
+    if (!event.success) {
+      span += ",\"message\":";
+      AppendJsonString(span, event.error);
+    }
+
+    span += "}}";
+
+    Emit(span);
+  }
+  catch (...) {
+    // A tracer must never take the command down with it.
+  }
+}
+
+} // namespace trace
+} // namespace rediswraps
@@ -0,0 +1,659 @@
+#include <rediswraps/uring.hh>
+
+#include <algorithm>  // std::min, std::max
+#include <cerrno>
+#include <cstring>    // memcpy(), memset(), strerror()
+#include <stdexcept>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>  // struct iovec
+#include <unistd.h>
+
+#include <rediswraps/log.hh>
+#include <rediswraps/sharded.hh>  // ShardedConnection::ShardId()
+
+
+namespace rediswraps {
+namespace {
+
+// Tags the user data of reads; writes carry the bare Channel address.
+constexpr uintptr_t kReadTag = 0x1;
+
+
+// The kernel and the driver share the ring indexes; each side publishes
+//   its own with release semantics and reads the other's with acquire.
+unsigned const LoadAcquire(unsigned const *index) noexcept {
+  return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+
+void StoreRelease(unsigned *index, unsigned const value) noexcept {
+  __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+
+// The system calls return -1 and set errno; the driver wants -errno.
+int const SystemResult(long const result) noexcept {
+  return (result < 0) ? -errno : static_cast<int>(result);
+}
+
+
+// What liburing's io_uring_prep_rw() does for the four operations used.
+void PrepareReadWrite(
+    struct io_uring_sqe *sqe,
+    uint8_t const opcode,
+    int const fd,
+    void *buffer,
+    size_t const length,
+    int const buffer_index,
+    uintptr_t const user_data
+) noexcept {
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->off       = 0;
+  sqe->addr      = reinterpret_cast<uint64_t>(buffer);
+  sqe->len       = static_cast<uint32_t>(length);
+  sqe->user_data = static_cast<uint64_t>(user_data);
+
+  if (buffer_index >= 0) {
+    sqe->buf_index = static_cast<uint16_t>(buffer_index);
+  }
+}
+
+} // namespace
+
+
+// Ring
+// One io_uring, driven through the kernel ABI directly (io_uring_setup(),
+//   io_uring_enter() and io_uring_register() on <linux/io_uring.h>): the
+//   driver only needs reads, writes and fixed buffers, none of which calls
+//   for liburing.
+//
+struct UringDriver::Ring {
+  explicit Ring(unsigned const entries);
+  ~Ring();
+
+  // The next free submission queue entry, zeroed; nullptr when full.
+  struct io_uring_sqe* GetSqe() noexcept;
+
+  // Hands every entry taken since the last call to the kernel and waits for
+  //   at least "wait" completions.  Returns the entries submitted, or
+  //   -errno.
+  int const Submit(unsigned const wait) noexcept;
+
+  // The oldest completion not seen yet, or nullptr.
+  struct io_uring_cqe* PeekCqe() noexcept;
+  void CqeSeen() noexcept;
+
+  int const RegisterBuffers(struct iovec const *iovecs, unsigned const count);
+  int const UnregisterBuffers() noexcept;
+
+  // Unmaps the rings and closes the ring's descriptor.
+  void Close() noexcept;
+
+  int fd = -1;
+
+  struct io_uring_params params;
+
+  void   *sq_ring      = MAP_FAILED;
+  size_t  sq_ring_size = 0;
+  void   *cq_ring      = MAP_FAILED;
+  size_t  cq_ring_size = 0;
+
+  struct io_uring_sqe *sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+
+  unsigned *sq_head  = nullptr;
+  unsigned *sq_tail  = nullptr;
+  unsigned  sq_mask  = 0;
+  unsigned *sq_array = nullptr;
+
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned  cq_mask = 0;
+
+  struct io_uring_cqe *cqes = nullptr;
+
+  // Entries handed out by GetSqe(); *sq_tail catches up on Submit().
+  unsigned sqe_tail = 0;
+};
+
+
+UringDriver::Ring::Ring(unsigned const entries) {
+  std::memset(&this->params, 0, sizeof(this->params));
+
+  this->fd = SystemResult(
+    syscall(__NR_io_uring_setup, entries, &this->params)
+  );
+
+  if (this->fd < 0) {
+    int const error = -this->fd;
+
+    throw std::runtime_error(
+      std::string("io_uring_setup() failed: ") + std::strerror(error)
+    );
+  }
+
+  struct io_uring_params const &p = this->params;
+
+  this->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  this->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+  // Since Linux 5.4 both rings live in one mapping.
+  bool const single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+  if (single) {
+    this->sq_ring_size = this->cq_ring_size =
+      std::max(this->sq_ring_size, this->cq_ring_size);
+  }
+
+  this->sq_ring = mmap(
+    nullptr, this->sq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING
+  );
+
+  if (this->sq_ring != MAP_FAILED) {
+    this->cq_ring = single ? this->sq_ring : mmap(
+      nullptr, this->cq_ring_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING
+    );
+  }
+
+  if (this->cq_ring != MAP_FAILED) {
+    this->sqes = static_cast<struct io_uring_sqe*>(mmap(
+      nullptr, p.sq_entries * sizeof(struct io_uring_sqe),
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      this->fd, IORING_OFF_SQES
+    ));
+  }
+
+  if (this->sqes == MAP_FAILED) {
+    int const error = errno;
+    this->Close();
+
+    throw std::runtime_error(
+      std::string("Mapping the io_uring failed: ") + std::strerror(error)
+    );
+  }
+
+  char *sq = static_cast<char*>(this->sq_ring);
+  char *cq = static_cast<char*>(this->cq_ring);
+
+  this->sq_head  = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  this->sq_tail  = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  this->sq_mask  = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  this->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+  this->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  this->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  this->cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  this->cqes    = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+  // Entry i of the queue is always sqes[i].
+  for (unsigned i = 0; i < p.sq_entries; ++i) {
+    this->sq_array[i] = i;
+  }
+
+  this->sqe_tail = *this->sq_tail;
+}
+
+
+UringDriver::Ring::~Ring() {
+  this->Close();
+}
+
+
+void UringDriver::Ring::Close() noexcept {
+  if (this->sqes != MAP_FAILED) {
+    munmap(this->sqes, this->params.sq_entries * sizeof(struct io_uring_sqe));
+    this->sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  }
+
+  if (this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring) {
+    munmap(this->cq_ring, this->cq_ring_size);
+  }
+
+  if (this->sq_ring != MAP_FAILED) {
+    munmap(this->sq_ring, this->sq_ring_size);
+  }
+
+  this->sq_ring = this->cq_ring = MAP_FAILED;
+
+  if (this->fd >= 0) {
+    close(this->fd);
+    this->fd = -1;
+  }
+}
+
+
+struct io_uring_sqe* UringDriver::Ring::GetSqe() noexcept {
+  if (this->sqe_tail - LoadAcquire(this->sq_head) >= this->params.sq_entries) {
+    return nullptr;
+  }
+
+  struct io_uring_sqe *sqe = &this->sqes[this->sqe_tail & this->sq_mask];
+  ++this->sqe_tail;
+
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+
+int const UringDriver::Ring::Submit(unsigned const wait) noexcept {
+  unsigned const submit = this->sqe_tail - *this->sq_tail;
+
+  StoreRelease(this->sq_tail, this->sqe_tail);
+
+  return SystemResult(syscall(
+    __NR_io_uring_enter, this->fd, submit, wait,
+    (wait > 0) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0
+  ));
+}
+
+
+struct io_uring_cqe* UringDriver::Ring::PeekCqe() noexcept {
+  unsigned const head = *this->cq_head;
+
+  if (head == LoadAcquire(this->cq_tail)) {
+    return nullptr;
+  }
+
+  return &this->cqes[head & this->cq_mask];
+}
+
+
+void UringDriver::Ring::CqeSeen() noexcept {
+  StoreRelease(this->cq_head, *this->cq_head + 1);
+}
+
+
+int const UringDriver::Ring::RegisterBuffers(
+    struct iovec const *iovecs,
+    unsigned const count
+) {
+  return SystemResult(syscall(
+    __NR_io_uring_register, this->fd, IORING_REGISTER_BUFFERS, iovecs, count
+  ));
+}
+
+
+int const UringDriver::Ring::UnregisterBuffers() noexcept {
+  return SystemResult(syscall(
+    __NR_io_uring_register, this->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0
+  ));
+}
+
+
+UringDriver::UringDriver(unsigned const queue_depth, size_t const buffer_size)
+  : buffer_size_(buffer_size)
+{
+  if (buffer_size == 0) {
+    throw std::invalid_argument("UringDriver buffer size must not be 0.");
+  }
+
+  this->ring_.reset(new Ring(queue_depth));
+}
+
+
+UringDriver::~UringDriver() = default;
+
+
+size_t const UringDriver::Attach(Connection &conn) {
+  if (!conn.IsConnected()) {
+    conn.Reconnect();
+  }
+
+  // Their replies would otherwise arrive ahead of the driver's.
+  conn.FlushDiscarded();
+
+  std::unique_ptr<Channel> channel(new Channel());
+
+  channel->conn         = &conn;
+  channel->index        = this->channels_.size();
+  channel->write_buffer = std::unique_ptr<char[]>(new char[this->buffer_size_]);
+  channel->read_buffer  = std::unique_ptr<char[]>(new char[this->buffer_size_]);
+
+  this->channels_.push_back(std::move(channel));
+
+  return this->channels_.back()->index;
+}
+
+
+size_t const UringDriver::Run() {
+  size_t const delivered = this->delivered_;
+
+  if (this->in_flight_ == 0) {
+    this->RegisterBuffers();
+  }
+
+  this->QueueAll();
+
+  Ring &ring = *this->ring_;
+
+  while (this->in_flight_ > 0) {
+    // Everything queued since the last round goes out in this one call.
+    int const result = ring.Submit(1);
+    ++this->stats_.submits;
+
+    if (result < 0 && result != -EINTR) {
+      throw std::runtime_error(
+        std::string("io_uring_enter() failed: ") + std::strerror(-result)
+      );
+    }
+
+    struct io_uring_cqe *cqe = nullptr;
+
+    while ((cqe = ring.PeekCqe()) != nullptr) {
+      uintptr_t const user_data = static_cast<uintptr_t>(cqe->user_data);
+      int const       res       = cqe->res;
+
+      ring.CqeSeen();
+
+      this->Completed(user_data, res);
+    }
+
+    this->QueueAll();
+  }
+
+  return this->delivered_ - delivered;
+}
+
+
+size_t const UringDriver::pending() const noexcept {
+  size_t pending = 0;
+
+  for (auto const &channel : this->channels_) {
+    pending += channel->handlers.size();
+  }
+
+  return pending;
+}
+
+
+bool const UringDriver::registered_buffers() const noexcept {
+  return this->fixed_ && this->registered_ > 0;
+}
+
+
+UringStats const& UringDriver::stats() const noexcept {
+  return this->stats_;
+}
+
+
+void UringDriver::QueueAll() {
+  for (auto &pointer : this->channels_) {
+    Channel &channel = *pointer;
+
+    bool const work =
+      channel.written < channel.output.size() || !channel.handlers.empty();
+
+    if (channel.failed || !work) {
+      continue;
+    }
+
+    if (!channel.conn->IsConnected()) {
+      try {
+        channel.conn->Reconnect();
+      }
+      catch (std::exception const &e) {
+        this->Fail(channel, e.what());
+        continue;
+      }
+    }
+
+    this->QueueWrite(channel);
+    this->QueueRead(channel);
+  }
+}
+
+
+struct io_uring_sqe* UringDriver::NextSqe() {
+  struct io_uring_sqe *sqe = this->ring_->GetSqe();
+
+  if (sqe == nullptr) {
+    // Submission queue full: send what is there and reuse the slots.
+    this->ring_->Submit(0);
+    ++this->stats_.submits;
+
+    sqe = this->ring_->GetSqe();
+  }
+
+  if (sqe == nullptr) {
+    throw std::runtime_error("io_uring submission queue is full.");
+  }
+
+  return sqe;
+}
+
+
+void UringDriver::QueueWrite(Channel &channel) {
+  if (channel.writing || channel.written >= channel.output.size()) {
+    return;
+  }
+
+  size_t const length =
+    std::min(channel.output.size() - channel.written, this->buffer_size_);
+
+  std::memcpy(
+    channel.write_buffer.get(),
+    channel.output.data() + channel.written,
+    length
+  );
+
+  bool const fixed = this->fixed_ && channel.index < this->registered_;
+
+  PrepareReadWrite(
+    this->NextSqe(),
+    fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE,
+    channel.conn->context_->fd,
+    channel.write_buffer.get(),
+    length,
+    fixed ? static_cast<int>(2 * channel.index) : -1,
+    reinterpret_cast<uintptr_t>(&channel)
+  );
+
+  channel.writing = true;
+  ++this->in_flight_;
+}
+
+
+void UringDriver::QueueRead(Channel &channel) {
+  if (channel.reading || channel.handlers.empty()) {
+    return;
+  }
+
+  bool const fixed = this->fixed_ && channel.index < this->registered_;
+
+  PrepareReadWrite(
+    this->NextSqe(),
+    fixed ? IORING_OP_READ_FIXED : IORING_OP_READ,
+    channel.conn->context_->fd,
+    channel.read_buffer.get(),
+    this->buffer_size_,
+    fixed ? static_cast<int>(2 * channel.index + 1) : -1,
+    reinterpret_cast<uintptr_t>(&channel) | kReadTag
+  );
+
+  channel.reading = true;
+  ++this->in_flight_;
+}
+
+
+void UringDriver::Completed(uintptr_t const user_data, int const result) {
+  Channel &channel = *reinterpret_cast<Channel*>(user_data & ~kReadTag);
+  bool const read  = (user_data & kReadTag) != 0;
+
+  --this->in_flight_;
+
+  if (read) {
+    channel.reading = false;
+    ++this->stats_.reads;
+  }
+  else {
+    channel.writing = false;
+    ++this->stats_.writes;
+  }
+
+  if (channel.failed) {
+    this->Settle(channel);
+    return;
+  }
+
+  if (result <= 0) {
+    this->Fail(
+      channel,
+      (result == 0) ? "Connection closed by the server." : std::strerror(-result)
+    );
+
+    return;
+  }
+
+  if (!read) {
+    channel.written += static_cast<size_t>(result);
+
+    if (channel.written == channel.output.size()) {
+      channel.output.clear();
+      channel.written = 0;
+    }
+
+    return;
+  }
+
+  redisReader *reader = channel.conn->context_->reader;
+
+  if (redisReaderFeed(reader, channel.read_buffer.get(), result) != REDIS_OK) {
+    this->Fail(channel, reader->errstr);
+    return;
+  }
+
+  this->Deliver(channel);
+}
+
+
+void UringDriver::Deliver(Channel &channel) {
+  redisReader *reader = channel.conn->context_->reader;
+
+  while (!channel.failed) {
+    void *reply = nullptr;
+
+    if (redisReaderGetReply(reader, &reply) != REDIS_OK) {
+      this->Fail(channel, reader->errstr);
+      return;
+    }
+
+    if (reply == nullptr) {
+      return;
+    }
+
+    if (static_cast<redisReply*>(reply)->type == REDIS_REPLY_PUSH) {
+      Connection::PushFrame(channel.conn, reply);
+      continue;
+    }
+
+    ReplyPtr owned(static_cast<redisReply*>(reply));
+
+    if (channel.handlers.empty()) {
+      logging::Log<logging::Severity::kWarning>(
+        logging::Topic::kReply,
+        ShardedConnection::ShardId(*channel.conn),
+        ": reply without a command; dropped."
+      );
+
+      continue;
+    }
+
+    ReplyHandler handler = std::move(channel.handlers.front());
+    channel.handlers.pop_front();
+
+    ++this->stats_.replies;
+    ++this->delivered_;
+
+    if (!handler) {
+      continue;
+    }
+
+    try {
+      handler(std::move(owned));
+    }
+    catch (std::exception const &e) {
+      logging::Log<logging::Severity::kError>(
+        logging::Topic::kUsage,
+        "UringDriver reply callback threw: ", e.what()
+      );
+    }
+  }
+}
+
+
+void UringDriver::Fail(Channel &channel, char const *what) {
+  logging::Log<logging::Severity::kError>(
+    logging::Topic::kConnection,
+    ShardedConnection::ShardId(*channel.conn), ": ", what, " Failing ",
+    channel.handlers.size(), " outstanding reply(ies)."
+  );
+
+  channel.failed = true;
+  channel.output.clear();
+  channel.written = 0;
+
+  std::deque<ReplyHandler> handlers;
+  handlers.swap(channel.handlers);
+
+  this->stats_.failed += handlers.size();
+
+  for (auto &handler : handlers) {
+    if (handler) {
+      handler(nullptr);
+    }
+  }
+
+  this->Settle(channel);
+}
+
+
+void UringDriver::Settle(Channel &channel) noexcept {
+  if (channel.failed && !channel.writing && !channel.reading) {
+    // Whatever is left on the socket belongs to the failed commands.
+    channel.conn->Disconnect();
+    channel.failed = false;
+  }
+}
+
+
+void UringDriver::RegisterBuffers() {
+  if (this->registered_ == this->channels_.size()) {
+    return;
+  }
+
+  if (this->registered_ > 0 && this->fixed_) {
+    this->ring_->UnregisterBuffers();
+  }
+
+  // Buffer 2i is channel i's write buffer, 2i + 1 its read buffer.
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(2 * this->channels_.size());
+
+  for (auto const &channel : this->channels_) {
+    iovecs.push_back({channel->write_buffer.get(), this->buffer_size_});
+    iovecs.push_back({channel->read_buffer.get(),  this->buffer_size_});
+  }
+
+  int const result = this->ring_->RegisterBuffers(
+    iovecs.data(),
+    static_cast<unsigned>(iovecs.size())
+  );
+
+  this->fixed_      = (result == 0);
+  this->registered_ = this->channels_.size();
+
+  if (!this->fixed_) {
+    logging::Log<logging::Severity::kWarning>(
+      logging::Topic::kConnection,
+      "Registering io_uring buffers failed (", std::strerror(-result),
+      "); using unregistered buffers."
+    );
+  }
+}
+
+} // namespace rediswraps
@@ -1,7 +1,10 @@
 #include <rediswraps/utils.hh>
 
+#include <cstdio>     // snprintf() used in Sha1Hex()
 #include <cstdlib>    // strtol() used in Convert<bool>
 
+#include <boost/uuid/detail/sha1.hpp>
+
 #include <rediswraps/constants.hh>
 
 
@@ -56,6 +59,80 @@ std::string const ReadFile(std::string const &filepath) {
   buffer << input.rdbuf();
   return buffer.str();
 }
+
+
+std::string const Sha1Hex(std::string const &data) {
+  boost::uuids::detail::sha1 sha1;
+  boost::uuids::detail::sha1::digest_type digest;
+
+  sha1.process_bytes(data.data(), data.size());
+  sha1.get_digest(digest);
+
+  // Boost has changed the digest's element type over time (32-bit words,
+  //   later bytes), so print each element with as many digits as it holds.
+  constexpr int kDigitsPerElement = sizeof(digest[0]) * 2;
+
+  std::string hex;
+  char element_hex[kDigitsPerElement + 1];
+
+  for (auto const element : digest) {
+    std::snprintf(
+      element_hex,
+      sizeof(element_hex),
+      "%0*lx",
+      kDigitsPerElement,
+      static_cast<unsigned long>(element)
+    );
+
+    hex += element_hex;
+  }
+
+  return hex;
+}
+
+
+std::unordered_map<std::string, std::string> ParseInfo(
+    std::string const &info
+) {
+  std::unordered_map<std::string, std::string> fields;
+  std::istringstream lines(info);
+
+  for (std::string line; std::getline(lines, line); ) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    auto const colon = line.find(':');
+
+    if (colon != std::string::npos) {
+      fields[line.substr(0, colon)] = line.substr(colon + 1);
+    }
+  }
+
+  return fields;
+}
+
+
+std::string const SameSlotKey(
+    std::string const &key,
+    std::string const &suffix
+) {
+  // A hash tag is a "{...}" that isn't empty; Redis Cluster hashes only
+  //   what is inside it.
+  size_t const open  = key.find('{');
+  size_t const close =
+    (open == std::string::npos) ? std::string::npos : key.find('}', open + 1);
+
+  if (close != std::string::npos && close > open + 1) {
+    return key + suffix;
+  }
+
+  return "{" + key + "}" + suffix;
+}
 } // namespace utils
 } // namespace rediswraps
 
@@ -0,0 +1,168 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Checks Bitmap against BITOP, BITCOUNT and BITPOS on a local Redis, with
+//   and without AVX2 and split over several threads:
+//
+//   rrtest_bitmap [port]
+//
+namespace {
+
+std::string const kFirst  = "bitmap:first";
+std::string const kSecond = "bitmap:second";
+std::string const kServer = "bitmap:server";
+std::string const kClient = "bitmap:client";
+
+// Runs of zeros, of ones and of noise, so that searches have to skip some.
+std::string const Value(size_t const size, unsigned const seed) {
+  std::string value(size, '\0');
+
+  for (size_t i = 0; i < size; ++i) {
+    switch ((i / 1000 + seed) % 3) {
+      case 0:  value[i] = '\0'; break;
+      case 1:  value[i] = '\xff'; break;
+      default: value[i] = static_cast<char>((i * 2654435761u + seed) >> 24);
+    }
+  }
+
+  return value;
+}
+
+
+void Check(Connection &redis, BitmapOptions const &options) {
+  Bitmap first(options);
+  Bitmap second(options);
+
+  BOOST_VERIFY(first.Load(redis, kFirst));
+  BOOST_VERIFY(second.Load(redis, kSecond));
+
+  int64_t const count = redis.Cmd("BITCOUNT", kFirst);
+  BOOST_VERIFY(first.Count() == static_cast<uint64_t>(count));
+
+  int64_t const ranges[][2] = {
+    {0, -1}, {10, 20}, {-100, -1}, {-1, -100}, {2500, 1000000}, {999, 1000}
+  };
+
+  for (auto const &range : ranges) {
+    int64_t const start = range[0];
+    int64_t const end   = range[1];
+
+    int64_t const server_count = redis.Cmd("BITCOUNT", kFirst, start, end);
+    BOOST_VERIFY(first.Count(start, end) == static_cast<uint64_t>(server_count));
+
+    for (int const bit : {0, 1}) {
+      int64_t const from = redis.Cmd("BITPOS", kFirst, bit, start);
+      BOOST_VERIFY(first.Position(bit, start) == from);
+
+      int64_t const within = redis.Cmd("BITPOS", kFirst, bit, start, end);
+      BOOST_VERIFY(first.Position(bit, start, end) == within);
+    }
+  }
+
+  // Bit ranges, against GETBIT's view of the same bits.
+  uint64_t ones = 0;
+
+  for (uint64_t offset = 8003; offset <= 8100; ++offset) {
+    ones += first.Get(offset);
+  }
+
+  BOOST_VERIFY(first.Count(8003, 8100, BitUnit::kBit) == ones);
+
+  int64_t const one = redis.Cmd("GETBIT", kFirst, 8003);
+  BOOST_VERIFY(first.Get(8003) == (one == 1));
+
+  // Whole bitmaps, in both orders so that either operand is the shorter.
+  char const *const ops[] = {"AND", "OR", "XOR"};
+
+  for (BitOp const op : {BitOp::kAnd, BitOp::kOr, BitOp::kXor}) {
+    char const *const name = ops[static_cast<int>(op)];
+
+    redis.Cmd("BITOP", name, kServer, kFirst, kSecond);
+    Bitmap(first).Apply(op, second).Store(redis, kClient);
+
+    std::string const server = redis.Cmd("GET", kServer);
+    std::string const client = redis.Cmd("GET", kClient);
+    BOOST_VERIFY(server == client);
+
+    redis.Cmd("BITOP", name, kServer, kSecond, kFirst);
+    Bitmap(second).Apply(op, first).Store(redis, kClient);
+
+    std::string const swapped_server = redis.Cmd("GET", kServer);
+    std::string const swapped_client = redis.Cmd("GET", kClient);
+    BOOST_VERIFY(swapped_server == swapped_client);
+  }
+
+  redis.Cmd("BITOP", "NOT", kServer, kFirst);
+  Bitmap(first).Not().Store(redis, kClient);
+
+  std::string const server = redis.Cmd("GET", kServer);
+  std::string const client = redis.Cmd("GET", kClient);
+  BOOST_VERIFY(server == client);
+
+  redis.Cmd("DEL", kServer, kClient);
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("SET", kFirst, Value(10000, 0));
+    redis.Cmd("SET", kSecond, Value(7777, 1));
+
+    // A missing key is an empty bitmap, and storing one deletes the key.
+    Bitmap missing;
+    BOOST_VERIFY(missing.Load(redis, "bitmap:missing"));
+    BOOST_VERIFY(missing.size() == 0);
+    BOOST_VERIFY(missing.Position(false) == 0);
+    BOOST_VERIFY(missing.Position(true) == -1);
+
+    BitmapOptions portable;
+    portable.simd    = false;
+    portable.threads = 1;
+
+    BitmapOptions split;
+    split.threads              = 4;
+    split.min_bytes_per_thread = 64;
+    split.transfer.chunk_size  = 1000;
+
+    Check(redis, BitmapOptions());
+    Check(redis, portable);
+    Check(redis, split);
+
+    BOOST_VERIFY(missing.Store(redis, kFirst));
+    redis.Cmd("DEL", kSecond);
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Bitmap tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Uploads and downloads chunked values against a local Redis:
+//
+//   rrtest_blob [port]
+//
+namespace {
+
+constexpr size_t kChunk = 4 * 1024;
+
+// Keys matching "pattern", with a single SCAN sweep.
+std::vector<std::string> Keys(Connection &conn, std::string const &pattern) {
+  std::vector<std::string> keys;
+  std::string cursor = "0";
+
+  do {
+    ReplyPtr const reply =
+      conn.RawCmd("SCAN", cursor, "MATCH", pattern, "COUNT", 1000);
+
+    BOOST_VERIFY(reply && reply->type == REDIS_REPLY_ARRAY);
+    cursor.assign(reply->element[0]->str, reply->element[0]->len);
+
+    redisReply const *const batch = reply->element[1];
+
+    for (size_t i = 0; i < batch->elements; ++i) {
+      keys.emplace_back(batch->element[i]->str, batch->element[i]->len);
+    }
+  } while (cursor != "0");
+
+  return keys;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    BlobOptions options;
+    options.chunk_size = kChunk;
+    options.window     = 4;
+
+    // A value of many chunks, the last one partial, there and back.
+    std::string value;
+
+    for (size_t i = 0; value.size() < 20 * kChunk + 100; ++i) {
+      value += std::to_string(i) + ",";
+    }
+
+    {
+      BlobTransfer blobs(redis, options);
+
+      BOOST_VERIFY(blobs.Upload("blob:value", value.data(), value.size()));
+      BOOST_VERIFY(blobs.stats().bytes == value.size());
+      BOOST_VERIFY(blobs.Size("blob:value") == value.size());
+
+      std::vector<char> buffer(value.size());
+      size_t size = 0;
+
+      BOOST_VERIFY(
+        blobs.Download("blob:value", buffer.data(), buffer.size(), size)
+      );
+      BOOST_VERIFY(std::string(buffer.data(), size) == value);
+
+      // Too small a buffer fails, with the size still set.
+      BOOST_VERIFY(!blobs.Download("blob:value", buffer.data(), 10, size));
+      BOOST_VERIFY(size == value.size());
+
+      // The temporary key's TTL didn't follow it to the final one.
+      int64_t const ttl = redis.Cmd("PTTL", "blob:value");
+      BOOST_VERIFY(ttl == -1);
+
+      BOOST_VERIFY(blobs.Upload("blob:empty", "", 0));
+      BOOST_VERIFY(blobs.Size("blob:empty") == 0);
+
+      int64_t const exists = redis.Cmd("EXISTS", "blob:empty");
+      BOOST_VERIFY(exists == 1);
+    }
+
+    // Concurrent uploads of one key each go to a temporary key of their own,
+    //   so the key ends up holding one of them whole, never a mix.
+    {
+      std::vector<std::string> values;
+
+      for (char const fill : {'a', 'b', 'c', 'd'}) {
+        values.emplace_back(32 * kChunk, fill);
+      }
+
+      for (int round = 0; round < 5; ++round) {
+        std::vector<std::thread> threads;
+
+        for (auto const &upload : values) {
+          threads.emplace_back([&upload, &options, port]() {
+            Connection conn(constants::kDefaultHost, port);
+            BlobTransfer blobs(conn, options);
+
+            BOOST_VERIFY(
+              blobs.Upload("blob:shared", upload.data(), upload.size())
+            );
+          });
+        }
+
+        for (auto &thread : threads) {
+          thread.join();
+        }
+
+        std::string const shared = redis.Cmd("GET", "blob:shared");
+        BOOST_VERIFY(shared.size() == 32 * kChunk);
+        BOOST_VERIFY(
+          shared.find_first_not_of(shared[0]) == std::string::npos
+        );
+      }
+
+      BOOST_VERIFY(Keys(redis, "*uploading*").empty());
+    }
+
+    // An upload cut off halfway leaves its temporary key behind, but only
+    //   until it expires.
+    {
+      BlobOptions expiring = options;
+      expiring.window     = 1;
+      expiring.upload_ttl = std::chrono::milliseconds(500);
+
+      std::string const large(16 * 1024 * 1024, 'x');
+      bool uploaded = true;
+
+      std::thread upload([&]() {
+        Connection conn(constants::kDefaultHost, port);
+        BlobTransfer blobs(conn, expiring);
+
+        uploaded = blobs.Upload("blob:abandoned", large.data(), large.size());
+      });
+
+      std::vector<std::string> temporary;
+
+      while (temporary.empty()) {
+        temporary = Keys(redis, "{blob:abandoned}.uploading.*");
+      }
+
+      int64_t const ttl = redis.Cmd("PTTL", temporary[0]);
+      BOOST_VERIFY(ttl > 0 && ttl <= 500);
+
+      redis.Cmd("CLIENT", "KILL", "TYPE", "normal", "SKIPME", "yes");
+      upload.join();
+
+      BOOST_VERIFY(!uploaded);
+
+      int64_t const exists = redis.Cmd("EXISTS", "blob:abandoned");
+      BOOST_VERIFY(exists == 0);
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(700));
+      BOOST_VERIFY(Keys(redis, "*uploading*").empty());
+    }
+
+    redis.Cmd("DEL", "blob:value", "blob:empty", "blob:shared");
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "BlobTransfer tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
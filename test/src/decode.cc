@@ -0,0 +1,187 @@
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Decodes replies straight into STL containers against a local Redis:
+//
+//   rrtest_decode [port]
+//
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("RPUSH", "decode:list", "a", "b", "c");
+    redis.Cmd("RPUSH", "decode:numbers", 3, -1, 42);
+    redis.Cmd("SADD", "decode:set", "x", "y", "z");
+    redis.Cmd("HSET", "decode:hash", "one", 1, "two", 2);
+    redis.Cmd("ZADD", "decode:zset", 1.5, "low", 2.5, "high");
+    redis.Cmd("SET", "decode:string", "hello");
+
+    // Sequences, in order.
+    std::vector<std::string> list;
+    BOOST_VERIFY(redis.Cmd(list, "LRANGE", "decode:list", 0, -1));
+    BOOST_VERIFY((list == std::vector<std::string>{"a", "b", "c"}));
+
+    std::vector<int> numbers;
+    BOOST_VERIFY(redis.Cmd(numbers, "LRANGE", "decode:numbers", 0, -1));
+    BOOST_VERIFY((numbers == std::vector<int>{3, -1, 42}));
+
+    // Containers are cleared first.
+    BOOST_VERIFY(redis.Cmd(list, "LRANGE", "decode:list", 0, 0));
+    BOOST_VERIFY(list.size() == 1 && list[0] == "a");
+
+    // Sets.
+    std::set<std::string> ordered;
+    BOOST_VERIFY(redis.Cmd(ordered, "SMEMBERS", "decode:set"));
+    BOOST_VERIFY((ordered == std::set<std::string>{"x", "y", "z"}));
+
+    std::unordered_set<std::string> unordered;
+    BOOST_VERIFY(redis.Cmd(unordered, "SMEMBERS", "decode:set"));
+    BOOST_VERIFY(unordered.size() == 3 && unordered.count("y"));
+
+    // Maps, from field/value pairs.
+    std::map<std::string, int> hash;
+    BOOST_VERIFY(redis.Cmd(hash, "HGETALL", "decode:hash"));
+    BOOST_VERIFY(hash.size() == 2 && hash["one"] == 1 && hash["two"] == 2);
+
+    std::unordered_map<std::string, long> unordered_hash;
+    BOOST_VERIFY(redis.Cmd(unordered_hash, "HGETALL", "decode:hash"));
+    BOOST_VERIFY(unordered_hash.size() == 2 && unordered_hash["two"] == 2);
+
+    // Pairs, in order.
+    std::vector<std::pair<std::string, double>> scores;
+    BOOST_VERIFY(
+      redis.Cmd(scores, "ZRANGE", "decode:zset", 0, -1, "WITHSCORES")
+    );
+    BOOST_VERIFY(scores.size() == 2);
+    BOOST_VERIFY(scores[0].first == "low"  && scores[0].second == 1.5);
+    BOOST_VERIFY(scores[1].first == "high" && scores[1].second == 2.5);
+
+    // Optional elements: nil for missing keys.
+    std::vector<boost::optional<std::string>> values;
+    BOOST_VERIFY(
+      redis.Cmd(values, "MGET", "decode:string", "decode:missing")
+    );
+    BOOST_VERIFY(values.size() == 2);
+    BOOST_VERIFY(values[0] && *values[0] == "hello");
+    BOOST_VERIFY(!values[1]);
+
+    std::vector<boost::optional<int>> fields;
+    BOOST_VERIFY(
+      redis.Cmd(fields, "HMGET", "decode:hash", "two", "three", "one")
+    );
+    BOOST_VERIFY(fields.size() == 3);
+    BOOST_VERIFY(fields[0] && *fields[0] == 2);
+    BOOST_VERIFY(!fields[1]);
+    BOOST_VERIFY(fields[2] && *fields[2] == 1);
+
+    // Scalars, through reply::Decode() directly.
+    boost::optional<std::string> missing = std::string("stale");
+    BOOST_VERIFY(
+      reply::Decode(redis.RawCmd("GET", "decode:missing").get(), missing)
+    );
+    BOOST_VERIFY(!missing);
+
+    int64_t length = 0;
+    BOOST_VERIFY(
+      reply::Decode(redis.RawCmd("LLEN", "decode:list").get(), length)
+    );
+    BOOST_VERIFY(length == 3);
+
+    // Replies that don't fit.
+    BOOST_VERIFY(!redis.Cmd(list, "GET", "decode:string"));      // scalar
+    BOOST_VERIFY(!redis.Cmd(list, "LRANGE", "decode:hash", 0, -1));  // error
+    BOOST_VERIFY(!redis.Cmd(hash, "LRANGE", "decode:list", 0, -1));  // odd
+    BOOST_VERIFY(!redis.Cmd(numbers, "LRANGE", "decode:list", 0, -1));
+
+    // RESP3 sends pairs as maps (HGETALL) or as two-element arrays (ZRANGE
+    //   WITHSCORES); both decode like the flat RESP2 replies above.
+    Connection resp3(constants::kDefaultHost, port, "", 3);
+    BOOST_VERIFY(resp3.protocol() == 3);
+
+    ReplyPtr const zrange =
+      resp3.RawCmd("ZRANGE", "decode:zset", 0, -1, "WITHSCORES");
+    BOOST_VERIFY(zrange && zrange->type == REDIS_REPLY_ARRAY);
+    BOOST_VERIFY(zrange->elements == 2);
+    BOOST_VERIFY(zrange->element[0]->type == REDIS_REPLY_ARRAY);
+
+    ReplyPtr const hgetall = resp3.RawCmd("HGETALL", "decode:hash");
+    BOOST_VERIFY(hgetall && hgetall->type == REDIS_REPLY_MAP);
+
+    scores.clear();
+    BOOST_VERIFY(reply::Decode(zrange.get(), scores));
+    BOOST_VERIFY(scores.size() == 2);
+    BOOST_VERIFY(scores[0].first == "low"  && scores[0].second == 1.5);
+    BOOST_VERIFY(scores[1].first == "high" && scores[1].second == 2.5);
+
+    std::map<std::string, double> score_map;
+    BOOST_VERIFY(
+      resp3.Cmd(score_map, "ZRANGE", "decode:zset", 0, -1, "WITHSCORES")
+    );
+    BOOST_VERIFY(score_map.size() == 2 && score_map["high"] == 2.5);
+
+    std::unordered_map<std::string, double> unordered_scores;
+    BOOST_VERIFY(
+      resp3.Cmd(unordered_scores, "ZRANGE", "decode:zset", 0, -1, "WITHSCORES")
+    );
+    BOOST_VERIFY(unordered_scores.size() == 2 && unordered_scores["low"] == 1.5);
+
+    hash.clear();
+    BOOST_VERIFY(resp3.Cmd(hash, "HGETALL", "decode:hash"));
+    BOOST_VERIFY(hash.size() == 2 && hash["one"] == 1 && hash["two"] == 2);
+
+    std::vector<std::pair<std::string, int>> fields_in_order;
+    BOOST_VERIFY(resp3.Cmd(fields_in_order, "HGETALL", "decode:hash"));
+    BOOST_VERIFY(fields_in_order.size() == 2);
+
+    // Sets arrive as RESP3 sets.
+    ordered.clear();
+    BOOST_VERIFY(resp3.Cmd(ordered, "SMEMBERS", "decode:set"));
+    BOOST_VERIFY((ordered == std::set<std::string>{"x", "y", "z"}));
+
+    BOOST_VERIFY(!resp3.Cmd(hash, "LRANGE", "decode:list", 0, -1));  // odd
+
+    redis.Cmd(
+      "DEL",
+      "decode:list", "decode:numbers", "decode:set",
+      "decode:hash", "decode:zset", "decode:string"
+    );
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Decode tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Fire-and-forget commands (CMD_VOID, CMD_CLEAR) against a local Redis:
+//
+//   rrtest_discard [port]
+//
+namespace {
+
+// Waits up to a second for "done" to hold.
+template<typename Condition>
+bool const Eventually(Condition const &done) {
+  auto const deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+  while (!done()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+
+    Connection redis(constants::kDefaultHost, port);
+    Connection observer(constants::kDefaultHost, port);
+
+    int64_t const size_before = observer.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    // A lone command goes out without anything else coming after it.
+    std::string const queued = redis.Cmd<CMD_VOID>("SET", "discard:lone", 1);
+    BOOST_VERIFY(queued == constants::kQueued);
+
+    BOOST_VERIFY(Eventually([&]() {
+      int64_t const exists = observer.Cmd("EXISTS", "discard:lone");
+      return exists == 1;
+    }));
+
+    // So does the CLIENT SETNAME of a named RESP2 connection.
+    Connection named(constants::kDefaultHost, port, "rrtest-discard", 2);
+
+    BOOST_VERIFY(Eventually([&]() {
+      std::string const clients = observer.Cmd("CLIENT", "LIST");
+      return clients.find("name=rrtest-discard") != std::string::npos;
+    }));
+
+    // A burst: every reply is read back and counted, without a round trip
+    //   per command.
+    for (int i = 0; i < 1000; ++i) {
+      redis.Cmd<CMD_VOID>("INCR", "discard:counter");
+    }
+
+    BOOST_VERIFY(redis.FlushDiscarded());
+    BOOST_VERIFY(redis.discard_stats().sent == 1001);
+    BOOST_VERIFY(redis.discard_stats().replied == 1001);
+    BOOST_VERIFY(redis.discard_stats().errors == 0);
+
+    int64_t const counter = observer.Cmd("GET", "discard:counter");
+    BOOST_VERIFY(counter == 1000);
+
+    // Errors are counted once their replies are read.
+    redis.Cmd<CMD_CLEAR>("LPUSH", "discard:lone", "x");
+
+    int64_t const lone = redis.Cmd("GET", "discard:lone");
+    BOOST_VERIFY(lone == 1);
+
+    BOOST_VERIFY(redis.discard_stats().errors == 1);
+    BOOST_VERIFY(
+      redis.discard_stats().last_error.compare(0, 9, "WRONGTYPE") == 0
+    );
+    BOOST_VERIFY(redis.FlushDiscarded());
+
+    redis.Cmd("DEL", "discard:lone", "discard:counter");
+
+    int64_t const size_after = observer.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Discard tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Hedges late reads within the budget, against a local Redis:
+//
+//   rrtest_hedge [port]
+//
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kWindow = 20;
+
+// Holds up the next command on "conn" for 50ms, and only on "conn": a
+//   discarded BLPOP that times out goes out ahead of it.
+void Stall(Connection &conn) {
+  conn.Cmd<CMD_VOID>("BLPOP", "hedge:nothing", "0.05");
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("SET", "hedge:key", "value");
+
+    Connection first(constants::kDefaultHost, port);
+    Connection second(constants::kDefaultHost, port);
+
+    // One hedge saved up at most, a quarter of one earned per request.
+    HedgeOptions options;
+    options.min_delay = std::chrono::milliseconds(2);
+    options.budget    = 0.25;
+    options.burst     = 1;
+    options.window    = kWindow;
+
+    HedgedReads hedged(options);
+
+    // Nothing is hedged before the first window is in, however late.
+    Stall(first);
+    std::string const early = hedged.Cmd(first, second, "GET", "hedge:key");
+    BOOST_VERIFY(early == "value");
+    BOOST_VERIFY(hedged.stats().hedged == 0);
+    BOOST_VERIFY(hedged.stats().delay.count() == 0);
+
+    for (size_t i = 1; i < kWindow; ++i) {
+      hedged.Cmd(first, second, "GET", "hedge:key");
+    }
+
+    // The stalled request is the window's slowest, so the 95th percentile
+    //   falls below it, on fast local replies: min_delay it is.
+    HedgeStats stats = hedged.stats();
+    BOOST_VERIFY(stats.requests == kWindow);
+    BOOST_VERIFY(stats.delay == options.min_delay);
+
+    // A late reply is hedged, and the second connection wins...
+    Stall(first);
+
+    Clock::time_point const start = Clock::now();
+    std::string const won = hedged.Cmd(first, second, "GET", "hedge:key");
+    Clock::duration const took = Clock::now() - start;
+
+    BOOST_VERIFY(won == "value");
+    BOOST_VERIFY(took < std::chrono::milliseconds(40));
+
+    stats = hedged.stats();
+    BOOST_VERIFY(stats.hedged == 1 && stats.hedge_wins == 1);
+    BOOST_VERIFY(stats.over_budget == 0);
+
+    // ...in the first connection's queue, whose own late reply is dropped
+    //   before its next command.
+    BOOST_VERIFY(first.NumResponses() > 0);
+    first.Flush();
+
+    std::string const after = first.Cmd("GET", "hedge:key");
+    BOOST_VERIFY(after == "value");
+    BOOST_VERIFY(first.NumResponses() == 1);
+    first.Flush();
+
+    // With the budget spent, the next late one waits it out.
+    Stall(first);
+    std::string const waited = hedged.Cmd(first, second, "GET", "hedge:key");
+    BOOST_VERIFY(waited == "value");
+
+    stats = hedged.stats();
+    BOOST_VERIFY(stats.hedged == 1 && stats.hedge_wins == 1);
+    BOOST_VERIFY(stats.over_budget == 1);
+
+    // Three more requests earn the hedge back.
+    for (int i = 0; i < 3; ++i) {
+      hedged.Cmd(first, second, "GET", "hedge:key");
+    }
+
+    Stall(first);
+    std::string const again = hedged.Cmd(first, second, "GET", "hedge:key");
+    BOOST_VERIFY(again == "value");
+
+    stats = hedged.stats();
+    BOOST_VERIFY(stats.hedged == 2 && stats.hedge_wins == 2);
+    BOOST_VERIFY(stats.over_budget == 1);
+
+    // Replies that are on time are never hedged.
+    hedged.Cmd(first, second, "GET", "hedge:key");
+    BOOST_VERIFY(hedged.stats().hedged == 2);
+
+    // Writes go to the first connection only.
+    hedged.Cmd(first, second, "SET", "hedge:key", "other");
+    BOOST_VERIFY(hedged.stats().bypassed == 1);
+    BOOST_VERIFY(hedged.stats().requests == kWindow + 7);
+
+    first.Flush();
+    second.Flush();
+    second.FlushDiscarded();
+
+    std::string const written = second.Cmd("GET", "hedge:key");
+    BOOST_VERIFY(written == "other");
+
+    redis.Cmd("DEL", "hedge:key");
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "HedgedReads tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// LatencyHistogram buckets, percentiles and coordinated omission
+//   corrections; no Redis needed:
+//
+//   rrtest_histogram
+//
+namespace {
+
+constexpr unsigned kBits  = constants::kHistogramSubBucketBits;
+constexpr uint64_t kExact = uint64_t(1) << kBits;
+
+// Checks that "value" falls in its own bucket, and that the bucket is no
+//   wider than the promised relative error.
+void VerifyBucket(uint64_t const value) {
+  size_t const index = LatencyHistogram::Index(value);
+
+  uint64_t const lowest  = LatencyHistogram::Lowest(index);
+  uint64_t const highest = LatencyHistogram::Highest(index);
+
+  BOOST_VERIFY(lowest <= value && value <= highest);
+  BOOST_VERIFY((highest - lowest) <= (lowest >> (kBits - 1)));
+}
+
+} // namespace
+
+
+int main() {
+  // Below the log-linear range, every value has a bucket of its own.
+  for (uint64_t value = 0; value < kExact; ++value) {
+    size_t const index = LatencyHistogram::Index(value);
+
+    BOOST_VERIFY(index == value);
+    BOOST_VERIFY(LatencyHistogram::Lowest(index) == value);
+    BOOST_VERIFY(LatencyHistogram::Highest(index) == value);
+  }
+
+  // Each power of 2 starts a new bucket, twice as wide as the one below.
+  for (unsigned bits = kBits; bits < 64; ++bits) {
+    uint64_t const power = uint64_t(1) << bits;
+
+    size_t const index = LatencyHistogram::Index(power);
+    BOOST_VERIFY(LatencyHistogram::Index(power - 1) + 1 == index);
+
+    BOOST_VERIFY(LatencyHistogram::Lowest(index) == power);
+    BOOST_VERIFY(LatencyHistogram::Highest(index - 1) == power - 1);
+
+    uint64_t const width = uint64_t(1) << (bits - kBits + 1);
+    BOOST_VERIFY(LatencyHistogram::Highest(index) == power + width - 1);
+
+    uint64_t const below = LatencyHistogram::Highest(index - 1) -
+      LatencyHistogram::Lowest(index - 1) + 1;
+    BOOST_VERIFY(below == ((bits == kBits) ? 1 : width / 2));
+
+    VerifyBucket(power - 1);
+    VerifyBucket(power);
+    VerifyBucket(power + 1);
+  }
+
+  // Everything in between, sampled.
+  for (uint64_t value = kExact; value < (uint64_t(1) << 62); value += value / 7 + 1) {
+    VerifyBucket(value);
+  }
+
+  uint64_t const largest = std::numeric_limits<uint64_t>::max();
+  BOOST_VERIFY(
+    LatencyHistogram::Highest(LatencyHistogram::Index(largest)) == largest
+  );
+
+  // Percentiles on exact values.
+  {
+    LatencyHistogram histogram;
+    BOOST_VERIFY(histogram.Percentile(50.0) == 0);
+    BOOST_VERIFY(histogram.min() == 0 && histogram.max() == 0);
+
+    for (uint64_t value = 1; value <= 100; ++value) {
+      histogram.Record(value);
+    }
+
+    BOOST_VERIFY(histogram.count() == 100);
+    BOOST_VERIFY(histogram.min() == 1 && histogram.max() == 100);
+    BOOST_VERIFY(histogram.mean() == 50.5);
+
+    BOOST_VERIFY(histogram.Percentile(0.0)   == 1);
+    BOOST_VERIFY(histogram.Percentile(50.0)  == 50);
+    BOOST_VERIFY(histogram.Percentile(99.0)  == 99);
+    BOOST_VERIFY(histogram.Percentile(100.0) == 100);
+    BOOST_VERIFY(histogram.Percentile(150.0) == 100);
+  }
+
+  // Percentiles on bucketed values: the top of the bucket, capped at the
+  //   largest value recorded.
+  {
+    LatencyHistogram histogram;
+
+    histogram.Record(1000, 50);
+    histogram.Record(2000, 49);
+    histogram.Record(1000000);
+
+    uint64_t const p50 = histogram.Percentile(50.0);
+    uint64_t const p99 = histogram.Percentile(99.0);
+
+    BOOST_VERIFY(
+      p50 == LatencyHistogram::Highest(LatencyHistogram::Index(1000))
+    );
+    BOOST_VERIFY(
+      p99 == LatencyHistogram::Highest(LatencyHistogram::Index(2000))
+    );
+    BOOST_VERIFY(p50 >= 1000 && p50 - 1000 <= 1000 >> (kBits - 1));
+    BOOST_VERIFY(histogram.Percentile(0.0)   == p50);
+    BOOST_VERIFY(histogram.Percentile(100.0) == 1000000);
+  }
+
+  // A late value brings along the ones that would have queued behind it.
+  {
+    LatencyHistogram corrected;
+    corrected.RecordCorrected(1000, 100);
+
+    BOOST_VERIFY(corrected.count() == 10);
+    BOOST_VERIFY(corrected.min() == 100 && corrected.max() == 1000);
+    BOOST_VERIFY(corrected.mean() == 550.0);
+
+    LatencyHistogram expected;
+
+    for (uint64_t value = 100; value <= 1000; value += 100) {
+      expected.Record(value);
+    }
+
+    for (double percentile = 0.0; percentile <= 100.0; percentile += 5.0) {
+      BOOST_VERIFY(
+        corrected.Percentile(percentile) == expected.Percentile(percentile)
+      );
+    }
+
+    // Nothing is made up for values on time, or without an interval.
+    corrected.Clear();
+    corrected.RecordCorrected(100, 100);
+    corrected.RecordCorrected(50, 100);
+    corrected.RecordCorrected(5000, 0);
+
+    BOOST_VERIFY(corrected.count() == 3);
+  }
+
+  // Correcting when adding up is the same, give or take bucket rounding.
+  {
+    LatencyHistogram raw;
+    raw.Record(10, 3);
+    raw.Record(1000);
+
+    LatencyHistogram corrected;
+    corrected.AddCorrected(raw, 100);
+
+    BOOST_VERIFY(corrected.count() == 3 + 10);
+    BOOST_VERIFY(corrected.min() == 10 && corrected.max() == 1000);
+    BOOST_VERIFY(corrected.Percentile(20.0) == 10);
+    BOOST_VERIFY(corrected.Percentile(30.0) == 100);
+    BOOST_VERIFY(corrected.Percentile(100.0) == 1000);
+
+    LatencyHistogram plain;
+    plain.AddCorrected(raw, 0);
+    plain.Add(raw);
+
+    BOOST_VERIFY(plain.count() == 2 * raw.count());
+    BOOST_VERIFY(plain.Percentile(50.0) == raw.Percentile(50.0));
+  }
+
+  std::cout << "LatencyHistogram tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
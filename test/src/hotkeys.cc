@@ -0,0 +1,171 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Samples hot keys against a local Redis:
+//
+//   rrtest_hotkeys [port]
+//
+namespace {
+
+// How many times "conn"'s server ran "command", per INFO commandstats.
+int64_t const Calls(Connection &conn, std::string const &command) {
+  ReplyPtr reply = conn.RawCmd("INFO", "commandstats");
+
+  BOOST_VERIFY(
+    reply &&
+    (reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_VERB)
+  );
+
+  auto const fields = utils::ParseInfo(std::string(reply->str, reply->len));
+  auto const stats = fields.find("cmdstat_" + command);
+
+  if (stats == fields.end()) {
+    return 0;
+  }
+
+  auto const calls = introspect::ParseInfoValue(stats->second).find("calls");
+  return std::atoll(calls->second.c_str());
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    HotKeyOptions options;
+    options.sample_every = 1;
+
+    auto hot_keys = std::make_shared<HotKeys>(options);
+
+    // One COMMAND fills the key positions, for every connection sharing
+    //   the sketch.
+    int64_t const commands_before = Calls(redis, "command");
+
+    redis.SampleHotKeys(hot_keys);
+
+    Connection other(constants::kDefaultHost, port);
+    other.SampleHotKeys(hot_keys);
+
+    int64_t const commands_learned = Calls(redis, "command");
+    BOOST_VERIFY(commands_learned == commands_before + 1);
+
+    redis.Cmd("SET", "hotkeys:a", 1);
+
+    for (int i = 0; i < 50; ++i) {
+      redis.Cmd<CMD_VOID>("GET", "hotkeys:a");
+      other.Cmd<CMD_VOID>("GET", "hotkeys:a");
+    }
+
+    for (int i = 0; i < 5; ++i) {
+      redis.Cmd<CMD_VOID>("GET", "hotkeys:b");
+    }
+
+    // Every key of multi-key commands, keycount keys of scripts.
+    redis.Cmd<CMD_VOID>("MGET", "hotkeys:a", "hotkeys:c");
+    redis.Cmd<CMD_VOID>("EVAL", "return 1", 1, "hotkeys:script", "notakey");
+
+    // Commands seen for the first time inside MULTI are sampled without a
+    //   round trip of their own, so EXEC answers exactly what was queued.
+    redis.Cmd("MULTI");
+    redis.Cmd<CMD_VOID>("INCRBY", "hotkeys:counter", 2);
+    redis.Cmd<CMD_VOID>("HINCRBY", "hotkeys:hash", "field", 3);
+    redis.Flush();
+
+    ReplyPtr const exec = redis.RawCmd("EXEC");
+    BOOST_VERIFY(exec && exec->type == REDIS_REPLY_ARRAY);
+    BOOST_VERIFY(exec->elements == 2);
+    BOOST_VERIFY(exec->element[0]->integer == 2);
+    BOOST_VERIFY(exec->element[1]->integer == 3);
+
+    // Pipelines are sampled like everything else the connection sends.
+    Pipeline pipe(redis);
+    pipe
+      .Add("GET", "hotkeys:piped")
+      .AddArgv({"GET", "hotkeys:piped"})
+      .Add(redis.Prepare("GET", CMD_PLACEHOLDER), "hotkeys:piped");
+    pipe.Execute();
+
+    redis.FlushDiscarded();
+    other.FlushDiscarded();
+
+    // Sampling never asked the server anything.
+    BOOST_VERIFY(Calls(redis, "command") == commands_learned);
+
+    auto const top = hot_keys->Top();
+    BOOST_VERIFY(!top.empty() && top[0].key == "hotkeys:a");
+    BOOST_VERIFY(top[0].per_second > 0.0);
+
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:a") >= 102);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:b") >= 5);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:c") >= 1);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:script") >= 1);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:counter") >= 1);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:hash") >= 1);
+    BOOST_VERIFY(hot_keys->Estimate("hotkeys:piped") >= 3);
+
+    hot_keys->Clear();
+    BOOST_VERIFY(hot_keys->Top().empty());
+
+    // Each instance samples its own share of what it is fed, even when
+    //   another one on the same thread is fed in between.
+    {
+      HotKeyOptions halved;
+      halved.sample_every = 2;
+
+      HotKeys first(halved);
+      HotKeys second(halved);
+
+      BOOST_VERIFY(first.Learn(redis) && second.Learn(redis));
+
+      std::string const argv[] = {"GET", "hotkeys:shared"};
+
+      for (int i = 0; i < 10; ++i) {
+        first.Sample(argv, 2);
+        second.Sample(argv, 2);
+      }
+
+      BOOST_VERIFY(first.Estimate("hotkeys:shared") == 5);
+      BOOST_VERIFY(second.Estimate("hotkeys:shared") == 5);
+    }
+
+    redis.SampleHotKeys(nullptr);
+    other.SampleHotKeys(nullptr);
+
+    redis.Cmd(
+      "DEL", "hotkeys:a", "hotkeys:counter", "hotkeys:hash"
+    );
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "HotKeys tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
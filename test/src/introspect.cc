@@ -0,0 +1,215 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// The introspect parsers and SlowlogCursor, on replies captured from Redis
+//   6.2 in both protocol versions; no Redis needed:
+//
+//   rrtest_introspect
+//
+namespace {
+
+// Reads one reply out of canned RESP bytes, the way a connection would.
+ReplyPtr Canned(std::string const &resp) {
+  redisReader *reader = redisReaderCreate();
+  void *reply = nullptr;
+
+  BOOST_VERIFY(redisReaderFeed(reader, resp.data(), resp.size()) == REDIS_OK);
+  BOOST_VERIFY(redisReaderGetReply(reader, &reply) == REDIS_OK);
+  BOOST_VERIFY(reply != nullptr);
+
+  redisReaderFree(reader);
+  return ReplyPtr(static_cast<redisReply*>(reply));
+}
+
+
+std::string const kInfoText =
+  "# Server\r\n"
+  "redis_version:6.2.14\r\n"
+  "uptime_in_seconds:42\r\n"
+  "\r\n"
+  "# Keyspace\r\n"
+  "db0:keys=3,expires=1,avg_ttl=100\r\n";
+
+// INFO: a bulk string in RESP2, a verbatim string in RESP3.
+std::string const kInfoResp2 =
+  "$" + std::to_string(kInfoText.size()) + "\r\n" + kInfoText + "\r\n";
+std::string const kInfoResp3 =
+  "=" + std::to_string(kInfoText.size() + 4) + "\r\ntxt:" + kInfoText + "\r\n";
+
+// SLOWLOG GET 3 and LATENCY LATEST are plain arrays in both versions; the
+//   oldest slowlog entry has the pre-4.0 shape, without client fields.
+std::string const kSlowlog =
+  "*3\r\n"
+  "*6\r\n:7\r\n:1792364391\r\n:9\r\n"
+    "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$1\r\nv\r\n"
+    "$15\r\n127.0.0.1:46490\r\n$3\r\napp\r\n"
+  "*6\r\n:6\r\n:1792364391\r\n:7\r\n"
+    "*2\r\n$7\r\nSLOWLOG\r\n$5\r\nRESET\r\n"
+    "$15\r\n127.0.0.1:46490\r\n$0\r\n\r\n"
+  "*4\r\n:5\r\n:1792364390\r\n:12\r\n"
+    "*1\r\n$4\r\nPING\r\n";
+
+std::string const kLatency =
+  "*2\r\n"
+  "*4\r\n$7\r\ncommand\r\n:1792364392\r\n:20\r\n:25\r\n"
+  "*4\r\n$4\r\nfork\r\n:1792364300\r\n:3\r\n:4\r\n";
+
+// MEMORY STATS: a flat array with doubles as strings in RESP2, a map with
+//   native doubles in RESP3; "db.0" nests either way.
+std::string const kMemoryResp2 =
+  "*8\r\n"
+  "$14\r\npeak.allocated\r\n:955104\r\n"
+  "$4\r\ndb.0\r\n"
+    "*4\r\n$23\r\noverhead.hashtable.main\r\n:72\r\n"
+    "$26\r\noverhead.hashtable.expires\r\n:0\r\n"
+  "$18\r\ndataset.percentage\r\n$18\r\n67.615013122558594\r\n"
+  "$19\r\nallocator-rss.ratio\r\n$1\r\n1\r\n";
+
+std::string const kMemoryResp3 =
+  "%4\r\n"
+  "$14\r\npeak.allocated\r\n:955104\r\n"
+  "$4\r\ndb.0\r\n"
+    "%2\r\n$23\r\noverhead.hashtable.main\r\n:72\r\n"
+    "$26\r\noverhead.hashtable.expires\r\n:0\r\n"
+  "$18\r\ndataset.percentage\r\n,67.615013122558594\r\n"
+  "$19\r\nallocator-rss.ratio\r\n,1\r\n";
+
+
+void CheckInfo(ReplyPtr const &reply) {
+  BOOST_VERIFY(
+    reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_VERB
+  );
+
+  introspect::Info const info =
+    introspect::ParseInfo(std::string(reply->str, reply->len));
+
+  BOOST_VERIFY(info.sections.size() == 2);
+  BOOST_VERIFY(info.sections[0].name == "Server");
+  BOOST_VERIFY(info.sections[1].name == "Keyspace");
+  BOOST_VERIFY(info.sections[0].fields.size() == 2);
+
+  BOOST_VERIFY(info.Find("redis_version") != nullptr);
+  BOOST_VERIFY(*info.Find("redis_version") == "6.2.14");
+  BOOST_VERIFY(info.Find("missing") == nullptr);
+  BOOST_VERIFY(info.Number("uptime_in_seconds") == 42);
+  BOOST_VERIFY(info.Number("redis_version", -1) == -1);  // not a number
+
+  auto keyspace = introspect::ParseInfoValue(*info.Find("db0"));
+  BOOST_VERIFY(keyspace.size() == 3);
+  BOOST_VERIFY(keyspace["keys"] == "3" && keyspace["avg_ttl"] == "100");
+}
+
+
+void CheckSlowlog(ReplyPtr const &reply) {
+  auto const entries = introspect::ParseSlowlog(*reply);
+
+  BOOST_VERIFY(entries.size() == 3);
+  BOOST_VERIFY(entries[0].id == 7 && entries[2].id == 5);
+  BOOST_VERIFY(entries[0].timestamp == 1792364391);
+  BOOST_VERIFY(entries[0].duration_us == 9);
+  BOOST_VERIFY((entries[0].args == std::vector<std::string>{"SET", "k", "v"}));
+  BOOST_VERIFY(entries[0].client_address == "127.0.0.1:46490");
+  BOOST_VERIFY(entries[0].client_name == "app");
+  BOOST_VERIFY(entries[1].client_name.empty());
+  BOOST_VERIFY(entries[2].args.size() == 1);
+  BOOST_VERIFY(entries[2].client_address.empty());
+}
+
+
+void CheckLatency(ReplyPtr const &reply) {
+  auto const events = introspect::ParseLatencyLatest(*reply);
+
+  BOOST_VERIFY(events.size() == 2);
+  BOOST_VERIFY(events[0].event == "command");
+  BOOST_VERIFY(events[0].timestamp == 1792364392);
+  BOOST_VERIFY(events[0].latest_ms == 20 && events[0].max_ms == 25);
+  BOOST_VERIFY(events[1].event == "fork" && events[1].max_ms == 4);
+}
+
+
+void CheckMemory(ReplyPtr const &reply) {
+  auto stats = introspect::ParseMemoryStats(*reply);
+
+  BOOST_VERIFY(stats.size() == 5);
+  BOOST_VERIFY(stats["peak.allocated"] == 955104);
+  BOOST_VERIFY(stats["db.0.overhead.hashtable.main"] == 72);
+  BOOST_VERIFY(stats.count("db.0.overhead.hashtable.expires"));
+  BOOST_VERIFY(stats["dataset.percentage"] > 67.6);
+  BOOST_VERIFY(stats["dataset.percentage"] < 67.7);
+  BOOST_VERIFY(stats["allocator-rss.ratio"] == 1);
+}
+
+
+introspect::SlowlogEntry Entry(int64_t const id, int64_t const timestamp) {
+  introspect::SlowlogEntry entry;
+  entry.id        = id;
+  entry.timestamp = timestamp;
+  return entry;
+}
+
+} // namespace
+
+
+int main() {
+  // Both protocol versions, through a RESP2 and a RESP3 reader alike: the
+  //   reader handles whichever types it is fed.
+  ReplyPtr const info2 = Canned(kInfoResp2);
+  ReplyPtr const info3 = Canned(kInfoResp3);
+  BOOST_VERIFY(info2->type == REDIS_REPLY_STRING);
+  BOOST_VERIFY(info3->type == REDIS_REPLY_VERB);
+  CheckInfo(info2);
+  CheckInfo(info3);
+
+  CheckSlowlog(Canned(kSlowlog));
+  CheckLatency(Canned(kLatency));
+
+  ReplyPtr const memory3 = Canned(kMemoryResp3);
+  BOOST_VERIFY(memory3->type == REDIS_REPLY_MAP);
+  CheckMemory(Canned(kMemoryResp2));
+  CheckMemory(memory3);
+
+  // Replies of the wrong shape parse to nothing.
+  ReplyPtr const error = Canned("-ERR unknown subcommand\r\n");
+  BOOST_VERIFY(introspect::ParseSlowlog(*error).empty());
+  BOOST_VERIFY(introspect::ParseLatencyLatest(*error).empty());
+  BOOST_VERIFY(introspect::ParseMemoryStats(*error).empty());
+  BOOST_VERIFY(introspect::ParseInfo("").sections.empty());
+
+  // SlowlogCursor: only entries past the last one seen...
+  introspect::SlowlogCursor cursor;
+
+  auto fresh = cursor.Next(introspect::ParseSlowlog(*Canned(kSlowlog)));
+  BOOST_VERIFY(fresh.size() == 3);
+
+  fresh = cursor.Next(introspect::ParseSlowlog(*Canned(kSlowlog)));
+  BOOST_VERIFY(fresh.empty());
+
+  fresh = cursor.Next({
+    Entry(9, 1792364400), Entry(8, 1792364399), Entry(7, 1792364391)
+  });
+  BOOST_VERIFY(fresh.size() == 2 && fresh[0].id == 9 && fresh[1].id == 8);
+
+  // ...until the server restarts and IDs start over, below the last one...
+  fresh = cursor.Next({Entry(1, 1792365000), Entry(0, 1792365000)});
+  BOOST_VERIFY(fresh.size() == 2 && fresh[0].id == 1);
+
+  fresh = cursor.Next({Entry(2, 1792365001), Entry(1, 1792365000)});
+  BOOST_VERIFY(fresh.size() == 1 && fresh[0].id == 2);
+
+  // ...or back at the last one seen, from another time.
+  fresh = cursor.Next({Entry(2, 1792366000), Entry(1, 1792366000)});
+  BOOST_VERIFY(fresh.size() == 2);
+
+  BOOST_VERIFY(cursor.Next({}).empty());
+
+  std::cout << "Introspect tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
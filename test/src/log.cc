@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Rate limits of rediswraps::logging; no Redis needed:
+//
+//   rrtest_log
+//
+namespace {
+
+// Counts the records it is handed by the first word of their message, and
+//   the suppressed counts reported along with them.
+class CountingSink : public logging::Sink {
+ public:
+  void Write(logging::Record const &record) override {
+    std::lock_guard<std::mutex> lock_guard(this->lock_);
+
+    std::string const code = record.message.substr(0, record.message.find(' '));
+
+    ++this->written[code];
+    this->suppressed[code] += record.suppressed;
+  }
+
+  std::map<std::string, uint32_t> written;
+  std::map<std::string, uint32_t> suppressed;
+
+ private:
+  std::mutex lock_;
+};
+
+} // namespace
+
+
+int main() {
+  auto const sink = std::make_shared<CountingSink>();
+  logging::SetSink(sink);
+
+  uint32_t const limit = constants::kLogRateLimitPerSecond;
+
+  // A storm of one error code...
+  for (uint32_t i = 0; i < 5 * limit; ++i) {
+    std::string const reply("WRONGTYPE Operation against a key holding the wrong kind of value");
+    logging::Log<logging::Severity::kError>(logging::Topic::kReply, reply);
+  }
+
+  // ...doesn't silence another one on the same topic, however the rest of the
+  //   message varies.
+  for (uint32_t i = 0; i < limit; ++i) {
+    char reply[] = "NOSCRIPT No matching script.";
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply, static_cast<char*>(reply), " (", i, ")"
+    );
+  }
+
+  // Each prefix is limited on its own.  The window may have moved on once
+  //   mid-storm, letting through at most one more second's worth.
+  BOOST_VERIFY(sink->written["WRONGTYPE"] >= limit);
+  BOOST_VERIFY(sink->written["WRONGTYPE"] <= 2 * limit);
+  BOOST_VERIFY(sink->written["NOSCRIPT"] == limit);
+
+  // Other topics have limits of their own.
+  logging::Log<logging::Severity::kWarning>(
+    logging::Topic::kConnection, "WRONGTYPE", " on another topic"
+  );
+  BOOST_VERIFY(sink->written["WRONGTYPE"] >= limit + 1);
+
+  // 0 lifts the limit of every prefix of a topic.
+  logging::SetRateLimit(logging::Topic::kReply, 0);
+
+  uint32_t const before = sink->written["WRONGTYPE"];
+
+  for (uint32_t i = 0; i < 2 * limit; ++i) {
+    logging::Log<logging::Severity::kError>(
+      logging::Topic::kReply, "WRONGTYPE Operation against a key"
+    );
+  }
+
+  BOOST_VERIFY(sink->written["WRONGTYPE"] == before + 2 * limit);
+
+  // The first line through reports the ones suppressed before it.
+  BOOST_VERIFY(sink->suppressed["WRONGTYPE"] > 0);
+
+  logging::SetRateLimit(logging::Topic::kReply, limit);
+  logging::SetSink(std::make_shared<logging::StderrSink>());
+
+  std::cout << "Log tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
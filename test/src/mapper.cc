@@ -0,0 +1,154 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+struct User {
+  std::string                  name;
+  int                          age = 0;
+  double                       score = 0.0;
+  boost::optional<std::string> email;
+  boost::optional<int64_t>     referrer;
+};
+
+REDISWRAPS_MAP_HASH(User, name, age, score, email, referrer)
+
+
+// Maps objects to hashes and back against a local Redis:
+//
+//   rrtest_mapper [port]
+//
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    BOOST_VERIFY(mapper::Fields<User>::kCount == 5);
+    BOOST_VERIFY(mapper::Fields<User>::Names()[3] == "email");
+
+    // Every member makes it there and back.
+    User ada;
+    ada.name     = "Ada";
+    ada.age      = 36;
+    ada.score    = 9.5;
+    ada.email    = std::string("ada@example.com");
+    ada.referrer = int64_t(7);
+
+    BOOST_VERIFY(mapper::Store(redis, "mapper:user:1", ada));
+
+    std::string const age = redis.Cmd("HGET", "mapper:user:1", "age");
+    BOOST_VERIFY(age == "36");
+
+    User loaded;
+    BOOST_VERIFY(mapper::Load(redis, "mapper:user:1", loaded));
+    BOOST_VERIFY(loaded.name == "Ada" && loaded.age == 36);
+    BOOST_VERIFY(loaded.score == 9.5);
+    BOOST_VERIFY(loaded.email && *loaded.email == "ada@example.com");
+    BOOST_VERIFY(loaded.referrer && *loaded.referrer == 7);
+
+    // Storing an empty optional removes its field.
+    ada.email = boost::none;
+    BOOST_VERIFY(mapper::Store(redis, "mapper:user:1", ada));
+
+    int64_t const has_email = redis.Cmd("HEXISTS", "mapper:user:1", "email");
+    BOOST_VERIFY(has_email == 0);
+
+    int64_t const fields = redis.Cmd("HLEN", "mapper:user:1");
+    BOOST_VERIFY(fields == 4);
+
+    // Missing fields load as none, or default-constructed.
+    redis.Cmd("HDEL", "mapper:user:1", "referrer", "age");
+
+    BOOST_VERIFY(mapper::Load(redis, "mapper:user:1", loaded));
+    BOOST_VERIFY(loaded.name == "Ada");
+    BOOST_VERIFY(!loaded.email);
+    BOOST_VERIFY(!loaded.referrer);
+    BOOST_VERIFY(loaded.age == 0);
+
+    // A missing hash leaves the object alone.
+    User untouched;
+    untouched.name  = "Grace";
+    untouched.email = std::string("grace@example.com");
+
+    BOOST_VERIFY(!mapper::Load(redis, "mapper:user:missing", untouched));
+    BOOST_VERIFY(untouched.name == "Grace");
+    BOOST_VERIFY(untouched.email && *untouched.email == "grace@example.com");
+
+    // Values that don't fit their member fail the load.
+    redis.Cmd("HSET", "mapper:user:1", "age", "not a number");
+    BOOST_VERIFY(!mapper::Load(redis, "mapper:user:1", loaded));
+
+    // Batches: one round trip each way.
+    std::vector<User> users(3);
+    std::vector<std::string> const keys = {
+      "mapper:user:10", "mapper:user:11", "mapper:user:12"
+    };
+
+    for (size_t i = 0; i < users.size(); ++i) {
+      users[i].name = "user" + std::to_string(i);
+      users[i].age  = static_cast<int>(20 + i);
+
+      if (i % 2 == 0) {
+        users[i].email = users[i].name + "@example.com";
+      }
+    }
+
+    BOOST_VERIFY(mapper::StoreMany(redis, keys, users));
+
+    std::vector<std::string> batch = keys;
+    batch.insert(batch.begin() + 1, "mapper:user:missing");
+
+    std::vector<boost::optional<User>> many;
+    BOOST_VERIFY(mapper::LoadMany(redis, batch, many));
+    BOOST_VERIFY(many.size() == 4);
+
+    BOOST_VERIFY(many[0] && many[0]->name == "user0" && many[0]->age == 20);
+    BOOST_VERIFY(many[0]->email && *many[0]->email == "user0@example.com");
+    BOOST_VERIFY(!many[1]);
+    BOOST_VERIFY(many[2] && many[2]->name == "user1" && !many[2]->email);
+    BOOST_VERIFY(many[3] && many[3]->age == 22 && many[3]->email);
+
+    // Empty optionals are removed in batches too.
+    users[0].email = boost::none;
+    BOOST_VERIFY(mapper::StoreMany(redis, keys, users));
+
+    int64_t const still_has_email =
+      redis.Cmd("HEXISTS", "mapper:user:10", "email");
+    BOOST_VERIFY(still_has_email == 0);
+
+    // Mismatched batches are refused.
+    BOOST_VERIFY(!mapper::StoreMany(redis, {"mapper:user:10"}, users));
+
+    redis.Cmd("DEL", "mapper:user:1", keys[0], keys[1], keys[2]);
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Mapper tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Migrates keys between two local servers, or between dbs 0 and 1 of the
+//   same one if only one port is given:
+//
+//   rrtest_migrate [port] [destination port]
+//
+namespace {
+
+constexpr int kKeys = 1000;
+
+std::string const Key(int const i) {
+  return "migrate:" + utils::ToString(i);
+}
+
+// Values with every byte in them, NULs included.
+std::string const Value(int const i) {
+  std::string value(i % 300, '\0');
+
+  for (size_t j = 0; j < value.size(); ++j) {
+    value[j] = static_cast<char>((i + j) % 256);
+  }
+
+  return value;
+}
+
+
+void Delete(Connection &redis, int const db) {
+  Pipeline pipe(redis);
+  pipe.Add("SELECT", db);
+
+  for (int i = 0; i < kKeys; ++i) {
+    pipe.Add("DEL", Key(i));
+  }
+
+  pipe.Add("SELECT", 0);
+  pipe.Execute();
+}
+
+
+int64_t const DbSize(Connection &redis, int const db) {
+  redis.Cmd("SELECT", db);
+  int64_t const size = redis.Cmd("DBSIZE");
+  redis.Cmd("SELECT", 0);
+
+  return size;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    int const destination_port = (argc > 2) ? std::atoi(argv[2]) : port;
+    int const destination_db = (destination_port == port) ? 1 : 0;
+
+    Connection source(constants::kDefaultHost, port);
+    Connection destination(constants::kDefaultHost, destination_port);
+
+    BOOST_VERIFY_MSG(
+      DbSize(source, 0) == 0 && DbSize(destination, destination_db) == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    {
+      Pipeline pipe(source);
+
+      for (int i = 0; i < kKeys; ++i) {
+        pipe.AddArgv({"SET", Key(i), Value(i)});
+
+        if (i % 10 == 0) {
+          pipe.Add("PEXPIRE", Key(i), 1000000);
+        }
+      }
+
+      pipe.Execute();
+    }
+
+    MigrationOptions options;
+    options.threads        = 4;
+    options.batch          = 64;
+    options.destination_db = destination_db;
+
+    {
+      Migration migration(source, destination, options);
+      BOOST_VERIFY(migration.Run());
+
+      MigrationStats const stats = migration.stats();
+
+      BOOST_VERIFY(stats.migrated >= kKeys);  // SCAN may repeat keys
+      BOOST_VERIFY(stats.vanished == 0);
+      BOOST_VERIFY(stats.failed == 0);
+      BOOST_VERIFY(stats.source_keys == kKeys);
+      BOOST_VERIFY(stats.destination_keys == kKeys);
+    }
+
+    // Values come over byte for byte, TTLs with them.
+    destination.Cmd("SELECT", destination_db);
+
+    for (int i = 0; i < kKeys; i += 7) {
+      std::string const value = destination.Cmd("GET", Key(i));
+      BOOST_VERIFY(value == Value(i));
+
+      int64_t const ttl = destination.Cmd("PTTL", Key(i));
+
+      if (i % 10 == 0) {
+        BOOST_VERIFY(ttl > 0 && ttl <= 1000000);
+      }
+      else {
+        BOOST_VERIFY(ttl == -1);
+      }
+    }
+
+    destination.Cmd("SELECT", 0);
+
+    // Without REPLACE, keys already there are left alone.
+    options.replace = false;
+    options.verify  = false;
+
+    {
+      Migration migration(source, destination, options);
+      BOOST_VERIFY(!migration.Run());
+
+      MigrationStats const stats = migration.stats();
+
+      BOOST_VERIFY(stats.migrated == 0);
+      BOOST_VERIFY(stats.failed >= kKeys);
+    }
+
+    // Throttled to 5000 keys per second, 1000 keys take at least 0.2s less
+    //   the first batch, which goes right away.
+    options.replace         = true;
+    options.keys_per_second = 5000;
+
+    {
+      Migration migration(source, destination, options);
+      BOOST_VERIFY(migration.Run());
+      BOOST_VERIFY(migration.stats().elapsed.count() >= 150);
+    }
+
+    Delete(source, 0);
+    Delete(destination, destination_db);
+
+    BOOST_VERIFY_MSG(
+      DbSize(source, 0) == 0 && DbSize(destination, destination_db) == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Migration tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Prepared commands against a local Redis:
+//
+//   rrtest_prepared [port]
+//
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    // Constants around a placeholder.
+    auto views = redis.Prepare("HINCRBY", CMD_PLACEHOLDER, "views", 1);
+
+    BOOST_VERIFY(views.arity() == 1);
+    BOOST_VERIFY(views.command() == "HINCRBY");
+
+    int64_t const first = views.Cmd("prepared:page:1");
+    int64_t const again = views.Cmd("prepared:page:1");
+    int64_t const other = views.Cmd("prepared:page:2");
+
+    BOOST_VERIFY(first == 1 && again == 2 && other == 1);
+
+    std::string const stored = redis.Cmd("HGET", "prepared:page:1", "views");
+    BOOST_VERIFY(stored == "2");
+
+    // Placeholders only, and placeholders after constants; arguments are
+    //   formatted like Cmd()'s.
+    auto set = redis.Prepare("SET", CMD_PLACEHOLDER, CMD_PLACEHOLDER);
+    auto add = redis.Prepare("ZADD", "prepared:zset", CMD_PLACEHOLDER, CMD_PLACEHOLDER);
+
+    BOOST_VERIFY(set.arity() == 2 && add.arity() == 2);
+
+    set.Cmd("prepared:string", std::string("a value"));
+    set.Cmd<CMD_VOID>("prepared:number", 42);
+    add.Cmd(1.5, "low");
+    add.Cmd(2, "high");
+
+    std::string const value = redis.Cmd("GET", "prepared:string");
+    int64_t const number = redis.Cmd("GET", "prepared:number");
+    std::string const low = redis.Cmd("ZSCORE", "prepared:zset", "low");
+
+    BOOST_VERIFY(value == "a value" && number == 42 && low == "1.5");
+
+    ReplyPtr const highest = add.RawCmd(3, "higher");
+    BOOST_VERIFY(highest && highest->type == REDIS_REPLY_INTEGER);
+
+    // Wrong argument counts are refused, and nothing is sent.
+    BOOST_VERIFY(!views.Cmd());
+    BOOST_VERIFY(!views.Cmd("prepared:page:1", "extra"));
+    BOOST_VERIFY(!add.RawCmd(4));
+
+    int64_t const members = redis.Cmd("ZCARD", "prepared:zset");
+    BOOST_VERIFY(members == 3);
+
+    // Script aliases are bound to EVALSHA when prepared.
+    BOOST_VERIFY(redis.LoadScriptFromString(
+      "prepared_get", "return redis.call('GET', KEYS[1])", 1
+    ));
+
+    auto get = redis.Prepare("prepared_get", CMD_PLACEHOLDER);
+
+    BOOST_VERIFY(get.command() == "EVALSHA");
+    BOOST_VERIFY(get.arity() == 1);
+
+    std::string const scripted = get.Cmd("prepared:string");
+    BOOST_VERIFY(scripted == "a value");
+
+    // In a pipeline, one reply per call, in order.
+    Pipeline pipe(redis);
+    pipe.Add(views, "prepared:page:3").Add(get, "prepared:string");
+    pipe.Add(views, "prepared:page:3");
+
+    std::vector<cmd::Response> const replies = pipe.Execute();
+
+    BOOST_VERIFY(replies.size() == 3);
+
+    int64_t const hits = replies[0];
+    std::string const piped = replies[1];
+    int64_t const hits_again = replies[2];
+
+    BOOST_VERIFY(hits == 1 && piped == "a value" && hits_again == 2);
+
+    // A wrong call can't be added without shifting the replies after it.
+    pipe.Add(views, "prepared:page:4");
+
+    bool refused = false;
+
+    try {
+      pipe.Add(views);
+    }
+    catch (std::invalid_argument const&) {
+      refused = true;
+    }
+
+    BOOST_VERIFY(refused && pipe.size() == 1);
+    pipe.Clear();
+
+    redis.Cmd(
+      "DEL",
+      "prepared:page:1", "prepared:page:2", "prepared:page:3",
+      "prepared:string", "prepared:number", "prepared:zset"
+    );
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Prepared command tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
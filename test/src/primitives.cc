@@ -0,0 +1,242 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Runs the single round trip primitives against a local Redis:
+//
+//   rrtest_primitives [port]
+//
+int main(int const argc, char const *argv[]) {
+  using std::chrono::milliseconds;
+
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    // Token bucket: a burst of 5, then 1 every 100ms.
+    {
+      primitives::TokenBucket bucket(redis, 10.0, 5);
+      primitives::Decision decision;
+
+      for (int i = 0; i < 5; ++i) {
+        BOOST_VERIFY(bucket.Take("primitives:bucket", decision));
+        BOOST_VERIFY(decision.allowed);
+        BOOST_VERIFY(decision.remaining == 4 - i);
+      }
+
+      BOOST_VERIFY(bucket.Take("primitives:bucket", decision));
+      BOOST_VERIFY(!decision.allowed);
+      BOOST_VERIFY(decision.retry_after > milliseconds(0));
+      BOOST_VERIFY(decision.retry_after <= milliseconds(100));
+
+      BOOST_VERIFY(bucket.Take("primitives:bucket", decision, 6));
+      BOOST_VERIFY(!decision.allowed);
+      BOOST_VERIFY(decision.retry_after == milliseconds(-1));
+
+      std::this_thread::sleep_for(milliseconds(150));
+
+      BOOST_VERIFY(bucket.Take("primitives:bucket", decision));
+      BOOST_VERIFY(decision.allowed);
+
+      redis.Cmd("DEL", "primitives:bucket");
+    }
+
+    // Sliding window: 3 per second.
+    {
+      primitives::SlidingWindow window(redis, milliseconds(1000), 3);
+      primitives::Decision decision;
+
+      BOOST_VERIFY(window.Take("primitives:window", decision, 2));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 1);
+
+      BOOST_VERIFY(window.Take("primitives:window", decision, 2));
+      BOOST_VERIFY(!decision.allowed && decision.remaining == 1);
+      BOOST_VERIFY(decision.retry_after > milliseconds(0));
+      BOOST_VERIFY(decision.retry_after <= milliseconds(1000));
+
+      BOOST_VERIFY(window.Take("primitives:window", decision));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 0);
+
+      int64_t const entries = redis.Cmd("ZCARD", "primitives:window");
+      BOOST_VERIFY(entries == 3);
+
+      redis.Cmd("DEL", "primitives:window");
+    }
+
+    // Fenced lock: tokens go up, and stale holders can't release.
+    {
+      primitives::FencedLock lock(redis, milliseconds(10000));
+      primitives::Fence first, second;
+      bool done = true;
+
+      BOOST_VERIFY(lock.Acquire("primitives:lock", "a", first));
+      BOOST_VERIFY(first.token > 0);
+
+      BOOST_VERIFY(lock.Acquire("primitives:lock", "b", second));
+      BOOST_VERIFY(second.token == 0);
+      BOOST_VERIFY(second.ttl > milliseconds(0));
+
+      // Held already: extended, same token.
+      BOOST_VERIFY(lock.Acquire("primitives:lock", "a", second));
+      BOOST_VERIFY(second.token == first.token);
+
+      BOOST_VERIFY(lock.Release("primitives:lock", "b", first.token, done));
+      BOOST_VERIFY(!done);
+      BOOST_VERIFY(lock.Release("primitives:lock", "a", first.token + 1, done));
+      BOOST_VERIFY(!done);
+
+      BOOST_VERIFY(lock.Extend("primitives:lock", "a", first.token, done));
+      BOOST_VERIFY(done);
+      BOOST_VERIFY(lock.Release("primitives:lock", "a", first.token, done));
+      BOOST_VERIFY(done);
+
+      BOOST_VERIFY(lock.Acquire("primitives:lock", "b", second));
+      BOOST_VERIFY(second.token == first.token + 1);
+
+      BOOST_VERIFY(lock.Release("primitives:lock", "a", first.token, done));
+      BOOST_VERIFY(!done);
+      BOOST_VERIFY(lock.Release("primitives:lock", "b", second.token, done));
+      BOOST_VERIFY(done);
+
+      BOOST_VERIFY(
+        primitives::FencedLock::FenceKey("primitives:lock") ==
+        "{primitives:lock}:fence"
+      );
+      BOOST_VERIFY(
+        primitives::FencedLock::FenceKey("{user:1}:lock") == "{user:1}:lock:fence"
+      );
+
+      redis.Cmd("DEL", primitives::FencedLock::FenceKey("primitives:lock"));
+    }
+
+    // Capped counter: within [0, 3].
+    {
+      primitives::CappedCounter counter(redis, 3, 0, milliseconds(60000));
+      primitives::CounterUpdate update;
+
+      BOOST_VERIFY(counter.Increment("primitives:counter", update, 2));
+      BOOST_VERIFY(update.applied && update.value == 2);
+
+      BOOST_VERIFY(counter.Increment("primitives:counter", update, 2));
+      BOOST_VERIFY(!update.applied && update.value == 2);
+
+      BOOST_VERIFY(counter.Increment("primitives:counter", update));
+      BOOST_VERIFY(update.applied && update.value == 3);
+
+      BOOST_VERIFY(counter.Increment("primitives:counter", update, -4));
+      BOOST_VERIFY(!update.applied && update.value == 3);
+
+      int64_t const ttl = redis.Cmd("PTTL", "primitives:counter");
+      BOOST_VERIFY(ttl > 0 && ttl <= 60000);
+
+      redis.Cmd("DEL", "primitives:counter");
+    }
+
+    // Lease semaphore: 2 slots, leases of 200ms.
+    {
+      primitives::LeaseSemaphore semaphore(redis, 2, milliseconds(200));
+      primitives::Decision decision;
+      bool done = false;
+
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "a", decision));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 1);
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "b", decision));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 0);
+
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "c", decision));
+      BOOST_VERIFY(!decision.allowed);
+      BOOST_VERIFY(decision.retry_after > milliseconds(0));
+
+      // Renewing a slot one holds doesn't take another.
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "a", decision));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 0);
+
+      BOOST_VERIFY(semaphore.Release("primitives:semaphore", "a", done));
+      BOOST_VERIFY(done);
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "c", decision));
+      BOOST_VERIFY(decision.allowed);
+
+      // A lease that ran out frees its slot.
+      std::this_thread::sleep_for(milliseconds(250));
+
+      BOOST_VERIFY(semaphore.Release("primitives:semaphore", "b", done));
+      BOOST_VERIFY(!done);
+      BOOST_VERIFY(semaphore.Acquire("primitives:semaphore", "a", decision));
+      BOOST_VERIFY(decision.allowed && decision.remaining == 1);
+
+      redis.Cmd("DEL", "primitives:semaphore");
+    }
+
+    // Many calls in one round trip.
+    {
+      primitives::TokenBucket bucket(redis, 1.0, 3);
+      primitives::CappedCounter counter(redis, 100);
+
+      Pipeline pipe(redis);
+
+      for (int i = 0; i < 4; ++i) {
+        bucket.AddTake(pipe, "primitives:bucket");
+        counter.AddIncrement(pipe, "primitives:counter", 10);
+      }
+
+      std::vector<ReplyPtr> const replies = pipe.ExecuteRaw();
+      BOOST_VERIFY(replies.size() == 8);
+
+      for (int i = 0; i < 4; ++i) {
+        primitives::Decision decision;
+        primitives::CounterUpdate update;
+
+        BOOST_VERIFY(primitives::Parse(replies[2 * i].get(), decision));
+        BOOST_VERIFY(decision.allowed == (i < 3));
+
+        BOOST_VERIFY(primitives::Parse(replies[2 * i + 1].get(), update));
+        BOOST_VERIFY(update.applied && update.value == 10 * (i + 1));
+      }
+
+      redis.Cmd("DEL", "primitives:bucket", "primitives:counter");
+    }
+
+    // Scripts Redis lost are loaded again.
+    {
+      redis.Cmd("SCRIPT", "FLUSH");
+
+      primitives::CappedCounter counter(redis, 1);
+      primitives::CounterUpdate update;
+
+      BOOST_VERIFY(counter.Increment("primitives:counter", update));
+      BOOST_VERIFY(update.applied && update.value == 1);
+
+      redis.Cmd("DEL", "primitives:counter");
+    }
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Primitives tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Reads back the RDB file of a local Redis after filling it with every
+//   type, in both its compact and its large encodings.  The snapshot is
+//   taken with SAVE, so the server must be allowed to write it:
+//
+//   rrtest_rdb [port]
+//
+namespace {
+
+constexpr int kLarge = 1000;  // elements; beyond every compact encoding
+
+struct Value {
+  rdb::Type type;
+  int64_t   expires_ms;
+
+  // "member", "member=value" or "member@score"
+  std::vector<std::string> elements;
+};
+
+
+std::string ConfigGet(Connection &redis, std::string const &parameter) {
+  // An array in RESP2, a map in RESP3: either way the value comes second.
+  ReplyPtr const reply = redis.RawCmd("CONFIG", "GET", parameter);
+
+  BOOST_VERIFY(reply && reply->elements == 2);
+  return std::string(reply->element[1]->str, reply->element[1]->len);
+}
+
+
+std::string Describe(rdb::Record const &record, rdb::Element const &element) {
+  switch (record.type) {
+  case rdb::Type::kHash:
+    return element.member.to_string() + "=" + element.value.to_string();
+  case rdb::Type::kSortedSet:
+    return element.member.to_string() + "@" + std::to_string(element.score);
+  default:
+    return element.member.to_string();
+  }
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("SET", "rdb:string", "hello");
+    redis.Cmd("SET", "rdb:integer", -12345);
+    redis.Cmd("SET", "rdb:compressed", std::string(1000, 'a'));
+    redis.Cmd("SET", "rdb:expiring", "soon", "PX", 3600000);
+
+    redis.Cmd("RPUSH", "rdb:list", "a", 2, "c");
+    redis.Cmd("HSET", "rdb:hash", "name", "bob", "age", 42);
+    redis.Cmd("SADD", "rdb:intset", 3, 1, 2);
+    redis.Cmd("SADD", "rdb:set", "x", "y");
+    redis.Cmd("ZADD", "rdb:zset", 1.5, "one", 2, "two");
+
+    for (int i = 0; i < kLarge; ++i) {
+      std::string const n = std::to_string(i);
+
+      redis.Cmd("RPUSH", "rdb:list:large", "element:" + n);
+      redis.Cmd("HSET", "rdb:hash:large", "field:" + n, i);
+      redis.Cmd("SADD", "rdb:set:large", "member:" + n);
+      redis.Cmd("ZADD", "rdb:zset:large", i, "member:" + n);
+    }
+
+    int const keys = redis.Cmd("DBSIZE");
+    BOOST_VERIFY(keys == 13);
+
+    redis.Cmd("SAVE");
+
+    std::string const path =
+      ConfigGet(redis, "dir") + "/" + ConfigGet(redis, "dbfilename");
+
+    redis.Cmd(
+      "DEL",
+      "rdb:string", "rdb:integer", "rdb:compressed", "rdb:expiring",
+      "rdb:list", "rdb:hash", "rdb:intset", "rdb:set", "rdb:zset",
+      "rdb:list:large", "rdb:hash:large", "rdb:set:large", "rdb:zset:large"
+    );
+
+    // Everything comes back, decoded, through Next() and Elements().
+    rdb::Snapshot snapshot(path);
+    BOOST_VERIFY(snapshot.version() >= 9);
+    BOOST_VERIFY(snapshot.aux().count("redis-ver") == 1);
+
+    std::map<std::string, Value> values;
+    rdb::Record record;
+
+    while (snapshot.Next(record)) {
+      Value &value = values[record.key.to_string()];
+
+      value.type       = record.type;
+      value.expires_ms = record.expires_ms;
+
+      BOOST_VERIFY(record.db == 0);
+      BOOST_VERIFY(record.serialized_size() > 0);
+      BOOST_VERIFY(snapshot.Elements(record, [&](rdb::Element const &element) {
+        value.elements.push_back(Describe(record, element));
+      }));
+    }
+
+    BOOST_VERIFY_MSG(snapshot.error().empty(), snapshot.error().c_str());
+    BOOST_VERIFY(values.size() == static_cast<size_t>(keys));
+
+    using Elements = std::vector<std::string>;
+
+    BOOST_VERIFY(values["rdb:string"].elements == Elements{"hello"});
+    BOOST_VERIFY(values["rdb:integer"].elements == Elements{"-12345"});
+    BOOST_VERIFY(
+      values["rdb:compressed"].elements == Elements{std::string(1000, 'a')}
+    );
+
+    int64_t const now_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+      ).count();
+
+    BOOST_VERIFY(values["rdb:expiring"].expires_ms > now_ms);
+    BOOST_VERIFY(values["rdb:string"].expires_ms == -1);
+
+    BOOST_VERIFY(values["rdb:list"].type == rdb::Type::kList);
+    BOOST_VERIFY((values["rdb:list"].elements == Elements{"a", "2", "c"}));
+    BOOST_VERIFY(
+      (values["rdb:hash"].elements == Elements{"name=bob", "age=42"})
+    );
+    BOOST_VERIFY((values["rdb:intset"].elements == Elements{"1", "2", "3"}));
+    BOOST_VERIFY(values["rdb:set"].elements.size() == 2);
+    BOOST_VERIFY(
+      (values["rdb:zset"].elements == Elements{
+        "one@" + std::to_string(1.5),
+        "two@" + std::to_string(2.0)
+      })
+    );
+
+    BOOST_VERIFY(values["rdb:list:large"].elements.size() == kLarge);
+    BOOST_VERIFY(values["rdb:list:large"].elements.back() == "element:999");
+    BOOST_VERIFY(values["rdb:hash:large"].elements.size() == kLarge);
+    BOOST_VERIFY(values["rdb:set:large"].elements.size() == kLarge);
+    BOOST_VERIFY(values["rdb:zset:large"].type == rdb::Type::kSortedSet);
+    BOOST_VERIFY(values["rdb:zset:large"].elements.size() == kLarge);
+
+    // ForEach() sees the same keys and elements from several threads.
+    std::atomic<size_t> records(0);
+    std::atomic<size_t> elements(0);
+
+    BOOST_VERIFY(snapshot.ForEach([&](rdb::Record const &record, size_t) {
+      ++records;
+      snapshot.Elements(record, [&](rdb::Element const&) { ++elements; });
+    }, 4));
+
+    size_t expected = 0;
+
+    for (auto const &value : values) {
+      expected += value.second.elements.size();
+    }
+
+    BOOST_VERIFY(records == values.size());
+    BOOST_VERIFY(elements == expected);
+
+    // A visitor's exception comes out of ForEach() on this thread.
+    bool threw = false;
+
+    try {
+      snapshot.ForEach([](rdb::Record const &record, size_t) {
+        if (record.key.to_string() == "rdb:hash") {
+          throw std::runtime_error("visitor failed");
+        }
+      }, 4);
+    }
+    catch (std::runtime_error const &e) {
+      threw = (std::string(e.what()) == "visitor failed");
+    }
+
+    BOOST_VERIFY(threw);
+
+    // A compressed string claiming more than LZF could ever expand it to is
+    //   malformed, and the file stops there: nothing is allocated for the
+    //   2^62 bytes claimed here.
+    {
+      std::ifstream saved(path, std::ios::binary);
+      std::string bytes(
+        (std::istreambuf_iterator<char>(saved)),
+        std::istreambuf_iterator<char>()
+      );
+
+      // The key, then the LZF encoding, the compressed length in 6 bits
+      //   and the uncompressed one, 1000, in 14 bits.
+      std::string const key = "rdb:compressed";
+      size_t const at = bytes.find(key) + key.size();
+
+      BOOST_VERIFY(static_cast<unsigned char>(bytes[at]) == 0xC3);
+      BOOST_VERIFY(bytes.compare(at + 2, 2, "\x43\xE8") == 0);
+
+      bytes.replace(at + 2, 2, std::string("\x81\x40\0\0\0\0\0\0\0", 9));
+
+      char forged[] = "/tmp/rrtest_rdb.XXXXXX";
+      int const fd = mkstemp(forged);
+      BOOST_VERIFY(fd >= 0);
+      BOOST_VERIFY(write(fd, bytes.data(), bytes.size()) ==
+        static_cast<ssize_t>(bytes.size()));
+      close(fd);
+
+      rdb::Snapshot malformed(forged);
+      std::remove(forged);
+
+      while (malformed.Next(record)) {
+        BOOST_VERIFY(record.key.to_string() != key);
+      }
+
+      BOOST_VERIFY(!malformed.error().empty());
+    }
+
+    // Rewind() starts over.
+    snapshot.Rewind();
+    BOOST_VERIFY(snapshot.Next(record));
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "RDB snapshot tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
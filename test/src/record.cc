@@ -0,0 +1,185 @@
+#include <cstdio>     // std::remove()
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Records the commands two connections send to a local Redis and reads
+//   them back from the log.  Run from the project root, for the test/lua
+//   scripts:
+//
+//   rrtest_record [port]
+//
+int main(int const argc, char const *argv[]) {
+  std::string const path = "rrtest_record.log";
+
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection first(constants::kDefaultHost, port);
+    Connection second(constants::kDefaultHost, port);
+
+    int64_t const size_before = first.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    std::string const binary("a\0b\r\n", 5);
+
+    using Argv = std::vector<std::string>;
+
+    {
+      // A tiny buffer, so that the log is written out several times.
+      auto recorder = std::make_shared<CommandRecorder>(path, 64);
+
+      first.RecordCommands(recorder);
+      second.RecordCommands(recorder);
+
+      first.Cmd("SET", "record:binary", binary);
+      second.Cmd<CMD_VOID>("INCR", "record:counter");
+      first.RawCmd("GET", "record:binary");
+
+      for (int i = 0; i < 100; ++i) {
+        second.Cmd("INCR", "record:counter");
+      }
+
+      first.RecordCommands(nullptr);
+      first.Cmd("DEL", "record:binary");
+
+      second.Cmd("DEL", "record:counter");
+      second.RecordCommands(nullptr);
+
+      BOOST_VERIFY(recorder->Flush());
+      BOOST_VERIFY(recorder->stats().commands == 104);
+      BOOST_VERIFY(recorder->stats().errors == 0);
+    }
+
+    // Everything else that sends commands on a connection records them
+    //   too, starting with the SCRIPT LOADs a replay needs.
+    std::vector<Argv> sent;
+
+    {
+      auto recorder = std::make_shared<CommandRecorder>(path + ".more", 64);
+
+      first.Cmd("SCRIPT", "FLUSH");
+      BOOST_VERIFY(IsReadOnlyCommand(first, "GET"));
+
+      first.RecordCommands(recorder);
+
+      BOOST_VERIFY(first.LoadScripts("test/lua/scripts.manifest", true));
+      first.Cmd("pointless_keyed", "record:script");
+
+      PreparedCmd get = first.Prepare("GET", CMD_PLACEHOLDER);
+
+      Pipeline pipe(first);
+      pipe
+        .Add("SET", "record:pipelined", 1)
+        .AddArgv({"INCR", "record:pipelined"})
+        .Add(get, "record:pipelined");
+
+      pipe.Execute();
+      get.Cmd("record:pipelined");
+
+      SingleFlight flights;
+      flights.Cmd(first, "GET", "record:pipelined");
+
+      HedgedReads hedged;
+      hedged.Cmd(first, second, "GET", "record:pipelined");
+
+      BlobTransfer blobs(first);
+      BOOST_VERIFY(blobs.Upload("record:blob", "abc", 3));
+
+      first.RecordCommands(nullptr);
+      first.Flush();
+      first.Cmd("DEL", "record:pipelined", "record:blob");
+
+      BOOST_VERIFY(recorder->Flush());
+
+      CommandLog more(path + ".more");
+      RecordedCommand command;
+
+      while (more.Next(command)) {
+        sent.push_back(command.argv);
+      }
+
+      BOOST_VERIFY(more.error().empty());
+    }
+
+    std::remove((path + ".more").c_str());
+
+    BOOST_VERIFY(sent.size() == 14);
+    BOOST_VERIFY((sent[0] == Argv{sent[0][0], "EXISTS", sent[0][2]}));
+    BOOST_VERIFY(sent[1].size() == 3 && sent[1][1] == "LOAD");
+    BOOST_VERIFY(
+      (sent[2] == Argv{"EVALSHA", sent[0][2], "1", "record:script"})
+    );
+    BOOST_VERIFY((sent[3] == Argv{"SET", "record:pipelined", "1"}));
+    BOOST_VERIFY((sent[4] == Argv{"INCR", "record:pipelined"}));
+
+    for (size_t i = 5; i < 9; ++i) {
+      BOOST_VERIFY((sent[i] == Argv{"GET", "record:pipelined"}));
+    }
+
+    // The upload's temporary key, then its publication.
+    BOOST_VERIFY(sent[9].size() == 5 && sent[9][0] == "SET");
+    BOOST_VERIFY(sent[9][1].compare(0, 13, "{record:blob}") == 0);
+    BOOST_VERIFY(sent[9][2] == "abc" && sent[9][3] == "PX");
+    BOOST_VERIFY(sent[10][0] == "MULTI" && sent[11][0] == "PERSIST");
+    BOOST_VERIFY((sent[12] == Argv{"RENAME", sent[9][1], "record:blob"}));
+    BOOST_VERIFY(sent[13][0] == "EXEC");
+
+    CommandLog log(path);
+    RecordedCommand command;
+    std::vector<RecordedCommand> commands;
+
+    while (log.Next(command)) {
+      commands.push_back(command);
+    }
+
+    BOOST_VERIFY(log.error().empty());
+    BOOST_VERIFY(commands.size() == 104);
+
+    // In the order they were sent, by the connection that sent them.
+    BOOST_VERIFY((commands[0].argv == Argv{"SET", "record:binary", binary}));
+    BOOST_VERIFY(commands[0].stream == 0);
+    BOOST_VERIFY((commands[1].argv == Argv{"INCR", "record:counter"}));
+    BOOST_VERIFY(commands[1].stream == 1);
+    BOOST_VERIFY((commands[2].argv == Argv{"GET", "record:binary"}));
+    BOOST_VERIFY(commands[2].stream == 0);
+    BOOST_VERIFY((commands[103].argv == Argv{"DEL", "record:counter"}));
+    BOOST_VERIFY(commands[103].stream == 1);
+
+    for (size_t i = 1; i < commands.size(); ++i) {
+      BOOST_VERIFY(commands[i].at >= commands[i - 1].at);
+    }
+
+    BOOST_VERIFY(log.started().count() > 0);
+
+    int64_t const size_after = first.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    std::remove(path.c_str());
+    std::remove((path + ".more").c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::remove(path.c_str());
+
+  std::cout << "Command recorder tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Follows the writes to a local Redis as a replica would, stops, and
+//   resumes from its offset:
+//
+//   rrtest_replication [port]
+//
+namespace {
+
+// Collects the commands on test keys as the stream hands them over.
+class Feed {
+ public:
+  void operator()(ReplicatedCommand const &command) {
+    if (command.argv.size() < 2 || command.argv[1].compare(0, 5, "repl:") != 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->commands_.push_back(command);
+    this->arrived_.notify_all();
+  }
+
+  // Waits for "count" commands in all; returns what arrived.
+  std::vector<ReplicatedCommand> const Wait(size_t const count) {
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    this->arrived_.wait_for(lock, std::chrono::seconds(10), [&]() {
+      return this->commands_.size() >= count;
+    });
+
+    return this->commands_;
+  }
+
+ private:
+  std::mutex              mutex_;
+  std::condition_variable arrived_;
+
+  std::vector<ReplicatedCommand> commands_;
+};
+
+
+// Replicas attached to the server, not counting the stream.
+int64_t const Replicas(Connection &redis) {
+  std::string const info = redis.Cmd("INFO", "replication");
+  return std::atoll(utils::ParseInfo(info)["connected_slaves"].c_str());
+}
+
+
+// Until the stream is an online replica, writes only go into its snapshot.
+//   "replicas" others may be attached as well, and answer WAIT too.
+void WaitForReplica(Connection &redis, int64_t const replicas) {
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+  while (std::chrono::steady_clock::now() < deadline) {
+    // WAIT has the server send REPLCONF GETACK, which the stream answers.
+    int64_t const acked = redis.Cmd("WAIT", replicas + 1, 100);
+
+    if (acked > replicas) {
+      return;
+    }
+  }
+
+  BOOST_VERIFY_MSG(false, "The stream never caught up with the server.");
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    int64_t const replicas = Replicas(redis);
+
+    ReplicationStream stream(constants::kDefaultHost, port);
+    Feed feed;
+
+    std::thread following([&]() {
+      BOOST_VERIFY(stream.Run(std::ref(feed)));
+    });
+
+    WaitForReplica(redis, replicas);
+
+    // Writes come over in order, with the db they ran in.
+    redis.Cmd("SET", "repl:string", "hello");
+    redis.Cmd("SELECT", 2);
+    redis.Cmd("RPUSH", "repl:list", "a", 2, "c");
+    redis.Cmd("SELECT", 0);
+    redis.Cmd("DEL", "repl:string");
+
+    std::vector<ReplicatedCommand> commands = feed.Wait(3);
+    BOOST_VERIFY(commands.size() == 3);
+
+    using Argv = std::vector<std::string>;
+
+    BOOST_VERIFY((commands[0].argv == Argv{"SET", "repl:string", "hello"}));
+    BOOST_VERIFY(commands[0].db == 0);
+    BOOST_VERIFY((commands[1].argv == Argv{"RPUSH", "repl:list", "a", "2", "c"}));
+    BOOST_VERIFY(commands[1].db == 2);
+    BOOST_VERIFY(commands[2].argv[0] == "DEL");
+    BOOST_VERIFY(commands[2].db == 0);
+
+    BOOST_VERIFY(commands[0].offset < commands[1].offset);
+    BOOST_VERIFY(commands[1].offset < commands[2].offset);
+    BOOST_VERIFY(stream.offset() >= commands[2].offset);
+
+    stream.Stop();
+    following.join();
+
+    BOOST_VERIFY(stream.stats().full_syncs == 1);
+    BOOST_VERIFY(stream.stats().partial_syncs == 0);
+    BOOST_VERIFY(!stream.replication_id().empty());
+
+    // What is written in the meantime comes over when it resumes, from the
+    //   backlog rather than with another full sync.
+    redis.Cmd("SET", "repl:missed", 1);
+
+    following = std::thread([&]() {
+      BOOST_VERIFY(stream.Run(std::ref(feed)));
+    });
+
+    commands = feed.Wait(4);
+    BOOST_VERIFY(commands.size() == 4);
+    BOOST_VERIFY((commands[3].argv == Argv{"SET", "repl:missed", "1"}));
+    BOOST_VERIFY(commands[3].offset > commands[2].offset);
+
+    stream.Stop();
+    following.join();
+
+    BOOST_VERIFY(stream.stats().full_syncs == 1);
+    BOOST_VERIFY(stream.stats().partial_syncs == 1);
+
+    redis.Cmd("DEL", "repl:missed");
+    redis.Cmd("SELECT", 2);
+    redis.Cmd("DEL", "repl:list");
+    redis.Cmd("SELECT", 0);
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Replication stream tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Multi-key commands over independent servers, on ports 6379 and 6381
+//   unless others are given:
+//
+//   rrtest_scatter [port ...]
+//
+namespace {
+
+// A connection to a local port that is closed right after it connects: its
+//   server is gone by the time the connection is first used, and stays gone.
+Ptr Unreachable() {
+  int const listener = socket(AF_INET, SOCK_STREAM, 0);
+
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  socklen_t length = sizeof(address);
+
+  BOOST_VERIFY(
+    bind(listener, reinterpret_cast<sockaddr*>(&address), length) == 0
+  );
+  BOOST_VERIFY(listen(listener, 1) == 0);
+  BOOST_VERIFY(
+    getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0
+  );
+
+  // Connects out of the listen backlog; nothing is sent until it's used.
+  Ptr conn(new Connection(constants::kDefaultHost, ntohs(address.sin_port)));
+
+  close(listener);
+  return conn;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  // Few keys per sub-command, so that every shard gets several of them.
+  constexpr size_t kBatchKeys = 7;
+  constexpr size_t kKeys      = 200;
+
+  try {
+    std::vector<int> ports;
+
+    for (int i = 1; i < argc; ++i) {
+      ports.push_back(std::atoi(argv[i]));
+    }
+
+    if (ports.empty()) {
+      ports = {constants::kDefaultPort, 6381};
+    }
+
+    std::vector<Ptr> shards;
+
+    for (int const port : ports) {
+      shards.emplace_back(new Connection(constants::kDefaultHost, port));
+    }
+
+    ShardedConnection sharded(std::move(shards));
+    ScatterGather scatter(sharded, kBatchKeys);
+
+    for (size_t i = 0; i < sharded.NumShards(); ++i) {
+      int64_t const size_before = sharded.shard(i).Cmd("DBSIZE");
+
+      BOOST_VERIFY_MSG(
+        size_before == 0,
+        "RedisWraps tests will not run against existing Redis data.\n"
+        "  Either backup and flush this db or spawn a new instance."
+      );
+    }
+
+    std::vector<std::string> keys;
+    std::vector<std::pair<std::string, std::string>> pairs;
+    std::vector<size_t> owned(sharded.NumShards(), 0);
+
+    for (size_t i = 0; i < kKeys; ++i) {
+      keys.push_back("scatter:" + std::to_string(i));
+      pairs.emplace_back(keys.back(), std::to_string(i));
+
+      ++owned[sharded.ShardIndex(keys.back())];
+    }
+
+    for (auto const count : owned) {
+      BOOST_VERIFY_MSG(count > kBatchKeys, "Every shard should own keys.");
+    }
+
+    BOOST_VERIFY(scatter.MSet(pairs));
+
+    // Each key is on the shard that owns it.
+    for (size_t i = 0; i < kKeys; i += 17) {
+      std::string const value = sharded.Shard(keys[i]).Cmd("GET", keys[i]);
+      BOOST_VERIFY(value == std::to_string(i));
+    }
+
+    // Results come back in the caller's order, interleaving shards and
+    //   missing keys, duplicates included.
+    std::vector<std::string> lookup;
+
+    for (size_t i = kKeys; i-- > 0; ) {
+      lookup.push_back(keys[i]);
+
+      if (i % 10 == 0) {
+        lookup.push_back("scatter:missing:" + std::to_string(i));
+      }
+    }
+
+    lookup.push_back(keys[0]);
+
+    std::vector<boost::optional<int>> values;
+    BOOST_VERIFY(scatter.MGet(lookup, values));
+    BOOST_VERIFY(values.size() == lookup.size());
+
+    for (size_t i = 0; i < lookup.size(); ++i) {
+      if (lookup[i].compare(0, 16, "scatter:missing:") == 0) {
+        BOOST_VERIFY(!values[i]);
+      }
+      else {
+        BOOST_VERIFY(values[i]);
+        BOOST_VERIFY(*values[i] == std::atoi(lookup[i].c_str() + 8));
+      }
+    }
+
+    std::vector<boost::optional<std::string>> strings;
+    BOOST_VERIFY(scatter.MGet({keys[5], "scatter:missing", keys[3]}, strings));
+    BOOST_VERIFY(strings.size() == 3);
+    BOOST_VERIFY(strings[0] && *strings[0] == "5");
+    BOOST_VERIFY(!strings[1]);
+    BOOST_VERIFY(strings[2] && *strings[2] == "3");
+
+    // Totals over every shard.
+    int64_t const existing = scatter.Exists(lookup);
+    BOOST_VERIFY(existing == static_cast<int64_t>(kKeys + 1));
+
+    std::vector<std::string> const half(keys.begin(), keys.begin() + kKeys / 2);
+    std::vector<std::string> const rest(keys.begin() + kKeys / 2, keys.end());
+
+    int64_t const deleted = scatter.Del(half);
+    BOOST_VERIFY(deleted == static_cast<int64_t>(kKeys / 2));
+
+    int64_t const unlinked = scatter.Unlink(keys);
+    BOOST_VERIFY(unlinked == static_cast<int64_t>(rest.size()));
+
+    // A shard that went away fails the call, without leaving replies behind
+    //   on the others, whether it is found out writing or reading.
+    {
+      std::vector<Ptr> with_down;
+      with_down.push_back(Unreachable());
+
+      for (int const port : ports) {
+        with_down.emplace_back(new Connection(constants::kDefaultHost, port));
+      }
+
+      ShardedConnection partial(std::move(with_down));
+      ScatterGather partial_scatter(partial, kBatchKeys);
+
+      BOOST_VERIFY(!partial_scatter.MSet(pairs));
+      BOOST_VERIFY(!partial_scatter.MSet(pairs));
+      BOOST_VERIFY(!partial_scatter.Exists(keys));
+
+      // Every other shard is in step and holds the keys it owns.
+      for (size_t i = 1; i < partial.NumShards(); ++i) {
+        int64_t const stored = partial.shard(i).Cmd("DBSIZE");
+        BOOST_VERIFY(stored > 0);
+
+        for (auto const &key : keys) {
+          if (partial.ShardIndex(key) == i) {
+            std::string const value = partial.shard(i).Cmd("GET", key);
+            BOOST_VERIFY(value == key.substr(8));
+          }
+        }
+
+        std::vector<std::string> del = {"DEL"};
+        del.insert(del.end(), keys.begin(), keys.end());
+
+        Pipeline(partial.shard(i)).AddArgv(del).ExecuteRaw();
+      }
+    }
+
+    for (size_t i = 0; i < sharded.NumShards(); ++i) {
+      int64_t const size_after = sharded.shard(i).Cmd("DBSIZE");
+
+      BOOST_VERIFY_MSG(
+        size_after == 0,
+        "RedisWraps tests must not leave db state with any observable modifications."
+      );
+    }
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Scatter/gather tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Bulk script loading from the test/lua fixtures.  Run from the project
+//   root, against a local Redis whose script cache may be flushed:
+//
+//   rrtest_scripts [port]
+//
+namespace {
+
+// How many SCRIPT subcommands Redis ran so far, per INFO commandstats.
+int64_t const ScriptCalls(Connection &redis) {
+  ReplyPtr reply = redis.RawCmd("INFO", "commandstats");
+  BOOST_VERIFY(reply && reply->str != nullptr);
+
+  int64_t calls = 0;
+
+  // "cmdstat_script" before Redis 7, "cmdstat_script|load" and so on since.
+  for (auto const &field :
+       utils::ParseInfo(std::string(reply->str, reply->len))) {
+    if (field.first.compare(0, 14, "cmdstat_script") == 0) {
+      auto const stats = introspect::ParseInfoValue(field.second);
+      calls += std::atoll(stats.at("calls").c_str());
+    }
+  }
+
+  return calls;
+}
+
+
+void VerifyPointless(Connection &redis) {
+  BOOST_VERIFY(redis.NumResponses() == 5);
+
+  std::string const first = redis.Response();
+  BOOST_VERIFY(first == "This");
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("SCRIPT", "FLUSH");
+
+    // A directory: one SCRIPT EXISTS, then a SCRIPT LOAD per missing script.
+    int64_t calls = ScriptCalls(redis);
+
+    BOOST_VERIFY(redis.LoadScripts("test/lua"));
+    BOOST_VERIFY(Connection::HasScript("pointless"));
+    BOOST_VERIFY(ScriptCalls(redis) == calls + 2);
+
+    redis.Cmd("pointless");
+    VerifyPointless(redis);
+
+    // Aliases already registered: nothing to do, no round trip at all.
+    calls = ScriptCalls(redis);
+
+    BOOST_VERIFY(redis.LoadScripts("test/lua"));
+    BOOST_VERIFY(ScriptCalls(redis) == calls);
+
+    // Reloaded, but Redis has them cached already: SCRIPT EXISTS only.
+    BOOST_VERIFY(redis.LoadScripts("test/lua", true));
+    BOOST_VERIFY(ScriptCalls(redis) == calls + 1);
+
+    // A manifest, with a keycount, naming a script Redis has cached.
+    calls = ScriptCalls(redis);
+
+    BOOST_VERIFY(redis.LoadScripts("test/lua/scripts.manifest"));
+    BOOST_VERIFY(Connection::HasScript("pointless_keyed"));
+    BOOST_VERIFY(ScriptCalls(redis) == calls + 1);
+
+    redis.Cmd("pointless_keyed", "scripts:unused");
+    VerifyPointless(redis);
+
+    // Reloaded after Redis lost them: loaded again.
+    redis.Cmd("SCRIPT", "FLUSH");
+    calls = ScriptCalls(redis);
+
+    BOOST_VERIFY(redis.LoadScripts("test/lua", true));
+    BOOST_VERIFY(ScriptCalls(redis) == calls + 2);
+
+    redis.Cmd("pointless");
+    VerifyPointless(redis);
+
+    // Nothing to list.
+    BOOST_VERIFY(!redis.LoadScripts("test/lua/missing"));
+    BOOST_VERIFY(!Connection::HasScript("missing"));
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Script loading tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <rediswraps/sharded.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Distribution quality of the consistent hash ring.  Needs no Redis server.
+int main(int const argc, char const *argv[]) {
+  constexpr size_t kNodes = 10;
+  constexpr size_t kKeys  = 1000000;
+
+  HashRing ring;
+
+  for (size_t i = 0; i < kNodes; ++i) {
+    ring.Add("10.0.0." + std::to_string(i + 1) + ":6379");
+  }
+
+  std::vector<size_t> owners(kKeys);
+  std::vector<size_t> counts(kNodes, 0);
+
+  for (size_t i = 0; i < kKeys; ++i) {
+    owners[i] = ring.Locate("key:" + std::to_string(i));
+    ++counts[owners[i]];
+  }
+
+  // Spread: with 160 points per node each node should get its fair share
+  //   give or take a few percent.
+  double const mean = static_cast<double>(kKeys) / kNodes;
+  double variance = 0.0;
+
+  for (auto const count : counts) {
+    std::cout << "  node share: " << count / mean << std::endl;
+
+    BOOST_VERIFY(std::fabs(count - mean) / mean < 0.2);
+    variance += (count - mean) * (count - mean) / kNodes;
+  }
+
+  double const cv = std::sqrt(variance) / mean;
+  std::cout << "coefficient of variation = " << cv << std::endl;
+  BOOST_VERIFY(cv < 0.1);
+
+  // Adding a node must only move keys onto that node, and about 1/(N+1)
+  //   of them.
+  size_t const added = ring.Add("10.0.0.11:6379");
+  size_t moved = 0;
+
+  for (size_t i = 0; i < kKeys; ++i) {
+    size_t const owner = ring.Locate("key:" + std::to_string(i));
+
+    if (owner != owners[i]) {
+      BOOST_VERIFY(owner == added);
+      ++moved;
+    }
+  }
+
+  double const moved_share = static_cast<double>(moved) / kKeys;
+  std::cout << "moved on add = " << moved_share << std::endl;
+  BOOST_VERIFY(std::fabs(moved_share - 1.0 / (kNodes + 1)) < 0.03);
+
+  // Removing it again must put every key back where it was.
+  BOOST_VERIFY(ring.Remove("10.0.0.11:6379"));
+
+  for (size_t i = 0; i < kKeys; ++i) {
+    BOOST_VERIFY(ring.Locate("key:" + std::to_string(i)) == owners[i]);
+  }
+
+  // Removing an original node only moves the keys it owned.
+  BOOST_VERIFY(ring.Remove("10.0.0.1:6379"));
+
+  for (size_t i = 0; i < kKeys; ++i) {
+    if (owners[i] != 0) {
+      // Indices above the removed node shift down by one.
+      BOOST_VERIFY(ring.Locate("key:" + std::to_string(i)) == owners[i] - 1);
+    }
+  }
+
+  // Hash tags keep related keys together.
+  BOOST_VERIFY(
+    ring.Locate("{user:42}:name") == ring.Locate("{user:42}:email")
+  );
+  BOOST_VERIFY(HashRing::Position("{}x") != HashRing::Position("{}y"));
+
+  std::cout << "Sharding distribution tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Collapses concurrent identical reads and caches replies, against a local
+//   Redis:
+//
+//   rrtest_singleflight [port]
+//
+namespace {
+
+constexpr size_t kThreads = 8;
+
+// How many GETs "conn"'s server served so far, per INFO commandstats.
+int64_t const GetCalls(Connection &conn) {
+  ReplyPtr reply = conn.RawCmd("INFO", "commandstats");
+
+  BOOST_VERIFY(
+    reply &&
+    (reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_VERB)
+  );
+
+  auto const fields = utils::ParseInfo(std::string(reply->str, reply->len));
+  auto const get = fields.find("cmdstat_get");
+
+  if (get == fields.end()) {
+    return 0;
+  }
+
+  auto const calls = introspect::ParseInfoValue(get->second).find("calls");
+  return std::atoll(calls->second.c_str());
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    redis.Cmd("SET", "singleflight:page", "home");
+    redis.Cmd("HSET", "singleflight:hash", "field", 1);
+
+    // Concurrent identical reads: Redis is paused while every thread asks,
+    //   so they all find the first one's GET still in flight.
+    {
+      SingleFlight flights;
+
+      std::vector<Ptr> conns;
+
+      for (size_t i = 0; i < kThreads; ++i) {
+        conns.emplace_back(new Connection(constants::kDefaultHost, port));
+      }
+
+      // COMMAND INFO is looked up once and cached, before the pause.
+      BOOST_VERIFY(IsReadOnlyCommand(redis, "GET"));
+
+      int64_t const gets_before = GetCalls(redis);
+
+      redis.Cmd("CLIENT", "PAUSE", 300);
+
+      std::vector<std::string> pages(kThreads);
+      std::vector<std::thread> threads;
+
+      for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i]() {
+          std::string const page =
+            flights.Cmd(*conns[i], "GET", "singleflight:page");
+          pages[i] = page;
+        });
+      }
+
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      for (auto const &page : pages) {
+        BOOST_VERIFY(page == "home");
+      }
+
+      SingleFlightStats const stats = flights.stats();
+      BOOST_VERIFY(stats.requests  == kThreads);
+      BOOST_VERIFY(stats.sent      == 1);
+      BOOST_VERIFY(stats.collapsed == kThreads - 1);
+      BOOST_VERIFY(stats.cache_hits == 0);
+
+      BOOST_VERIFY(GetCalls(redis) == gets_before + 1);
+
+      // Each waiter got its reply on its own connection's queue as well.
+      for (auto &conn : conns) {
+        BOOST_VERIFY(conn->NumResponses() == 1);
+        std::string const queued = conn->Response();
+        BOOST_VERIFY(queued == "home");
+      }
+
+      // Writes are never collapsed.
+      flights.Cmd(*conns[0], "SET", "singleflight:page", "about");
+      flights.Cmd(*conns[1], "SET", "singleflight:page", "home");
+      BOOST_VERIFY(flights.stats().bypassed == 2);
+      BOOST_VERIFY(flights.stats().sent == 1);
+
+      for (auto &conn : conns) {
+        conn->Flush();
+      }
+    }
+
+    // The cache serves identical reads issued after the reply arrived.
+    {
+      SingleFlightOptions options;
+      options.cache_ttl = std::chrono::milliseconds(200);
+
+      SingleFlight flights(options);
+
+      std::string const first  = flights.Cmd(redis, "GET", "singleflight:page");
+      std::string const second = flights.Cmd(redis, "GET", "singleflight:page");
+      BOOST_VERIFY(first == "home" && second == "home");
+      BOOST_VERIFY(flights.stats().sent       == 1);
+      BOOST_VERIFY(flights.stats().cache_hits == 1);
+
+      // Different arguments are different commands.
+      flights.Cmd(redis, "HGET", "singleflight:hash", "field");
+      BOOST_VERIFY(flights.stats().sent == 2);
+
+      flights.ClearCache();
+      flights.Cmd(redis, "GET", "singleflight:page");
+      BOOST_VERIFY(flights.stats().sent       == 3);
+      BOOST_VERIFY(flights.stats().cache_hits == 1);
+
+      // Cached replies expire...
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+      flights.Cmd(redis, "GET", "singleflight:page");
+      BOOST_VERIFY(flights.stats().sent == 4);
+
+      // ...and errors are never cached.
+      BOOST_VERIFY(!flights.Cmd(redis, "GET", "singleflight:hash"));
+      BOOST_VERIFY(!flights.Cmd(redis, "GET", "singleflight:hash"));
+      BOOST_VERIFY(flights.stats().sent       == 6);
+      BOOST_VERIFY(flights.stats().cache_hits == 1);
+
+      redis.Flush();
+    }
+
+    // Replies that may differ between identical calls, or that wait for
+    //   data, are never shared nor cached.
+    {
+      redis.Cmd("SADD", "singleflight:set", "a", "b", "c");
+      redis.Cmd("XADD", "singleflight:stream", "*", "field", 1);
+
+      BOOST_VERIFY(DescribeCommand(redis, "RANDOMKEY").random);
+      BOOST_VERIFY(DescribeCommand(redis, "SRANDMEMBER").random);
+      BOOST_VERIFY(DescribeCommand(redis, "HRANDFIELD").random);
+      BOOST_VERIFY(DescribeCommand(redis, "XREAD").blocking);
+
+      CommandInfo const get = DescribeCommand(redis, "GET");
+      BOOST_VERIFY(get.readonly && !get.random && !get.blocking);
+
+      SingleFlightOptions options;
+      options.cache_ttl = std::chrono::milliseconds(1000);
+
+      SingleFlight flights(options);
+
+      for (int i = 0; i < 2; ++i) {
+        std::string const key = flights.Cmd(redis, "RANDOMKEY");
+        BOOST_VERIFY(key.compare(0, 13, "singleflight:") == 0);
+
+        std::string const member =
+          flights.Cmd(redis, "SRANDMEMBER", "singleflight:set");
+        BOOST_VERIFY(member.size() == 1);
+
+        std::string const field =
+          flights.Cmd(redis, "HRANDFIELD", "singleflight:hash");
+        BOOST_VERIFY(field == "field");
+
+        flights.Cmd(
+          redis,
+          "XREAD", "BLOCK", 10, "STREAMS", "singleflight:stream", "$"
+        );
+      }
+
+      SingleFlightStats const stats = flights.stats();
+      BOOST_VERIFY(stats.requests   == 8);
+      BOOST_VERIFY(stats.bypassed   == 8);
+      BOOST_VERIFY(stats.sent       == 0);
+      BOOST_VERIFY(stats.collapsed  == 0);
+      BOOST_VERIFY(stats.cache_hits == 0);
+
+      // Concurrent ones each go out on their own connection.
+      std::vector<Ptr> conns;
+
+      for (size_t i = 0; i < kThreads; ++i) {
+        conns.emplace_back(new Connection(constants::kDefaultHost, port));
+      }
+
+      redis.Cmd("CLIENT", "PAUSE", 100);
+
+      std::vector<std::thread> threads;
+
+      for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i]() {
+          std::string const member =
+            flights.Cmd(*conns[i], "SRANDMEMBER", "singleflight:set");
+          BOOST_VERIFY(member.size() == 1);
+        });
+      }
+
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      BOOST_VERIFY(flights.stats().bypassed == 8 + kThreads);
+      BOOST_VERIFY(flights.stats().collapsed == 0);
+
+      redis.Flush();
+    }
+
+    redis.Cmd(
+      "DEL",
+      "singleflight:page", "singleflight:hash",
+      "singleflight:set", "singleflight:stream"
+    );
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "SingleFlight tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Streams reply elements to a visitor against a local Redis:
+//
+//   rrtest_stream [port]
+//
+int main(int const argc, char const *argv[]) {
+  constexpr int kElements = 10000;
+
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    Pipeline pipe(redis);
+
+    for (int i = 0; i < kElements; ++i) {
+      pipe.Add("RPUSH", "stream:list", i);
+    }
+
+    pipe.ExecuteRaw();
+
+    redis.Cmd("ZADD", "stream:zset", 1, "one", 2, "two");
+
+    // Every element, in order, and nothing queued.
+    redis.Flush();
+    redis.Cmd<CMD_SAVED>("SET", "stream:queued", "kept");
+
+    int64_t visited = 0;
+    bool in_order = true;
+
+    BOOST_VERIFY(redis.Cmd([&](cmd::Response const &element) {
+      in_order = in_order && static_cast<int64_t>(element) == visited;
+      ++visited;
+      return true;
+    }, "LRANGE", "stream:list", 0, -1));
+
+    BOOST_VERIFY(visited == kElements && in_order);
+    BOOST_VERIFY(redis.NumResponses() == 1);
+
+    // Stopping early: the visitor isn't called again, and the rest of the
+    //   reply is still read off so the next command gets its own reply.
+    visited = 0;
+
+    BOOST_VERIFY(redis.Cmd([&](cmd::Response const &element) {
+      ++visited;
+      return visited < 10;
+    }, "LRANGE", "stream:list", 0, -1));
+
+    BOOST_VERIFY(visited == 10);
+
+    int64_t const length = redis.Cmd("LLEN", "stream:list");
+    BOOST_VERIFY(length == kElements);
+
+    // A visitor that throws stops like one returning false: the exception
+    //   comes out once the reply is read, and the connection carries on.
+    visited = 0;
+    bool thrown = false;
+
+    try {
+      redis.Cmd([&](cmd::Response const &element) -> bool {
+        if (++visited == 10) {
+          throw std::runtime_error("visitor gave up");
+        }
+
+        return true;
+      }, "LRANGE", "stream:list", 0, -1);
+    }
+    catch (std::runtime_error const &e) {
+      thrown = std::string(e.what()) == "visitor gave up";
+    }
+
+    BOOST_VERIFY(thrown && visited == 10);
+
+    int64_t const length_after_throw = redis.Cmd("LLEN", "stream:list");
+    BOOST_VERIFY(length_after_throw == kElements);
+
+    // Nested replies are flattened.
+    std::vector<std::string> flattened;
+
+    BOOST_VERIFY(redis.Cmd([&](cmd::Response const &element) {
+      flattened.push_back(element);
+      return true;
+    }, "ZRANGE", "stream:zset", 0, -1, "WITHSCORES"));
+
+    BOOST_VERIFY(
+      (flattened == std::vector<std::string>{"one", "1", "two", "2"})
+    );
+
+    // Scalars are one element; errors are not visited.
+    visited = 0;
+
+    BOOST_VERIFY(redis.Cmd([&](cmd::Response const &element) {
+      ++visited;
+      return true;
+    }, "LLEN", "stream:list"));
+
+    BOOST_VERIFY(visited == 1);
+
+    visited = 0;
+
+    BOOST_VERIFY(!redis.Cmd([&](cmd::Response const &element) {
+      ++visited;
+      return true;
+    }, "LRANGE", "stream:zset", 0, -1));
+
+    BOOST_VERIFY(visited == 0);
+
+    redis.Cmd("DEL", "stream:list", "stream:zset", "stream:queued");
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Streaming tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
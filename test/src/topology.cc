@@ -0,0 +1,163 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Expects a primary on port 6379 and a replica of it on port 6380 unless
+//   other ports are given on the command line:
+//
+//   rrtest_topology [primary_port [replica_port ...]]
+//
+// The last replica is shut down (SHUTDOWN NOSAVE) partway through; start it
+//   again before the next run.
+//
+namespace {
+
+// How many GETs "conn" served so far, per INFO commandstats.
+int64_t const GetCalls(Connection &conn) {
+  ReplyPtr reply = conn.RawCmd("INFO", "commandstats");
+
+  BOOST_VERIFY(
+    reply &&
+    (reply->type == REDIS_REPLY_STRING || reply->type == REDIS_REPLY_VERB)
+  );
+
+  auto const fields = utils::ParseInfo(std::string(reply->str, reply->len));
+  auto const get = fields.find("cmdstat_get");
+
+  if (get == fields.end()) {
+    return 0;
+  }
+
+  auto const calls = introspect::ParseInfoValue(get->second).find("calls");
+  return std::atoll(calls->second.c_str());
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const primary_port = (argc > 1) ? std::atoi(argv[1]) : 6379;
+
+    std::vector<int> replica_ports;
+
+    for (int i = 2; i < argc; ++i) {
+      replica_ports.push_back(std::atoi(argv[i]));
+    }
+
+    if (replica_ports.empty()) {
+      replica_ports.push_back(6380);
+    }
+
+    // The topology's own connections are moved into it; these ones watch
+    //   the same servers from the outside.
+    std::vector<Ptr> replicas;
+    std::vector<Ptr> observers;
+
+    for (int const port : replica_ports) {
+      replicas.emplace_back(new Connection(constants::kDefaultHost, port));
+      observers.emplace_back(new Connection(constants::kDefaultHost, port));
+    }
+
+    TopologyConnection redis(
+      Ptr(new Connection(constants::kDefaultHost, primary_port)),
+      std::move(replicas)
+    );
+
+    int64_t const size_before = redis.primary().Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    BOOST_VERIFY_MSG(
+      redis.NumHealthyReplicas() == replica_ports.size(),
+      "Not every replica is healthy.  Start them with --replicaof."
+    );
+
+    // Classification comes from COMMAND INFO.
+    BOOST_VERIFY( IsReadOnlyCommand(redis.primary(), "GET"));
+    BOOST_VERIFY( IsReadOnlyCommand(redis.primary(), "lrange"));
+    BOOST_VERIFY(!IsReadOnlyCommand(redis.primary(), "SET"));
+    BOOST_VERIFY(!DescribeCommand(redis.primary(), "notacommand").known);
+
+    // Writes go to the primary...
+    redis.Cmd("SET", "foo", 123);
+    redis.Cmd("rpush", "bar", 1, "2", 3.4);
+
+    // ...and only become readable once they have replicated.
+    redis.primary().Cmd("WAIT", static_cast<int>(replica_ports.size()), 1000);
+    redis.Refresh();
+
+    // Reads are served by a replica, not by the primary.
+    int64_t const primary_gets = GetCalls(redis.primary());
+    int64_t replica_gets = 0;
+
+    for (auto &observer : observers) {
+      replica_gets += GetCalls(*observer);
+    }
+
+    int const foo = redis.Cmd("GET", "foo");
+    BOOST_VERIFY(foo == 123);
+
+    int64_t replica_gets_after = 0;
+
+    for (auto &observer : observers) {
+      replica_gets_after += GetCalls(*observer);
+    }
+
+    BOOST_VERIFY(replica_gets_after == replica_gets + 1);
+    BOOST_VERIFY(GetCalls(redis.primary()) == primary_gets);
+
+    redis.Cmd("lrange", "bar", 0, -1);
+    BOOST_VERIFY(redis.NumResponses() == 3);
+
+    int const one = redis.Response();
+    BOOST_VERIFY(one == 1);
+
+    // A replica that goes down is skipped, and reads it was about to serve
+    //   fall back to the primary.
+    try {
+      observers.back()->RawCmd("SHUTDOWN", "NOSAVE");
+    }
+    catch (std::exception const&) {
+      // It can't be reconnected to once it's down, which is the point.
+    }
+
+    for (size_t i = 0; i < replica_ports.size(); ++i) {
+      int const still_foo = redis.Cmd("GET", "foo");
+      BOOST_VERIFY(still_foo == 123);
+    }
+
+    redis.Refresh();
+    BOOST_VERIFY(redis.NumHealthyReplicas() == replica_ports.size() - 1);
+
+    if (replica_ports.size() == 1) {
+      BOOST_VERIFY(GetCalls(redis.primary()) == primary_gets + 1);
+    }
+
+    redis.Cmd("del", "foo", "bar");
+
+    int64_t const size_after = redis.primary().Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Topology tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
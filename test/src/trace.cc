@@ -0,0 +1,296 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Records a span per command, pipelined or not, against a local Redis:
+//
+//   rrtest_trace [port]
+//
+// Both the library and this test must be built with
+//   -DREDISWRAPS_TRACER=rediswraps::trace::SpanRecorder; without it there
+//   is nothing to record, and the test is skipped.
+//
+namespace {
+
+using trace::SpanRecorder;
+
+// The raw JSON value of "key" in "span": quoted strings keep their quotes.
+std::string Field(std::string const &span, std::string const &key) {
+  std::string const quoted = "\"" + key + "\":";
+  size_t const at = span.find(quoted);
+
+  BOOST_VERIFY_MSG(at != std::string::npos, key.c_str());
+
+  size_t const from = at + quoted.size();
+  size_t to = from;
+
+  if (span[from] == '"') {
+    to = span.find('"', from + 1) + 1;
+  }
+  else {
+    to = span.find_first_of(",}", from);
+  }
+
+  return span.substr(from, to - from);
+}
+
+// Checks the fields of a command's span.
+void VerifySpan(
+    std::string const &span,
+    std::string const &operation,
+    size_t const argc,
+    size_t const request_bytes,
+    size_t const reply_bytes,
+    bool const success
+) {
+  BOOST_VERIFY(Field(span, "name") == "\"redis " + operation + "\"");
+  BOOST_VERIFY(Field(span, "kind") == "\"SPAN_KIND_CLIENT\"");
+  BOOST_VERIFY(Field(span, "db.system") == "\"redis\"");
+  BOOST_VERIFY(Field(span, "db.operation") == "\"" + operation + "\"");
+  BOOST_VERIFY(Field(span, "rediswraps.argc") == std::to_string(argc));
+  BOOST_VERIFY(
+    Field(span, "rediswraps.request_bytes") == std::to_string(request_bytes)
+  );
+  BOOST_VERIFY(
+    Field(span, "rediswraps.reply_bytes") == std::to_string(reply_bytes)
+  );
+  BOOST_VERIFY(
+    Field(span, "code") ==
+      (success ? "\"STATUS_CODE_OK\"" : "\"STATUS_CODE_ERROR\"")
+  );
+  BOOST_VERIFY(
+    std::stoll(Field(span, "startTimeUnixNano").substr(1)) <=
+      std::stoll(Field(span, "endTimeUnixNano").substr(1))
+  );
+}
+
+// Empties the ring buffer, keeping its capacity.
+void Reset(size_t const capacity) {
+  SpanRecorder::ToRingBuffer(0);
+  SpanRecorder::ToRingBuffer(capacity);
+}
+
+// A connection to a local port that is closed right after it connects, so
+//   that reconnecting it fails.
+Ptr Unreachable() {
+  int const listener = socket(AF_INET, SOCK_STREAM, 0);
+
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  socklen_t length = sizeof(address);
+
+  BOOST_VERIFY(
+    bind(listener, reinterpret_cast<sockaddr*>(&address), length) == 0
+  );
+  BOOST_VERIFY(listen(listener, 1) == 0);
+  BOOST_VERIFY(
+    getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0
+  );
+
+  Ptr conn(new Connection(constants::kDefaultHost, ntohs(address.sin_port)));
+
+  close(listener);
+  return conn;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  if (!trace::Tracer::kEnabled) {
+    std::cout << "Tracing tests skipped: built without REDISWRAPS_TRACER."
+              << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  constexpr size_t kCapacity = 64;
+
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    Reset(kCapacity);
+
+    // One span per command, with its sizes and outcome.
+    {
+      redis.Cmd("SET", "trace:key", "value");
+
+      std::string const value = redis.Cmd("GET", "trace:key");
+      BOOST_VERIFY(value == "value");
+
+      ReplyPtr const error = redis.RawCmd("INCR", "trace:key");
+      BOOST_VERIFY(error && error->type == REDIS_REPLY_ERROR);
+
+      std::vector<std::string> const spans = SpanRecorder::Spans();
+      BOOST_VERIFY(spans.size() == 3);
+
+      VerifySpan(spans[0], "SET",  3, 17, 2, true);
+      VerifySpan(spans[1], "GET",  2, 12, 5, true);
+      VerifySpan(spans[2], "INCR", 2, 13, error->len, false);
+
+      BOOST_VERIFY(
+        Field(spans[2], "message").find("not an integer") != std::string::npos
+      );
+      BOOST_VERIFY(Field(spans[0], "net.peer.port") == std::to_string(port));
+    }
+
+    // Every pipelined command gets its own span, in order.
+    {
+      Reset(kCapacity);
+
+      Pipeline pipe(redis);
+      pipe.Add("GET", "trace:key")
+          .Add("INCR", "trace:key")
+          .AddArgv({"DEL", "trace:key", "trace:other"});
+
+      std::vector<ReplyPtr> const replies = pipe.ExecuteRaw();
+      BOOST_VERIFY(replies.size() == 3);
+
+      std::vector<std::string> const spans = SpanRecorder::Spans();
+      BOOST_VERIFY(spans.size() == 3);
+
+      VerifySpan(spans[0], "GET",  2, 12, 5, true);
+      VerifySpan(spans[1], "INCR", 2, 13, replies[1]->len, false);
+      VerifySpan(spans[2], "DEL",  3, 23, 0, true);
+    }
+
+    // Reconnecting is a span of its own, failed if the server is gone.
+    {
+      Connection conn(constants::kDefaultHost, port);
+      conn.Cmd("PING");
+
+      redis.Cmd("CLIENT", "KILL", "TYPE", "normal", "SKIPME", "yes");
+      Reset(kCapacity);
+
+      std::string const pong = conn.Cmd("PING");
+      BOOST_VERIFY(pong == "PONG");
+
+      std::vector<std::string> spans = SpanRecorder::Spans();
+      BOOST_VERIFY(spans.size() == 2);
+
+      BOOST_VERIFY(Field(spans[0], "name") == "\"redis RECONNECT\"");
+      BOOST_VERIFY(Field(spans[0], "code") == "\"STATUS_CODE_OK\"");
+      VerifySpan(spans[1], "PING", 1, 4, 4, true);
+
+      Ptr const gone = Unreachable();
+      Reset(kCapacity);
+
+      bool threw = false;
+
+      try {
+        gone->RawCmd("PING");
+      }
+      catch (std::runtime_error const &e) {
+        threw = true;
+      }
+
+      BOOST_VERIFY(threw);
+
+      spans = SpanRecorder::Spans();
+      BOOST_VERIFY(!spans.empty());
+      BOOST_VERIFY(Field(spans.back(), "name") == "\"redis RECONNECT\"");
+      BOOST_VERIFY(Field(spans.back(), "code") == "\"STATUS_CODE_ERROR\"");
+      BOOST_VERIFY(
+        Field(spans.back(), "message") == "\"reconnection failed\""
+      );
+    }
+
+    // The ring buffer keeps only the latest spans, oldest first, and takes
+    //   a parent span's ids when given one.
+    {
+      Reset(2);
+
+      std::string const trace_id(32, 'a');
+      std::string const parent_id(16, 'b');
+
+      redis.Cmd("ECHO", "first");
+      SpanRecorder::SetParent(trace_id, parent_id);
+      redis.Cmd("ECHO", "second");
+      redis.Cmd("ECHO", "third");
+      SpanRecorder::SetParent("", "");
+
+      std::vector<std::string> const spans = SpanRecorder::Spans();
+      BOOST_VERIFY(spans.size() == 2);
+
+      VerifySpan(spans[0], "ECHO", 2, 10, 6, true);
+      VerifySpan(spans[1], "ECHO", 2,  9, 5, true);
+
+      for (auto const &span : spans) {
+        BOOST_VERIFY(Field(span, "traceId") == "\"" + trace_id + "\"");
+        BOOST_VERIFY(Field(span, "parentSpanId") == "\"" + parent_id + "\"");
+        BOOST_VERIFY(Field(span, "spanId").size() == 16 + 2);
+      }
+
+      SpanRecorder::ToRingBuffer(0);
+      redis.Cmd("PING");
+      BOOST_VERIFY(SpanRecorder::Spans().empty());
+    }
+
+    // Spans go to a file one JSON object per line.
+    {
+      char path[] = "/tmp/rrtest_trace.XXXXXX";
+      int const fd = mkstemp(path);
+      BOOST_VERIFY(fd >= 0);
+      close(fd);
+
+      BOOST_VERIFY(SpanRecorder::ToFile(path));
+      redis.Cmd("PING");
+      redis.Cmd("ECHO", "filed");
+      BOOST_VERIFY(SpanRecorder::ToFile(""));
+
+      std::ifstream file(path);
+      std::vector<std::string> lines;
+
+      for (std::string line; std::getline(file, line); ) {
+        lines.push_back(line);
+      }
+
+      std::remove(path);
+
+      BOOST_VERIFY(lines.size() == 2);
+      BOOST_VERIFY(lines[0].front() == '{' && lines[0].back() == '}');
+      VerifySpan(lines[0], "PING", 1, 4, 4, true);
+      VerifySpan(lines[1], "ECHO", 2, 9, 5, true);
+    }
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Tracing tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,306 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/capability.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include <boost/assert.hpp>
+
+
+// Drives several connections at once through a UringDriver, against a
+//   local Redis:
+//
+//   rrtest_uring [port]
+//
+// Only with a library built with -DREDISWRAPS_WITH_IO_URING=ON; otherwise,
+//   or if the kernel has no io_uring for us, the test is skipped.
+//
+#ifdef REDISWRAPS_WITH_IO_URING
+
+namespace {
+
+constexpr size_t kConnections = 4;
+constexpr size_t kCommands    = 200;
+
+// Small enough that a round of commands takes several writes, and a large
+//   reply several reads.
+constexpr size_t kBufferSize = 512;
+
+using Connections = std::vector<std::unique_ptr<Connection>>;
+
+std::string const Key(size_t const conn, std::string const &name) {
+  return "uring:" + std::to_string(conn) + ":" + name;
+}
+
+
+// Queues a mix of commands on every connection, each of whose replies can
+//   only be right if it came back to its own connection, in order.
+//   Returns the number of replies that will be checked.
+size_t const Queue(
+    UringDriver &driver,
+    std::vector<size_t> const &indexes,
+    std::vector<int64_t> const &client_ids,
+    std::vector<size_t> &checked
+) {
+  size_t queued = 0;
+
+  for (size_t c = 0; c < indexes.size(); ++c) {
+    size_t const index = indexes[c];
+    std::string const large(3 * kBufferSize + c, static_cast<char>('a' + c));
+
+    auto const check = [&checked, c](bool const ok) {
+      BOOST_VERIFY(ok);
+      ++checked[c];
+    };
+
+    driver.Cmd(index, [check, &client_ids, c](ReplyPtr reply) {
+      check(
+        reply && reply->type == REDIS_REPLY_INTEGER &&
+        reply->integer == client_ids[c]
+      );
+    }, "CLIENT", "ID");
+
+    driver.Cmd(index, [check](ReplyPtr reply) {
+      check(reply && reply->type == REDIS_REPLY_STATUS);
+    }, "SET", Key(c, "large"), large);
+
+    for (size_t i = 0; i < kCommands; ++i) {
+      std::string const echo = std::to_string(c) + ":" + std::to_string(i);
+
+      driver.Cmd(index, [check, echo](ReplyPtr reply) {
+        check(reply && std::string(reply->str, reply->len) == echo);
+      }, "ECHO", echo);
+
+      driver.Cmd(index, [check, i](ReplyPtr reply) {
+        check(
+          reply && reply->type == REDIS_REPLY_INTEGER &&
+          reply->integer == static_cast<long long>(i + 1)
+        );
+      }, "INCR", Key(c, "counter"));
+    }
+
+    // Spans several reads.
+    driver.Cmd(index, [check, large](ReplyPtr reply) {
+      check(reply && std::string(reply->str, reply->len) == large);
+    }, "GET", Key(c, "large"));
+
+    driver.Cmd(index, [check](ReplyPtr reply) {
+      check(reply && reply->type == REDIS_REPLY_ERROR);
+    }, "INCR", Key(c, "large"));
+
+    // A callback may queue more; Run() waits for those as well.
+    driver.Cmd(index, [check, &driver, index, c](ReplyPtr reply) {
+      check(reply && reply->integer == 2);
+
+      driver.Cmd(index, [check](ReplyPtr reply) {
+        check(reply && reply->integer == 0);
+      }, "EXISTS", Key(c, "large"));
+    }, "DEL", Key(c, "large"), Key(c, "counter"));
+
+    queued += 2 * kCommands + 6;
+  }
+
+  return queued;
+}
+
+
+// Runs a round of Queue() and checks that every reply came back right.
+void Round(
+    UringDriver &driver,
+    std::vector<size_t> const &indexes,
+    std::vector<int64_t> const &client_ids
+) {
+  std::vector<size_t> checked(indexes.size(), 0);
+  size_t const queued = Queue(driver, indexes, client_ids, checked);
+
+  BOOST_VERIFY(driver.Run() == queued);
+  BOOST_VERIFY(driver.pending() == 0);
+
+  for (size_t const count : checked) {
+    BOOST_VERIFY(count == queued / indexes.size());
+  }
+}
+
+
+// Caps the memory io_uring may lock, which covers its rings and registered
+//   buffers, and drops the CAP_IPC_LOCK that would lift the cap.  Applies
+//   to rings set up from then on.
+void LimitLockedMemory(rlim_t const bytes) {
+  struct __user_cap_header_struct header = {_LINUX_CAPABILITY_VERSION_3, 0};
+  struct __user_cap_data_struct data[2] = {};
+
+  BOOST_VERIFY(syscall(SYS_capget, &header, data) == 0);
+  data[CAP_TO_INDEX(CAP_IPC_LOCK)].effective &= ~CAP_TO_MASK(CAP_IPC_LOCK);
+  BOOST_VERIFY(syscall(SYS_capset, &header, data) == 0);
+
+  struct rlimit limit;
+  BOOST_VERIFY(getrlimit(RLIMIT_MEMLOCK, &limit) == 0);
+
+  limit.rlim_cur = bytes;
+  BOOST_VERIFY(setrlimit(RLIMIT_MEMLOCK, &limit) == 0);
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  try {
+    int const port = (argc > 1) ? std::atoi(argv[1]) : constants::kDefaultPort;
+    Connection redis(constants::kDefaultHost, port);
+
+    int64_t const size_before = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_before == 0,
+      "RedisWraps tests will not run against existing Redis data.\n"
+      "  Either backup and flush this db or spawn a new instance."
+    );
+
+    std::unique_ptr<UringDriver> driver;
+
+    try {
+      driver.reset(
+        new UringDriver(constants::kUringQueueDepth, kBufferSize)
+      );
+    }
+    catch (std::runtime_error const &e) {
+      // No io_uring here (old kernel, seccomp...): a clean error, and the
+      //   connections work as ever without it.
+      std::string const pong = redis.Cmd("PING");
+      BOOST_VERIFY(pong == "PONG");
+
+      std::cout << "UringDriver tests skipped: " << e.what() << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    Connections conns;
+    std::vector<size_t>  indexes;
+    std::vector<int64_t> client_ids;
+
+    for (size_t c = 0; c < kConnections; ++c) {
+      conns.emplace_back(new Connection(constants::kDefaultHost, port));
+
+      int64_t const id = conns.back()->Cmd("CLIENT", "ID");
+      client_ids.push_back(id);
+      indexes.push_back(driver->Attach(*conns.back()));
+    }
+
+    // Every reply to its own connection, across short writes and reads.
+    Round(*driver, indexes, client_ids);
+
+    UringStats const stats = driver->stats();
+    BOOST_VERIFY(stats.failed == 0);
+    BOOST_VERIFY(stats.writes > 2 * kConnections);
+    BOOST_VERIFY(stats.reads > 2 * kConnections);
+    BOOST_VERIFY(stats.submits < stats.writes + stats.reads);
+
+    // A connection killed under the driver fails its own replies only...
+    {
+      std::string const kill = std::to_string(client_ids[1]);
+      redis.Cmd("CLIENT", "KILL", "ID", kill);
+
+      size_t failed = 0;
+      size_t fine   = 0;
+
+      for (size_t c = 0; c < kConnections; ++c) {
+        driver->Cmd(indexes[c], [&failed, &fine, c](ReplyPtr reply) {
+          if (c == 1) {
+            failed += !reply;
+          }
+          else {
+            fine += (reply && std::string(reply->str, reply->len) == "PONG");
+          }
+        }, "PING");
+      }
+
+      driver->Run();
+
+      BOOST_VERIFY(failed == 1);
+      BOOST_VERIFY(fine == kConnections - 1);
+      BOOST_VERIFY(driver->stats().failed == 1);
+    }
+
+    // ...and is reconnected along with its next commands.
+    {
+      BOOST_VERIFY(!conns[1]->IsConnected());
+
+      driver->Cmd(indexes[1], [&client_ids](ReplyPtr reply) {
+        BOOST_VERIFY(reply && reply->type == REDIS_REPLY_INTEGER);
+        client_ids[1] = reply->integer;
+      }, "CLIENT", "ID");
+
+      BOOST_VERIFY(driver->Run() == 1);
+      BOOST_VERIFY(conns[1]->IsConnected());
+
+      Round(*driver, indexes, client_ids);
+    }
+
+    // With room for its rings but not its buffers, a driver falls back to
+    //   plain reads and writes...
+    LimitLockedMemory(256 * 1024);
+
+    {
+      UringDriver plain(constants::kUringQueueDepth, 64 * 1024);
+      std::vector<size_t> plain_indexes;
+
+      for (auto &conn : conns) {
+        plain_indexes.push_back(plain.Attach(*conn));
+      }
+
+      Round(plain, plain_indexes, client_ids);
+      BOOST_VERIFY(!plain.registered_buffers());
+    }
+
+    // ...and without even that, there is no io_uring: a clean error, and
+    //   the connections go on without it.
+    LimitLockedMemory(0);
+
+    bool refused = false;
+
+    try {
+      UringDriver none;
+    }
+    catch (std::runtime_error const&) {
+      refused = true;
+    }
+
+    BOOST_VERIFY(refused);
+
+    for (auto &conn : conns) {
+      std::string const pong = conn->Cmd("PING");
+      BOOST_VERIFY(pong == "PONG");
+    }
+
+    int64_t const size_after = redis.Cmd("DBSIZE");
+
+    BOOST_VERIFY_MSG(
+      size_after == 0,
+      "RedisWraps tests must not leave db state with any observable modifications."
+    );
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "UringDriver tests passed!" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main() {
+  std::cout << "UringDriver tests skipped: built without io_uring." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef REDISWRAPS_TOOLS_OPTIONS_HH
+#define REDISWRAPS_TOOLS_OPTIONS_HH
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <rediswraps/histogram.hh>
+
+
+// What the programs in tools/src have in common: "--name=value" command
+//   lines, and JSON results with latency percentiles.
+//
+namespace rediswraps {
+namespace tools {
+
+enum class Option {
+  kValid,
+  kInvalid,
+  kUnknown
+};
+
+
+// Sets "out" to "text" read as a T, all of it; false, leaving "out" alone,
+//   if it isn't one.
+template<typename T>
+bool const ParseNumber(std::string const &text, T &out) {
+  std::istringstream stream(text);
+  T value;
+
+  if (!(stream >> value) || !stream.eof()) {
+    return false;
+  }
+
+  out = value;
+  return true;
+}
+
+
+// ParseOptions()
+// Hands the name and value of every "--name=value" argument ("--name"
+//   alone has an empty value) to "option":
+//
+//   Option const option(std::string const &name, std::string const &value);
+//
+// Stops at the first argument that is no option, or that "option" doesn't
+//   know or finds invalid, and returns false after saying so on stderr.
+//
+template<typename OptionHandler>
+bool const ParseOptions(
+    int const argc,
+    char const *argv[],
+    OptionHandler option
+) {
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+
+    if (arg.compare(0, 2, "--") != 0) {
+      std::cerr << "Unexpected argument: " << arg << std::endl;
+      return false;
+    }
+
+    size_t const equals = arg.find('=');
+    std::string const name = arg.substr(2, equals - 2);
+    std::string const value =
+      (equals == std::string::npos) ? "" : arg.substr(equals + 1);
+
+    switch (option(name, value)) {
+    case Option::kValid:
+      break;
+    case Option::kInvalid:
+      std::cerr << "Invalid value: " << arg << std::endl;
+      return false;
+    case Option::kUnknown:
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// Writes the count, mean, min, max and usual percentiles of "histogram" as
+//   a JSON object.  Latencies are recorded in nanoseconds and reported in
+//   microseconds.
+inline
+void WriteStats(std::ostream &out, LatencyHistogram const &histogram) {
+  auto const us = [](double const ns) { return ns / 1000.0; };
+
+  out <<
+    "{\"count\": " << histogram.count() <<
+    ", \"mean\": " << us(histogram.mean()) <<
+    ", \"min\": " << us(histogram.min());
+
+  struct {
+    char const *name;
+    double      percentile;
+  } const percentiles[] = {
+    {"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p99.9", 99.9}, {"p99.99", 99.99}
+  };
+
+  for (auto const &p : percentiles) {
+    out << ", \"" << p.name << "\": " << us(histogram.Percentile(p.percentile));
+  }
+
+  out << ", \"max\": " << us(histogram.max()) << "}";
+}
+
+
+// Calls "write" with std::cout if "path" is empty, or else with the file
+//   at "path".  Returns false, after saying so on stderr, if the file could
+//   not be written.
+template<typename Writer>
+bool const WriteOutput(std::string const &path, Writer write) {
+  if (path.empty()) {
+    write(std::cout);
+    return true;
+  }
+
+  std::ofstream file(path);
+  write(file);
+
+  if (!file) {
+    std::cerr << "Could not write " << path << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace tools
+} // namespace rediswraps
+
+#endif
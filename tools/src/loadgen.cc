@@ -0,0 +1,878 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include "options.hh"
+
+
+// A memtier-style load generator that drives Redis through this library,
+//   i.e. through the very client code applications ship with:
+//
+//   rediswraps_loadgen [--option=value ...]
+//
+// Every thread owns its connections and issues GETs and SETs on a key space
+//   of "keys" keys, either as fast as replies come back (closed loop) or at
+//   a fixed total "rate" (open loop).  Results, latency percentiles included,
+//   are printed as JSON.  See Usage() for the options.
+//
+namespace {
+
+using tools::Option;
+using tools::ParseNumber;
+using tools::ParseOptions;
+using tools::WriteOutput;
+using tools::WriteStats;
+
+using Clock = std::chrono::steady_clock;
+
+enum class Api {
+  kCmd,       // Connection::Cmd(), one round trip per command
+  kPipeline,  // Pipeline::Write() on every connection, then ReadRaw()
+  kUring      // UringDriver over every connection of a thread
+};
+
+char const* ApiName(Api const api) noexcept {
+  switch (api) {
+  case Api::kCmd:      return "cmd";
+  case Api::kPipeline: return "pipeline";
+  case Api::kUring:    return "uring";
+  }
+
+  return "";
+}
+
+
+struct Options {
+  std::string host   = constants::kDefaultHost;
+  int         port   = constants::kDefaultPort;
+  std::string socket;
+  int         protocol = constants::kDefaultProtocol;
+
+  size_t threads     = 4;
+  size_t connections = 4;  // per thread
+
+  Api    api      = Api::kCmd;
+  bool   api_set  = false;
+  size_t pipeline = 1;     // commands in flight per connection
+
+  uint64_t    keys       = 100000;
+  std::string key_prefix = "loadgen:";
+  bool        zipf       = false;
+  double      zipf_exponent = 0.99;
+
+  size_t min_value_size = 32;
+  size_t max_value_size = 32;
+
+  // SETs to GETs, as in memtier's --ratio.
+  unsigned set_ratio = 1;
+  unsigned get_ratio = 10;
+
+  double rate     = 0.0;  // commands per second in all; 0 is closed loop
+  double duration = 10.0; // seconds
+
+  bool     prefill = false;
+  uint64_t seed    = 1;
+
+  std::string output;  // JSON goes to stdout if empty
+};
+
+
+void Usage(char const *name) {
+  std::cerr <<
+    "Usage: " << name << " [--option=value ...]\n"
+    "\n"
+    "  --host=127.0.0.1       --port=6379           --socket=PATH\n"
+    "  --protocol=2           or 3 for RESP3\n"
+    "  --threads=4            --connections=4       (per thread)\n"
+    "  --api=cmd|pipeline|uring\n"
+    "                         cmd: Connection::Cmd(); pipeline: Pipeline,\n"
+    "                         written to all connections then read back;\n"
+    "                         uring: UringDriver (io_uring builds only).\n"
+    "                         Default: cmd, or pipeline with --pipeline > 1.\n"
+    "  --pipeline=1           commands in flight per connection\n"
+    "  --keys=100000          key space size\n"
+    "  --key-prefix=loadgen:\n"
+    "  --distribution=uniform|zipf\n"
+    "  --zipf-exponent=0.99   key 0 is the hottest\n"
+    "  --value-size=32        or MIN-MAX, uniformly distributed\n"
+    "  --ratio=1:10           SETs to GETs\n"
+    "  --rate=0               commands per second in all (open loop);\n"
+    "                         0 sends as fast as replies come (closed loop)\n"
+    "  --duration=10          seconds\n"
+    "  --prefill              SET every key before starting\n"
+    "  --seed=1\n"
+    "  --output=PATH          JSON results (default: stdout)\n";
+}
+
+
+bool const Parse(int const argc, char const *argv[], Options &options) {
+  bool const parsed = ParseOptions(argc, argv, [&](
+      std::string const &name,
+      std::string const &value
+  ) -> Option {
+    bool valid = true;
+
+    if (name == "host") {
+      options.host = value;
+    }
+    else if (name == "port") {
+      valid = ParseNumber(value, options.port);
+    }
+    else if (name == "socket") {
+      options.socket = value;
+    }
+    else if (name == "protocol") {
+      valid = ParseNumber(value, options.protocol) &&
+        (options.protocol == 2 || options.protocol == 3);
+    }
+    else if (name == "threads") {
+      valid = ParseNumber(value, options.threads) && options.threads > 0;
+    }
+    else if (name == "connections") {
+      valid = ParseNumber(value, options.connections) && options.connections > 0;
+    }
+    else if (name == "api") {
+      options.api_set = true;
+
+      if (value == "cmd") {
+        options.api = Api::kCmd;
+      }
+      else if (value == "pipeline") {
+        options.api = Api::kPipeline;
+      }
+      else if (value == "uring") {
+        options.api = Api::kUring;
+      }
+      else {
+        valid = false;
+      }
+    }
+    else if (name == "pipeline") {
+      valid = ParseNumber(value, options.pipeline) && options.pipeline > 0;
+    }
+    else if (name == "keys") {
+      valid = ParseNumber(value, options.keys) && options.keys > 0;
+    }
+    else if (name == "key-prefix") {
+      options.key_prefix = value;
+    }
+    else if (name == "distribution") {
+      options.zipf = (value == "zipf");
+      valid = options.zipf || value == "uniform";
+    }
+    else if (name == "zipf-exponent") {
+      valid = ParseNumber(value, options.zipf_exponent) &&
+        options.zipf_exponent > 0.0;
+    }
+    else if (name == "value-size") {
+      size_t const dash = value.find('-');
+
+      if (dash == std::string::npos) {
+        valid = ParseNumber(value, options.min_value_size);
+        options.max_value_size = options.min_value_size;
+      }
+      else {
+        valid =
+          ParseNumber(value.substr(0, dash), options.min_value_size) &&
+          ParseNumber(value.substr(dash + 1), options.max_value_size) &&
+          options.min_value_size <= options.max_value_size;
+      }
+    }
+    else if (name == "ratio") {
+      size_t const colon = value.find(':');
+
+      valid = colon != std::string::npos &&
+        ParseNumber(value.substr(0, colon), options.set_ratio) &&
+        ParseNumber(value.substr(colon + 1), options.get_ratio) &&
+        options.set_ratio + options.get_ratio > 0;
+    }
+    else if (name == "rate") {
+      valid = ParseNumber(value, options.rate) && options.rate >= 0.0;
+    }
+    else if (name == "duration") {
+      valid = ParseNumber(value, options.duration) && options.duration > 0.0;
+    }
+    else if (name == "prefill") {
+      options.prefill = true;
+    }
+    else if (name == "seed") {
+      valid = ParseNumber(value, options.seed);
+    }
+    else if (name == "output") {
+      options.output = value;
+    }
+    else {
+      return Option::kUnknown;
+    }
+
+    return valid ? Option::kValid : Option::kInvalid;
+  });
+
+  if (!parsed) {
+    return false;
+  }
+
+  if (!options.api_set && options.pipeline > 1) {
+    options.api = Api::kPipeline;
+  }
+
+  if (options.api == Api::kCmd && options.pipeline > 1) {
+    std::cerr << "--api=cmd sends one command at a time; "
+      "use --api=pipeline or --api=uring with --pipeline." << std::endl;
+    return false;
+  }
+
+#ifndef REDISWRAPS_WITH_IO_URING
+  if (options.api == Api::kUring) {
+    std::cerr << "--api=uring needs a library built with "
+      "-DREDISWRAPS_WITH_IO_URING=ON." << std::endl;
+    return false;
+  }
+#endif
+
+  return true;
+}
+
+
+// Zipf
+// Draws ranks from 1 to n with probability proportional to 1 / rank^s, in
+//   constant time and memory whatever n, by rejection-inversion (Hörmann
+//   and Derflinger, "Rejection-inversion to generate variates from monotone
+//   discrete distributions", 1996).
+//
+class Zipf {
+ public:
+  Zipf(uint64_t const n, double const exponent)
+    : n_(n),
+      exponent_(exponent),
+      h_integral_x1_(this->HIntegral(1.5) - 1.0),
+      h_integral_n_(this->HIntegral(n + 0.5)),
+      s_(2.0 - this->HIntegralInverse(this->HIntegral(2.5) - this->H(2.0)))
+  {}
+
+  template<typename Random>
+  uint64_t const operator()(Random &random) const {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    for (;;) {
+      double const u = this->h_integral_n_ +
+        uniform(random) * (this->h_integral_x1_ - this->h_integral_n_);
+      double const x = this->HIntegralInverse(u);
+
+      double k = std::floor(x + 0.5);
+      k = std::min(std::max(k, 1.0), static_cast<double>(this->n_));
+
+      if (k - x <= this->s_ || u >= this->HIntegral(k + 0.5) - this->H(k)) {
+        return static_cast<uint64_t>(k);
+      }
+    }
+  }
+
+ private:
+  double const H(double const x) const {
+    return std::exp(-this->exponent_ * std::log(x));
+  }
+
+  double const HIntegral(double const x) const {
+    double const log_x = std::log(x);
+    return Helper2((1.0 - this->exponent_) * log_x) * log_x;
+  }
+
+  double const HIntegralInverse(double const x) const {
+    double const t = std::max(x * (1.0 - this->exponent_), -1.0);
+    return std::exp(Helper1(t) * x);
+  }
+
+  // log(1 + x) / x and (exp(x) - 1) / x, accurate near 0.
+  static double const Helper1(double const x) {
+    return (std::abs(x) > 1e-8) ?
+      std::log1p(x) / x :
+      1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+  }
+
+  static double const Helper2(double const x) {
+    return (std::abs(x) > 1e-8) ?
+      std::expm1(x) / x :
+      1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+  }
+
+  uint64_t const n_;
+  double const   exponent_;
+  double const   h_integral_x1_;
+  double const   h_integral_n_;
+  double const   s_;
+};
+
+
+// Latencies in nanoseconds, per kind of command.
+struct Latencies {
+  LatencyHistogram get;
+  LatencyHistogram set;
+};
+
+struct Results {
+  uint64_t sets   = 0;
+  uint64_t gets   = 0;
+  uint64_t hits   = 0;
+  uint64_t misses = 0;
+  uint64_t errors = 0;
+
+  // From when each command was due (open loop), or sent (closed loop).
+  Latencies latency;
+
+  // From when each command was actually sent.
+  Latencies service;
+
+  void Add(Results const &other) {
+    this->sets   += other.sets;
+    this->gets   += other.gets;
+    this->hits   += other.hits;
+    this->misses += other.misses;
+    this->errors += other.errors;
+
+    this->latency.get.Add(other.latency.get);
+    this->latency.set.Add(other.latency.set);
+    this->service.get.Add(other.service.get);
+    this->service.set.Add(other.service.set);
+  }
+};
+
+
+Connection* Connect(Options const &options) {
+  return options.socket.empty() ?
+    new Connection(options.host, options.port, "loadgen", options.protocol) :
+    new Connection(options.socket, "loadgen", options.protocol);
+}
+
+
+// Worker
+// One thread's share of the load: its own connections, random numbers and
+//   results, so threads share nothing while they run.
+//
+class Worker {
+ public:
+  Worker(Options const &options, size_t const number, std::string const &payload)
+    : options_(options),
+      payload_(payload),
+      random_(options.seed + number),
+      zipf_(options.keys, options.zipf_exponent)
+  {
+    for (size_t i = 0; i < options.connections; ++i) {
+      this->connections_.emplace_back(Connect(options));
+    }
+
+    size_t const total = options.threads * options.connections;
+
+    if (options.rate > 0.0) {
+      this->interval_ns_ = 1e9 * total / options.rate;
+    }
+
+    // Connections start a fraction of an interval apart, so an open loop
+    //   spreads its commands out instead of sending them in bursts.
+    for (size_t i = 0; i < options.connections; ++i) {
+      double const slot = number * options.connections + i;
+      this->next_ns_.push_back(this->interval_ns_ * slot / total);
+    }
+  }
+
+  void Run(Clock::time_point const start, Clock::time_point const end) {
+#ifdef REDISWRAPS_WITH_IO_URING
+    if (this->options_.api == Api::kUring) {
+      this->driver_.reset(new UringDriver());
+
+      for (auto &conn : this->connections_) {
+        this->driver_->Attach(*conn);
+      }
+    }
+#endif
+
+    std::this_thread::sleep_until(start);
+
+    std::vector<std::vector<Command>> batches(this->connections_.size());
+
+    for (;;) {
+      Clock::time_point const now = Clock::now();
+
+      if (now >= end) {
+        break;
+      }
+
+      double const now_ns = Nanoseconds(now - start);
+      size_t due = 0;
+
+      for (size_t i = 0; i < this->connections_.size(); ++i) {
+        batches[i].clear();
+
+        for (size_t k = 0; k < this->options_.pipeline; ++k) {
+          Command command;
+
+          if (this->interval_ns_ > 0.0) {
+            double const scheduled = this->next_ns_[i];
+
+            if (scheduled > now_ns) {
+              break;
+            }
+
+            command.due = start + std::chrono::nanoseconds(
+              static_cast<int64_t>(scheduled)
+            );
+            this->next_ns_[i] += this->interval_ns_;
+          }
+
+          this->Choose(command);
+          batches[i].push_back(std::move(command));
+          ++due;
+        }
+      }
+
+      if (due == 0) {
+        double const next_ns =
+          *std::min_element(this->next_ns_.begin(), this->next_ns_.end());
+
+        std::this_thread::sleep_until(
+          std::min(end, start + std::chrono::nanoseconds(
+            static_cast<int64_t>(next_ns)
+          ))
+        );
+        continue;
+      }
+
+      switch (this->options_.api) {
+      case Api::kCmd:
+        this->SendCmd(batches);
+        break;
+      case Api::kPipeline:
+        this->SendPipeline(batches);
+        break;
+      case Api::kUring:
+        this->SendUring(batches);
+        break;
+      }
+    }
+  }
+
+  Results const& results() const noexcept {
+    return this->results_;
+  }
+
+  // Why Run() stopped early, if it threw: its thread reports it here so
+  //   that main() can once they have all been joined.
+  void Fail(std::string const &error) {
+    this->error_ = error;
+  }
+
+  std::string const& error() const noexcept {
+    return this->error_;
+  }
+
+ private:
+  struct Command {
+    bool        set = false;
+    std::string key;
+    std::string value;
+
+    Clock::time_point due;  // set when sent in a closed loop
+    Clock::time_point sent;
+  };
+
+  static double const Nanoseconds(Clock::duration const duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  void Choose(Command &command) {
+    unsigned const total = this->options_.set_ratio + this->options_.get_ratio;
+    command.set =
+      std::uniform_int_distribution<unsigned>(1, total)(this->random_) <=
+      this->options_.set_ratio;
+
+    uint64_t const index = this->options_.zipf ?
+      this->zipf_(this->random_) - 1 :
+      std::uniform_int_distribution<uint64_t>(0, this->options_.keys - 1)(this->random_);
+
+    command.key = this->options_.key_prefix + std::to_string(index);
+
+    if (command.set) {
+      size_t const size = std::uniform_int_distribution<size_t>(
+        this->options_.min_value_size, this->options_.max_value_size
+      )(this->random_);
+
+      size_t const offset = std::uniform_int_distribution<size_t>(
+        0, this->payload_.size() - size
+      )(this->random_);
+
+      command.value.assign(this->payload_, offset, size);
+    }
+  }
+
+  void Sent(Command &command, Clock::time_point const now) {
+    command.sent = now;
+
+    if (this->interval_ns_ == 0.0) {
+      command.due = now;
+    }
+  }
+
+  // "missing" is whether a GET found nothing, "failed" whether the command
+  //   failed altogether.
+  void Done(
+      Command const &command,
+      Clock::time_point const now,
+      bool const failed,
+      bool const missing
+  ) {
+    if (failed) {
+      ++this->results_.errors;
+      return;
+    }
+
+    uint64_t const latency = Nanoseconds(now - command.due);
+    uint64_t const service = Nanoseconds(now - command.sent);
+
+    if (command.set) {
+      ++this->results_.sets;
+      this->results_.latency.set.Record(latency);
+      this->results_.service.set.Record(service);
+    }
+    else {
+      ++this->results_.gets;
+      ++(missing ? this->results_.misses : this->results_.hits);
+      this->results_.latency.get.Record(latency);
+      this->results_.service.get.Record(service);
+    }
+  }
+
+  void Done(Command const &command, Clock::time_point const now, redisReply const *reply) {
+    this->Done(
+      command,
+      now,
+      reply == nullptr || reply->type == REDIS_REPLY_ERROR,
+      reply != nullptr && reply->type == REDIS_REPLY_NIL
+    );
+  }
+
+  void SendCmd(std::vector<std::vector<Command>> &batches) {
+    for (size_t i = 0; i < batches.size(); ++i) {
+      Connection &conn = *this->connections_[i];
+
+      for (auto &command : batches[i]) {
+        this->Sent(command, Clock::now());
+
+        cmd::Response const response = command.set ?
+          conn.Cmd("SET", command.key, command.value) :
+          conn.Cmd("GET", command.key);
+
+        this->Done(
+          command,
+          Clock::now(),
+          !response.success(),
+          response.type() == cmd::Response::Type::kNil
+        );
+      }
+    }
+  }
+
+  void SendPipeline(std::vector<std::vector<Command>> &batches) {
+    std::vector<std::unique_ptr<Pipeline>> pipelines;
+
+    // Everything goes out before anything is read, so the connections of a
+    //   thread have their batches in flight together.
+    for (size_t i = 0; i < batches.size(); ++i) {
+      pipelines.emplace_back(new Pipeline(*this->connections_[i]));
+
+      for (auto const &command : batches[i]) {
+        if (command.set) {
+          pipelines[i]->Add("SET", command.key, command.value);
+        }
+        else {
+          pipelines[i]->Add("GET", command.key);
+        }
+      }
+
+      Clock::time_point const now = Clock::now();
+
+      for (auto &command : batches[i]) {
+        this->Sent(command, now);
+      }
+
+      if (!batches[i].empty()) {
+        pipelines[i]->Write();
+      }
+    }
+
+    for (size_t i = 0; i < batches.size(); ++i) {
+      if (batches[i].empty()) {
+        continue;
+      }
+
+      std::vector<ReplyPtr> const replies = pipelines[i]->ReadRaw();
+      Clock::time_point const now = Clock::now();
+
+      for (size_t k = 0; k < batches[i].size(); ++k) {
+        this->Done(
+          batches[i][k],
+          now,
+          (k < replies.size()) ? replies[k].get() : nullptr
+        );
+      }
+    }
+  }
+
+  void SendUring(std::vector<std::vector<Command>> &batches) {
+#ifdef REDISWRAPS_WITH_IO_URING
+    for (size_t i = 0; i < batches.size(); ++i) {
+      Clock::time_point const now = Clock::now();
+
+      for (auto &command : batches[i]) {
+        this->Sent(command, now);
+
+        Command const *queued = &command;
+        auto const handler = [this, queued](ReplyPtr reply) {
+          this->Done(*queued, Clock::now(), reply.get());
+        };
+
+        if (command.set) {
+          this->driver_->Cmd(i, handler, "SET", command.key, command.value);
+        }
+        else {
+          this->driver_->Cmd(i, handler, "GET", command.key);
+        }
+      }
+    }
+
+    this->driver_->Run();
+#else
+    (void)batches;
+#endif
+  }
+
+  Options const     &options_;
+  std::string const &payload_;
+
+  std::vector<std::unique_ptr<Connection>> connections_;
+
+#ifdef REDISWRAPS_WITH_IO_URING
+  std::unique_ptr<UringDriver> driver_;
+#endif
+
+  std::mt19937_64 random_;
+  Zipf const      zipf_;
+
+  // Open loop: nanoseconds between the commands of a connection, and when
+  //   (since the start) each connection's next one is due.  0 and unused in
+  //   a closed loop.
+  double              interval_ns_ = 0.0;
+  std::vector<double> next_ns_;
+
+  Results     results_;
+  std::string error_;
+};
+
+
+void Prefill(Options const &options, std::string const &payload) {
+  std::unique_ptr<Connection> conn(Connect(options));
+  Pipeline pipe(*conn);
+
+  for (uint64_t i = 0; i < options.keys; ++i) {
+    pipe.Add(
+      "SET",
+      options.key_prefix + std::to_string(i),
+      payload.substr(0, options.max_value_size)
+    );
+
+    if (pipe.size() == 1000 || i + 1 == options.keys) {
+      pipe.ExecuteRaw();
+    }
+  }
+}
+
+
+void WriteLatencies(
+    std::ostream &out,
+    char const *name,
+    Latencies const &latencies,
+    uint64_t const correction_ns
+) {
+  LatencyHistogram get;
+  LatencyHistogram set;
+  LatencyHistogram all;
+
+  get.AddCorrected(latencies.get, correction_ns);
+  set.AddCorrected(latencies.set, correction_ns);
+  all.Add(get);
+  all.Add(set);
+
+  out << "  \"" << name << "\": {\n    \"all\": ";
+  WriteStats(out, all);
+  out << ",\n    \"get\": ";
+  WriteStats(out, get);
+  out << ",\n    \"set\": ";
+  WriteStats(out, set);
+  out << "\n  }";
+}
+
+
+void WriteJson(
+    std::ostream &out,
+    Options const &options,
+    Results const &results,
+    double const seconds
+) {
+  uint64_t const ops = results.sets + results.gets;
+  bool const open_loop = options.rate > 0.0;
+
+  // A closed loop waits for each reply before sending the next command, so
+  //   stalls hide the commands that would have been sent meanwhile.  Those
+  //   are put back, as HdrHistogram does, assuming commands were meant to go
+  //   out every median service time.  An open loop measures from when each
+  //   command was due, which accounts for them already.
+  uint64_t correction_ns = 0;
+
+  if (!open_loop) {
+    LatencyHistogram service;
+    service.Add(results.service.get);
+    service.Add(results.service.set);
+    correction_ns = service.Percentile(50.0);
+  }
+
+  out << std::fixed << std::setprecision(3);
+
+  out <<
+    "{\n"
+    "  \"config\": {"
+    "\"host\": \"" << options.host << "\", "
+    "\"port\": " << options.port << ", "
+    "\"socket\": \"" << options.socket << "\", "
+    "\"protocol\": " << options.protocol << ", "
+    "\"threads\": " << options.threads << ", "
+    "\"connections_per_thread\": " << options.connections << ", "
+    "\"api\": \"" << ApiName(options.api) << "\", "
+    "\"pipeline\": " << options.pipeline << ", "
+    "\"keys\": " << options.keys << ", "
+    "\"distribution\": \"" << (options.zipf ? "zipf" : "uniform") << "\", "
+    "\"zipf_exponent\": " << options.zipf_exponent << ", "
+    "\"value_size\": [" << options.min_value_size << ", " <<
+      options.max_value_size << "], "
+    "\"ratio\": \"" << options.set_ratio << ":" << options.get_ratio << "\", "
+    "\"rate\": " << options.rate << ", "
+    "\"duration\": " << options.duration << "},\n"
+    "  \"mode\": \"" << (open_loop ? "open-loop" : "closed-loop") << "\",\n"
+    "  \"elapsed_s\": " << seconds << ",\n"
+    "  \"ops\": " << ops << ",\n"
+    "  \"ops_per_s\": " << ops / seconds << ",\n"
+    "  \"sets\": " << results.sets << ",\n"
+    "  \"gets\": " << results.gets << ",\n"
+    "  \"hits\": " << results.hits << ",\n"
+    "  \"misses\": " << results.misses << ",\n"
+    "  \"errors\": " << results.errors << ",\n"
+    "  \"coordinated_omission\": \"" << (open_loop ?
+      "latency measured from each command's scheduled send time" :
+      "latency back-filled for an expected interval of the median service time")
+    << "\",\n"
+    "  \"correction_interval_us\": " << correction_ns / 1000.0 << ",\n";
+
+  WriteLatencies(out, "latency_us", results.latency, correction_ns);
+  out << ",\n";
+  WriteLatencies(out, "service_time_us", results.service, 0);
+  out << "\n}" << std::endl;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  Options options;
+
+  if (!Parse(argc, argv, options)) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Values are slices of one random buffer rather than generated each time.
+  std::string payload(options.max_value_size + 4096, '\0');
+  std::mt19937_64 random(options.seed);
+
+  for (auto &c : payload) {
+    c = static_cast<char>('a' + random() % 26);
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  try {
+    if (options.prefill) {
+      Prefill(options, payload);
+    }
+
+    for (size_t i = 0; i < options.threads; ++i) {
+      workers.emplace_back(new Worker(options, i, payload));
+    }
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // All threads start together, once they all exist.
+  Clock::time_point const start = Clock::now() + std::chrono::milliseconds(100);
+  Clock::time_point const end = start + std::chrono::microseconds(
+    static_cast<int64_t>(options.duration * 1e6)
+  );
+
+  std::vector<std::thread> threads;
+
+  for (auto &worker : workers) {
+    threads.emplace_back([&worker, start, end]() {
+      try {
+        worker->Run(start, end);
+      }
+      catch (std::exception const &e) {
+        worker->Fail(e.what());
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  bool failed = false;
+
+  for (size_t i = 0; i < workers.size(); ++i) {
+    if (!workers[i]->error().empty()) {
+      std::cerr << "Thread " << i << " stopped: " << workers[i]->error()
+                << std::endl;
+      failed = true;
+    }
+  }
+
+  double const seconds = std::chrono::duration_cast<std::chrono::microseconds>(
+    Clock::now() - start
+  ).count() / 1e6;
+
+  Results results;
+
+  for (auto const &worker : workers) {
+    results.Add(worker->results());
+  }
+
+  bool const written = WriteOutput(options.output, [&](std::ostream &out) {
+    WriteJson(out, options, results, seconds);
+  });
+
+  if (!written) {
+    return EXIT_FAILURE;
+  }
+
+  return (results.errors == 0 && !failed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
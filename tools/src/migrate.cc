@@ -0,0 +1,226 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include "options.hh"
+
+
+// Copies keys from one Redis server (or database) to another with a
+//   Migration:
+//
+//   rediswraps_migrate --source=HOST:PORT --destination=HOST:PORT [--option=value ...]
+//
+// Progress goes to stderr every second, and a summary to stdout at the end.
+//   Exits with 0 only if every key made it and, unless --no-verify, both
+//   sides end up with as many keys.  See Usage() for the options.
+//
+namespace {
+
+using tools::Option;
+using tools::ParseNumber;
+using tools::ParseOptions;
+
+struct Endpoint {
+  std::string host = constants::kDefaultHost;
+  int         port = constants::kDefaultPort;
+  std::string socket;
+};
+
+struct Options {
+  Endpoint source;
+  Endpoint destination;
+  bool     destination_set = false;
+
+  MigrationOptions migration;
+};
+
+
+void Usage(char const *name) {
+  std::cerr <<
+    "Usage: " << name << " --source=ADDRESS --destination=ADDRESS [--option=value ...]\n"
+    "\n"
+    "  ADDRESS is HOST:PORT or the path to a unix socket.\n"
+    "\n"
+    "  --source-db=0          --destination-db=0\n"
+    "  --threads=4            workers, each with a connection to either side\n"
+    "  --batch=256            keys per SCAN and per pipeline\n"
+    "  --match=PATTERN        only keys matching it, as in SCAN MATCH\n"
+    "  --rate=0               keys per second in all; 0 for no limit\n"
+    "  --no-replace           fail keys the destination has rather than\n"
+    "                         overwrite them\n"
+    "  --no-verify            don't compare key counts at the end\n";
+}
+
+
+bool const ParseEndpoint(std::string const &text, Endpoint &out) {
+  size_t const colon = text.rfind(':');
+
+  if (colon == std::string::npos) {
+    out.socket = text;
+    return !text.empty();
+  }
+
+  out.host = text.substr(0, colon);
+  return !out.host.empty() && ParseNumber(text.substr(colon + 1), out.port);
+}
+
+
+bool const Parse(int const argc, char const *argv[], Options &options) {
+  bool source_set = false;
+
+  bool const parsed = ParseOptions(argc, argv, [&](
+      std::string const &name,
+      std::string const &value
+  ) -> Option {
+    MigrationOptions &migration = options.migration;
+    bool valid = true;
+
+    if (name == "source") {
+      valid = source_set = ParseEndpoint(value, options.source);
+    }
+    else if (name == "destination") {
+      valid = options.destination_set =
+        ParseEndpoint(value, options.destination);
+    }
+    else if (name == "source-db") {
+      valid = ParseNumber(value, migration.source_db) && migration.source_db >= 0;
+    }
+    else if (name == "destination-db") {
+      valid = ParseNumber(value, migration.destination_db) &&
+        migration.destination_db >= 0;
+    }
+    else if (name == "threads") {
+      valid = ParseNumber(value, migration.threads) && migration.threads > 0;
+    }
+    else if (name == "batch") {
+      valid = ParseNumber(value, migration.batch) && migration.batch > 0;
+    }
+    else if (name == "match") {
+      migration.match = value;
+    }
+    else if (name == "rate") {
+      valid = ParseNumber(value, migration.keys_per_second) &&
+        migration.keys_per_second >= 0.0;
+    }
+    else if (name == "no-replace") {
+      migration.replace = false;
+    }
+    else if (name == "no-verify") {
+      migration.verify = false;
+    }
+    else {
+      return Option::kUnknown;
+    }
+
+    return valid ? Option::kValid : Option::kInvalid;
+  });
+
+  if (!parsed) {
+    return false;
+  }
+
+  if (!source_set || !options.destination_set) {
+    std::cerr << "Both --source and --destination are required." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+Ptr Open(Endpoint const &endpoint) {
+  if (!endpoint.socket.empty()) {
+    return Ptr(new Connection(endpoint.socket, "migrate"));
+  }
+
+  return Ptr(new Connection(endpoint.host, endpoint.port, "migrate"));
+}
+
+
+void Print(std::ostream &os, MigrationStats const &stats) {
+  os << "scanned "   << stats.scanned
+     << " migrated " << stats.migrated
+     << " vanished " << stats.vanished
+     << " failed "   << stats.failed
+     << " bytes "    << stats.bytes;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  Options options;
+
+  if (!Parse(argc, argv, options)) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Ptr source;
+  Ptr destination;
+
+  try {
+    source      = Open(options.source);
+    destination = Open(options.destination);
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Migration migration(*source, *destination, options.migration);
+
+  std::atomic<bool> done(false);
+
+  std::thread progress([&]() {
+    auto const start = std::chrono::steady_clock::now();
+    auto next = start;
+
+    while (!done) {
+      next += std::chrono::seconds(1);
+
+      while (!done && std::chrono::steady_clock::now() < next) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+
+      if (done) {
+        break;
+      }
+
+      MigrationStats const stats = migration.stats();
+      double const seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+      ).count();
+
+      std::cerr << static_cast<int>(seconds) << "s: ";
+      Print(std::cerr, stats);
+      std::cerr << " (" << static_cast<uint64_t>(stats.migrated / seconds)
+        << " keys/s)" << std::endl;
+    }
+  });
+
+  bool const ok = migration.Run();
+
+  done = true;
+  progress.join();
+
+  MigrationStats const stats = migration.stats();
+
+  Print(std::cout, stats);
+  std::cout << " seconds " << stats.elapsed.count() / 1000.0;
+
+  if (options.migration.verify) {
+    std::cout << " source_keys " << stats.source_keys
+      << " destination_keys " << stats.destination_keys;
+  }
+
+  std::cout << std::endl;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rediswraps/rediswraps.hh>
+using namespace rediswraps;
+
+#include "options.hh"
+
+
+// Plays a command log written by CommandRecorder back against a server:
+//
+//   rediswraps_replay --log=PATH [--option=value ...]
+//
+// Each recorded connection's commands go to one replay connection, in
+//   order; with fewer --connections than were recorded, several share one.
+//   Every connection has a thread of its own and sends its commands either
+//   as fast as replies come back or when they were due at the recorded
+//   pace, in pipelines of up to --pipeline commands.  Results, latency
+//   percentiles per command included, are printed as JSON.  See Usage() for
+//   the options.
+//
+namespace {
+
+using tools::Option;
+using tools::ParseNumber;
+using tools::ParseOptions;
+using tools::WriteOutput;
+using tools::WriteStats;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string log;
+
+  std::string host     = constants::kDefaultHost;
+  int         port     = constants::kDefaultPort;
+  std::string socket;
+  int         protocol = constants::kDefaultProtocol;
+
+  size_t connections = 0;  // 0 for one per recorded connection
+  size_t pipeline    = 1;  // commands in flight per connection
+
+  bool   recorded_pace = false;
+  double speed         = 1.0;  // of the recorded pace
+  size_t loops         = 1;
+
+  std::string output;  // JSON goes to stdout if empty
+};
+
+
+void Usage(char const *name) {
+  std::cerr <<
+    "Usage: " << name << " --log=PATH [--option=value ...]\n"
+    "\n"
+    "  --log=PATH             written by CommandRecorder\n"
+    "  --host=127.0.0.1       --port=6379           --socket=PATH\n"
+    "  --protocol=2           or 3 for RESP3\n"
+    "  --connections=0        0 for one per recorded connection\n"
+    "  --pipeline=1           commands in flight per connection\n"
+    "  --pacing=max|recorded  as fast as possible, or as they were sent\n"
+    "  --speed=1              of the recorded pace, e.g. 2 for twice as fast\n"
+    "  --loops=1              times through the log\n"
+    "  --output=PATH          JSON results (default: stdout)\n";
+}
+
+
+bool const Parse(int const argc, char const *argv[], Options &options) {
+  bool const parsed = ParseOptions(argc, argv, [&](
+      std::string const &name,
+      std::string const &value
+  ) -> Option {
+    bool valid = true;
+
+    if (name == "log") {
+      options.log = value;
+    }
+    else if (name == "host") {
+      options.host = value;
+    }
+    else if (name == "port") {
+      valid = ParseNumber(value, options.port);
+    }
+    else if (name == "socket") {
+      options.socket = value;
+    }
+    else if (name == "protocol") {
+      valid = ParseNumber(value, options.protocol) &&
+        (options.protocol == 2 || options.protocol == 3);
+    }
+    else if (name == "connections") {
+      valid = ParseNumber(value, options.connections);
+    }
+    else if (name == "pipeline") {
+      valid = ParseNumber(value, options.pipeline) && options.pipeline > 0;
+    }
+    else if (name == "pacing") {
+      options.recorded_pace = (value == "recorded");
+      valid = options.recorded_pace || value == "max";
+    }
+    else if (name == "speed") {
+      valid = ParseNumber(value, options.speed) && options.speed > 0.0;
+    }
+    else if (name == "loops") {
+      valid = ParseNumber(value, options.loops) && options.loops > 0;
+    }
+    else if (name == "output") {
+      options.output = value;
+    }
+    else {
+      return Option::kUnknown;
+    }
+
+    return valid ? Option::kValid : Option::kInvalid;
+  });
+
+  if (!parsed) {
+    return false;
+  }
+
+  if (options.log.empty()) {
+    std::cerr << "--log is required." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+// Latencies of every command, and of each command by name.
+struct Latencies {
+  LatencyHistogram all;
+  std::map<std::string, LatencyHistogram> by_command;
+
+  void Record(std::string const &command, uint64_t const ns) {
+    this->all.Record(ns);
+    this->by_command[command].Record(ns);
+  }
+
+  void Add(Latencies const &other) {
+    this->all.Add(other.all);
+
+    for (auto const &command : other.by_command) {
+      this->by_command[command.first].Add(command.second);
+    }
+  }
+};
+
+struct Results {
+  uint64_t commands      = 0;
+  uint64_t errors        = 0;  // no reply: the connection broke
+  uint64_t error_replies = 0;  // e.g. WRONGTYPE, which the recording may have had too
+
+  // From when each command was due (recorded pacing), or sent.
+  Latencies latency;
+
+  // From when each command was actually sent.
+  Latencies service;
+
+  void Add(Results const &other) {
+    this->commands      += other.commands;
+    this->errors        += other.errors;
+    this->error_replies += other.error_replies;
+
+    this->latency.Add(other.latency);
+    this->service.Add(other.service);
+  }
+};
+
+
+std::string const CommandName(std::string const &command) {
+  std::string name(command);
+  std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+
+  return name;
+}
+
+
+// Worker
+// One connection's share of the log, replayed on a thread of its own.
+//
+class Worker {
+ public:
+  Worker(
+      Options const &options,
+      std::vector<RecordedCommand const*> commands,
+      std::chrono::nanoseconds const span
+  )
+    : options_(options),
+      commands_(std::move(commands)),
+      span_(span),
+      conn_(options.socket.empty() ?
+        new Connection(options.host, options.port, "replay", options.protocol) :
+        new Connection(options.socket, "replay", options.protocol))
+  {
+    for (auto const *command : this->commands_) {
+      this->names_.push_back(CommandName(command->argv[0]));
+    }
+  }
+
+  void Run(Clock::time_point const start) {
+    Pipeline pipe(*this->conn_);
+
+    std::vector<Clock::time_point> due(this->options_.pipeline);
+    size_t const count = this->commands_.size();
+
+    for (size_t loop = 0; loop < this->options_.loops; ++loop) {
+      for (size_t next = 0; next < count; ) {
+        size_t const first = next;
+
+        if (this->options_.recorded_pace) {
+          std::this_thread::sleep_until(this->Due(start, loop, first));
+        }
+
+        Clock::time_point const now = Clock::now();
+
+        // Whatever else is due already goes out along with it.
+        while (
+            next < count &&
+            next - first < this->options_.pipeline && (
+              !this->options_.recorded_pace ||
+              (due[next - first] = this->Due(start, loop, next)) <= now
+            )
+        ) {
+          pipe.AddArgv(this->commands_[next]->argv);
+          ++next;
+        }
+
+        Clock::time_point const sent_at = Clock::now();
+        std::vector<ReplyPtr> replies;
+
+        try {
+          pipe.Write();
+          replies = pipe.ReadRaw();
+        }
+        catch (std::exception const&) {
+          // Reconnecting failed; the next batch tries again.
+          pipe.Clear();
+          replies.resize(next - first);
+        }
+
+        Clock::time_point const replied_at = Clock::now();
+
+        for (size_t i = 0; i < replies.size(); ++i) {
+          std::string const &name = this->names_[first + i];
+
+          ++this->results_.commands;
+
+          if (!replies[i]) {
+            ++this->results_.errors;
+          }
+          else if (replies[i]->type == REDIS_REPLY_ERROR) {
+            ++this->results_.error_replies;
+          }
+
+          Clock::time_point const from =
+            this->options_.recorded_pace ? due[i] : sent_at;
+
+          this->results_.latency.Record(name, Nanoseconds(replied_at - from));
+          this->results_.service.Record(name, Nanoseconds(replied_at - sent_at));
+        }
+      }
+    }
+  }
+
+  Results const& results() const noexcept {
+    return this->results_;
+  }
+
+ private:
+  static uint64_t const Nanoseconds(Clock::duration const duration) {
+    return std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+      0
+    );
+  }
+
+  // When the command was due, the log playing back to back "loop" times.
+  Clock::time_point const Due(
+      Clock::time_point const start,
+      size_t const loop,
+      size_t const index
+  ) const {
+    double const at = static_cast<double>(
+      (this->commands_[index]->at + this->span_ * loop).count()
+    );
+
+    return start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::nanoseconds(static_cast<int64_t>(at / this->options_.speed))
+    );
+  }
+
+  Options const &options_;
+
+  std::vector<RecordedCommand const*> commands_;
+  std::vector<std::string>            names_;
+  std::chrono::nanoseconds const      span_;
+
+  Ptr     conn_;
+  Results results_;
+};
+
+
+void WriteLatencies(
+    std::ostream &out,
+    char const *name,
+    Latencies const &latencies
+) {
+  out << "  \"" << name << "\": {\n    \"all\": ";
+  WriteStats(out, latencies.all);
+
+  for (auto const &command : latencies.by_command) {
+    out << ",\n    \"" << command.first << "\": ";
+    WriteStats(out, command.second);
+  }
+
+  out << "\n  }";
+}
+
+
+void WriteJson(
+    std::ostream &out,
+    Options const &options,
+    size_t const connections,
+    Results const &results,
+    double const seconds
+) {
+  out << std::fixed << std::setprecision(3);
+
+  out <<
+    "{\n"
+    "  \"config\": {"
+    "\"log\": \"" << options.log << "\", "
+    "\"host\": \"" << options.host << "\", "
+    "\"port\": " << options.port << ", "
+    "\"socket\": \"" << options.socket << "\", "
+    "\"protocol\": " << options.protocol << ", "
+    "\"connections\": " << connections << ", "
+    "\"pipeline\": " << options.pipeline << ", "
+    "\"pacing\": \"" << (options.recorded_pace ? "recorded" : "max") << "\", "
+    "\"speed\": " << options.speed << ", "
+    "\"loops\": " << options.loops << "},\n"
+    "  \"elapsed_s\": " << seconds << ",\n"
+    "  \"commands\": " << results.commands << ",\n"
+    "  \"commands_per_s\": " << results.commands / seconds << ",\n"
+    "  \"errors\": " << results.errors << ",\n"
+    "  \"error_replies\": " << results.error_replies << ",\n";
+
+  WriteLatencies(out, "latency_us", results.latency);
+  out << ",\n";
+  WriteLatencies(out, "service_time_us", results.service);
+  out << "\n}" << std::endl;
+}
+
+} // namespace
+
+
+int main(int const argc, char const *argv[]) {
+  Options options;
+
+  if (!Parse(argc, argv, options)) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // The whole log is read up front, so that reading it costs no time
+  //   during the replay.
+  std::vector<RecordedCommand> commands;
+  uint64_t streams = 0;
+
+  try {
+    CommandLog log(options.log);
+    RecordedCommand command;
+
+    while (log.Next(command)) {
+      streams = std::max(streams, command.stream + 1);
+      commands.push_back(std::move(command));
+    }
+
+    if (!log.error().empty()) {
+      std::cerr << log.error() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (commands.empty()) {
+    std::cerr << options.log << " holds no commands." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t const connections =
+    (options.connections > 0) ? options.connections : streams;
+
+  std::vector<std::vector<RecordedCommand const*>> shares(connections);
+
+  for (auto const &command : commands) {
+    shares[command.stream % connections].push_back(&command);
+  }
+
+  // Loops follow each other a mean gap after the last command.
+  std::chrono::nanoseconds const span =
+    commands.back().at + commands.back().at / commands.size();
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  try {
+    for (auto &share : shares) {
+      if (!share.empty()) {
+        workers.emplace_back(new Worker(options, std::move(share), span));
+      }
+    }
+  }
+  catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // All threads start together, once they all exist.
+  Clock::time_point const start = Clock::now() + std::chrono::milliseconds(100);
+
+  std::vector<std::thread> threads;
+
+  for (auto &worker : workers) {
+    threads.emplace_back([&worker, start]() {
+      std::this_thread::sleep_until(start);
+      worker->Run(start);
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  double const seconds = std::chrono::duration_cast<std::chrono::microseconds>(
+    Clock::now() - start
+  ).count() / 1e6;
+
+  Results results;
+
+  for (auto const &worker : workers) {
+    results.Add(worker->results());
+  }
+
+  bool const written = WriteOutput(options.output, [&](std::ostream &out) {
+    WriteJson(out, options, workers.size(), results, seconds);
+  });
+
+  if (!written) {
+    return EXIT_FAILURE;
+  }
+
+  return (results.errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}